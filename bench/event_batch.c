@@ -0,0 +1,225 @@
+/*  @file   event_batch.c
+ *  @brief  イベントのバッチ送信の性能測定.
+ *
+ *  送信スレッドから受信スレッドの状態マシンにイベントを送り,
+ *  バッチの閾値ごとのスループット (events/s) と
+ *  送信から発生までの遅延の 99 パーセンタイルを測定する.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+
+#include "hfsm.h"
+
+/*
+ *  1 回の測定で送信するイベントの数.
+ */
+#define EVENT_COUNT (1 << 20)
+
+/*
+ *  受信箱に保持できるバッチの数.
+ */
+#define INBOX_CAPACITY (1024)
+
+/*
+ *  送信期限 (マイクロ秒).
+ */
+#define BATCH_TIMEOUT_US (50)
+
+/*
+ *  測定情報構造体.
+ */
+struct bench {
+    size_t threshold;            /* バッチの閾値. */
+    struct fsm_inbox *inbox;     /* 受信箱. */
+    struct fsm_event *events;    /* 送信するイベント. */
+    uint64_t *posted;            /* イベントごとの送信時刻. */
+    uint64_t *latencies;         /* イベントごとの遅延. */
+    atomic_bool ready;           /* 受信スレッドの準備完了. */
+};
+
+/*
+ *  待機状態.
+ */
+FSM_STATE(state_idle, NULL, NULL, NULL, NULL);
+
+/*
+ *  単調増加する現在時刻を取得する.
+ *
+ *  @return 現在時刻 (ナノ秒) が返る.
+ */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ *  遅延の比較関数.
+ */
+static int compare_latency(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ *  送信スレッド.
+ *
+ *  @param  [in,out]    arg 測定情報.
+ *  @return NULL が返る.
+ */
+static void *producer(void *arg)
+{
+    struct bench *bench = arg;
+    struct fsm_batcher *batcher;
+
+    batcher = fsm_batcher_init(bench->threshold, BATCH_TIMEOUT_US);
+    if (batcher == NULL) {
+        perror("fsm_batcher_init");
+        exit(EXIT_FAILURE);
+    }
+    while (!atomic_load(&bench->ready)) {
+        /* 受信スレッドの準備を待つ. */
+        sched_yield();
+    }
+
+    for (size_t i = 0; i < EVENT_COUNT; ++i) {
+        bench->posted[i] = now_ns();
+        while (fsm_batcher_post(batcher, bench->inbox, &bench->events[i]) != 0) {
+            fsm_batcher_poll(batcher);
+            sched_yield();
+        }
+    }
+    while (fsm_batcher_flush(batcher) != 0) {
+        /* 受信箱が空くのを待つ. */
+        sched_yield();
+    }
+
+    fsm_batcher_release(batcher);
+
+    return NULL;
+}
+
+/*
+ *  受信スレッド.
+ *
+ *  @param  [in,out]    arg 測定情報.
+ *  @return NULL が返る.
+ */
+static void *consumer(void *arg)
+{
+    struct bench *bench = arg;
+    const struct fsm_rels rels[] = {
+        FSM_RELS_TERMINATOR
+    };
+    const struct fsm_trans corresps[] = {
+        FSM_TRANS_HELPER(state_start, event_null, NULL, NULL, state_idle),
+        FSM_TRANS_TERMINATOR
+    };
+    struct fsm *machine = fsm_init(rels, corresps);
+    struct fsm_batch batch;
+    size_t received = 0;
+
+    if (machine == NULL) {
+        perror("fsm_init");
+        exit(EXIT_FAILURE);
+    }
+    atomic_store(&bench->ready, true);
+
+    while (received < EVENT_COUNT) {
+        if (fsm_inbox_pop(bench->inbox, &batch) != 0) {
+            sched_yield();
+            continue;
+        }
+        fsm_dispatch_batch(machine, &batch);
+
+        uint64_t now = now_ns();
+        for (size_t i = 0; i < batch.count; ++i) {
+            size_t index = (size_t)(batch.events[i] - bench->events);
+            bench->latencies[index] = now - bench->posted[index];
+        }
+        received += batch.count;
+    }
+
+    fsm_term(machine);
+
+    return NULL;
+}
+
+/*
+ *  指定の閾値で測定する.
+ *
+ *  @param  [in]    threshold   バッチの閾値.
+ */
+static void run(size_t threshold)
+{
+    struct bench bench = {
+        .threshold = threshold,
+        .inbox = fsm_inbox_init(INBOX_CAPACITY),
+        .events = calloc(EVENT_COUNT, sizeof(struct fsm_event)),
+        .posted = calloc(EVENT_COUNT, sizeof(uint64_t)),
+        .latencies = calloc(EVENT_COUNT, sizeof(uint64_t)),
+        .ready = false
+    };
+    pthread_t prod, cons;
+    uint64_t begin, end;
+
+    if ((bench.inbox == NULL) || (bench.events == NULL)
+        || (bench.posted == NULL) || (bench.latencies == NULL)) {
+        perror("run");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < EVENT_COUNT; ++i) {
+        bench.events[i] = FSM_EVENT_INITIALIZER("event_bench");
+    }
+
+    begin = now_ns();
+    if ((errno = pthread_create(&cons, NULL, consumer, &bench)) != 0) {
+        perror("pthread_create");
+        exit(EXIT_FAILURE);
+    }
+    if ((errno = pthread_create(&prod, NULL, producer, &bench)) != 0) {
+        perror("pthread_create");
+        exit(EXIT_FAILURE);
+    }
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+    end = now_ns();
+
+    qsort(bench.latencies, EVENT_COUNT, sizeof(uint64_t), compare_latency);
+    printf("%9zu %14.0f %12.1f %12.1f\n",
+           threshold,
+           (double)EVENT_COUNT * 1e9 / (double)(end - begin),
+           (double)bench.latencies[EVENT_COUNT / 2] / 1000.0,
+           (double)bench.latencies[(EVENT_COUNT * 99) / 100] / 1000.0);
+
+    free(bench.latencies);
+    free(bench.posted);
+    free(bench.events);
+    fsm_inbox_release(bench.inbox);
+}
+
+/*
+ *  バッチの閾値を 1 から @ref FSM_BATCH_MAX まで変えて測定する.
+ */
+int main(int argc, char **argv)
+{
+    printf("%9s %14s %12s %12s\n", "threshold", "events/s", "p50 (us)", "p99 (us)");
+    for (size_t threshold = 1; threshold <= FSM_BATCH_MAX; threshold *= 2) {
+        run(threshold);
+    }
+
+    return 0;
+}
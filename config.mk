@@ -8,6 +8,9 @@ VERSION = $(MAJOR_VERSION).$(MINOR_VERSION).$(REVISION)
 
 NODEBUG = 0
 
+## Sanitizer to instrument with (e.g. thread, address). Empty to disable.
+SANITIZE ?=
+
 ## Header direcotyr of Catch2 test framework.
 CATCH2_DIR ?=
 
@@ -0,0 +1,151 @@
+/** @file   allocator.h
+ *  @brief  メモリ割り当てに関する機能を提供する.
+ *
+ *  コレクションおよび状態マシンが使用するメモリの割り当てを差し替える
+ *  ためのインタフェースと, その実装 (システム, スラブ, 割り当てなし,
+ *  計数) を提供する.
+ *  ライブラリ内のメモリの確保はすべてこのインタフェースを経由し,
+ *  個別に指定しない場合は @ref allocator_set_default で設定した
+ *  既定のメモリ割り当てを使用する.
+ *
+ *  @date   2026-10-16 新規作成.
+ *  @copyright  Copyright (c) 2018 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __HFSM_ALLOCATOR_H__
+#define __HFSM_ALLOCATOR_H__
+
+#include <stddef.h>
+
+/** @defgroup cat_allocator Allocator
+ *  メモリ割り当てを提供するモジュール.
+ *  @{
+ */
+
+/**
+ *  メモリ割り当て構造体.
+ *
+ *  @c alloc は @c bytes バイトの領域を確保し, 失敗時は NULL を返して
+ *  errno を設定する. @c align が 0 の場合は malloc と同じ整列とし,
+ *  0 以外の場合は 2 のべき乗で, @c bytes はその倍数とする.
+ *  @c free には確保時と同じ @c bytes が渡される.
+ */
+struct allocator {
+    void *(*alloc)(void *ctx, size_t bytes, size_t align); /**< 確保関数. */
+    void (*free)(void *ctx, void *ptr, size_t bytes);      /**< 解放関数. */
+    void *ctx;                                             /**< 関数に渡す文脈. */
+};
+
+/**
+ *  メモリ割り当て構造体の設定ヘルパ.
+ */
+#define ALLOCATOR_HELPER(a, f, c) \
+    {                             \
+        .alloc = (a),             \
+        .free = (f),              \
+        .ctx = (c)                \
+    }
+
+/**
+ *  メモリ割り当ての統計情報構造体.
+ */
+struct allocator_stats {
+    size_t allocs;       /**< 確保に成功した回数. */
+    size_t frees;        /**< 解放した回数. */
+    size_t failures;     /**< 確保に失敗した回数. */
+    size_t bytes_in_use; /**< 使用中のバイト数. */
+    size_t peak_bytes;   /**< 使用中のバイト数の最大値. */
+};
+
+/**
+ *  メモリ割り当ての統計情報構造体の初期化子.
+ */
+#define ALLOCATOR_STATS_INITIALIZER \
+    (struct allocator_stats){       \
+        .allocs = 0,                \
+        .frees = 0,                 \
+        .failures = 0,              \
+        .bytes_in_use = 0,          \
+        .peak_bytes = 0             \
+    }
+
+/**
+ *  システム (malloc/free) によるメモリ割り当て.
+ */
+extern const struct allocator allocator_system;
+
+/**
+ *  サイズクラス別のスラブによるメモリ割り当て.
+ *
+ *  4096 バイト以下の要求は 2 のべき乗のサイズクラスに丸め, 64 KiB の
+ *  スラブから切り出す. スレッドごとのマガジン (キャッシュ) から
+ *  ロックなしで確保および解放し, マガジンが空または満杯の場合のみ
+ *  サイズクラスごとのロックを取得する.
+ *  スラブはシステムに返却しないため, @ref slab_reserve で事前に
+ *  確保しておけば, 以降の確保および解放の時間は一定となる.
+ *  4096 バイトを超える要求は @ref allocator_system に委譲する.
+ */
+extern const struct allocator allocator_slab;
+
+/**
+ *  常に失敗する (errno を ENOMEM とする) メモリ割り当て.
+ *
+ *  既定に設定すると, 以降のライブラリ内のメモリの確保はすべて失敗する.
+ *  実時間処理の開始後に意図しない確保がないことの検証に使用する.
+ */
+extern const struct allocator allocator_none;
+
+/**
+ *  既定のメモリ割り当てを設定する.
+ */
+void allocator_set_default(const struct allocator *allocator);
+
+/**
+ *  既定のメモリ割り当てを取得する.
+ */
+const struct allocator *allocator_get_default(void);
+
+/**
+ *  指定の割り当てで領域を確保する.
+ */
+void *allocator_alloc(const struct allocator *allocator, size_t bytes, size_t align);
+
+/**
+ *  指定の割り当てで 0 初期化した領域を確保する.
+ */
+void *allocator_zalloc(const struct allocator *allocator, size_t bytes, size_t align);
+
+/**
+ *  指定の割り当てで確保した領域を解放する.
+ */
+void allocator_free(const struct allocator *allocator, void *ptr, size_t bytes);
+
+/**
+ *  確保と解放を計数するメモリ割り当てを生成する.
+ */
+const struct allocator *allocator_counter_init(const struct allocator *backing);
+
+/**
+ *  計数するメモリ割り当てを破棄する.
+ */
+void allocator_counter_release(const struct allocator *counter);
+
+/**
+ *  計数するメモリ割り当ての統計情報を取得する.
+ */
+int allocator_counter_get_stats(const struct allocator *counter, struct allocator_stats *stats);
+
+/**
+ *  スラブに指定のサイズの要素を事前に確保する.
+ */
+int slab_reserve(size_t bytes, size_t count);
+
+/**
+ *  呼び出したスレッドのマガジンをスラブに返却する.
+ */
+void slab_flush(void);
+
+/** @} */
+
+#endif /* __HFSM_ALLOCATOR_H__ */
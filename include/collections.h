@@ -1,7 +1,8 @@
 /** @file   collections.h
  *  @brief  コレクションに関する機能を提供する.
  *
- *  コレクション (リスト, スタック, キュー, ツリー) を提供する.
+ *  コレクション (リスト, スタック, キュー, セット, マップ, 優先度付きキュー,
+ *  ビットセット, ツリー) を提供する.
  *
  *  @author t-kenji <protect.2501@gmail.com>
  *  @date   2018-03-18 新規作成.
@@ -12,8 +13,12 @@
 #ifndef __HFSM_COLLECTIONS_H__
 #define __HFSM_COLLECTIONS_H__
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <unistd.h>
 
+#include "allocator.h"
+
 /** @defgroup cat_collections Collections
  *  汎用コレクションを提供するモジュール.
  */
@@ -33,6 +38,48 @@ ITER iter_next(ITER iter);
  */
 void *iter_get_payload(ITER iter);
 
+/**
+ *  コレクションの属性構造体.
+ */
+struct collection_attr {
+    bool growable;       /**< 容量の不足時に拡張するか. */
+    size_t max_capacity; /**< 拡張できる最大の容量. 0 の場合は無制限. */
+    bool indexed;        /**< 位置による操作を O(log n) で行うか. (リストのみ) */
+    bool compact;        /**< リンクを 32 ビットの番号とし, データ部と分離して
+                              配置するか. 拡張不可の場合のみ有効. (ツリーのみ) */
+    const struct allocator *allocator; /**< メモリ割り当て.
+                                            NULL の場合は初期化時点の
+                                            @ref allocator_get_default. */
+};
+
+/**
+ *  コレクションの属性構造体の設定ヘルパ.
+ */
+#define COLLECTION_ATTR_HELPER(g, m) \
+    {                                \
+        .growable = (g),             \
+        .max_capacity = (m)          \
+    }
+
+/**
+ *  位置による操作を O(log n) で行うリスト向けの, コレクションの属性構造体の
+ *  設定ヘルパ.
+ */
+#define COLLECTION_ATTR_INDEXED_HELPER(g, m) \
+    {                                        \
+        .growable = (g),                     \
+        .max_capacity = (m),                 \
+        .indexed = true                      \
+    }
+
+/**
+ *  コレクションの属性構造体の初期化子.
+ *
+ *  拡張しない (初期容量で固定する) 属性となる.
+ */
+#define COLLECTION_ATTR_INITIALIZER \
+    (struct collection_attr)COLLECTION_ATTR_HELPER(false, 0)
+
 /** @addtogroup cat_list List 構造
  *  List 構造を提供するモジュール.
  *  @ingroup cat_collections
@@ -64,6 +111,20 @@ typedef struct {} *LIST;
  */
 LIST list_init(size_t payload_bytes, size_t capacity);
 
+/**
+ *  属性を指定してリストオブジェクトを初期化する.
+ *
+ *  @par    使用例
+ *          @code
+ *          struct collection_attr attr = COLLECTION_ATTR_INITIALIZER;
+ *          attr.growable = true;
+ *          LIST list = list_init_attr(sizeof(int), 16, &attr);
+ *          @endcode
+ */
+LIST list_init_attr(size_t payload_bytes,
+                    size_t capacity,
+                    const struct collection_attr *attr);
+
 /**
  *  リストオブジェクトを解放する.
  */
@@ -84,11 +145,21 @@ void *list_add(LIST list, void *payload);
  */
 void *list_insert(LIST list, int index, void *payload);
 
+/**
+ *  データ部が未初期化の要素をリストの指定位置に追加する.
+ */
+void *list_insert_slot(LIST list, int index);
+
 /**
  *  要素をリストから削除する.
  */
 int list_remove(LIST list, ITER iter);
 
+/**
+ *  リストの指定位置の要素を取得する.
+ */
+void *list_get(LIST list, size_t index);
+
 /**
  *  リストのデータ部のサイズを取得する.
  */
@@ -109,6 +180,20 @@ ITER list_iter(LIST list);
  */
 int list_to_array(LIST list, void **array, size_t *count);
 
+/**
+ *  配列からリストオブジェクトを構築する.
+ *
+ *  @par    使用例
+ *          @code
+ *          const int data[] = {1, 2, 3};
+ *          LIST list = list_from_array(sizeof(int), data, 3, NULL);
+ *          @endcode
+ */
+LIST list_from_array(size_t payload_bytes,
+                     const void *array,
+                     size_t count,
+                     const struct collection_attr *attr);
+
 /** @} */
 
 /** @addtogroup cat_stack Stack 構造
@@ -142,6 +227,23 @@ typedef struct {} *STACK;
  */
 STACK stack_init(size_t payload_bytes, size_t capacity);
 
+/**
+ *  属性を指定してスタックオブジェクトを初期化する.
+ */
+STACK stack_init_attr(size_t payload_bytes,
+                      size_t capacity,
+                      const struct collection_attr *attr);
+
+/**
+ *  呼び出し側の領域にスタックを配置するために必要なサイズを取得する.
+ */
+ssize_t stack_required_size(size_t payload_bytes, size_t capacity);
+
+/**
+ *  呼び出し側の領域にスタックオブジェクトを配置して初期化する.
+ */
+STACK stack_init_in(void *buffer, size_t size, size_t payload_bytes, size_t capacity);
+
 /**
  *  スタックオブジェクトを解放する.
  */
@@ -157,11 +259,21 @@ int stack_clear(STACK stack);
  */
 void *stack_push(STACK stack, void *payload);
 
+/**
+ *  データ部が未初期化の要素をスタックに積む.
+ */
+void *stack_push_slot(STACK stack);
+
 /**
  *  スタックから要素を取り出す.
  */
 int stack_pop(STACK stack, void *payload);
 
+/**
+ *  スタックから要素を取り出し, そのデータ部を取得する.
+ */
+void *stack_pop_slot(STACK stack);
+
 /**
  *  スタックの深さを取得する.
  */
@@ -185,6 +297,17 @@ ITER stack_iter(STACK stack);
  */
 typedef struct {} *QUEUE;
 
+/**
+ *  キュー上で連続して配置された要素の領域.
+ *
+ *  要素はスロットの先頭に管理情報を持つため, @c stride 間隔で配置される.
+ */
+struct queue_span {
+    void *base;    /**< 最初の要素のデータ部. */
+    size_t count;  /**< 要素の数. */
+    size_t stride; /**< 要素の間隔 (バイト). */
+};
+
 /**
  *  キューオブジェクトを初期化する.
  *
@@ -205,6 +328,23 @@ typedef struct {} *QUEUE;
  */
 QUEUE queue_init(size_t payload_bytes, size_t capacity);
 
+/**
+ *  属性を指定してキューオブジェクトを初期化する.
+ */
+QUEUE queue_init_attr(size_t payload_bytes,
+                      size_t capacity,
+                      const struct collection_attr *attr);
+
+/**
+ *  呼び出し側の領域にキューを配置するために必要なサイズを取得する.
+ */
+ssize_t queue_required_size(size_t payload_bytes, size_t capacity);
+
+/**
+ *  呼び出し側の領域にキューオブジェクトを配置して初期化する.
+ */
+QUEUE queue_init_in(void *buffer, size_t size, size_t payload_bytes, size_t capacity);
+
 /**
  *  キューオブジェクトを解放する.
  */
@@ -220,11 +360,21 @@ int queue_clear(QUEUE que);
  */
 void *queue_enq(QUEUE que, void *payload);
 
+/**
+ *  データ部が未初期化の要素をキューに追加する.
+ */
+void *queue_enq_slot(QUEUE que);
+
 /**
  *  キューから要素を取り出す.
  */
 int queue_deq(QUEUE que, void *payload);
 
+/**
+ *  キューから要素を取り出し, そのデータ部を取得する.
+ */
+void *queue_deq_slot(QUEUE que);
+
 /**
  *  キューの長さを取得する.
  */
@@ -240,6 +390,122 @@ ITER queue_iter(QUEUE que);
  */
 int queue_to_array(QUEUE que, void **array, size_t *count);
 
+/**
+ *  キューの先頭から連続して配置された要素の領域を取得する.
+ */
+ssize_t queue_peek_spans(QUEUE que, struct queue_span spans[2]);
+
+/**
+ *  キューの先頭から指定の数の要素を取り除く.
+ */
+int queue_consume(QUEUE que, size_t count);
+
+/** @} */
+
+/** @addtogroup cat_cqueue Concurrent Queue 構造
+ *  スレッドセーフな Queue 構造を提供するモジュール.
+ *  複数の生産者, 複数の消費者から同時に操作できる, 有界のロックフリーキュー.
+ *  @ingroup cat_collections
+ *  @{
+ */
+
+/**
+ *  スレッドセーフなキュー型.
+ */
+typedef struct {} *CQUEUE;
+
+/**
+ *  スレッドセーフなキューオブジェクトを初期化する.
+ *
+ *  @par    使用例
+ *          @code
+ *          CQUEUE que = cqueue_init(sizeof(int), 128);
+ *          int data = 1;
+ *          // producer thread.
+ *          cqueue_enq(que, &data);
+ *          // consumer thread.
+ *          if (cqueue_deq(que, &data) == 0) {
+ *              // do something.
+ *          }
+ *          cqueue_release(que);
+ *          @endcode
+ */
+CQUEUE cqueue_init(size_t payload_bytes, size_t capacity);
+
+/**
+ *  属性を指定してスレッドセーフなキューオブジェクトを初期化する.
+ */
+CQUEUE cqueue_init_attr(size_t payload_bytes,
+                        size_t capacity,
+                        const struct collection_attr *attr);
+
+/**
+ *  スレッドセーフなキューオブジェクトを解放する.
+ */
+void cqueue_release(CQUEUE que);
+
+/**
+ *  要素をスレッドセーフなキューに積める.
+ */
+int cqueue_enq(CQUEUE que, const void *payload);
+
+/**
+ *  スレッドセーフなキューから要素を取り出す.
+ */
+int cqueue_deq(CQUEUE que, void *payload);
+
+/**
+ *  スレッドセーフなキューの長さを取得する.
+ */
+ssize_t cqueue_count(CQUEUE que);
+
+/** @} */
+
+/** @addtogroup cat_cstack Concurrent Stack 構造
+ *  スレッドセーフな Stack 構造を提供するモジュール.
+ *  事前に確保したノードプール上の, ABA 対策済み Treiber スタック.
+ *  @ingroup cat_collections
+ *  @{
+ */
+
+/**
+ *  スレッドセーフなスタック型.
+ */
+typedef struct {} *CSTACK;
+
+/**
+ *  スレッドセーフなスタックオブジェクトを初期化する.
+ */
+CSTACK cstack_init(size_t payload_bytes, size_t capacity);
+
+/**
+ *  属性を指定してスレッドセーフなスタックオブジェクトを初期化する.
+ */
+CSTACK cstack_init_attr(size_t payload_bytes,
+                        size_t capacity,
+                        const struct collection_attr *attr);
+
+/**
+ *  スレッドセーフなスタックオブジェクトを解放する.
+ */
+void cstack_release(CSTACK stack);
+
+/**
+ *  要素をスレッドセーフなスタックに積む.
+ */
+int cstack_push(CSTACK stack, const void *payload);
+
+/**
+ *  スレッドセーフなスタックから要素を取り出す.
+ */
+int cstack_pop(CSTACK stack, void *payload);
+
+/**
+ *  スレッドセーフなスタックの深さを取得する.
+ *  他のスレッドが操作中の場合は概算値となる.
+ */
+ssize_t cstack_count(CSTACK stack);
+
 /** @} */
 
 /** @addtogroup cat_set Set 構造
@@ -273,6 +539,13 @@ typedef struct {} *SET;
  */
 SET set_init(size_t payload_bytes, size_t capacity);
 
+/**
+ *  属性を指定してセットオブジェクトを初期化する.
+ */
+SET set_init_attr(size_t payload_bytes,
+                  size_t capacity,
+                  const struct collection_attr *attr);
+
 /**
  *  セットオブジェクトを解放する.
  */
@@ -288,6 +561,14 @@ int set_clear(SET set);
  */
 void *set_add(SET set, void *payload);
 
+/**
+ *  配列からセットオブジェクトを構築する.
+ */
+SET set_from_array(size_t payload_bytes,
+                   const void *array,
+                   size_t count,
+                   const struct collection_attr *attr);
+
 /**
  *  セットの長さを取得する.
  */
@@ -300,6 +581,272 @@ ITER set_iter(SET set);
 
 /** @} */
 
+/** @addtogroup cat_map Map 構造
+ *  Map 構造を提供するモジュール.
+ *  @ingroup cat_collections
+ *  @{
+ */
+
+/**
+ *  汎用マップ型.
+ */
+typedef struct {} *MAP;
+
+/**
+ *  マップオブジェクトを初期化する.
+ *
+ *  @par    使用例
+ *          @code
+ *          MAP map = map_init(sizeof(int), sizeof(double), 100);
+ *          int key = 1;
+ *          double value = 0.5;
+ *          map_put(map, &key, &value);
+ *          double *p = map_get(map, &key);
+ *          for (ITER iter = map_iter(map); iter != NULL; iter = iter_next(iter)) {
+ *              key = *(int *)iter_get_payload(iter);
+ *              value = *(double *)map_iter_get_value(map, iter);
+ *              // do something.
+ *          }
+ *          map_release(map);
+ *          @endcode
+ */
+MAP map_init(size_t key_bytes, size_t value_bytes, size_t capacity);
+
+/**
+ *  属性を指定してマップオブジェクトを初期化する.
+ */
+MAP map_init_attr(size_t key_bytes,
+                  size_t value_bytes,
+                  size_t capacity,
+                  const struct collection_attr *attr);
+
+/**
+ *  マップオブジェクトを解放する.
+ */
+void map_release(MAP map);
+
+/**
+ *  マップの要素をすべて消去する.
+ */
+int map_clear(MAP map);
+
+/**
+ *  キーと値の組をマップに追加する.
+ */
+void *map_put(MAP map, const void *key, const void *value);
+
+/**
+ *  キーに対応する値を取得する.
+ */
+void *map_get(MAP map, const void *key);
+
+/**
+ *  キーの要素をマップから削除する.
+ */
+int map_remove(MAP map, const void *key);
+
+/**
+ *  マップの要素の数を取得する.
+ */
+ssize_t map_count(MAP map);
+
+/**
+ *  マップの反復子を取得する.
+ */
+ITER map_iter(MAP map);
+
+/**
+ *  マップの反復子から値を取得する.
+ */
+void *map_iter_get_value(MAP map, ITER iter);
+
+/** @} */
+
+/** @addtogroup cat_pqueue Priority Queue 構造
+ *  優先度付きキュー構造を提供するモジュール.
+ *  @ingroup cat_collections
+ *  @{
+ */
+
+/**
+ *  汎用優先度付きキュー型.
+ */
+typedef struct {} *PQUEUE;
+
+/**
+ *  優先度付きキューの比較関数型.
+ *
+ *  @c a を @c b より先に取り出す場合は負数, 後に取り出す場合は正数,
+ *  同じ優先度の場合は 0 を返すこと.
+ */
+typedef int (*pqueue_compare)(const void *a, const void *b);
+
+/**
+ *  優先度付きキューオブジェクトを初期化する.
+ *
+ *  @par    使用例
+ *          @code
+ *          static int compare_int(const void *a, const void *b)
+ *          {
+ *              return *(const int *)a - *(const int *)b;
+ *          }
+ *
+ *          PQUEUE pq = pqueue_init(sizeof(int), 100, compare_int);
+ *          int data = 3;
+ *          int *handle = pqueue_push(pq, &data);
+ *          *handle = 1;
+ *          pqueue_update(pq, handle);
+ *          pqueue_pop(pq, &data);
+ *          pqueue_release(pq);
+ *          @endcode
+ */
+PQUEUE pqueue_init(size_t payload_bytes, size_t capacity, pqueue_compare compare);
+
+/**
+ *  属性を指定して優先度付きキューオブジェクトを初期化する.
+ */
+PQUEUE pqueue_init_attr(size_t payload_bytes,
+                        size_t capacity,
+                        pqueue_compare compare,
+                        const struct collection_attr *attr);
+
+/**
+ *  優先度付きキューオブジェクトを解放する.
+ */
+void pqueue_release(PQUEUE pq);
+
+/**
+ *  優先度付きキューの要素をすべて消去する.
+ */
+int pqueue_clear(PQUEUE pq);
+
+/**
+ *  要素を優先度付きキューに追加する.
+ */
+void *pqueue_push(PQUEUE pq, const void *payload);
+
+/**
+ *  配列の要素をまとめて優先度付きキューに追加する.
+ */
+int pqueue_heapify(PQUEUE pq, const void *array, size_t count);
+
+/**
+ *  優先度付きキューの先頭の要素を取得する.
+ */
+void *pqueue_peek(PQUEUE pq);
+
+/**
+ *  優先度付きキューの先頭の要素を取り出す.
+ */
+int pqueue_pop(PQUEUE pq, void *payload);
+
+/**
+ *  優先度付きキューから要素を削除する.
+ */
+int pqueue_remove(PQUEUE pq, void *handle);
+
+/**
+ *  要素の優先度の変更を優先度付きキューに反映する.
+ */
+int pqueue_update(PQUEUE pq, void *handle);
+
+/**
+ *  優先度付きキューの要素の数を取得する.
+ */
+ssize_t pqueue_count(PQUEUE pq);
+
+/** @} */
+
+/** @addtogroup cat_bitset Bitset 構造
+ *  ビットセット構造を提供するモジュール.
+ *  @ingroup cat_collections
+ *  @{
+ */
+
+/**
+ *  汎用ビットセット型.
+ */
+typedef struct {} *BITSET;
+
+/**
+ *  ビットセットオブジェクトを初期化する.
+ *
+ *  @par    使用例
+ *          @code
+ *          BITSET active = bitset_init(128);
+ *          BITSET handled = bitset_init(128);
+ *          bitset_set(active, 3);
+ *          bitset_set(handled, 3);
+ *          bitset_set(handled, 70);
+ *          bitset_intersect(handled, active);
+ *          for (ssize_t bit = bitset_next(handled, 0);
+ *               bit >= 0;
+ *               bit = bitset_next(handled, bit + 1)) {
+ *              // do something.
+ *          }
+ *          bitset_release(handled);
+ *          bitset_release(active);
+ *          @endcode
+ */
+BITSET bitset_init(size_t bits);
+
+/**
+ *  属性を指定してビットセットオブジェクトを初期化する.
+ */
+BITSET bitset_init_attr(size_t bits, const struct collection_attr *attr);
+
+/**
+ *  ビットセットオブジェクトを解放する.
+ */
+void bitset_release(BITSET bs);
+
+/**
+ *  ビットセットのすべてのビットを 0 にする.
+ */
+int bitset_clear(BITSET bs);
+
+/**
+ *  ビットを 1 にする.
+ */
+int bitset_set(BITSET bs, size_t bit);
+
+/**
+ *  ビットを 0 にする.
+ */
+int bitset_reset(BITSET bs, size_t bit);
+
+/**
+ *  ビットを取得する.
+ */
+int bitset_test(BITSET bs, size_t bit);
+
+/**
+ *  1 のビットの数を取得する.
+ */
+ssize_t bitset_count(BITSET bs);
+
+/**
+ *  指定位置以降で最初に 1 であるビットの位置を取得する.
+ */
+ssize_t bitset_next(BITSET bs, size_t from);
+
+/**
+ *  ビットセットを和集合にする.
+ */
+int bitset_union(BITSET dst, BITSET src);
+
+/**
+ *  ビットセットを積集合にする.
+ */
+int bitset_intersect(BITSET dst, BITSET src);
+
+/**
+ *  ビットセットを差集合にする.
+ */
+int bitset_difference(BITSET dst, BITSET src);
+
+/** @} */
+
 /** @addtogroup cat_tree N-ary Tree 構造
  *  N-ary Tree 構造を提供するモジュール.
  *  @ingroup cat_collections
@@ -316,6 +863,60 @@ typedef struct {} *TREE;
  */
 typedef struct {} *TREE_ITER;
 
+/**
+ *  N-ary ツリーの要素のハンドル.
+ *  要素を削除するまで有効で, 移動しても変わらない.
+ */
+typedef struct {} *TREE_NODE;
+
+/**
+ *  N-ary ツリー走査子構造体.
+ *  呼び出し側のスタックに確保でき, 走査中にメモリを確保しない.
+ *  メンバは内部状態のため, 直接参照しないこと.
+ */
+struct tree_walk {
+    const void *tree; /**< 走査中のツリー. */
+    void *top;        /**< 走査する部分木の根. NULL の場合はツリー全体. */
+    void *payload;    /**< 現在地のデータ部. */
+    int age;          /**< 現在地の世代. */
+};
+
+/**
+ *  N-ary ツリー走査子構造体の初期化子.
+ */
+#define TREE_WALK_INITIALIZER \
+    (struct tree_walk){       \
+        .tree = NULL,         \
+        .top = NULL,          \
+        .payload = NULL,      \
+        .age = 0              \
+    }
+
+/**
+ *  N-ary ツリー幅優先走査子構造体.
+ *  未訪問の要素のハンドルをキューに保持する.
+ *  メンバは内部状態のため, 直接参照しないこと.
+ */
+struct tree_bfs {
+    const void *tree; /**< 走査中のツリー. */
+    void *queue;      /**< 未訪問の要素のハンドルのキュー. (@ref QUEUE) */
+    void *payload;    /**< 現在地のデータ部. */
+    int age;          /**< 現在地の世代. */
+    size_t remaining; /**< 現在の世代で, キューに残っている要素の数. */
+};
+
+/**
+ *  N-ary ツリー幅優先走査子構造体の初期化子.
+ */
+#define TREE_BFS_INITIALIZER \
+    (struct tree_bfs){       \
+        .tree = NULL,        \
+        .queue = NULL,       \
+        .payload = NULL,     \
+        .age = 0,            \
+        .remaining = 0       \
+    }
+
 /**
  *  N-ary ツリーオブジェクトを初期化する.
  *
@@ -344,6 +945,22 @@ typedef struct {} *TREE_ITER;
  */
 TREE tree_init(size_t payload_bytes, size_t capacity);
 
+/**
+ *  属性を指定して N-ary ツリーオブジェクトを初期化する.
+ */
+TREE tree_init_attr(size_t payload_bytes,
+                    size_t capacity,
+                    const struct collection_attr *attr);
+
+/**
+ *  要素の配列と親要素の番号の配列から N-ary ツリーオブジェクトを構築する.
+ */
+TREE tree_from_parent_array(size_t payload_bytes,
+                            const void *array,
+                            const ssize_t *parents,
+                            size_t count,
+                            const struct collection_attr *attr);
+
 /**
  *  N-ary ツリーオブジェクトを解放する.
  */
@@ -359,6 +976,46 @@ int tree_clear(TREE tree);
  */
 void *tree_insert(TREE tree, void *parent, void *payload);
 
+/**
+ *  N-ary 要素をツリーに挿入し, ハンドルを取得する.
+ *
+ *  @par    使用例
+ *          @code
+ *          int data = 1;
+ *          TREE_NODE parent = tree_insert_node(tree, NULL, &data);
+ *          data = 11;
+ *          TREE_NODE child = tree_insert_node(tree, parent, &data);
+ *          tree_move(tree, child, NULL);
+ *          tree_remove(tree, parent);
+ *          @endcode
+ */
+TREE_NODE tree_insert_node(TREE tree, TREE_NODE parent, const void *payload);
+
+/**
+ *  データ部と一致する N-ary ツリーの要素のハンドルを取得する.
+ */
+TREE_NODE tree_find(TREE tree, const void *payload);
+
+/**
+ *  N-ary ツリーの要素のデータ部を取得する.
+ */
+void *tree_node_get_payload(TREE tree, TREE_NODE node);
+
+/**
+ *  N-ary ツリーの要素の親要素のハンドルを取得する.
+ */
+TREE_NODE tree_node_get_parent(TREE tree, TREE_NODE node);
+
+/**
+ *  N-ary ツリーから要素とその子孫を削除する.
+ */
+ssize_t tree_remove(TREE tree, TREE_NODE node);
+
+/**
+ *  N-ary ツリーの要素とその子孫を別の親要素の下に移動する.
+ */
+int tree_move(TREE tree, TREE_NODE node, TREE_NODE parent);
+
 /**
  *  N-ary ツリーの要素の数を取得する.
  */
@@ -389,6 +1046,322 @@ void *tree_iter_get_payload(TREE_ITER iter);
  */
 int tree_iter_get_age(TREE_ITER iter);
 
+/**
+ *  走査子を N-ary ツリーの先頭に位置付ける.
+ *
+ *  @par    使用例
+ *          @code
+ *          struct tree_walk walk;
+ *          for (int *data = tree_walk_first(tree, &walk);
+ *               data != NULL;
+ *               data = tree_walk_next(&walk)) {
+ *              int age = tree_walk_get_age(&walk);
+ *              // do something.
+ *          }
+ *          @endcode
+ */
+void *tree_walk_first(TREE tree, struct tree_walk *walk);
+
+/**
+ *  走査子を次の要素に進める.
+ */
+void *tree_walk_next(struct tree_walk *walk);
+
+/**
+ *  走査子の N-ary ツリーでのネストの位置を取得する.
+ */
+int tree_walk_get_age(const struct tree_walk *walk);
+
+/**
+ *  走査子を N-ary ツリーの部分木の先頭に位置付ける.
+ */
+void *tree_walk_first_at(TREE tree, TREE_NODE top, struct tree_walk *walk);
+
+/**
+ *  N-ary ツリーの幅優先走査子を初期化する.
+ *
+ *  @par    使用例
+ *          @code
+ *          struct tree_bfs bfs;
+ *          tree_bfs_init(&bfs, tree, NULL);
+ *          for (int *data = tree_bfs_next(&bfs);
+ *               data != NULL;
+ *               data = tree_bfs_next(&bfs)) {
+ *              int age = tree_bfs_get_age(&bfs);
+ *              // do something.
+ *          }
+ *          tree_bfs_release(&bfs);
+ *          @endcode
+ */
+int tree_bfs_init(struct tree_bfs *bfs, TREE tree, TREE_NODE top);
+
+/**
+ *  幅優先走査子を次の要素に進める.
+ */
+void *tree_bfs_next(struct tree_bfs *bfs);
+
+/**
+ *  幅優先走査子を次の世代に進め, 世代の要素を連続した領域で取得する.
+ */
+ssize_t tree_bfs_next_level(struct tree_bfs *bfs, struct queue_span spans[2]);
+
+/**
+ *  幅優先走査子の N-ary ツリーでのネストの位置を取得する.
+ */
+int tree_bfs_get_age(const struct tree_bfs *bfs);
+
+/**
+ *  幅優先走査子を解放する.
+ */
+void tree_bfs_release(struct tree_bfs *bfs);
+
+/** @} */
+
+/**
+ *  埋め込んだリンクから, それを含む構造体のポインタを取得する.
+ *
+ *  @param  ptr     リンクのポインタ.
+ *  @param  type    リンクを含む構造体の型.
+ *  @param  member  構造体でのリンクのメンバ名.
+ */
+#define COLLECTION_ENTRY(ptr, type, member) \
+    ((type *)((char *)(ptr) - offsetof(type, member)))
+
+/** @addtogroup cat_ilist Intrusive List 構造
+ *  呼び出し側の構造体に埋め込んだリンクを連結する List 構造を提供するモジュール.
+ *  連結および切り離しはポインタの付け替えのみで, メモリの確保もデータの
+ *  複製も行わず, 容量の制限もない.
+ *  @ingroup cat_collections
+ *  @{
+ */
+
+/**
+ *  Intrusive リストのリンク構造体.
+ *  要素とする構造体に埋め込む. メンバは内部状態のため, 直接参照しないこと.
+ */
+struct ilist_link {
+    struct ilist_link *prev; /**< 前の要素へのポインタ. */
+    struct ilist_link *next; /**< 次の要素へのポインタ. */
+    const void *owner;       /**< 連結しているリスト. */
+};
+
+/**
+ *  Intrusive リストのリンク構造体の初期化子.
+ */
+#define ILIST_LINK_INITIALIZER \
+    (struct ilist_link){       \
+        .prev = NULL,          \
+        .next = NULL,          \
+        .owner = NULL          \
+    }
+
+/**
+ *  Intrusive リスト構造体.
+ *  メンバは内部状態のため, 直接参照しないこと.
+ */
+struct ilist {
+    struct ilist_link *first; /**< 先頭の要素へのポインタ. */
+    struct ilist_link *last;  /**< 末尾の要素へのポインタ. */
+    size_t count;             /**< 要素の数. */
+};
+
+/**
+ *  Intrusive リスト構造体の初期化子.
+ *
+ *  @par    使用例
+ *          @code
+ *          struct item {
+ *              int value;
+ *              struct ilist_link link;
+ *          };
+ *          struct ilist list = ILIST_INITIALIZER;
+ *          struct item a = {.value = 1, .link = ILIST_LINK_INITIALIZER};
+ *          ilist_push_back(&list, &a.link);
+ *          for (struct ilist_link *link = ilist_first(&list);
+ *               link != NULL;
+ *               link = ilist_next(link)) {
+ *              struct item *item = COLLECTION_ENTRY(link, struct item, link);
+ *              // do something.
+ *          }
+ *          @endcode
+ */
+#define ILIST_INITIALIZER \
+    (struct ilist){       \
+        .first = NULL,    \
+        .last = NULL,     \
+        .count = 0        \
+    }
+
+/**
+ *  要素を Intrusive リストの末尾に連結する.
+ */
+int ilist_push_back(struct ilist *list, struct ilist_link *link);
+
+/**
+ *  要素を Intrusive リストの先頭に連結する.
+ */
+int ilist_push_front(struct ilist *list, struct ilist_link *link);
+
+/**
+ *  要素を Intrusive リストの指定要素の前に連結する.
+ */
+int ilist_insert_before(struct ilist *list, struct ilist_link *pos, struct ilist_link *link);
+
+/**
+ *  要素を Intrusive リストから切り離す.
+ */
+int ilist_remove(struct ilist *list, struct ilist_link *link);
+
+/**
+ *  Intrusive リストの先頭の要素を切り離して取得する.
+ */
+struct ilist_link *ilist_pop_front(struct ilist *list);
+
+/**
+ *  Intrusive リストの先頭の要素を取得する.
+ */
+struct ilist_link *ilist_first(const struct ilist *list);
+
+/**
+ *  Intrusive リストの末尾の要素を取得する.
+ */
+struct ilist_link *ilist_last(const struct ilist *list);
+
+/**
+ *  Intrusive リストの次の要素を取得する.
+ */
+struct ilist_link *ilist_next(const struct ilist_link *link);
+
+/**
+ *  Intrusive リストの前の要素を取得する.
+ */
+struct ilist_link *ilist_prev(const struct ilist_link *link);
+
+/**
+ *  Intrusive リストの要素の数を取得する.
+ */
+ssize_t ilist_count(const struct ilist *list);
+
+/** @} */
+
+/** @addtogroup cat_itree Intrusive N-ary Tree 構造
+ *  呼び出し側の構造体に埋め込んだリンクを連結する N-ary Tree 構造を
+ *  提供するモジュール.
+ *  連結および切り離しはポインタの付け替えのみで, メモリの確保もデータの
+ *  複製も行わず, 容量の制限もない.
+ *  @ingroup cat_collections
+ *  @{
+ */
+
+/**
+ *  Intrusive N-ary ツリーのリンク構造体.
+ *  要素とする構造体に埋め込む. メンバは内部状態のため, 直接参照しないこと.
+ */
+struct itree_link {
+    struct itree_link *parent;       /**< 親要素へのポインタ. */
+    struct itree_link *first_child;  /**< 最初の子要素へのポインタ. */
+    struct itree_link *last_child;   /**< 最後の子要素へのポインタ. */
+    struct itree_link *prev_sibling; /**< 前の兄弟要素へのポインタ. */
+    struct itree_link *next_sibling; /**< 次の兄弟要素へのポインタ. */
+    const void *owner;               /**< 連結しているツリー. */
+};
+
+/**
+ *  Intrusive N-ary ツリーのリンク構造体の初期化子.
+ */
+#define ITREE_LINK_INITIALIZER   \
+    (struct itree_link){         \
+        .parent = NULL,          \
+        .first_child = NULL,     \
+        .last_child = NULL,      \
+        .prev_sibling = NULL,    \
+        .next_sibling = NULL,    \
+        .owner = NULL            \
+    }
+
+/**
+ *  Intrusive N-ary ツリー構造体.
+ *  最上位の要素は, 根 (@c root) の子として連結する.
+ *  メンバは内部状態のため, 直接参照しないこと.
+ */
+struct itree {
+    struct itree_link root; /**< 根. (要素ではない) */
+    size_t count;           /**< 要素の数. */
+};
+
+/**
+ *  Intrusive N-ary ツリー構造体の初期化子.
+ *
+ *  @par    使用例
+ *          @code
+ *          struct node {
+ *              int value;
+ *              struct itree_link link;
+ *          };
+ *          struct itree tree = ITREE_INITIALIZER;
+ *          struct node a = {.value = 1, .link = ITREE_LINK_INITIALIZER};
+ *          struct node b = {.value = 11, .link = ITREE_LINK_INITIALIZER};
+ *          itree_insert(&tree, NULL, &a.link);
+ *          itree_insert(&tree, &a.link, &b.link);
+ *          for (struct itree_link *link = itree_first(&tree);
+ *               link != NULL;
+ *               link = itree_next(&tree, link)) {
+ *              struct node *node = COLLECTION_ENTRY(link, struct node, link);
+ *              // do something.
+ *          }
+ *          @endcode
+ */
+#define ITREE_INITIALIZER                    \
+    (struct itree){                          \
+        .root = ITREE_LINK_INITIALIZER,      \
+        .count = 0                           \
+    }
+
+/**
+ *  要素を Intrusive N-ary ツリーに連結する.
+ */
+int itree_insert(struct itree *tree, struct itree_link *parent, struct itree_link *link);
+
+/**
+ *  要素とその子孫を Intrusive N-ary ツリーから切り離す.
+ */
+ssize_t itree_remove(struct itree *tree, struct itree_link *link);
+
+/**
+ *  Intrusive N-ary ツリーの行きがけ順で先頭の要素を取得する.
+ */
+struct itree_link *itree_first(const struct itree *tree);
+
+/**
+ *  Intrusive N-ary ツリーの行きがけ順で次の要素を取得する.
+ */
+struct itree_link *itree_next(const struct itree *tree, const struct itree_link *link);
+
+/**
+ *  Intrusive N-ary ツリーの親要素を取得する.
+ */
+struct itree_link *itree_parent(const struct itree *tree, const struct itree_link *link);
+
+/**
+ *  Intrusive N-ary ツリーの最初の子要素を取得する.
+ */
+struct itree_link *itree_first_child(const struct itree_link *link);
+
+/**
+ *  Intrusive N-ary ツリーの次の兄弟要素を取得する.
+ */
+struct itree_link *itree_next_sibling(const struct itree_link *link);
+
+/**
+ *  Intrusive N-ary ツリーでのネストの位置を取得する.
+ */
+int itree_get_age(const struct itree *tree, const struct itree_link *link);
+
+/**
+ *  Intrusive N-ary ツリーの要素の数を取得する.
+ */
+ssize_t itree_count(const struct itree *tree);
+
 /** @} */
 
 #endif /* __HFSM_COLLECTIONS_H__ */
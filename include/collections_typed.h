@@ -0,0 +1,265 @@
+/** @file   collections_typed.h
+ *  @brief  型付きのコレクションのフロントエンドを提供する.
+ *
+ *  要素の型を与えて @ref collections.h のリスト, スタック, キューを操作する
+ *  インライン関数 (C++ ではクラステンプレート) を生成する.
+ *  データ部のコピーは呼び出し側で要素の型として行うため, コンパイラは
+ *  小さな要素のコピーを memcpy の呼び出しではなく単一の転送命令にできる.
+ *  格納領域は型なしの API と共通であり, 生成した関数と型なしの API を
+ *  混在させてもよい.
+ *
+ *  @date   2026-10-16 新規作成.
+ *  @copyright  Copyright (c) 2018 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __HFSM_COLLECTIONS_TYPED_H__
+#define __HFSM_COLLECTIONS_TYPED_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "collections.h"
+#ifdef __cplusplus
+}
+#endif
+
+/** @addtogroup cat_collections
+ *  @{
+ */
+
+/**
+ *  型付きのリスト操作関数を定義する.
+ *
+ *  @c name を接頭辞として, 以下のインライン関数を生成する.
+ *  - LIST name_init(size_t capacity)
+ *  - type *name_add(LIST list, type value)
+ *  - type *name_insert(LIST list, int index, type value)
+ *  - type *name_get(LIST list, size_t index)
+ *
+ *  @param  name    生成する関数の接頭辞.
+ *  @param  type    要素の型.
+ */
+#define COLLECTION_DEFINE_LIST(name, type)                                  \
+    static inline LIST name##_init(size_t capacity)                         \
+    {                                                                       \
+        return list_init(sizeof(type), capacity);                           \
+    }                                                                       \
+    static inline type *name##_insert(LIST list, int index, type value)     \
+    {                                                                       \
+        type *slot = (type *)list_insert_slot(list, index);                 \
+        if (slot != NULL) {                                                 \
+            *slot = value;                                                  \
+        }                                                                   \
+        return slot;                                                        \
+    }                                                                       \
+    static inline type *name##_add(LIST list, type value)                   \
+    {                                                                       \
+        return name##_insert(list, -1, value);                              \
+    }                                                                       \
+    static inline type *name##_get(LIST list, size_t index)                 \
+    {                                                                       \
+        return (type *)list_get(list, index);                               \
+    }
+
+/**
+ *  型付きのスタック操作関数を定義する.
+ *
+ *  @c name を接頭辞として, 以下のインライン関数を生成する.
+ *  - STACK name_init(size_t capacity)
+ *  - type *name_push(STACK stack, type value)
+ *  - int name_pop(STACK stack, type *value)
+ *
+ *  @param  name    生成する関数の接頭辞.
+ *  @param  type    要素の型.
+ */
+#define COLLECTION_DEFINE_STACK(name, type)                                 \
+    static inline STACK name##_init(size_t capacity)                        \
+    {                                                                       \
+        return stack_init(sizeof(type), capacity);                          \
+    }                                                                       \
+    static inline type *name##_push(STACK stack, type value)                \
+    {                                                                       \
+        type *slot = (type *)stack_push_slot(stack);                        \
+        if (slot != NULL) {                                                 \
+            *slot = value;                                                  \
+        }                                                                   \
+        return slot;                                                        \
+    }                                                                       \
+    static inline int name##_pop(STACK stack, type *value)                  \
+    {                                                                       \
+        type *slot = (type *)stack_pop_slot(stack);                         \
+        if (slot == NULL) {                                                 \
+            return -1;                                                      \
+        }                                                                   \
+        *value = *slot;                                                     \
+        return 0;                                                           \
+    }
+
+/**
+ *  型付きのキュー操作関数を定義する.
+ *
+ *  @c name を接頭辞として, 以下のインライン関数を生成する.
+ *  - QUEUE name_init(size_t capacity)
+ *  - type *name_enq(QUEUE que, type value)
+ *  - int name_deq(QUEUE que, type *value)
+ *
+ *  @param  name    生成する関数の接頭辞.
+ *  @param  type    要素の型.
+ */
+#define COLLECTION_DEFINE_QUEUE(name, type)                                 \
+    static inline QUEUE name##_init(size_t capacity)                        \
+    {                                                                       \
+        return queue_init(sizeof(type), capacity);                          \
+    }                                                                       \
+    static inline type *name##_enq(QUEUE que, type value)                   \
+    {                                                                       \
+        type *slot = (type *)queue_enq_slot(que);                           \
+        if (slot != NULL) {                                                 \
+            *slot = value;                                                  \
+        }                                                                   \
+        return slot;                                                        \
+    }                                                                       \
+    static inline int name##_deq(QUEUE que, type *value)                    \
+    {                                                                       \
+        type *slot = (type *)queue_deq_slot(que);                           \
+        if (slot == NULL) {                                                 \
+            return -1;                                                      \
+        }                                                                   \
+        *value = *slot;                                                     \
+        return 0;                                                           \
+    }
+
+/** @} */
+
+#ifdef __cplusplus
+
+#include <type_traits>
+
+namespace hfsm {
+
+/**
+ *  型付きのリスト.
+ *
+ *  @ref COLLECTION_DEFINE_LIST の C++ 版. 失敗は C の API と同様に
+ *  戻り値と errno で通知する.
+ */
+template <typename T>
+class typed_list {
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+public:
+    explicit typed_list(size_t capacity, const struct collection_attr *attr = NULL)
+        : handle_(list_init_attr(sizeof(T), capacity, attr)) {}
+    ~typed_list() { list_release(handle_); }
+    typed_list(const typed_list &) = delete;
+    typed_list &operator=(const typed_list &) = delete;
+
+    /** 型なしのハンドルを取得する. 初期化に失敗した場合は NULL. */
+    LIST handle() const { return handle_; }
+
+    T *insert(int index, const T &value)
+    {
+        T *slot = static_cast<T *>(list_insert_slot(handle_, index));
+        if (slot != NULL) {
+            *slot = value;
+        }
+        return slot;
+    }
+    T *add(const T &value) { return insert(-1, value); }
+    T *get(size_t index) const { return static_cast<T *>(list_get(handle_, index)); }
+    ssize_t count() const { return list_count(handle_); }
+
+private:
+    LIST handle_;
+};
+
+/**
+ *  型付きのスタック.
+ *
+ *  @ref COLLECTION_DEFINE_STACK の C++ 版.
+ */
+template <typename T>
+class typed_stack {
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+public:
+    explicit typed_stack(size_t capacity, const struct collection_attr *attr = NULL)
+        : handle_(stack_init_attr(sizeof(T), capacity, attr)) {}
+    ~typed_stack() { stack_release(handle_); }
+    typed_stack(const typed_stack &) = delete;
+    typed_stack &operator=(const typed_stack &) = delete;
+
+    /** 型なしのハンドルを取得する. 初期化に失敗した場合は NULL. */
+    STACK handle() const { return handle_; }
+
+    T *push(const T &value)
+    {
+        T *slot = static_cast<T *>(stack_push_slot(handle_));
+        if (slot != NULL) {
+            *slot = value;
+        }
+        return slot;
+    }
+    int pop(T &value)
+    {
+        const T *slot = static_cast<const T *>(stack_pop_slot(handle_));
+        if (slot == NULL) {
+            return -1;
+        }
+        value = *slot;
+        return 0;
+    }
+    ssize_t count() const { return stack_count(handle_); }
+
+private:
+    STACK handle_;
+};
+
+/**
+ *  型付きのキュー.
+ *
+ *  @ref COLLECTION_DEFINE_QUEUE の C++ 版.
+ */
+template <typename T>
+class typed_queue {
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+public:
+    explicit typed_queue(size_t capacity, const struct collection_attr *attr = NULL)
+        : handle_(queue_init_attr(sizeof(T), capacity, attr)) {}
+    ~typed_queue() { queue_release(handle_); }
+    typed_queue(const typed_queue &) = delete;
+    typed_queue &operator=(const typed_queue &) = delete;
+
+    /** 型なしのハンドルを取得する. 初期化に失敗した場合は NULL. */
+    QUEUE handle() const { return handle_; }
+
+    T *enq(const T &value)
+    {
+        T *slot = static_cast<T *>(queue_enq_slot(handle_));
+        if (slot != NULL) {
+            *slot = value;
+        }
+        return slot;
+    }
+    int deq(T &value)
+    {
+        const T *slot = static_cast<const T *>(queue_deq_slot(handle_));
+        if (slot == NULL) {
+            return -1;
+        }
+        value = *slot;
+        return 0;
+    }
+    ssize_t count() const { return queue_count(handle_); }
+
+private:
+    QUEUE handle_;
+};
+
+} /* namespace hfsm */
+
+#endif /* __cplusplus */
+
+#endif /* __HFSM_COLLECTIONS_TYPED_H__ */
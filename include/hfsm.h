@@ -20,6 +20,15 @@
 
 struct fsm_trans;
 struct fsm;
+struct fsm_sched;
+struct fsm_inbox;
+struct fsm_batcher;
+
+/**
+ *  非同期アクションの保留トークン型.
+ *  遷移ごとの通番を持つ, NULL でない不透明な値. 参照してはならない.
+ */
+typedef struct fsm_token *FSM_TOKEN;
 
 /** @addtogroup cat_hfsm 階層型有限状態マシン
  *  階層型有限状態マシンを構成するモジュール.
@@ -88,6 +97,70 @@ struct fsm_state {
         FSM_STATE_HELPER(#var, &var##_var, (ent), (exe), (exi)), \
                                   *var = &var##_
 
+/**
+ *  do アクティビティの完了を示す再開位置.
+ */
+#define FSM_ACTIVITY_DONE (-1)
+
+/**
+ *  再開可能な do アクティビティの開始.
+ *
+ *  do アクティビティの先頭に記述する.
+ *  @ref FSM_ACTIVITY_YIELD で中断した場合, 次の @ref fsm_update では
+ *  中断した位置から再開する.
+ *  スタックレスのため, 中断をまたぐ値は状態固有情報に保持すること.
+ *  また, 中断を含む区間内に @c switch 文を記述することはできない.
+ *
+ *  @par    使用例
+ *          @code
+ *          static void exec_heating(struct fsm *machine, void *data)
+ *          {
+ *              struct setting *setting = (struct setting *)data;
+ *
+ *              FSM_ACTIVITY_BEGIN(machine);
+ *              for (setting->step = 0; setting->step < 10; ++setting->step) {
+ *                  // do something.
+ *                  FSM_ACTIVITY_YIELD(machine);
+ *              }
+ *              FSM_ACTIVITY_END(machine);
+ *          }
+ *          @endcode
+ */
+#define FSM_ACTIVITY_BEGIN(machine)          \
+    switch (*fsm_activity_resume(machine)) { \
+    case 0:
+
+/**
+ *  do アクティビティを中断し, @ref fsm_update に制御を戻す.
+ */
+#define FSM_ACTIVITY_YIELD(machine)                   \
+    do {                                              \
+        *fsm_activity_resume(machine) = __LINE__;     \
+        return;                                       \
+    case __LINE__:;                                   \
+    } while (0)
+
+/**
+ *  条件が成立するまで do アクティビティを中断する.
+ */
+#define FSM_ACTIVITY_AWAIT(machine, cond)             \
+    do {                                              \
+        *fsm_activity_resume(machine) = __LINE__;     \
+    case __LINE__:                                    \
+        if (!(cond)) {                                \
+            return;                                   \
+        }                                             \
+    } while (0)
+
+/**
+ *  再開可能な do アクティビティの終了.
+ *
+ *  終了したアクティビティは, 状態から出るまで再実行されない.
+ */
+#define FSM_ACTIVITY_END(machine)                          \
+    }                                                      \
+    *fsm_activity_resume(machine) = FSM_ACTIVITY_DONE
+
 /**
  *  開始状態.
  */
@@ -162,10 +235,13 @@ struct fsm_cond {
 
 /**
  *  遷移アクション構造体.
+ *
+ *  @c async が設定されている場合は非同期アクションとなり, @c func は使用しない.
  */
 struct fsm_action {
-    const char *name;                 /**< アクション名. */
-    void (*const func)(struct fsm *); /**< 遷移アクション. */
+    const char *name;                       /**< アクション名. */
+    void (*const func)(struct fsm *);       /**< 遷移アクション. */
+    FSM_TOKEN (*const async)(struct fsm *); /**< 非同期遷移アクション. */
 };
 
 /**
@@ -174,7 +250,8 @@ struct fsm_action {
 #define FSM_ACTION_HELPER(nam, fn) \
     {                              \
         .name = (nam),             \
-        .func = (fn)               \
+        .func = (fn),              \
+        .async = NULL              \
     }
 
 /**
@@ -187,6 +264,46 @@ struct fsm_action {
                                    *var = &var##_; \
     static void var##_func args
 
+/**
+ *  非同期遷移アクション構造体設定ヘルパ.
+ */
+#define FSM_ASYNC_ACTION_HELPER(nam, fn) \
+    {                                    \
+        .name = (nam),                   \
+        .func = NULL,                    \
+        .async = (fn)                    \
+    }
+
+/**
+ *  非同期遷移アクション定義ヘルパ.
+ *
+ *  アクションは, 処理を完了した場合は NULL を返し, 完了を待つ場合は
+ *  @ref fsm_action_pend で取得したトークンを返す.
+ *  トークンを返した場合, 状態マシンは @ref fsm_action_complete が呼ばれるまで
+ *  遷移中となり, その間に発生したイベントは保留される.
+ *
+ *  @par    使用例
+ *          @code
+ *          FSM_ASYNC_ACTION(action_save, (struct fsm *machine))
+ *          {
+ *              FSM_TOKEN token = fsm_action_pend(machine);
+ *              start_write(setting, on_written, machine, token);
+ *              return token;
+ *          }
+ *
+ *          static void on_written(struct fsm *machine, FSM_TOKEN token)
+ *          {
+ *              fsm_action_complete(machine, token);
+ *          }
+ *          @endcode
+ */
+#define FSM_ASYNC_ACTION(var, args)                      \
+    static FSM_TOKEN var##_func args;                    \
+    static const struct fsm_action var##_ =              \
+        FSM_ASYNC_ACTION_HELPER(#var, var##_func),       \
+                                   *var = &var##_;       \
+    static FSM_TOKEN var##_func args
+
 /**
  *  遷移構造体.
  */
@@ -251,28 +368,65 @@ struct fsm_rels {
  */
 #define FSM_RELS_TERMINATOR FSM_RELS_INITIALIZER
 
+/**
+ *  状態マシンの属性構造体.
+ */
+struct fsm_attr {
+    const struct allocator *allocator; /**< メモリ割り当て. NULL の場合は既定. */
+};
+
+/**
+ *  状態マシンの属性構造体の設定ヘルパ.
+ */
+#define FSM_ATTR_HELPER(a) \
+    {                      \
+        .allocator = (a)   \
+    }
+
+/**
+ *  状態マシンの属性構造体の初期化子.
+ */
+#define FSM_ATTR_INITIALIZER \
+    (struct fsm_attr)FSM_ATTR_HELPER(NULL)
+
+/**
+ *  非同期アクションの完了待ちの間に保留できるイベントの最大数.
+ */
+#define FSM_DEFER_MAX (16)
+
+/**
+ *  1 つのバッチに含められるイベントの最大数.
+ */
+#define FSM_BATCH_MAX (32)
+
+/**
+ *  イベントのバッチ構造体.
+ */
+struct fsm_batch {
+    size_t count;                                  /**< イベントの数. */
+    const struct fsm_event *events[FSM_BATCH_MAX]; /**< イベント. */
+};
+
 /**
  *  ダンプ処理の標準ハンドラ.
  */
 static inline void fsm_dump_state_transition_to_text(TREE tree)
 {
-    TREE_ITER iter;
+    struct tree_walk walk;
+    const struct fsm_state **payload;
 
-    for (iter = tree_iter_get(tree);
-         iter != NULL;
-         iter = tree_iter_next(iter)) {
+    for (payload = (const struct fsm_state **)tree_walk_first(tree, &walk);
+         payload != NULL;
+         payload = (const struct fsm_state **)tree_walk_next(&walk)) {
 
-        const struct fsm_state *state =
-            *(const struct fsm_state **)tree_iter_get_payload(iter);
-        int age = tree_iter_get_age(iter);
+        const struct fsm_state *state = *payload;
+        int age = tree_walk_get_age(&walk);
         char spacer[128] = {'\0'};
         for (int i = 0; i < age; ++i) {
             strncat(spacer, "    ", sizeof(spacer) - (i * 4));
         }
         printf("%s%s\n", spacer, state->name);
     }
-
-    tree_iter_release(iter);
 }
 
 /**
@@ -281,6 +435,26 @@ static inline void fsm_dump_state_transition_to_text(TREE tree)
 struct fsm *fsm_init(const struct fsm_rels *rels,
                      const struct fsm_trans *corresps);
 
+/**
+ *  属性を指定して状態マシンを初期化する.
+ */
+struct fsm *fsm_init_attr(const struct fsm_rels *rels,
+                          const struct fsm_trans *corresps,
+                          const struct fsm_attr *attr);
+
+/**
+ *  呼び出し側の領域に状態マシンを配置するために必要なサイズを取得する.
+ */
+ssize_t fsm_required_size(const struct fsm_rels *rels, const struct fsm_trans *corresps);
+
+/**
+ *  呼び出し側の領域に状態マシンを配置して初期化する.
+ */
+struct fsm *fsm_init_in(void *buffer,
+                        size_t size,
+                        const struct fsm_rels *rels,
+                        const struct fsm_trans *corresps);
+
 /**
  *  状態マシンを破棄する.
  */
@@ -288,14 +462,82 @@ int fsm_term(struct fsm *machine);
 
 /**
  *  イベントによる状態遷移を実施する.
+ *
+ *  @remarks    非同期アクションの完了待ちの間に保留できるイベントは
+ *              @ref FSM_DEFER_MAX 個までであり, 超えた場合は失敗する (ENOBUFS).
  */
-void fsm_transition(struct fsm *machine, const struct fsm_event *event);
+int fsm_transition(struct fsm *machine, const struct fsm_event *event);
 
 /**
  *  現在の状態の do アクティビティを実行する.
  */
 void fsm_update(struct fsm *machine);
 
+/**
+ *  更新スケジューラを生成する.
+ */
+struct fsm_sched *fsm_sched_init(size_t capacity);
+
+/**
+ *  属性を指定して更新スケジューラを生成する.
+ */
+struct fsm_sched *fsm_sched_init_attr(size_t capacity, const struct fsm_attr *attr);
+
+/**
+ *  更新スケジューラを破棄する.
+ */
+void fsm_sched_release(struct fsm_sched *sched);
+
+/**
+ *  状態マシンを更新スケジューラに登録する.
+ */
+int fsm_sched_attach(struct fsm_sched *sched, struct fsm *machine);
+
+/**
+ *  状態マシンの更新スケジューラへの登録を解除する.
+ */
+int fsm_sched_detach(struct fsm *machine);
+
+/**
+ *  実行可能な do アクティビティを持つ状態マシンだけを更新する.
+ */
+void fsm_update_all(struct fsm_sched *sched);
+
+/**
+ *  実行可能な状態マシンの数を取得する.
+ */
+ssize_t fsm_sched_count(struct fsm_sched *sched);
+
+/**
+ *  現在の状態の do アクティビティの再開位置を取得する.
+ */
+int *fsm_activity_resume(struct fsm *machine);
+
+/**
+ *  現在の状態の do アクティビティが実行可能か確認する.
+ */
+bool fsm_activity_runnable(struct fsm *machine);
+
+/**
+ *  非同期アクションの保留トークンを取得する.
+ */
+FSM_TOKEN fsm_action_pend(struct fsm *machine);
+
+/**
+ *  保留している遷移を完了させる.
+ *
+ *  @retval 0   完了した.
+ *  @retval -1  遷移中でない, またはトークンが現在の遷移のものでない (EINVAL).
+ *
+ *  @remarks    アクションの内部で呼んだ場合は, アクションから戻った時点で遷移する.
+ */
+int fsm_action_complete(struct fsm *machine, FSM_TOKEN token);
+
+/**
+ *  非同期アクションの完了待ちか確認する.
+ */
+bool fsm_in_flight(struct fsm *machine);
+
 /**
  *  状態の固有情報を取得する.
  */
@@ -311,6 +553,84 @@ void fsm_current_state(struct fsm *machine, char *name, size_t len);
  */
 void fsm_dump_state_transition(struct fsm *machine, void (*handler)(TREE));
 
+/**
+ *  受信箱を生成する.
+ *
+ *  @par    使用例
+ *          @code
+ *          // consumer thread.
+ *          struct fsm_inbox *inbox = fsm_inbox_init(64);
+ *          for (;;) {
+ *              fsm_inbox_dispatch(inbox, machine);
+ *          }
+ *
+ *          // producer thread.
+ *          struct fsm_batcher *batcher = fsm_batcher_init(16, 100);
+ *          fsm_batcher_post(batcher, inbox, event_run);
+ *          fsm_batcher_poll(batcher);
+ *          @endcode
+ */
+struct fsm_inbox *fsm_inbox_init(size_t capacity);
+
+/**
+ *  属性を指定して受信箱を生成する.
+ */
+struct fsm_inbox *fsm_inbox_init_attr(size_t capacity, const struct fsm_attr *attr);
+
+/**
+ *  受信箱を破棄する.
+ */
+void fsm_inbox_release(struct fsm_inbox *inbox);
+
+/**
+ *  受信箱からバッチを取り出す.
+ */
+int fsm_inbox_pop(struct fsm_inbox *inbox, struct fsm_batch *batch);
+
+/**
+ *  バッチのイベントを状態マシンに発生させる.
+ */
+ssize_t fsm_dispatch_batch(struct fsm *machine, const struct fsm_batch *batch);
+
+/**
+ *  受信箱のイベントをすべて状態マシンに発生させる.
+ */
+ssize_t fsm_inbox_dispatch(struct fsm_inbox *inbox, struct fsm *machine);
+
+/**
+ *  バッチ送信オブジェクトを生成する.
+ */
+struct fsm_batcher *fsm_batcher_init(size_t threshold, unsigned long timeout_us);
+
+/**
+ *  属性を指定してバッチ送信オブジェクトを生成する.
+ */
+struct fsm_batcher *fsm_batcher_init_attr(size_t threshold,
+                                          unsigned long timeout_us,
+                                          const struct fsm_attr *attr);
+
+/**
+ *  バッチ送信オブジェクトを破棄する.
+ */
+void fsm_batcher_release(struct fsm_batcher *batcher);
+
+/**
+ *  イベントを送信バッファに追加する.
+ */
+int fsm_batcher_post(struct fsm_batcher *batcher,
+                     struct fsm_inbox *inbox,
+                     const struct fsm_event *event);
+
+/**
+ *  送信期限を過ぎた送信バッファを受信箱に渡す.
+ */
+int fsm_batcher_poll(struct fsm_batcher *batcher);
+
+/**
+ *  すべての送信バッファを受信箱に渡す.
+ */
+int fsm_batcher_flush(struct fsm_batcher *batcher);
+
 /** @} */
 
 #endif /* __HFSM_HFSM_H__ */
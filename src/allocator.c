@@ -0,0 +1,683 @@
+/** @file   allocator.c
+ *  @brief  メモリ割り当てに関する機能を提供する.
+ *
+ *  システム (malloc/free), サイズクラス別のスラブ, 割り当てなし,
+ *  および計数によるメモリ割り当てを提供する.
+ *
+ *  @date   2026-10-16 新規作成.
+ *  @copyright  Copyright (c) 2018 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdalign.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "allocator.h"
+#include "debug.h"
+
+/**
+ *  スラブの最小のサイズクラス (2 の対数).
+ */
+#define SLAB_CLASS_MIN_SHIFT (4)
+
+/**
+ *  スラブの最大のサイズクラス (2 の対数).
+ */
+#define SLAB_CLASS_MAX_SHIFT (12)
+
+/**
+ *  スラブのサイズクラスの数.
+ */
+#define SLAB_CLASSES (SLAB_CLASS_MAX_SHIFT - SLAB_CLASS_MIN_SHIFT + 1)
+
+/**
+ *  スラブのページのバイト数.
+ *  ページはバイト数で整列して確保するため, 各要素はサイズクラスで整列する.
+ */
+#define SLAB_PAGE_BYTES (64 * 1024)
+
+/**
+ *  マガジンに保持する要素の最大数.
+ */
+#define SLAB_MAGAZINE_SIZE (32)
+
+/**
+ *  マガジンとサイズクラスの間で一度に移動する要素数.
+ */
+#define SLAB_MAGAZINE_BATCH (SLAB_MAGAZINE_SIZE / 2)
+
+/**
+ *  スラブの空き要素構造体.
+ */
+struct slab_free {
+    struct slab_free *next; /**< 次の空き要素. */
+};
+
+/**
+ *  スラブのページ構造体.
+ *  ページの先頭の要素を管理領域として使用する.
+ */
+struct slab_page {
+    struct slab_page *next; /**< 次のページ. */
+};
+
+/**
+ *  計数するメモリ割り当て構造体.
+ *
+ *  先頭に @ref allocator を配置し, そのポインタを公開する.
+ */
+struct allocator_counter {
+    struct allocator allocator;      /**< 公開するメモリ割り当て. */
+    const struct allocator *backing; /**< 実際に確保を行うメモリ割り当て. */
+    atomic_size_t allocs;            /**< 確保に成功した回数. */
+    atomic_size_t frees;             /**< 解放した回数. */
+    atomic_size_t failures;          /**< 確保に失敗した回数. */
+    atomic_size_t bytes_in_use;      /**< 使用中のバイト数. */
+    atomic_size_t peak_bytes;        /**< 使用中のバイト数の最大値. */
+};
+
+/**
+ *  スラブのサイズクラス構造体.
+ */
+struct slab_class {
+    pthread_mutex_t lock;    /**< 排他制御. */
+    struct slab_free *free;  /**< 空き要素の連結. */
+    struct slab_page *pages; /**< 確保済みのページの連結. */
+    char *fresh;             /**< 未使用領域の先頭. */
+    char *fresh_end;         /**< 未使用領域の終端. */
+    size_t available;        /**< 空き要素と未使用領域の要素数の合計. */
+};
+
+/**
+ *  スラブのマガジン (スレッドごとのキャッシュ) 構造体.
+ */
+struct slab_magazine {
+    size_t count;                     /**< 保持している要素数. */
+    void *slot[SLAB_MAGAZINE_SIZE];   /**< 保持している要素. */
+};
+
+/**
+ *  サイズクラスのスラブ構造体の初期化子.
+ */
+#define SLAB_CLASS_INITIALIZER                \
+    {                                         \
+        .lock = PTHREAD_MUTEX_INITIALIZER,    \
+        .free = NULL,                         \
+        .pages = NULL,                        \
+        .fresh = NULL,                        \
+        .fresh_end = NULL,                    \
+        .available = 0                        \
+    }
+
+/**
+ *  サイズクラスごとのスラブ.
+ */
+static struct slab_class slab_classes[SLAB_CLASSES] = {
+    SLAB_CLASS_INITIALIZER, SLAB_CLASS_INITIALIZER, SLAB_CLASS_INITIALIZER,
+    SLAB_CLASS_INITIALIZER, SLAB_CLASS_INITIALIZER, SLAB_CLASS_INITIALIZER,
+    SLAB_CLASS_INITIALIZER, SLAB_CLASS_INITIALIZER, SLAB_CLASS_INITIALIZER,
+};
+
+/**
+ *  スレッドごとのマガジン.
+ */
+static _Thread_local struct slab_magazine slab_magazines[SLAB_CLASSES];
+
+/**
+ *  スレッドの終了時にマガジンを返却するためのキー.
+ */
+static pthread_key_t slab_thread_key;
+
+/**
+ *  @ref slab_thread_key の初期化制御.
+ */
+static pthread_once_t slab_thread_once = PTHREAD_ONCE_INIT;
+
+/**
+ *  スレッドの @ref slab_thread_key の登録状態.
+ */
+static _Thread_local bool slab_thread_registered;
+
+/**
+ *  システムによる確保.
+ */
+static void *system_alloc(void *ctx, size_t bytes, size_t align)
+{
+    void *ptr;
+
+    (void)ctx;
+
+    if (align <= alignof(max_align_t)) {
+        ptr = malloc(bytes);
+    } else {
+        ptr = aligned_alloc(align, bytes);
+    }
+    if (ptr == NULL) {
+        errno = ENOMEM;
+    }
+
+    return ptr;
+}
+
+/**
+ *  システムによる解放.
+ */
+static void system_free(void *ctx, void *ptr, size_t bytes)
+{
+    (void)ctx;
+    (void)bytes;
+
+    free(ptr);
+}
+
+/**
+ *  要求のバイト数に対応するサイズクラスを取得する.
+ *
+ *  @param  [in]    bytes   要求のバイト数.
+ *  @return サイズクラスの番号が返る.
+ *          スラブの対象外の場合は -1 が返る.
+ */
+static inline int slab_class_of(size_t bytes)
+{
+    int shift;
+
+    if (bytes > ((size_t)1 << SLAB_CLASS_MAX_SHIFT)) {
+        return -1;
+    }
+    if (bytes <= ((size_t)1 << SLAB_CLASS_MIN_SHIFT)) {
+        return 0;
+    }
+    shift = (int)(sizeof(unsigned long) * 8) - __builtin_clzl((unsigned long)(bytes - 1));
+
+    return shift - SLAB_CLASS_MIN_SHIFT;
+}
+
+/**
+ *  サイズクラスの要素のバイト数を取得する.
+ */
+static inline size_t slab_class_bytes(int cls)
+{
+    return (size_t)1 << (cls + SLAB_CLASS_MIN_SHIFT);
+}
+
+/**
+ *  サイズクラスにページを追加する.
+ *
+ *  @param  [in,out]    slab    サイズクラスのスラブ.
+ *  @param  [in]        cls     サイズクラスの番号.
+ *  @return 成功時は 0 が返る.
+ *          失敗時は -1 が返り, errno が適切に設定される.
+ *  @pre    @c slab のロックを取得していること.
+ *          未使用領域が空であること.
+ */
+static int slab_class_grow(struct slab_class *slab, int cls)
+{
+    size_t bytes = slab_class_bytes(cls);
+    struct slab_page *page;
+
+    page = aligned_alloc(SLAB_PAGE_BYTES, SLAB_PAGE_BYTES);
+    if (page == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    page->next = slab->pages;
+    slab->pages = page;
+    slab->fresh = (char *)page + bytes;
+    slab->fresh_end = (char *)page + SLAB_PAGE_BYTES;
+    slab->available += (SLAB_PAGE_BYTES / bytes) - 1;
+
+    return 0;
+}
+
+/**
+ *  サイズクラスからマガジンに要素を補充する.
+ *
+ *  @param  [in]        cls         サイズクラスの番号.
+ *  @param  [in,out]    magazine    空のマガジン.
+ *  @return 成功時は 0 が返る.
+ *          失敗時は -1 が返り, errno が適切に設定される.
+ */
+static int slab_refill(int cls, struct slab_magazine *magazine)
+{
+    struct slab_class *slab = &slab_classes[cls];
+    size_t bytes = slab_class_bytes(cls);
+    int ret = 0;
+
+    pthread_mutex_lock(&slab->lock);
+    while (magazine->count < SLAB_MAGAZINE_BATCH) {
+        if (slab->free != NULL) {
+            magazine->slot[magazine->count++] = slab->free;
+            slab->free = slab->free->next;
+        } else if (slab->fresh < slab->fresh_end) {
+            magazine->slot[magazine->count++] = slab->fresh;
+            slab->fresh += bytes;
+        } else if (magazine->count > 0) {
+            break;
+        } else if (slab_class_grow(slab, cls) != 0) {
+            ret = -1;
+            break;
+        } else {
+            continue;
+        }
+        --slab->available;
+    }
+    pthread_mutex_unlock(&slab->lock);
+
+    return ret;
+}
+
+/**
+ *  マガジンからサイズクラスに要素を返却する.
+ *
+ *  @param  [in]        cls         サイズクラスの番号.
+ *  @param  [in,out]    magazine    マガジン.
+ *  @param  [in]        count       返却する要素数.
+ */
+static void slab_drain(int cls, struct slab_magazine *magazine, size_t count)
+{
+    struct slab_class *slab = &slab_classes[cls];
+
+    pthread_mutex_lock(&slab->lock);
+    while ((count-- > 0) && (magazine->count > 0)) {
+        struct slab_free *entry = magazine->slot[--magazine->count];
+        entry->next = slab->free;
+        slab->free = entry;
+        ++slab->available;
+    }
+    pthread_mutex_unlock(&slab->lock);
+}
+
+/**
+ *  スレッドの終了時にマガジンを返却する.
+ */
+static void slab_thread_exit(void *arg)
+{
+    (void)arg;
+
+    slab_flush();
+}
+
+/**
+ *  @ref slab_thread_key を生成する.
+ */
+static void slab_thread_key_create(void)
+{
+    pthread_key_create(&slab_thread_key, slab_thread_exit);
+}
+
+/**
+ *  スレッドの終了時にマガジンを返却するよう登録する.
+ */
+static inline void slab_thread_register(void)
+{
+    if (!slab_thread_registered) {
+        pthread_once(&slab_thread_once, slab_thread_key_create);
+        pthread_setspecific(slab_thread_key, slab_magazines);
+        slab_thread_registered = true;
+    }
+}
+
+/**
+ *  スラブによる確保.
+ */
+static void *slab_alloc(void *ctx, size_t bytes, size_t align)
+{
+    int cls = slab_class_of(bytes);
+    struct slab_magazine *magazine;
+
+    if (cls < 0) {
+        return system_alloc(ctx, bytes, align);
+    }
+
+    magazine = &slab_magazines[cls];
+    if (magazine->count == 0) {
+        slab_thread_register();
+        if (slab_refill(cls, magazine) != 0) {
+            return NULL;
+        }
+    }
+
+    return magazine->slot[--magazine->count];
+}
+
+/**
+ *  スラブによる解放.
+ */
+static void slab_free(void *ctx, void *ptr, size_t bytes)
+{
+    int cls = slab_class_of(bytes);
+    struct slab_magazine *magazine;
+
+    if (cls < 0) {
+        system_free(ctx, ptr, bytes);
+        return;
+    }
+
+    magazine = &slab_magazines[cls];
+    if (magazine->count == SLAB_MAGAZINE_SIZE) {
+        slab_drain(cls, magazine, SLAB_MAGAZINE_BATCH);
+    } else if (magazine->count == 0) {
+        slab_thread_register();
+    }
+    magazine->slot[magazine->count++] = ptr;
+}
+
+/**
+ *  システムによるメモリ割り当て.
+ */
+const struct allocator allocator_system = ALLOCATOR_HELPER(system_alloc, system_free, NULL);
+
+/**
+ *  スラブによるメモリ割り当て.
+ */
+const struct allocator allocator_slab = ALLOCATOR_HELPER(slab_alloc, slab_free, NULL);
+
+/**
+ *  割り当てなしによる確保.
+ */
+static void *none_alloc(void *ctx, size_t bytes, size_t align)
+{
+    (void)ctx;
+    (void)bytes;
+    (void)align;
+
+    errno = ENOMEM;
+    return NULL;
+}
+
+/**
+ *  割り当てなしによる解放.
+ */
+static void none_free(void *ctx, void *ptr, size_t bytes)
+{
+    (void)ctx;
+    (void)ptr;
+    (void)bytes;
+}
+
+/**
+ *  割り当てなしによるメモリ割り当て.
+ */
+const struct allocator allocator_none = ALLOCATOR_HELPER(none_alloc, none_free, NULL);
+
+/**
+ *  既定のメモリ割り当て.
+ */
+static _Atomic(const struct allocator *) allocator_default = &allocator_system;
+
+/**
+ *  計数による確保.
+ */
+static void *counter_alloc(void *ctx, size_t bytes, size_t align)
+{
+    struct allocator_counter *self = ctx;
+    size_t in_use, peak;
+    void *ptr;
+
+    ptr = self->backing->alloc(self->backing->ctx, bytes, align);
+    if (ptr == NULL) {
+        atomic_fetch_add_explicit(&self->failures, 1, memory_order_relaxed);
+        return NULL;
+    }
+    atomic_fetch_add_explicit(&self->allocs, 1, memory_order_relaxed);
+    in_use = atomic_fetch_add_explicit(&self->bytes_in_use, bytes, memory_order_relaxed) + bytes;
+    peak = atomic_load_explicit(&self->peak_bytes, memory_order_relaxed);
+    while ((peak < in_use)
+           && !atomic_compare_exchange_weak_explicit(&self->peak_bytes, &peak, in_use,
+                                                     memory_order_relaxed,
+                                                     memory_order_relaxed)) {
+    }
+
+    return ptr;
+}
+
+/**
+ *  計数による解放.
+ */
+static void counter_free(void *ctx, void *ptr, size_t bytes)
+{
+    struct allocator_counter *self = ctx;
+
+    self->backing->free(self->backing->ctx, ptr, bytes);
+    atomic_fetch_add_explicit(&self->frees, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&self->bytes_in_use, bytes, memory_order_relaxed);
+}
+
+/**
+ *  @details    ライブラリ内で個別に指定せずに行うメモリの確保に使用する,
+ *              既定のメモリ割り当てを設定する.
+ *
+ *  @param      [in]    allocator   メモリ割り当て.
+ *                                  NULL の場合は @ref allocator_system に戻す.
+ *  @remarks    コレクションおよび状態マシンは, 生成時の既定のメモリ割り当てを
+ *              保持するため, 設定の変更は以降に生成したものにのみ影響する.
+ *              @c allocator は以降に生成したものをすべて解放するまで
+ *              有効である必要がある.
+ */
+void allocator_set_default(const struct allocator *allocator)
+{
+    if (allocator == NULL) {
+        allocator = &allocator_system;
+    }
+
+    atomic_store(&allocator_default, allocator);
+}
+
+/**
+ *  @details    既定のメモリ割り当てを取得する.
+ *
+ *  @return     既定のメモリ割り当てが返る.
+ */
+const struct allocator *allocator_get_default(void)
+{
+    return atomic_load(&allocator_default);
+}
+
+/**
+ *  @details    @c allocator で @c bytes バイトの領域を確保する.
+ *
+ *  @param      [in]    allocator   メモリ割り当て.
+ *                                  NULL の場合は既定のメモリ割り当てを使用する.
+ *  @param      [in]    bytes       確保するバイト数.
+ *  @param      [in]    align       整列のバイト数. 0 の場合は malloc と同じ.
+ *  @return     成功時は, 確保した領域のポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    解放は同じ @c allocator と @c bytes で
+ *              @ref allocator_free を呼び出す.
+ */
+void *allocator_alloc(const struct allocator *allocator, size_t bytes, size_t align)
+{
+    if (allocator == NULL) {
+        allocator = allocator_get_default();
+    }
+    if ((bytes == 0) || ((align & (align - 1)) != 0)
+        || ((align != 0) && ((bytes % align) != 0))) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    return allocator->alloc(allocator->ctx, bytes, align);
+}
+
+/**
+ *  @details    @c allocator で 0 初期化した @c bytes バイトの領域を確保する.
+ *
+ *  @param      [in]    allocator   メモリ割り当て.
+ *                                  NULL の場合は既定のメモリ割り当てを使用する.
+ *  @param      [in]    bytes       確保するバイト数.
+ *  @param      [in]    align       整列のバイト数. 0 の場合は malloc と同じ.
+ *  @return     成功時は, 確保した領域のポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+void *allocator_zalloc(const struct allocator *allocator, size_t bytes, size_t align)
+{
+    void *ptr = allocator_alloc(allocator, bytes, align);
+
+    if (ptr != NULL) {
+        memset(ptr, 0, bytes);
+    }
+
+    return ptr;
+}
+
+/**
+ *  @details    @ref allocator_alloc で確保した領域を解放する.
+ *
+ *  @param      [in]    allocator   確保時のメモリ割り当て.
+ *  @param      [in]    ptr         解放する領域. NULL の場合は何もしない.
+ *  @param      [in]    bytes       確保時のバイト数.
+ */
+void allocator_free(const struct allocator *allocator, void *ptr, size_t bytes)
+{
+    if (ptr == NULL) {
+        return;
+    }
+    if (allocator == NULL) {
+        allocator = allocator_get_default();
+    }
+
+    allocator->free(allocator->ctx, ptr, bytes);
+}
+
+/**
+ *  @details    @c backing の確保と解放を計数するメモリ割り当てを生成する.
+ *
+ *  @code
+ *  const struct allocator *counter = allocator_counter_init(NULL);
+ *  allocator_set_default(counter);
+ *  ...
+ *  struct allocator_stats stats;
+ *  allocator_counter_get_stats(counter, &stats);
+ *  @endcode
+ *
+ *  @param      [in]    backing 実際に確保を行うメモリ割り当て.
+ *                              NULL の場合は @ref allocator_system を使用する.
+ *  @return     成功時は, 計数するメモリ割り当てが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    計数するメモリ割り当て自身はシステムから確保する.
+ *              計数はスレッドセーフである.
+ */
+const struct allocator *allocator_counter_init(const struct allocator *backing)
+{
+    struct allocator_counter *self;
+
+    self = malloc(sizeof(*self));
+    if (self == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    self->allocator = (struct allocator)ALLOCATOR_HELPER(counter_alloc, counter_free, self);
+    self->backing = (backing != NULL) ? backing : &allocator_system;
+    atomic_init(&self->allocs, 0);
+    atomic_init(&self->frees, 0);
+    atomic_init(&self->failures, 0);
+    atomic_init(&self->bytes_in_use, 0);
+    atomic_init(&self->peak_bytes, 0);
+
+    return &self->allocator;
+}
+
+/**
+ *  @details    @c counter を破棄する.
+ *              @c counter は @ref allocator_counter_init の戻り値である必要がある.
+ *
+ *  @param      [in]    counter 計数するメモリ割り当て.
+ *  @warning    @c counter で確保した領域をすべて解放してから呼び出すこと.
+ */
+void allocator_counter_release(const struct allocator *counter)
+{
+    if ((counter != NULL) && (counter->alloc == counter_alloc)) {
+        free(counter->ctx);
+    }
+}
+
+/**
+ *  @details    @c counter の統計情報を取得する.
+ *
+ *  @param      [in]    counter 計数するメモリ割り当て.
+ *  @param      [out]   stats   統計情報.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int allocator_counter_get_stats(const struct allocator *counter, struct allocator_stats *stats)
+{
+    const struct allocator_counter *self;
+
+    if ((counter == NULL) || (counter->alloc != counter_alloc) || (stats == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    self = counter->ctx;
+    stats->allocs = atomic_load_explicit(&self->allocs, memory_order_relaxed);
+    stats->frees = atomic_load_explicit(&self->frees, memory_order_relaxed);
+    stats->failures = atomic_load_explicit(&self->failures, memory_order_relaxed);
+    stats->bytes_in_use = atomic_load_explicit(&self->bytes_in_use, memory_order_relaxed);
+    stats->peak_bytes = atomic_load_explicit(&self->peak_bytes, memory_order_relaxed);
+
+    return 0;
+}
+
+/**
+ *  @details    スラブに @c bytes バイトの要素を @c count 個以上確保しておく.
+ *              以降, 確保済みの範囲の要素の確保はシステムを呼び出さない.
+ *
+ *  @param      [in]    bytes   要素のバイト数.
+ *  @param      [in]    count   要素数.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @remarks    初期化時 (実時間処理の開始前) に呼び出すことを想定している.
+ */
+int slab_reserve(size_t bytes, size_t count)
+{
+    int cls = slab_class_of(bytes);
+    struct slab_class *slab;
+    int ret = 0;
+
+    if ((bytes == 0) || (cls < 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    slab = &slab_classes[cls];
+    pthread_mutex_lock(&slab->lock);
+    while (slab->available < count) {
+        /* 未使用領域は空き要素の連結に移してからページを追加する. */
+        while (slab->fresh < slab->fresh_end) {
+            struct slab_free *entry = (struct slab_free *)slab->fresh;
+            entry->next = slab->free;
+            slab->free = entry;
+            slab->fresh += slab_class_bytes(cls);
+        }
+        if (slab_class_grow(slab, cls) != 0) {
+            ret = -1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&slab->lock);
+
+    return ret;
+}
+
+/**
+ *  @details    呼び出したスレッドのマガジンに保持している要素を
+ *              スラブに返却し, 他のスレッドから確保できるようにする.
+ *
+ *  @remarks    スレッドの終了時には自動的に呼び出される.
+ */
+void slab_flush(void)
+{
+    for (int cls = 0; cls < SLAB_CLASSES; ++cls) {
+        if (slab_magazines[cls].count > 0) {
+            slab_drain(cls, &slab_magazines[cls], SLAB_MAGAZINE_SIZE);
+        }
+    }
+}
@@ -11,7 +11,10 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <stdalign.h>
 #include <string.h>
 #include <errno.h>
 
@@ -19,1308 +22,6514 @@
 #include "debug.h"
 
 /**
- *  リストノード構造体.
+ *  キャッシュラインのサイズ.
  */
-struct list_node {
-    struct list_node *prev; /**< 前要素へのポインタ. */
-    struct list_node *next; /**< 次要素へのポインタ. */
-    char payload[];         /**< データ部. */
-};
+#define CACHE_LINE_BYTES (64)
 
 /**
- *  リストノード構造体の初期化子.
+ *  メモリプールのチャンク構造体.
+ *
+ *  容量の拡張時はチャンクを追加するため, 確保済みのノードは移動しない.
  */
-#define LIST_NODE_INITIALIZER \
-    (struct list_node){       \
-        .prev = NULL,         \
-        .next = NULL          \
-    }
+struct pool_chunk {
+    struct pool_chunk *next; /**< 次のチャンクへのポインタ. */
+    size_t count;            /**< チャンクに含まれるノードの数. */
+    size_t bytes;            /**< チャンク全体のサイズ. */
+    alignas(max_align_t) char nodes[]; /**< ノード領域. 基本型の整列に合わせる. */
+};
 
 /**
- *  リスト管理構造体.
+ *  メモリプールのチャンクを確保する.
+ *
+ *  @param  [in]    allocator   メモリ割り当て.
+ *  @param  [in]    count       ノードの数.
+ *  @param  [in]    node_bytes  ノードのサイズ.
+ *  @return 成功時は, 確保したチャンクのポインタが返る.
+ *          失敗時は, NULL が返り, errno が適切に設定される.
  */
-struct list {
-    void *pool;                 /**< リストで使用するメモリプール. */
-    struct list_node *released; /**< 解放済みノードのリスト. */
-    struct list_node *root;     /**< 使用中の先頭ノード. */
-    struct list_node *last;     /**< 使用中の末尾ノード. */
-    size_t payload_bytes;       /**< データ部のサイズ. */
-    size_t capacity;            /**< 確保したノードの数. */
-    size_t count;               /**< 使用中のノードの数. */
-};
+static struct pool_chunk *pool_chunk_alloc(const struct allocator *allocator,
+                                           size_t count,
+                                           size_t node_bytes)
+{
+    struct pool_chunk *chunk;
+    size_t bytes = sizeof(*chunk) + (count * node_bytes);
+
+    chunk = allocator_zalloc(allocator, bytes, 0);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    chunk->next = NULL;
+    chunk->count = count;
+    chunk->bytes = bytes;
+
+    return chunk;
+}
 
 /**
- *  リスト管理構造体の初期化子.
+ *  メモリプールのチャンクをすべて解放する.
+ *
+ *  @param  [in]        allocator   確保時のメモリ割り当て.
+ *  @param  [in,out]    chunk       先頭のチャンク.
  */
-#define LIST_INITIALIZER(p, b, c) \
-    (struct list){                \
-        .pool = (p),              \
-        .released = NULL,         \
-        .root = NULL,             \
-        .last = NULL,             \
-        .payload_bytes = (b),     \
-        .capacity = (c),          \
-        .count = 0                \
+static void pool_chunk_free_all(const struct allocator *allocator, struct pool_chunk *chunk)
+{
+    while (chunk != NULL) {
+        struct pool_chunk *next = chunk->next;
+        allocator_free(allocator, chunk, chunk->bytes);
+        chunk = next;
     }
+}
 
 /**
- *  解放済みノードのリストにノードを追加する.
+ *  メモリプールの末尾にチャンクを追加する.
  *
- *  @param  [in,out]    self    リストオブジェクト.
- *  @param  [in]        node    追加するノード.
- *  @pre    @c self の非 NULL は呼び出し側で保証すること.
- *  @pre    @c node の非 NULL は呼び出し側で保証すること.
+ *  @param  [in,out]    pool    先頭のチャンク.
+ *  @param  [in]        chunk   追加するチャンク.
  */
-static inline void list_push_released(struct list *self, struct list_node *node)
+static inline void pool_chunk_append(struct pool_chunk *pool, struct pool_chunk *chunk)
 {
-    node->prev = NULL;
-    if (self->released == NULL) {
-        node->next = NULL;
-    } else {
-        node->next = self->released;
-        self->released->prev = node;
+    while (pool->next != NULL) {
+        pool = pool->next;
     }
-    self->released = node;
+    pool->next = chunk;
 }
 
 /**
- *  解放済みノードのリストからノードを取得する.
+ *  メモリプールから未使用のノードを切り出す.
  *
- *  @param  [in,out]    self    リストオブジェクト.
+ *  未使用のノードは先頭のチャンクから順に切り出すため, 初期化や消去の際に
+ *  すべてのノードを辿る必要がない.
+ *
+ *  @param  [in,out]    chunk       切り出し中のチャンク.
+ *  @param  [in,out]    index       切り出し中のチャンク内の位置.
+ *  @param  [in]        node_bytes  ノードのサイズ.
  *  @return 成功時は, ノードのポインタが返る.
- *          失敗時は, NULL が返り, errno が適切に設定される.
- *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ *          未使用のノードがない場合は, NULL が返る.
  */
-static inline struct list_node *list_pop_released(struct list *self)
+static inline void *pool_take_fresh(struct pool_chunk **chunk,
+                                    size_t *index,
+                                    size_t node_bytes)
 {
-    struct list_node *node = self->released;
+    void *node;
 
-    if (node == NULL) {
-        errno = ENOMEM;
+    if (*chunk == NULL) {
         return NULL;
     }
-
-    self->released = node->next;
-    if (self->released != NULL) {
-        self->released->prev = NULL;
+    node = (void *)((uintptr_t)(*chunk)->nodes + (node_bytes * (*index)));
+    if (++(*index) == (*chunk)->count) {
+        *chunk = (*chunk)->next;
+        *index = 0;
     }
 
     return node;
 }
 
 /**
- *  リストの初期設定を行う.
+ *  容量の拡張で追加するノードの数を算出する.
  *
- *  @param  [in,out]    self            リストオブジェクト.
- *  @param  [in]        pool            リストに使用するメモリプール.
- *  @param  [in]        payload_bytes   データ部のサイズ.
- *  @param  [in]        capacity        リストの容量.
- *  @pre    @c self の非 NULL は呼び出し側で保証すること.
- *  @pre    @c pool の非 NULL は呼び出し側で保証すること.
+ *  @param  [in]    attr        コレクションの属性.
+ *  @param  [in]    capacity    現在の容量.
+ *  @return 追加するノードの数が返る. 拡張できない場合は 0 が返る.
  */
-static inline void list_setup(struct list *self,
-                              void *pool,
-                              size_t payload_bytes,
-                              size_t capacity)
+static inline size_t pool_grow_count(const struct collection_attr *attr,
+                                     size_t capacity)
 {
-    size_t node_bytes;
-    struct list_node *node;
-    size_t i;
+    size_t count = capacity;
 
-    *self = LIST_INITIALIZER(pool, payload_bytes, capacity);
-    node_bytes = sizeof(*node) + self->payload_bytes;
-    for (i = 0; i < self->capacity; ++i) {
-        node = (struct list_node *)((uintptr_t)self->pool + (node_bytes * i));
-        list_push_released(self, node);
+    if (!attr->growable) {
+        return 0;
+    }
+    if (attr->max_capacity != 0) {
+        if (capacity >= attr->max_capacity) {
+            return 0;
+        }
+        if (count > (attr->max_capacity - capacity)) {
+            count = attr->max_capacity - capacity;
+        }
     }
+
+    return count;
 }
 
 /**
- *  @details    @c iter の次の反復子を取得する.
+ *  指定の属性から, 使用する属性を得る.
  *
- *  @param      [in]    iter    リストの反復子.
- *  @return     成功時は, 次の反復子が返る. 次の要素がない場合は NULL が返る.
- *              失敗時は, NULL が返り, errno が適切に設定される.
- *  @warning    スレッドセーフではない.
+ *  メモリ割り当てが未指定の場合は, この時点の既定のメモリ割り当てを
+ *  保持する. これにより, 以降に既定が変更されても同じメモリ割り当てで
+ *  解放できる.
+ *
+ *  @param  [in]    attr    コレクションの属性. NULL の場合は
+ *                          @ref COLLECTION_ATTR_INITIALIZER と同じ属性となる.
+ *  @return 使用する属性が返る.
  */
-ITER iter_next(ITER iter)
+static inline struct collection_attr collection_attr_of(const struct collection_attr *attr)
 {
-    if (iter == NULL) {
-        errno = EINVAL;
-        return NULL;
+    struct collection_attr a = (attr != NULL) ? *attr : COLLECTION_ATTR_INITIALIZER;
+
+    if (a.allocator == NULL) {
+        a.allocator = allocator_get_default();
     }
-    return (ITER)((struct list_node *)iter)->next;
+
+    return a;
 }
 
 /**
- *  @details    @c iter のデータ部を取得する.
+ *  コレクションの属性を検証する.
  *
- *  @param      [in]    iter    リストの反復子.
- *  @return     成功時は, データ部のポインタが返る.
- *              失敗時は, NULL が返り, errno が適切に設定される.
- *  @warning    スレッドセーフではない.
+ *  @param  [in]    attr        コレクションの属性.
+ *  @param  [in]    capacity    初期容量.
+ *  @return 有効な場合は, true が返る.
  */
-void *iter_get_payload(ITER iter)
+static inline bool collection_attr_is_valid(const struct collection_attr *attr,
+                                            size_t capacity)
 {
-    if (iter == NULL) {
-        errno = EINVAL;
-        return NULL;
-    }
-    return ((struct list_node *)iter)->payload;
+    return (attr->max_capacity == 0) || (capacity <= attr->max_capacity);
 }
 
 /**
- *  @details    空で, 指定の容量を備えた, @ref LIST オブジェクトを確保
- *              および初期化する.
+ *  サイズを基本型の整列に切り上げる.
  *
- *  @param      [in]    payload_bytes   データ部のサイズ.
- *  @param      [in]    capacity        リストの容量.
- *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
- *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @param  [in]    bytes   サイズ.
+ *  @return 切り上げたサイズが返る.
  */
-LIST list_init(size_t payload_bytes, size_t capacity)
+static inline size_t collection_align(size_t bytes)
 {
-    struct list *self;
-    size_t node_bytes;
-    void *pool;
+    return ((bytes + alignof(max_align_t) - 1) / alignof(max_align_t)) * alignof(max_align_t);
+}
 
-    if ((payload_bytes == 0) || (capacity == 0)) {
+/**
+ *  呼び出し側の領域がオブジェクトの配置に使用できるか検証する.
+ *
+ *  @param  [in]    buffer      呼び出し側の領域.
+ *  @param  [in]    size        @c buffer のサイズ.
+ *  @param  [in]    required    必要なサイズ.
+ *  @return 使用できる場合は, true が返る.
+ *          使用できない場合は, false が返り, errno が適切に設定される.
+ */
+static inline bool collection_buffer_is_valid(const void *buffer, size_t size, size_t required)
+{
+    if ((buffer == NULL) || (((uintptr_t)buffer % alignof(max_align_t)) != 0)) {
         errno = EINVAL;
-        return NULL;
+        return false;
     }
-
-    self = malloc(sizeof(*self));
-    node_bytes = sizeof(struct list_node) + payload_bytes;
-    pool = calloc(capacity, node_bytes);
-    if ((self == NULL) || (pool == NULL)) {
-        free(pool);
-        free(self);
+    if (size < required) {
         errno = ENOMEM;
-        return NULL;
+        return false;
     }
 
-    list_setup(self, pool, payload_bytes, capacity);
-
-    return (LIST)self;
+    return true;
 }
 
 /**
- *  @details    @c list を解放する.
- *              @c list は @ref list_init の戻り値である必要がある.
+ *  ハッシュ索引の要素構造体.
+ */
+struct hindex_slot {
+    size_t hash;    /**< データ部のハッシュ値. */
+    void *payload;  /**< 索引対象のデータ部のポインタ. */
+    uint32_t epoch; /**< 登録時の世代. 索引の世代と異なる場合は未使用. */
+};
+
+/**
+ *  ハッシュ索引構造体.
  *
- *  @param      [in,out]    list    リストオブジェクト.
- *  @warning    スレッドセーフではない.
+ *  データ部の内容からデータ部のポインタを引くための,
+ *  オープンアドレス法 (線形探索) のハッシュ表.
+ *  負荷率が 1/2 を超えないよう拡張する.
  */
-void list_release(LIST list)
+struct hindex {
+    struct hindex_slot *slots; /**< ハッシュ表. */
+    size_t mask;               /**< ハッシュ表の大きさ - 1. */
+    size_t count;              /**< 登録済みの要素の数. */
+    size_t payload_bytes;      /**< データ部のサイズ. */
+    uint32_t epoch;            /**< ハッシュ表の世代. 消去するたびに進める. */
+    const struct allocator *allocator; /**< メモリ割り当て. */
+};
+
+/**
+ *  データ部のハッシュ値を算出する. (FNV-1a)
+ *
+ *  @param  [in]    payload         データ部.
+ *  @param  [in]    payload_bytes   データ部のサイズ.
+ *  @return ハッシュ値が返る.
+ */
+static inline size_t hindex_hash(const void *payload, size_t payload_bytes)
 {
-    struct list *self = (struct list *)list;
+    const unsigned char *p = payload;
+    uint64_t hash = 0xcbf29ce484222325ULL;
 
-    if (self != NULL) {
-        free(self->pool);
-        free(self);
+    for (size_t i = 0; i < payload_bytes; ++i) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
     }
+
+    return (size_t)hash;
 }
 
 /**
- *  @details    @c list を空の状態にする.
+ *  ハッシュ索引を初期化する.
  *
- *  @param      [in,out]    list    リストオブジェクト.
- *  @return     成功時は, 0 が返る.
- *              失敗時は, -1 が返り, errno が適切に設定される.
- *  @warning    スレッドセーフではない.
+ *  @param  [out]   self            ハッシュ索引.
+ *  @param  [in]    payload_bytes   データ部のサイズ.
+ *  @param  [in]    capacity        想定する要素の数.
+ *  @param  [in]    allocator       メモリ割り当て.
+ *  @return 成功時は, 0 が返る.
+ *          失敗時は, -1 が返り, errno が適切に設定される.
  */
-int list_clear(LIST list)
+static int hindex_init(struct hindex *self,
+                       size_t payload_bytes,
+                       size_t capacity,
+                       const struct allocator *allocator)
 {
-    struct list *self = (struct list *)list;
+    size_t size = 8;
 
-    if (self == NULL) {
-        errno = EINVAL;
+    while (size < (capacity * 2)) {
+        size <<= 1;
+    }
+    self->slots = allocator_zalloc(allocator, size * sizeof(*self->slots), 0);
+    if (self->slots == NULL) {
         return -1;
     }
-
-    list_setup(self, self->pool, self->payload_bytes, self->capacity);
+    self->allocator = allocator;
+    self->mask = size - 1;
+    self->count = 0;
+    self->payload_bytes = payload_bytes;
+    self->epoch = 1;
 
     return 0;
 }
 
 /**
- *  リストの先頭にノードを追加する.
+ *  ハッシュ索引の使用領域を解放する.
  *
- *  @param  [in,out]    self    リストオブジェクト.
- *  @param  [in,out]    node    追加するノード.
+ *  @param  [in,out]    self    ハッシュ索引.
  */
-void list_insert_head(struct list *self, struct list_node *node)
+static inline void hindex_release(struct hindex *self)
 {
-    if (self->root == NULL) {
-        self->root = self->last = node;
-    } else {
-        node->next = self->root;
-        self->root->prev = node;
-        self->root = node;
-    }
+    allocator_free(self->allocator, self->slots, sizeof(*self->slots) * (self->mask + 1));
+    self->slots = NULL;
 }
 
 /**
- *  リストの末尾にノードを追加する.
+ *  ハッシュ索引を空にする.
  *
- *  @param  [in,out]    self    リストオブジェクト.
- *  @param  [in,out]    node    追加するノード.
+ *  世代を進めることで, すべての要素を未使用とみなす.
+ *
+ *  @param  [in,out]    self    ハッシュ索引.
  */
-void list_insert_tail(struct list *self, struct list_node *node)
+static inline void hindex_clear(struct hindex *self)
 {
-    if (self->last == NULL) {
-        self->root = self->last = node;
-    } else {
-        node->prev = self->last;
-        self->last->next = node;
-        self->last = node;
+    if (++self->epoch == 0) {
+        memset(self->slots, 0, sizeof(*self->slots) * (self->mask + 1));
+        self->epoch = 1;
     }
+    self->count = 0;
 }
 
 /**
- *  @details    @c list の指定位置に要素を追加する.
+ *  ハッシュ索引からデータ部の一致する要素, もしくは登録先の空き要素を探す.
  *
- *  @param      [in,out]    list    リストオブジェクト.
- *  @param      [in]        index   追加する位置.
- *  @param      [in]        payload リストに追加するデータ.
- *  @return     成功時は, 追加したリスト上のデータ部のポインタが返る.
- *              失敗時は, NULL が返り, errno が適切に設定される.
- *  @remarks    @c index が負数の場合はリストの最後に追加される.
- *  @warning    スレッドセーフではない.
+ *  @param  [in]    self    ハッシュ索引.
+ *  @param  [in]    payload 探索するデータ部.
+ *  @param  [in]    hash    @c payload のハッシュ値.
+ *  @return 一致する要素がある場合は, その要素が返る.
+ *          ない場合は, 登録先の空き要素が返る.
  */
-void *list_insert(LIST list, int index, void *payload)
+static inline struct hindex_slot *hindex_probe(const struct hindex *self,
+                                               const void *payload,
+                                               size_t hash)
 {
-    struct list *self = (struct list *)list;
-    struct list_node *node;
-    struct list_node *iter;
-    int i;
-
-    if ((self == NULL) || (payload == NULL)) {
-        errno = EINVAL;
-        return NULL;
-    }
+    size_t i;
 
-    node = list_pop_released(self);
-    if (node == NULL) {
-        return NULL;
-    }
-    *node = LIST_NODE_INITIALIZER;
-    memcpy(node->payload, payload, self->payload_bytes);
+    for (i = hash & self->mask;
+         self->slots[i].epoch == self->epoch;
+         i = (i + 1) & self->mask) {
 
-    if (index == 0) {
-        list_insert_head(self, node);
-    } else if (index > 0) {
-        iter = self->root;
-        for (i = 0; i < index; ++i) {
-            if (iter == NULL) {
-                errno = EINVAL;
-                return NULL;
-            }
-            iter = iter->next;
-        }
-        if (iter == NULL) {
-            node->prev = self->last;
-            self->last->next = node;
-            self->last = node;
-        } else {
-            node->next = iter;
-            node->prev = iter->prev;
-            node->prev->next = node;
-            iter->prev = node;
+        if ((self->slots[i].hash == hash)
+            && (memcmp(payload, self->slots[i].payload, self->payload_bytes) == 0)) {
+            break;
         }
-    } else {
-        list_insert_tail(self, node);
     }
-    ++self->count;
 
-    return node->payload;
+    return &self->slots[i];
 }
 
 /**
- *  @details    @c list の末尾に要素を追加する.
+ *  ハッシュ索引からデータ部の一致する要素を探す.
  *
- *  @param      [in,out]    list    リストオブジェクト.
- *  @param      [in]        payload リストに追加するデータ部.
- *  @return     成功時は, 追加したリスト上のデータ部のポインタが返る.
- *              失敗時は, NULL が返り, errno が適切に設定される.
- *  @warning    スレッドセーフではない.
+ *  @param  [in]    self    ハッシュ索引.
+ *  @param  [in]    payload 探索するデータ部.
+ *  @return 一致する要素がある場合は, 登録したデータ部のポインタが返る.
+ *          ない場合は, NULL が返る.
  */
-void *list_add(LIST list, void *payload)
+static inline void *hindex_find(const struct hindex *self, const void *payload)
 {
-    return list_insert(list, -1, payload);
+    struct hindex_slot *slot;
+
+    slot = hindex_probe(self, payload, hindex_hash(payload, self->payload_bytes));
+
+    return (slot->epoch == self->epoch) ? slot->payload : NULL;
 }
 
 /**
- *  @details    @c list から指定のデータを削除する.
+ *  ハッシュ索引に 1 要素を追加できるよう, 必要に応じて拡張する.
  *
- *  @param      [in,out]    list    リストオブジェクト.
- *  @param      [in]        iter    削除する要素の反復子.
- *  @return     成功時は 0 が返る.
- *              失敗時は -1 が返り, errno が適切に設定される.
- *  @warning    スレッドセーフではない.
+ *  @param  [in,out]    self    ハッシュ索引.
+ *  @return 成功時は, 0 が返る.
+ *          失敗時は, -1 が返り, errno が適切に設定される.
  */
-int list_remove(LIST list, ITER iter)
+static int hindex_reserve(struct hindex *self)
 {
-    struct list *self = (struct list *)list;
-    struct list_node *node;
+    struct hindex_slot *slots;
+    size_t size;
 
-    if ((self == NULL) || (iter == NULL)) {
-        errno = EINVAL;
-        return -1;
+    if (((self->count + 1) * 2) <= (self->mask + 1)) {
+        return 0;
     }
 
-    node = (struct list_node *)iter;
-    --self->count;
-    if (self->root == node) {
-        self->root = node->next;
-    }
-    if (self->last == node) {
-        self->last = node->prev;
-    }
-    if (node->prev != NULL) {
-        node->prev->next = node->next;
+    size = (self->mask + 1) * 2;
+    slots = allocator_zalloc(self->allocator, size * sizeof(*slots), 0);
+    if (slots == NULL) {
+        return -1;
     }
-    if (node->next != NULL) {
-        node->next->prev = node->prev;
+    for (size_t i = 0; i <= self->mask; ++i) {
+        if (self->slots[i].epoch == self->epoch) {
+            size_t j = self->slots[i].hash & (size - 1);
+            while (slots[j].epoch == 1) {
+                j = (j + 1) & (size - 1);
+            }
+            slots[j] = self->slots[i];
+            slots[j].epoch = 1;
+        }
     }
-
-    list_push_released(self, node);
+    allocator_free(self->allocator, self->slots, sizeof(*self->slots) * (self->mask + 1));
+    self->slots = slots;
+    self->mask = size - 1;
+    self->epoch = 1;
 
     return 0;
 }
 
 /**
- *  @details    @c list のデータ部のサイズを取得する.
+ *  ハッシュ索引の空き要素に登録する.
  *
- *  @param      [in]    list    リストオブジェクト.
- *  @return     成功時は, @c list のデータ部のサイズが返る.
- *              失敗時は, -1 が返り, errno が適切に設定される.
- *  @warning    スレッドセーフではない.
+ *  @param  [in,out]    self    ハッシュ索引.
+ *  @param  [out]       slot    @ref hindex_probe で得た空き要素.
+ *  @param  [in]        hash    データ部のハッシュ値.
+ *  @param  [in]        payload 登録するデータ部のポインタ.
  */
-ssize_t list_payload_bytes(LIST list)
+static inline void hindex_put(struct hindex *self,
+                              struct hindex_slot *slot,
+                              size_t hash,
+                              void *payload)
 {
-    struct list *self = (struct list *)list;
-
-    if (self == NULL) {
-        errno = EINVAL;
-        return -1;
-    }
-
-    return self->payload_bytes;
+    slot->hash = hash;
+    slot->payload = payload;
+    slot->epoch = self->epoch;
+    ++self->count;
 }
 
 /**
- *  @details    @c list に追加されている要素の数を返す.
+ *  ハッシュ索引から要素を削除する.
  *
- *  @param      [in]    list    リストオブジェクト.
+ *  削除した位置に後続の要素を詰める (後方シフト削除) ため,
+ *  削除済みの印を残さず, 探索が長くならない.
+ *
+ *  @param  [in,out]    self    ハッシュ索引.
+ *  @param  [in,out]    slot    @ref hindex_probe で得た使用中の要素.
+ */
+static void hindex_remove(struct hindex *self, struct hindex_slot *slot)
+{
+    size_t hole = (size_t)(slot - self->slots);
+    size_t i = hole;
+
+    for (;;) {
+        size_t home;
+
+        i = (i + 1) & self->mask;
+        if (self->slots[i].epoch != self->epoch) {
+            break;
+        }
+        /* 本来の位置から穴までの距離が, 現在の位置までの距離以下なら詰める. */
+        home = self->slots[i].hash & self->mask;
+        if (((i - home) & self->mask) >= ((i - hole) & self->mask)) {
+            self->slots[hole] = self->slots[i];
+            hole = i;
+        }
+    }
+    /* 世代は 1 以上のため, 0 は常に未使用を表す. */
+    self->slots[hole].epoch = 0;
+    --self->count;
+}
+
+/**
+ *  リストノード構造体.
+ */
+struct list_node {
+    struct list_node *prev; /**< 前要素へのポインタ. */
+    struct list_node *next; /**< 次要素へのポインタ. */
+    char payload[];         /**< データ部. */
+};
+
+/**
+ *  リストノード構造体の初期化子.
+ */
+#define LIST_NODE_INITIALIZER \
+    (struct list_node){       \
+        .prev = NULL,         \
+        .next = NULL          \
+    }
+
+/**
+ *  リストの位置索引ノード構造体.
+ *
+ *  位置索引を有効にしたリストでは, 各ノードの直前に配置する.
+ *  位置をキーとする Treap (implicit treap) を構成し, 部分木の要素数から
+ *  位置を求める.
+ */
+struct list_rank {
+    struct list_rank *left;   /**< 左の子. (前方の要素) */
+    struct list_rank *right;  /**< 右の子. (後方の要素) */
+    struct list_rank *parent; /**< 親. */
+    size_t size;              /**< 部分木の要素数. */
+    uint32_t prio;            /**< ヒープ順序の優先度. */
+};
+
+/**
+ *  リスト管理構造体.
+ */
+struct list {
+    struct pool_chunk *pool;     /**< リストで使用するメモリプール. */
+    struct pool_chunk *fresh;    /**< 未使用のノードを切り出し中のチャンク. */
+    size_t fresh_index;          /**< @c fresh 内の次に切り出す位置. */
+    struct list_node *released;  /**< 解放済みノードのリスト. */
+    struct list_node *root;      /**< 使用中の先頭ノード. */
+    struct list_node *last;      /**< 使用中の末尾ノード. */
+    size_t payload_bytes;        /**< データ部のサイズ. */
+    size_t capacity;             /**< 確保したノードの数. */
+    size_t count;                /**< 使用中のノードの数. */
+    struct collection_attr attr; /**< 属性. */
+    struct list_rank *ranks;     /**< 位置索引の根. */
+    uint32_t seed;               /**< 位置索引の優先度の乱数状態. */
+};
+
+/**
+ *  リスト管理構造体の初期化子.
+ */
+#define LIST_INITIALIZER(p, b, c, a) \
+    (struct list){                   \
+        .pool = (p),                 \
+        .fresh = (p),                \
+        .fresh_index = 0,            \
+        .released = NULL,            \
+        .root = NULL,                \
+        .last = NULL,                \
+        .payload_bytes = (b),        \
+        .capacity = (c),             \
+        .count = 0,                  \
+        .attr = (a),                 \
+        .ranks = NULL,               \
+        .seed = 2463534242U          \
+    }
+
+/**
+ *  リストの 1 ノードあたりの前置領域のサイズを取得する.
+ *
+ *  @param  [in]    attr    リストの属性.
+ *  @return 前置領域のサイズが返る.
+ */
+static inline size_t list_rank_bytes(const struct collection_attr *attr)
+{
+    return attr->indexed ? collection_align(sizeof(struct list_rank)) : 0;
+}
+
+/**
+ *  リストの 1 ノードあたりのサイズを取得する.
+ *  ノードを連続して配置するため, 基本型の整列に切り上げる.
+ *
+ *  @param  [in]    payload_bytes   データ部のサイズ.
+ *  @param  [in]    attr            リストの属性.
+ *  @return ノードのサイズが返る.
+ */
+static inline size_t list_node_bytes(size_t payload_bytes,
+                                     const struct collection_attr *attr)
+{
+    return list_rank_bytes(attr) + collection_align(sizeof(struct list_node) + payload_bytes);
+}
+
+/**
+ *  ノードの位置索引を取得する.
+ *
+ *  @param  [in]    node    ノード.
+ *  @return 位置索引のポインタが返る.
+ *  @pre    位置索引を有効にしたリストのノードであること.
+ */
+static inline struct list_rank *list_rank_of(struct list_node *node)
+{
+    return (struct list_rank *)node - 1;
+}
+
+/**
+ *  位置索引からノードを取得する.
+ *
+ *  @param  [in]    rank    位置索引.
+ *  @return ノードのポインタが返る.
+ */
+static inline struct list_node *list_node_of(struct list_rank *rank)
+{
+    return (struct list_node *)(rank + 1);
+}
+
+/**
+ *  位置索引の部分木の要素数を取得する.
+ *
+ *  @param  [in]    rank    部分木の根.
+ *  @return 要素数が返る.
+ */
+static inline size_t list_rank_size(const struct list_rank *rank)
+{
+    return (rank != NULL) ? rank->size : 0;
+}
+
+/**
+ *  位置索引の部分木の要素数と子の親を更新する.
+ *
+ *  @param  [in,out]    rank    部分木の根.
+ */
+static inline void list_rank_update(struct list_rank *rank)
+{
+    rank->size = 1 + list_rank_size(rank->left) + list_rank_size(rank->right);
+    if (rank->left != NULL) {
+        rank->left->parent = rank;
+    }
+    if (rank->right != NULL) {
+        rank->right->parent = rank;
+    }
+}
+
+/**
+ *  位置索引を先頭から @c k 要素とそれ以降に分割する.
+ *
+ *  @param  [in,out]    rank    分割する部分木の根.
+ *  @param  [in]        k       前方に残す要素数.
+ *  @param  [out]       left    前方の部分木.
+ *  @param  [out]       right   後方の部分木.
+ */
+static void list_rank_split(struct list_rank *rank,
+                            size_t k,
+                            struct list_rank **left,
+                            struct list_rank **right)
+{
+    if (rank == NULL) {
+        *left = *right = NULL;
+        return;
+    }
+    if (list_rank_size(rank->left) < k) {
+        list_rank_split(rank->right, k - list_rank_size(rank->left) - 1, &rank->right, right);
+        list_rank_update(rank);
+        *left = rank;
+    } else {
+        list_rank_split(rank->left, k, left, &rank->left);
+        list_rank_update(rank);
+        *right = rank;
+    }
+}
+
+/**
+ *  位置索引の 2 つの部分木を連結する.
+ *
+ *  @param  [in,out]    left    前方の部分木.
+ *  @param  [in,out]    right   後方の部分木.
+ *  @return 連結した部分木の根が返る.
+ */
+static struct list_rank *list_rank_merge(struct list_rank *left, struct list_rank *right)
+{
+    if (left == NULL) {
+        return right;
+    }
+    if (right == NULL) {
+        return left;
+    }
+    if (left->prio > right->prio) {
+        left->right = list_rank_merge(left->right, right);
+        list_rank_update(left);
+        return left;
+    } else {
+        right->left = list_rank_merge(left, right->left);
+        list_rank_update(right);
+        return right;
+    }
+}
+
+/**
+ *  位置索引から指定位置のノードを取得する.
+ *
+ *  @param  [in]    rank    部分木の根.
+ *  @param  [in]    index   位置.
+ *  @return ノードのポインタが返る. 範囲外の場合は NULL が返る.
+ */
+static struct list_node *list_rank_at(struct list_rank *rank, size_t index)
+{
+    while (rank != NULL) {
+        size_t left = list_rank_size(rank->left);
+        if (index < left) {
+            rank = rank->left;
+        } else if (index == left) {
+            return list_node_of(rank);
+        } else {
+            index -= left + 1;
+            rank = rank->right;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ *  位置索引の優先度を生成する. (xorshift32)
+ *
+ *  @param  [in,out]    self    リストオブジェクト.
+ *  @return 優先度が返る.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static inline uint32_t list_rank_prio(struct list *self)
+{
+    self->seed ^= self->seed << 13;
+    self->seed ^= self->seed >> 17;
+    self->seed ^= self->seed << 5;
+
+    return self->seed;
+}
+
+/**
+ *  位置索引の指定位置にノードを挿入する.
+ *
+ *  @param  [in,out]    self    リストオブジェクト.
+ *  @param  [in]        index   位置.
+ *  @param  [in,out]    node    挿入するノード.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static void list_rank_insert(struct list *self, size_t index, struct list_node *node)
+{
+    struct list_rank *rank = list_rank_of(node);
+    struct list_rank *left, *right;
+
+    rank->left = rank->right = rank->parent = NULL;
+    rank->size = 1;
+    rank->prio = list_rank_prio(self);
+
+    list_rank_split(self->ranks, index, &left, &right);
+    self->ranks = list_rank_merge(list_rank_merge(left, rank), right);
+    self->ranks->parent = NULL;
+}
+
+/**
+ *  位置索引の末尾にノードを追加する. (一括構築用)
+ *
+ *  末尾のノードから根までの右端の経路のうち, 優先度が低いノードを
+ *  追加するノードの左の部分木とする. 各ノードは経路から外れる際に
+ *  1 度だけ要素数を確定するため, 償却 O(1) で追加できる.
+ *  経路上に残るノードの要素数は @ref list_rank_seal で確定する.
+ *
+ *  @param  [in,out]    self    リストオブジェクト.
+ *  @param  [in]        last    現在の末尾のノード. 空の場合は NULL.
+ *  @param  [in,out]    node    追加するノード.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ *  @pre    構築中は位置索引を使用しないこと.
+ */
+static void list_rank_append(struct list *self, struct list_node *last, struct list_node *node)
+{
+    struct list_rank *rank = list_rank_of(node);
+    struct list_rank *curr = (last != NULL) ? list_rank_of(last) : NULL;
+    struct list_rank *popped = NULL;
+
+    rank->right = NULL;
+    rank->size = 1;
+    rank->prio = list_rank_prio(self);
+
+    while ((curr != NULL) && (curr->prio <= rank->prio)) {
+        curr->size = 1 + list_rank_size(curr->left) + list_rank_size(curr->right);
+        popped = curr;
+        curr = curr->parent;
+    }
+    rank->left = popped;
+    if (popped != NULL) {
+        popped->parent = rank;
+    }
+    rank->parent = curr;
+    if (curr == NULL) {
+        self->ranks = rank;
+    } else {
+        curr->right = rank;
+    }
+}
+
+/**
+ *  @ref list_rank_append で構築した位置索引の, 右端の経路上の要素数を確定する.
+ *
+ *  @param  [in,out]    self    リストオブジェクト.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static void list_rank_seal(struct list *self)
+{
+    if (!self->attr.indexed || (self->last == NULL)) {
+        return;
+    }
+    for (struct list_rank *curr = list_rank_of(self->last); curr != NULL; curr = curr->parent) {
+        curr->size = 1 + list_rank_size(curr->left) + list_rank_size(curr->right);
+    }
+}
+
+/**
+ *  位置索引からノードを取り除く.
+ *
+ *  @param  [in,out]    self    リストオブジェクト.
+ *  @param  [in]        node    取り除くノード.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static void list_rank_remove(struct list *self, struct list_node *node)
+{
+    struct list_rank *rank = list_rank_of(node);
+    struct list_rank *parent = rank->parent;
+    struct list_rank *sub;
+
+    sub = list_rank_merge(rank->left, rank->right);
+    if (sub != NULL) {
+        sub->parent = parent;
+    }
+    if (parent == NULL) {
+        self->ranks = sub;
+    } else if (parent->left == rank) {
+        parent->left = sub;
+    } else {
+        parent->right = sub;
+    }
+    for (; parent != NULL; parent = parent->parent) {
+        --parent->size;
+    }
+}
+
+/**
+ *  解放済みノードのリストにノードを追加する.
+ *
+ *  @param  [in,out]    self    リストオブジェクト.
+ *  @param  [in]        node    追加するノード.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ *  @pre    @c node の非 NULL は呼び出し側で保証すること.
+ */
+static inline void list_push_released(struct list *self, struct list_node *node)
+{
+    node->prev = NULL;
+    if (self->released == NULL) {
+        node->next = NULL;
+    } else {
+        node->next = self->released;
+        self->released->prev = node;
+    }
+    self->released = node;
+}
+
+/**
+ *  リストの容量を拡張する.
+ *
+ *  @param  [in,out]    self    リストオブジェクト.
+ *  @return 成功時は, 0 が返る.
+ *          失敗時は, -1 が返り, errno が適切に設定される.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static int list_grow(struct list *self)
+{
+    struct pool_chunk *chunk;
+    size_t count;
+
+    count = pool_grow_count(&self->attr, self->capacity);
+    if (count == 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+    chunk = pool_chunk_alloc(self->attr.allocator, count,
+                             list_node_bytes(self->payload_bytes, &self->attr));
+    if (chunk == NULL) {
+        return -1;
+    }
+    pool_chunk_append(self->pool, chunk);
+    self->capacity += count;
+    self->fresh = chunk;
+    self->fresh_index = 0;
+
+    return 0;
+}
+
+/**
+ *  解放済みノードのリストからノードを取得する.
+ *  解放済みノードがない場合は未使用のノードを切り出し, それもない場合,
+ *  拡張可能であれば容量を拡張する.
+ *
+ *  @param  [in,out]    self    リストオブジェクト.
+ *  @return 成功時は, ノードのポインタが返る.
+ *          失敗時は, NULL が返り, errno が適切に設定される.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static inline struct list_node *list_pop_released(struct list *self)
+{
+    struct list_node *node = self->released;
+    size_t node_bytes = list_node_bytes(self->payload_bytes, &self->attr);
+    void *block;
+
+    if (node == NULL) {
+        block = pool_take_fresh(&self->fresh, &self->fresh_index, node_bytes);
+        if (block == NULL) {
+            if (list_grow(self) != 0) {
+                return NULL;
+            }
+            block = pool_take_fresh(&self->fresh, &self->fresh_index, node_bytes);
+        }
+        return (struct list_node *)((uintptr_t)block + list_rank_bytes(&self->attr));
+    }
+
+    self->released = node->next;
+    if (self->released != NULL) {
+        self->released->prev = NULL;
+    }
+
+    return node;
+}
+
+/**
+ *  リストの初期設定を行う.
+ *
+ *  @param  [in,out]    self            リストオブジェクト.
+ *  @param  [in]        pool            リストに使用するメモリプール.
+ *  @param  [in]        payload_bytes   データ部のサイズ.
+ *  @param  [in]        capacity        リストの容量.
+ *  @param  [in]        attr            リストの属性.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ *  @pre    @c pool の非 NULL は呼び出し側で保証すること.
+ */
+static inline void list_setup(struct list *self,
+                              struct pool_chunk *pool,
+                              size_t payload_bytes,
+                              size_t capacity,
+                              struct collection_attr attr)
+{
+    *self = LIST_INITIALIZER(pool, payload_bytes, capacity, attr);
+}
+
+/**
+ *  @details    @c iter の次の反復子を取得する.
+ *
+ *  @param      [in]    iter    リストの反復子.
+ *  @return     成功時は, 次の反復子が返る. 次の要素がない場合は NULL が返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+ITER iter_next(ITER iter)
+{
+    if (iter == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return (ITER)((struct list_node *)iter)->next;
+}
+
+/**
+ *  @details    @c iter のデータ部を取得する.
+ *
+ *  @param      [in]    iter    リストの反復子.
+ *  @return     成功時は, データ部のポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+void *iter_get_payload(ITER iter)
+{
+    if (iter == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return ((struct list_node *)iter)->payload;
+}
+
+/**
+ *  @details    空で, 指定の容量を備えた, @ref LIST オブジェクトを確保
+ *              および初期化する.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        リストの容量.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+LIST list_init(size_t payload_bytes, size_t capacity)
+{
+    return list_init_attr(payload_bytes, capacity, NULL);
+}
+
+/**
+ *  @details    空で, 指定の容量と属性を備えた, @ref LIST オブジェクトを確保
+ *              および初期化する.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        リストの初期容量.
+ *  @param      [in]    attr            リストの属性.
+ *                                      NULL の場合は @ref COLLECTION_ATTR_INITIALIZER
+ *                                      と同じ属性となる.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    拡張可能な場合, 容量の不足時に現在の容量と同数のノードを
+ *              追加で確保する. 確保済みのノードは移動しないため,
+ *              返却したデータ部のポインタは有効なままとなる.
+ */
+LIST list_init_attr(size_t payload_bytes,
+                    size_t capacity,
+                    const struct collection_attr *attr)
+{
+    struct collection_attr a = collection_attr_of(attr);
+    struct list *self;
+    struct pool_chunk *pool;
+
+    if ((payload_bytes == 0) || (capacity == 0)
+        || !collection_attr_is_valid(&a, capacity)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    self = allocator_alloc(a.allocator, sizeof(*self), 0);
+    pool = pool_chunk_alloc(a.allocator, capacity, list_node_bytes(payload_bytes, &a));
+    if ((self == NULL) || (pool == NULL)) {
+        pool_chunk_free_all(a.allocator, pool);
+        allocator_free(a.allocator, self, sizeof(*self));
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    list_setup(self, pool, payload_bytes, capacity, a);
+
+    return (LIST)self;
+}
+
+/**
+ *  @details    @c list を解放する.
+ *              @c list は @ref list_init の戻り値である必要がある.
+ *
+ *  @param      [in,out]    list    リストオブジェクト.
+ *  @warning    スレッドセーフではない.
+ */
+void list_release(LIST list)
+{
+    struct list *self = (struct list *)list;
+
+    if (self != NULL) {
+        pool_chunk_free_all(self->attr.allocator, self->pool);
+        allocator_free(self->attr.allocator, self, sizeof(*self));
+    }
+}
+
+/**
+ *  @details    @c list を空の状態にする.
+ *
+ *  @param      [in,out]    list    リストオブジェクト.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int list_clear(LIST list)
+{
+    struct list *self = (struct list *)list;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    list_setup(self, self->pool, self->payload_bytes, self->capacity, self->attr);
+
+    return 0;
+}
+
+/**
+ *  リストの先頭にノードを追加する.
+ *
+ *  @param  [in,out]    self    リストオブジェクト.
+ *  @param  [in,out]    node    追加するノード.
+ */
+void list_insert_head(struct list *self, struct list_node *node)
+{
+    if (self->root == NULL) {
+        self->root = self->last = node;
+    } else {
+        node->next = self->root;
+        self->root->prev = node;
+        self->root = node;
+    }
+}
+
+/**
+ *  リストの末尾にノードを追加する.
+ *
+ *  @param  [in,out]    self    リストオブジェクト.
+ *  @param  [in,out]    node    追加するノード.
+ */
+void list_insert_tail(struct list *self, struct list_node *node)
+{
+    if (self->last == NULL) {
+        self->root = self->last = node;
+    } else {
+        node->prev = self->last;
+        self->last->next = node;
+        self->last = node;
+    }
+}
+
+/**
+ *  リストの指定位置のノードを取得する.
+ *
+ *  @param  [in]    self    リストオブジェクト.
+ *  @param  [in]    index   位置.
+ *  @return ノードのポインタが返る. 範囲外の場合は NULL が返る.
+ *  @remarks    位置索引が有効な場合は O(log n), それ以外は O(n) となる.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static struct list_node *list_node_at(struct list *self, size_t index)
+{
+    struct list_node *node;
+
+    if (self->attr.indexed) {
+        return list_rank_at(self->ranks, index);
+    }
+
+    for (node = self->root; (node != NULL) && (index > 0); --index) {
+        node = node->next;
+    }
+
+    return node;
+}
+
+/**
+ *  @details    @c list の指定位置に, データ部が未初期化の要素を追加する.
+ *              データ部は呼び出し側で書き込むこと.
+ *
+ *  @param      [in,out]    list    リストオブジェクト.
+ *  @param      [in]        index   追加する位置.
+ *  @return     成功時は, 追加したリスト上のデータ部のポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    @c index が負数の場合はリストの最後に追加される.
+ *  @remarks    型付きのフロントエンドから, データ部のコピーを
+ *              インライン化するために使用する.
+ *  @warning    スレッドセーフではない.
+ *  @sa         list_insert
+ */
+void *list_insert_slot(LIST list, int index)
+{
+    struct list *self = (struct list *)list;
+    struct list_node *node;
+    struct list_node *iter;
+    size_t pos;
+
+    if ((self == NULL) || ((index > 0) && ((size_t)index > self->count))) {
+        errno = EINVAL;
+        return NULL;
+    }
+    pos = (index < 0) ? self->count : (size_t)index;
+
+    node = list_pop_released(self);
+    if (node == NULL) {
+        return NULL;
+    }
+    *node = LIST_NODE_INITIALIZER;
+
+    if (pos == 0) {
+        list_insert_head(self, node);
+    } else if (pos == self->count) {
+        list_insert_tail(self, node);
+    } else {
+        iter = list_node_at(self, pos);
+        node->next = iter;
+        node->prev = iter->prev;
+        node->prev->next = node;
+        iter->prev = node;
+    }
+    if (self->attr.indexed) {
+        list_rank_insert(self, pos, node);
+    }
+    ++self->count;
+
+    return node->payload;
+}
+
+/**
+ *  @details    @c list の指定位置に要素を追加する.
+ *
+ *  @param      [in,out]    list    リストオブジェクト.
+ *  @param      [in]        index   追加する位置.
+ *  @param      [in]        payload リストに追加するデータ.
+ *  @return     成功時は, 追加したリスト上のデータ部のポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    @c index が負数の場合はリストの最後に追加される.
+ *  @remarks    属性で位置索引を有効にした場合, 位置の探索は O(log n) となる.
+ *  @warning    スレッドセーフではない.
+ */
+void *list_insert(LIST list, int index, void *payload)
+{
+    struct list *self = (struct list *)list;
+    void *slot;
+
+    if ((self == NULL) || (payload == NULL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    slot = list_insert_slot(list, index);
+    if (slot != NULL) {
+        memcpy(slot, payload, self->payload_bytes);
+    }
+
+    return slot;
+}
+
+/**
+ *  @details    @c list の末尾に要素を追加する.
+ *
+ *  @param      [in,out]    list    リストオブジェクト.
+ *  @param      [in]        payload リストに追加するデータ部.
+ *  @return     成功時は, 追加したリスト上のデータ部のポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+void *list_add(LIST list, void *payload)
+{
+    return list_insert(list, -1, payload);
+}
+
+/**
+ *  リストの末尾に要素を追加する. (一括構築用)
+ *  位置の検証と探索を行わない.
+ *  位置索引を有効にしたリストでは, 追加を終えた後に @ref list_rank_seal を
+ *  呼び出すこと.
+ *
+ *  @param  [in,out]    self    リストオブジェクト.
+ *  @param  [in]        payload 追加するデータ.
+ *  @return 成功時は, 追加したデータ部のポインタが返る.
+ *          失敗時は, NULL が返り, errno が適切に設定される.
+ *  @pre    @c self および @c payload の非 NULL は呼び出し側で保証すること.
+ */
+static void *list_append(struct list *self, const void *payload)
+{
+    struct list_node *node;
+
+    node = list_pop_released(self);
+    if (node == NULL) {
+        return NULL;
+    }
+    *node = LIST_NODE_INITIALIZER;
+    if (self->attr.indexed) {
+        list_rank_append(self, self->last, node);
+    }
+    list_insert_tail(self, node);
+    memcpy(node->payload, payload, self->payload_bytes);
+    ++self->count;
+
+    return node->payload;
+}
+
+/**
+ *  @details    配列の要素を順に格納した @ref LIST オブジェクトを確保
+ *              および初期化する.
+ *              容量は要素の数とし, ノードは 1 つのチャンクにまとめて確保する.
+ *              要素の数が 0 の場合は, 容量 1 の空のリストとなる.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    array           要素の配列. @c count が 0 の場合は NULL でもよい.
+ *  @param      [in]    count           要素の数.
+ *  @param      [in]    attr            リストの属性.
+ *                                      NULL の場合は @ref COLLECTION_ATTR_INITIALIZER
+ *                                      と同じ属性となる.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    位置索引を有効にした場合も, 索引を末尾から組み立てるため,
+ *              要素の数に比例した時間で構築する.
+ *  @sa         list_init_attr
+ */
+LIST list_from_array(size_t payload_bytes,
+                     const void *array,
+                     size_t count,
+                     const struct collection_attr *attr)
+{
+    struct list *self;
+
+    if ((array == NULL) && (count != 0)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    self = (struct list *)list_init_attr(payload_bytes, (count == 0) ? 1 : count, attr);
+    if (self == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (list_append(self, (const char *)array + (payload_bytes * i)) == NULL) {
+            list_release((LIST)self);
+            return NULL;
+        }
+    }
+    list_rank_seal(self);
+
+    return (LIST)self;
+}
+
+/**
+ *  @details    @c list から指定のデータを削除する.
+ *
+ *  @param      [in,out]    list    リストオブジェクト.
+ *  @param      [in]        iter    削除する要素の反復子.
+ *  @return     成功時は 0 が返る.
+ *              失敗時は -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int list_remove(LIST list, ITER iter)
+{
+    struct list *self = (struct list *)list;
+    struct list_node *node;
+
+    if ((self == NULL) || (iter == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    node = (struct list_node *)iter;
+    --self->count;
+    if (self->root == node) {
+        self->root = node->next;
+    }
+    if (self->last == node) {
+        self->last = node->prev;
+    }
+    if (node->prev != NULL) {
+        node->prev->next = node->next;
+    }
+    if (node->next != NULL) {
+        node->next->prev = node->prev;
+    }
+    if (self->attr.indexed) {
+        list_rank_remove(self, node);
+    }
+
+    list_push_released(self, node);
+
+    return 0;
+}
+
+/**
+ *  @details    @c list の指定位置の要素を取得する.
+ *
+ *  @param      [in]    list    リストオブジェクト.
+ *  @param      [in]    index   取得する位置.
+ *  @return     成功時は, リスト上のデータ部のポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    属性で位置索引を有効にした場合は O(log n), それ以外は O(n) となる.
+ *  @warning    スレッドセーフではない.
+ */
+void *list_get(LIST list, size_t index)
+{
+    struct list *self = (struct list *)list;
+
+    if ((self == NULL) || (index >= self->count)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    return list_node_at(self, index)->payload;
+}
+
+/**
+ *  @details    @c list のデータ部のサイズを取得する.
+ *
+ *  @param      [in]    list    リストオブジェクト.
+ *  @return     成功時は, @c list のデータ部のサイズが返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+ssize_t list_payload_bytes(LIST list)
+{
+    struct list *self = (struct list *)list;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return self->payload_bytes;
+}
+
+/**
+ *  @details    @c list に追加されている要素の数を返す.
+ *
+ *  @param      [in]    list    リストオブジェクト.
  *  @return     成功時は, @c list に追加されている要素の数を返す.
  *              失敗時は, -1 が返り, errno が適切に設定される.
  *  @warning    スレッドセーフではない.
  */
-ssize_t list_count(LIST list)
+ssize_t list_count(LIST list)
+{
+    struct list *self = (struct list *)list;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return self->count;
+}
+
+/**
+ *  @details    @c list の反復子を取得する.
+ *
+ *  @code
+ *  for (ITER iter = list_iter(list);
+ *       iter != NULL;
+ *       iter = iter_next(iter)) {
+ *      void *payload = iter_get_payload(iter);
+ *  }
+ *  @endcode
+ *
+ *  @param      [in]    list    リストオブジェクト.
+ *  @return     成功時は, @c list の反復子が返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ *  @sa         iter_next, iter_get_payload
+ */
+ITER list_iter(LIST list)
+{
+    struct list *self = (struct list *)list;
+    if (self == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return (ITER)self->root;
+}
+
+/**
+ *  @details    @c list に積まれた要素を配列にコピーする.
+ *
+ *  @param      [in]    list    リストオブジェクト.
+ *  @param      [out]   array   確保した配列のポインタ.
+ *  @param      [out]   count   要素の数.
+ *  @return     成功時は, 0 が返り, @c array に確保された配列のポインタを
+ *              設定する. 要素がない場合は NULL を設定する.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @remarks    配列は @c list のメモリ割り当てで確保する. 解放は同じメモリ割り当てと
+ *              @c count × データ部のサイズで @ref allocator_free を呼び出す.
+ *              (システムから確保した場合は free でもよい)
+ *  @warning    スレッドセーフではない.
+ */
+int list_to_array(LIST list, void **array, size_t *count)
+{
+    struct list *self = (struct list *)list;
+    ITER iter;
+    void *buf;
+
+    if ((self == NULL) || (array == NULL) || (count == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (self->count == 0) {
+        *array = NULL;
+        *count = 0;
+        return 0;
+    }
+    buf = allocator_alloc(self->attr.allocator, self->payload_bytes * self->count, 0);
+    if (buf == NULL) {
+        return -1;
+    }
+    *array = buf;
+    *count = 0;
+    for (iter = list_iter(list); iter != NULL; iter = iter_next(iter)) {
+        memcpy(buf, iter_get_payload(iter), self->payload_bytes);
+        buf = (void *)((uintptr_t)buf + self->payload_bytes);
+        ++(*count);
+    }
+
+    return 0;
+}
+
+/**
+ *  スタックのセグメント構造体.
+ *
+ *  スロットは配列として連続に配置する. 容量の拡張時はセグメントを追加するため,
+ *  確保済みのスロットは移動しない.
+ */
+struct stack_seg {
+    struct stack_seg *prev; /**< 前のセグメントへのポインタ. */
+    struct stack_seg *next; /**< 次のセグメントへのポインタ. */
+    size_t capacity;        /**< セグメントに含まれるスロットの数. */
+    alignas(max_align_t) char slots[]; /**< スロット領域. 基本型の整列に合わせる. */
+};
+
+/**
+ *  スタック管理構造体.
+ *
+ *  スロットは反復子で辿れるよう @ref list_node と同じ形式とし,
+ *  next に 1 つ下のスロットを保持する.
+ */
+struct stack {
+    struct stack_seg *base;      /**< 最初のセグメント. */
+    struct stack_seg *seg;       /**< 最上位のスロットを含むセグメント. */
+    size_t used;                 /**< @c seg で使用中のスロットの数. */
+    struct list_node *top;       /**< 最上位のスロット. */
+    size_t payload_bytes;        /**< データ部のサイズ. */
+    size_t capacity;             /**< 確保したスロットの数. */
+    size_t count;                /**< 使用中のスロットの数. */
+    struct collection_attr attr; /**< 属性. */
+};
+
+/**
+ *  スタックの 1 スロットあたりのサイズを算出する.
+ *  スロットを連続して配置するため, 基本型の整列に切り上げる.
+ *
+ *  @param  [in]    payload_bytes   データ部のサイズ.
+ *  @return スロットのサイズが返る.
+ */
+static inline size_t stack_slot_bytes(size_t payload_bytes)
+{
+    return collection_align(sizeof(struct list_node) + payload_bytes);
+}
+
+/**
+ *  スタックのセグメントのサイズを算出する.
+ *
+ *  @param  [in]    capacity        スロットの数.
+ *  @param  [in]    payload_bytes   データ部のサイズ.
+ *  @return セグメントのサイズが返る.
+ */
+static inline size_t stack_seg_bytes(size_t capacity, size_t payload_bytes)
+{
+    return sizeof(struct stack_seg) + (capacity * stack_slot_bytes(payload_bytes));
+}
+
+/**
+ *  スタックのセグメントを確保する.
+ *
+ *  @param  [in]    allocator       メモリ割り当て.
+ *  @param  [in]    capacity        スロットの数.
+ *  @param  [in]    payload_bytes   データ部のサイズ.
+ *  @return 成功時は, 確保したセグメントのポインタが返る.
+ *          失敗時は, NULL が返り, errno が適切に設定される.
+ */
+static struct stack_seg *stack_seg_alloc(const struct allocator *allocator,
+                                         size_t capacity,
+                                         size_t payload_bytes)
+{
+    struct stack_seg *seg;
+
+    seg = allocator_alloc(allocator, stack_seg_bytes(capacity, payload_bytes), 0);
+    if (seg == NULL) {
+        return NULL;
+    }
+    seg->prev = NULL;
+    seg->next = NULL;
+    seg->capacity = capacity;
+
+    return seg;
+}
+
+/**
+ *  スタックを初期化する.
+ *
+ *  @param  [out]   self            スタックオブジェクト.
+ *  @param  [in]    seg             最初のセグメント.
+ *  @param  [in]    payload_bytes   データ部のサイズ.
+ *  @param  [in]    capacity        スタックの容量.
+ *  @param  [in]    attr            スタックの属性.
+ */
+static inline void stack_setup(struct stack *self,
+                               struct stack_seg *seg,
+                               size_t payload_bytes,
+                               size_t capacity,
+                               struct collection_attr attr)
+{
+    self->base = self->seg = seg;
+    self->used = 0;
+    self->top = NULL;
+    self->payload_bytes = payload_bytes;
+    self->capacity = capacity;
+    self->count = 0;
+    self->attr = attr;
+}
+
+/**
+ *  @details    空で, 指定の容量を備えた, @ref STACK オブジェクトを確保
+ *              および初期化する.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        スタックの容量.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+STACK stack_init(size_t payload_bytes, size_t capacity)
+{
+    return stack_init_attr(payload_bytes, capacity, NULL);
+}
+
+/**
+ *  @details    空で, 指定の容量と属性を備えた, @ref STACK オブジェクトを
+ *              確保および初期化する.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        スタックの初期容量.
+ *  @param      [in]    attr            スタックの属性.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @sa         list_init_attr
+ */
+STACK stack_init_attr(size_t payload_bytes,
+                      size_t capacity,
+                      const struct collection_attr *attr)
+{
+    struct collection_attr a = collection_attr_of(attr);
+    struct stack *self;
+    struct stack_seg *seg;
+
+    if ((payload_bytes == 0) || (capacity == 0)
+        || !collection_attr_is_valid(&a, capacity)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    self = allocator_alloc(a.allocator, sizeof(*self), 0);
+    seg = stack_seg_alloc(a.allocator, capacity, payload_bytes);
+    if ((self == NULL) || (seg == NULL)) {
+        if (seg != NULL) {
+            allocator_free(a.allocator, seg, stack_seg_bytes(capacity, payload_bytes));
+        }
+        allocator_free(a.allocator, self, sizeof(*self));
+        errno = ENOMEM;
+        return NULL;
+    }
+    stack_setup(self, seg, payload_bytes, capacity, a);
+
+    return (STACK)self;
+}
+
+/**
+ *  @details    指定の容量のスタックを @ref stack_init_in で配置するために
+ *              必要なサイズを取得する.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        スタックの容量.
+ *  @return     成功時は, 必要なサイズが返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+ssize_t stack_required_size(size_t payload_bytes, size_t capacity)
+{
+    if ((payload_bytes == 0) || (capacity == 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return (ssize_t)(collection_align(sizeof(struct stack))
+                     + stack_seg_bytes(capacity, payload_bytes));
+}
+
+/**
+ *  @details    空で, 指定の容量を備えた, @ref STACK オブジェクトを
+ *              呼び出し側の領域に配置および初期化する.
+ *
+ *  @param      [out]   buffer          配置する領域. 基本型に整列していること.
+ *  @param      [in]    size            @c buffer のサイズ.
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        スタックの容量.
+ *  @return     成功時は, 初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *              @c size が @ref stack_required_size に満たない場合,
+ *              errno には ENOMEM が設定される.
+ *  @remarks    メモリを確保しない. 容量は拡張しない.
+ *              @ref stack_release は領域を解放しないため, 呼び出してもよい.
+ */
+STACK stack_init_in(void *buffer, size_t size, size_t payload_bytes, size_t capacity)
+{
+    struct collection_attr a = COLLECTION_ATTR_INITIALIZER;
+    ssize_t required = stack_required_size(payload_bytes, capacity);
+    struct stack *self = buffer;
+    struct stack_seg *seg;
+
+    if ((required < 0) || !collection_buffer_is_valid(buffer, size, (size_t)required)) {
+        return NULL;
+    }
+
+    a.allocator = &allocator_none;
+    seg = (struct stack_seg *)((uintptr_t)buffer + collection_align(sizeof(*self)));
+    seg->prev = NULL;
+    seg->next = NULL;
+    seg->capacity = capacity;
+    stack_setup(self, seg, payload_bytes, capacity, a);
+
+    return (STACK)self;
+}
+
+/**
+ *  @details    @c stack を解放する.
+ *              @c stack は @ref stack_init の戻り値である必要がある.
+ *
+ *  @param      [in,out]    stack   スタックオブジェクト.
+ *  @warning    スレッドセーフではない.
+ */
+void stack_release(STACK stack)
+{
+    struct stack *self = (struct stack *)stack;
+
+    if (self != NULL) {
+        struct stack_seg *seg = self->base;
+        while (seg != NULL) {
+            struct stack_seg *next = seg->next;
+            allocator_free(self->attr.allocator, seg,
+                           stack_seg_bytes(seg->capacity, self->payload_bytes));
+            seg = next;
+        }
+        allocator_free(self->attr.allocator, self, sizeof(*self));
+    }
+}
+
+/**
+ *  @details    @c stack を空の状態にする.
+ *
+ *  @param      [in,out]    stack   スタックオブジェクト.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int stack_clear(STACK stack)
+{
+    struct stack *self = (struct stack *)stack;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    self->seg = self->base;
+    self->used = 0;
+    self->top = NULL;
+    self->count = 0;
+
+    return 0;
+}
+
+/**
+ *  @details    @c stack に, データ部が未初期化の要素を積む.
+ *              データ部は呼び出し側で書き込むこと.
+ *
+ *  @param      [in,out]    stack   スタックオブジェクト.
+ *  @return     成功時は, 積んだスタック上のデータ部のポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    型付きのフロントエンドから, データ部のコピーを
+ *              インライン化するために使用する.
+ *  @warning    スレッドセーフではない.
+ *  @sa         stack_push
+ */
+void *stack_push_slot(STACK stack)
+{
+    struct stack *self = (struct stack *)stack;
+    struct list_node *slot;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (self->used == self->seg->capacity) {
+        if (self->seg->next == NULL) {
+            size_t count = pool_grow_count(&self->attr, self->capacity);
+            struct stack_seg *seg;
+            if (count == 0) {
+                errno = ENOMEM;
+                return NULL;
+            }
+            seg = stack_seg_alloc(self->attr.allocator, count, self->payload_bytes);
+            if (seg == NULL) {
+                return NULL;
+            }
+            seg->prev = self->seg;
+            self->seg->next = seg;
+            self->capacity += count;
+        }
+        self->seg = self->seg->next;
+        self->used = 0;
+    }
+
+    slot = (struct list_node *)((uintptr_t)self->seg->slots
+                                + (stack_slot_bytes(self->payload_bytes) * self->used));
+    /* 反復子は next のみを辿るため, prev は設定しない. */
+    slot->next = self->top;
+    self->top = slot;
+    ++self->used;
+    ++self->count;
+
+    return slot->payload;
+}
+
+/**
+ *  @details    @c stack に要素を積む.
+ *
+ *  @param      [in,out]    stack   スタックオブジェクト.
+ *  @param      [in]        payload スタックに積むデータ.
+ *  @return     成功時は, 積んだスタック上のデータ部のポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+void *stack_push(STACK stack, void *payload)
+{
+    struct stack *self = (struct stack *)stack;
+    void *slot;
+
+    if ((self == NULL) || (payload == NULL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    slot = stack_push_slot(stack);
+    if (slot != NULL) {
+        memcpy(slot, payload, self->payload_bytes);
+    }
+
+    return slot;
+}
+
+/**
+ *  @details    @c stack から最初の要素を取り除き, そのデータ部を返す.
+ *
+ *  @param      [in,out]    stack   スタックオブジェクト.
+ *  @return     成功時は, 取り除いた要素のデータ部のポインタが返る.
+ *              データ部は次に要素を積むまで有効.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    型付きのフロントエンドから, データ部のコピーを
+ *              インライン化するために使用する.
+ *  @warning    スレッドセーフではない.
+ *  @sa         stack_pop
+ */
+void *stack_pop_slot(STACK stack)
+{
+    struct stack *self = (struct stack *)stack;
+    struct list_node *slot;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (self->top == NULL) {
+        errno = EAGAIN;
+        return NULL;
+    }
+
+    slot = self->top;
+    self->top = slot->next;
+    --self->count;
+    if ((--self->used == 0) && (self->seg->prev != NULL)) {
+        self->seg = self->seg->prev;
+        self->used = self->seg->capacity;
+    }
+
+    return slot->payload;
+}
+
+/**
+ *  @details    @c stack から, 最初の要素を取り除く.
+ *
+ *  @param      [in,out]    stack   スタックオブジェクト.
+ *  @param      [out]       payload データ部をコピーするバッファ.
+ *  @return     成功時は, @c stack に残っている要素の数が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int stack_pop(STACK stack, void *payload)
+{
+    struct stack *self = (struct stack *)stack;
+    void *slot;
+
+    if ((self == NULL) || (payload == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    slot = stack_pop_slot(stack);
+    if (slot == NULL) {
+        return -1;
+    }
+    memcpy(payload, slot, self->payload_bytes);
+
+    return self->count;
+}
+
+/**
+ *  @details    @c stack に積まれている要素の数を返す.
+ *
+ *  @param      [in]    stack   スタックオブジェクト.
+ *  @return     成功時は, @c stack に積まれている要素の数を返す.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+ssize_t stack_count(STACK stack)
+{
+    struct stack *self = (struct stack *)stack;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return self->count;
+}
+
+/**
+ *  @details    @c stack の反復子を取得する.
+ *              反復子は最上位の要素から順に辿る.
+ *
+ *  @code
+ *  for (ITER iter = stack_iter(stack);
+ *       iter != NULL;
+ *       iter = iter_next(iter)) {
+ *      void *payload = iter_get_payload(iter);
+ *  }
+ *  @endcode
+ *
+ *  @param      [in]    stack   スタックオブジェクト.
+ *  @return     成功時は, @c stack の反復子が返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ *  @sa         iter_next, iter_get_payload
+ */
+ITER stack_iter(STACK stack)
+{
+    struct stack *self = (struct stack *)stack;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    return (ITER)self->top;
+}
+
+/**
+ *  キューのリングバッファ構造体.
+ *
+ *  スロット数は 2 のべき乗とし, 先頭と末尾の位置は剰余を取らずに
+ *  単調増加させる.
+ */
+struct queue_ring {
+    struct queue_ring *next; /**< 次のリングバッファへのポインタ. */
+    size_t capacity;         /**< 格納できる要素の数. */
+    size_t mask;             /**< スロット数 - 1. */
+    size_t head;             /**< 先頭の位置. */
+    size_t tail;             /**< 末尾の位置. */
+    alignas(max_align_t) char slots[]; /**< スロット領域. 基本型の整列に合わせる. */
+};
+
+/**
+ *  キュー管理構造体.
+ *
+ *  容量の拡張時はリングバッファを追加し, 既存のリングバッファが空に
+ *  なった時点で予備として末尾に回す. そのため確保済みのスロットは移動しない.
+ *  スロットは反復子で辿れるよう @ref list_node と同じ形式とし,
+ *  next に 1 つ後のスロットを保持する.
+ */
+struct queue {
+    struct queue_ring *first;    /**< 取り出し側のリングバッファ. */
+    struct queue_ring *last;     /**< 追加側のリングバッファ. */
+    struct list_node *back;      /**< 最後に追加したスロット. */
+    size_t payload_bytes;        /**< データ部のサイズ. */
+    size_t slot_bytes;           /**< スロットのサイズ. */
+    size_t capacity;             /**< 確保したスロットの数. */
+    size_t count;                /**< 使用中のスロットの数. */
+    struct collection_attr attr; /**< 属性. */
+};
+
+/**
+ *  キューのリングバッファのスロット数を算出する.
+ *
+ *  @param  [in]    capacity    格納できる要素の数.
+ *  @return スロット数 (2 のべき乗) が返る.
+ */
+static inline size_t queue_ring_slots(size_t capacity)
+{
+    size_t size = 1;
+
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    return size;
+}
+
+/**
+ *  キューの 1 スロットあたりのサイズを算出する.
+ *  スロットを連続して配置するため, 基本型の整列に切り上げる.
+ *
+ *  @param  [in]    payload_bytes   データ部のサイズ.
+ *  @return スロットのサイズが返る.
+ */
+static inline size_t queue_slot_bytes(size_t payload_bytes)
+{
+    return collection_align(sizeof(struct list_node) + payload_bytes);
+}
+
+/**
+ *  キューのリングバッファのサイズを算出する.
+ *
+ *  @param  [in]    capacity    格納できる要素の数.
+ *  @param  [in]    slot_bytes  スロットのサイズ.
+ *  @return リングバッファのサイズが返る.
+ */
+static inline size_t queue_ring_bytes(size_t capacity, size_t slot_bytes)
+{
+    return sizeof(struct queue_ring) + (queue_ring_slots(capacity) * slot_bytes);
+}
+
+/**
+ *  キューのリングバッファを初期化する.
+ *
+ *  @param  [out]   ring        リングバッファ.
+ *  @param  [in]    capacity    格納できる要素の数.
+ */
+static inline void queue_ring_setup(struct queue_ring *ring, size_t capacity)
+{
+    ring->next = NULL;
+    ring->capacity = capacity;
+    ring->mask = queue_ring_slots(capacity) - 1;
+    ring->head = ring->tail = 0;
+}
+
+/**
+ *  キューのリングバッファを確保する.
+ *
+ *  @param  [in]    allocator   メモリ割り当て.
+ *  @param  [in]    capacity    格納できる要素の数.
+ *  @param  [in]    slot_bytes  スロットのサイズ.
+ *  @return 成功時は, 確保したリングバッファのポインタが返る.
+ *          失敗時は, NULL が返り, errno が適切に設定される.
+ */
+static struct queue_ring *queue_ring_alloc(const struct allocator *allocator,
+                                           size_t capacity,
+                                           size_t slot_bytes)
+{
+    struct queue_ring *ring;
+
+    ring = allocator_alloc(allocator, queue_ring_bytes(capacity, slot_bytes), 0);
+    if (ring == NULL) {
+        return NULL;
+    }
+    queue_ring_setup(ring, capacity);
+
+    return ring;
+}
+
+/**
+ *  キューのリングバッファを解放する.
+ *
+ *  @param  [in]        allocator   確保時のメモリ割り当て.
+ *  @param  [in,out]    ring        リングバッファ.
+ *  @param  [in]        slot_bytes  スロットのサイズ.
+ */
+static inline void queue_ring_free(const struct allocator *allocator,
+                                   struct queue_ring *ring,
+                                   size_t slot_bytes)
+{
+    if (ring != NULL) {
+        allocator_free(allocator, ring, sizeof(*ring) + ((ring->mask + 1) * slot_bytes));
+    }
+}
+
+/**
+ *  リングバッファの指定位置のスロットを取得する.
+ *
+ *  @param  [in]    ring        リングバッファ.
+ *  @param  [in]    pos         位置.
+ *  @param  [in]    slot_bytes  スロットのサイズ.
+ *  @return スロットのポインタが返る.
+ */
+static inline struct list_node *queue_ring_slot(struct queue_ring *ring,
+                                                size_t pos,
+                                                size_t slot_bytes)
+{
+    return (struct list_node *)((uintptr_t)ring->slots + ((pos & ring->mask) * slot_bytes));
+}
+
+/**
+ *  キューの容量の拡張で追加するスロットの数を算出する.
+ *
+ *  取り出し側のリングバッファの先頭の空きは再利用できないため,
+ *  最大の容量は確保したスロットの数ではなく, 格納中の要素の数に対して適用する.
+ *
+ *  @param  [in]    self    キューオブジェクト.
+ *  @return 追加するスロットの数が返る. 拡張できない場合は 0 が返る.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static inline size_t queue_grow_count(const struct queue *self)
+{
+    size_t count = self->capacity;
+
+    if (!self->attr.growable) {
+        return 0;
+    }
+    if (self->attr.max_capacity != 0) {
+        if (self->count >= self->attr.max_capacity) {
+            return 0;
+        }
+        if (count > (self->attr.max_capacity - self->count)) {
+            count = self->attr.max_capacity - self->count;
+        }
+    }
+
+    return count;
+}
+
+/**
+ *  空になった取り出し側のリングバッファを予備として末尾に回す.
+ *
+ *  @param  [in,out]    self    キューオブジェクト.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static inline void queue_retire(struct queue *self)
+{
+    while ((self->first != self->last) && (self->first->head == self->first->tail)) {
+        struct queue_ring *ring = self->first;
+        self->first = ring->next;
+        ring->head = ring->tail = 0;
+        ring->next = self->last->next;
+        self->last->next = ring;
+    }
+}
+
+/**
+ *  キューを初期化する.
+ *
+ *  @param  [out]   self            キューオブジェクト.
+ *  @param  [in]    ring            最初のリングバッファ.
+ *  @param  [in]    payload_bytes   データ部のサイズ.
+ *  @param  [in]    capacity        キューの容量.
+ *  @param  [in]    attr            キューの属性.
+ */
+static inline void queue_setup(struct queue *self,
+                               struct queue_ring *ring,
+                               size_t payload_bytes,
+                               size_t capacity,
+                               struct collection_attr attr)
+{
+    self->first = self->last = ring;
+    self->back = NULL;
+    self->payload_bytes = payload_bytes;
+    self->slot_bytes = queue_slot_bytes(payload_bytes);
+    self->capacity = capacity;
+    self->count = 0;
+    self->attr = attr;
+}
+
+/**
+ *  @details    空で, 指定の容量を備えた, @ref QUEUE オブジェクトを
+ *              確保および初期化する.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        キューの容量.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+QUEUE queue_init(size_t payload_bytes, size_t capacity)
+{
+    return queue_init_attr(payload_bytes, capacity, NULL);
+}
+
+/**
+ *  @details    空で, 指定の容量と属性を備えた, @ref QUEUE オブジェクトを
+ *              確保および初期化する.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        キューの初期容量.
+ *  @param      [in]    attr            キューの属性.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    拡張可能な場合, 最大の容量は格納中の要素の数に対して適用する.
+ *              取り出し側のリングバッファの空きは再利用できないため,
+ *              確保するスロットの数は最大の容量を超えることがある.
+ *  @sa         list_init_attr
+ */
+QUEUE queue_init_attr(size_t payload_bytes,
+                      size_t capacity,
+                      const struct collection_attr *attr)
+{
+    struct collection_attr a = collection_attr_of(attr);
+    struct queue *self;
+    struct queue_ring *ring;
+    size_t slot_bytes = queue_slot_bytes(payload_bytes);
+
+    if ((payload_bytes == 0) || (capacity == 0)
+        || !collection_attr_is_valid(&a, capacity)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    self = allocator_alloc(a.allocator, sizeof(*self), 0);
+    ring = queue_ring_alloc(a.allocator, capacity, slot_bytes);
+    if ((self == NULL) || (ring == NULL)) {
+        queue_ring_free(a.allocator, ring, slot_bytes);
+        allocator_free(a.allocator, self, sizeof(*self));
+        errno = ENOMEM;
+        return NULL;
+    }
+    queue_setup(self, ring, payload_bytes, capacity, a);
+
+    return (QUEUE)self;
+}
+
+/**
+ *  @details    指定の容量のキューを @ref queue_init_in で配置するために
+ *              必要なサイズを取得する.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        キューの容量.
+ *  @return     成功時は, 必要なサイズが返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+ssize_t queue_required_size(size_t payload_bytes, size_t capacity)
+{
+    if ((payload_bytes == 0) || (capacity == 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return (ssize_t)(collection_align(sizeof(struct queue))
+                     + queue_ring_bytes(capacity, queue_slot_bytes(payload_bytes)));
+}
+
+/**
+ *  @details    空で, 指定の容量を備えた, @ref QUEUE オブジェクトを
+ *              呼び出し側の領域に配置および初期化する.
+ *
+ *  @param      [out]   buffer          配置する領域. 基本型に整列していること.
+ *  @param      [in]    size            @c buffer のサイズ.
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        キューの容量.
+ *  @return     成功時は, 初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *              @c size が @ref queue_required_size に満たない場合,
+ *              errno には ENOMEM が設定される.
+ *  @remarks    メモリを確保しない. 容量は拡張しない.
+ *              @ref queue_release は領域を解放しないため, 呼び出してもよい.
+ */
+QUEUE queue_init_in(void *buffer, size_t size, size_t payload_bytes, size_t capacity)
+{
+    struct collection_attr a = COLLECTION_ATTR_INITIALIZER;
+    ssize_t required = queue_required_size(payload_bytes, capacity);
+    struct queue *self = buffer;
+    struct queue_ring *ring;
+
+    if ((required < 0) || !collection_buffer_is_valid(buffer, size, (size_t)required)) {
+        return NULL;
+    }
+
+    a.allocator = &allocator_none;
+    ring = (struct queue_ring *)((uintptr_t)buffer + collection_align(sizeof(*self)));
+    queue_ring_setup(ring, capacity);
+    queue_setup(self, ring, payload_bytes, capacity, a);
+
+    return (QUEUE)self;
+}
+
+/**
+ *  @details    @c que を解放する.
+ *              @c que は @ref queue_init の戻り値である必要がある.
+ *
+ *  @param      [in,out]    que キューオブジェクト.
+ *  @warning    スレッドセーフではない.
+ */
+void queue_release(QUEUE que)
+{
+    struct queue *self = (struct queue *)que;
+
+    if (self != NULL) {
+        struct queue_ring *ring = self->first;
+        while (ring != NULL) {
+            struct queue_ring *next = ring->next;
+            queue_ring_free(self->attr.allocator, ring, self->slot_bytes);
+            ring = next;
+        }
+        allocator_free(self->attr.allocator, self, sizeof(*self));
+    }
+}
+
+/**
+ *  @details    @c que を空の状態にする.
+ *
+ *  @param      [in,out]    que キューオブジェクト.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int queue_clear(QUEUE que)
+{
+    struct queue *self = (struct queue *)que;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (struct queue_ring *ring = self->first; ring != NULL; ring = ring->next) {
+        ring->head = ring->tail = 0;
+    }
+    self->last = self->first;
+    self->back = NULL;
+    self->count = 0;
+
+    return 0;
+}
+
+/**
+ *  @details    @c que の最後に, データ部が未初期化の要素を追加する.
+ *              データ部は呼び出し側で書き込むこと.
+ *
+ *  @param      [in,out]    que     キューオブジェクト.
+ *  @return     成功時は, 追加したキュー上のデータ部のポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    型付きのフロントエンドから, データ部のコピーを
+ *              インライン化するために使用する.
+ *  @warning    スレッドセーフではない.
+ *  @sa         queue_enq
+ */
+void *queue_enq_slot(QUEUE que)
+{
+    struct queue *self = (struct queue *)que;
+    struct queue_ring *ring;
+    struct list_node *slot;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (self->attr.growable && (self->attr.max_capacity != 0)
+        && (self->count >= self->attr.max_capacity)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    ring = self->last;
+    if ((ring->tail - ring->head) == ring->capacity) {
+        if (ring->next == NULL) {
+            size_t count = queue_grow_count(self);
+            if (count == 0) {
+                errno = ENOMEM;
+                return NULL;
+            }
+            ring->next = queue_ring_alloc(self->attr.allocator, count, self->slot_bytes);
+            if (ring->next == NULL) {
+                return NULL;
+            }
+            self->capacity += count;
+        }
+        ring = self->last = ring->next;
+    }
+
+    slot = queue_ring_slot(ring, ring->tail++, self->slot_bytes);
+    /* 反復子は next のみを辿るため, prev は設定しない. */
+    slot->next = NULL;
+    if (self->back != NULL) {
+        self->back->next = slot;
+    }
+    self->back = slot;
+    ++self->count;
+
+    return slot->payload;
+}
+
+/**
+ *  @details    @c que の最後に要素を追加する.
+ *
+ *  @param      [in,out]    que     キューオブジェクト.
+ *  @param      [in]        payload キューに追加するデータ.
+ *  @return     成功時は, 追加したキュー上のデータ部のポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+void *queue_enq(QUEUE que, void *payload)
+{
+    struct queue *self = (struct queue *)que;
+    void *slot;
+
+    if ((self == NULL) || (payload == NULL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    slot = queue_enq_slot(que);
+    if (slot != NULL) {
+        memcpy(slot, payload, self->payload_bytes);
+    }
+
+    return slot;
+}
+
+/**
+ *  @details    @c que の最初の要素を削除し, そのデータ部を返す.
+ *
+ *  @param      [in,out]    que     キューオブジェクト.
+ *  @return     成功時は, 削除した要素のデータ部のポインタが返る.
+ *              データ部は次に要素を追加するまで有効.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    型付きのフロントエンドから, データ部のコピーを
+ *              インライン化するために使用する.
+ *  @warning    スレッドセーフではない.
+ *  @sa         queue_deq
+ */
+void *queue_deq_slot(QUEUE que)
+{
+    struct queue *self = (struct queue *)que;
+    struct list_node *slot;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (self->count == 0) {
+        errno = EAGAIN;
+        return NULL;
+    }
+
+    slot = queue_ring_slot(self->first, self->first->head++, self->slot_bytes);
+    if (--self->count == 0) {
+        self->back = NULL;
+    }
+    queue_retire(self);
+
+    return slot->payload;
+}
+
+/**
+ *  @details    @c que の最初の要素をコピーし, 削除する.
+ *
+ *  @param      [in,out]    que     キューオブジェクト.
+ *  @param      [out]       payload データ部をコピーするバッファ.
+ *  @return     成功時は, @c que に残っている要素の数が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int queue_deq(QUEUE que, void *payload)
+{
+    struct queue *self = (struct queue *)que;
+    void *slot;
+
+    if ((self == NULL) || (payload == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    slot = queue_deq_slot(que);
+    if (slot == NULL) {
+        return -1;
+    }
+    memcpy(payload, slot, self->payload_bytes);
+
+    return self->count;
+}
+
+/**
+ *  @details    @c que に積まれた要素の数を返す.
+ *
+ *  @param      [in]    que キューオブジェクト.
+ *  @return     成功時は, @c que に積まれた要素の数を返す.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+ssize_t queue_count(QUEUE que)
+{
+    struct queue *self = (struct queue *)que;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return self->count;
+}
+
+/**
+ *  @details    @c que の反復子を取得する.
+ *
+ *  @code
+ *  for (ITER iter = queue_iter(que);
+ *       iter != NULL;
+ *       iter = iter_next(iter)) {
+ *      void *payload = iter_get_payload(iter);
+ *  }
+ *  @endcode
+ *
+ *  @param      [in]    que キューオブジェクト.
+ *  @return     成功時は, @c que の反復子が返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ *  @sa         iter_next, iter_get_payload
+ */
+ITER queue_iter(QUEUE que)
+{
+    struct queue *self = (struct queue *)que;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (self->count == 0) {
+        return NULL;
+    }
+
+    return (ITER)queue_ring_slot(self->first, self->first->head, self->slot_bytes);
+}
+
+/**
+ *  @details    @c que の先頭から連続して配置された要素の領域を取得する.
+ *              要素はコピーされないため, 取得した領域を直接参照できる.
+ *              リングバッファの折り返しにより, 領域は最大 2 つとなる.
+ *              i 番目の要素のデータ部は
+ *              <tt>(char *)span.base + (i * span.stride)</tt> となる.
+ *
+ *  @code
+ *  struct queue_span spans[2];
+ *  ssize_t n = queue_peek_spans(que, spans);
+ *  for (ssize_t s = 0; s < n; ++s) {
+ *      for (size_t i = 0; i < spans[s].count; ++i) {
+ *          void *payload = (char *)spans[s].base + (i * spans[s].stride);
+ *      }
+ *  }
+ *  @endcode
+ *
+ *  @param      [in]    que     キューオブジェクト.
+ *  @param      [out]   spans   領域を格納する配列.
+ *  @return     成功時は, 取得した領域の数 (0 から 2) が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @remarks    容量の拡張により複数のリングバッファがある場合は,
+ *              取り出し側のリングバッファの領域のみを返す.
+ *              @ref queue_consume で取り除いた後に再度呼び出すこと.
+ *  @warning    スレッドセーフではない.
+ *  @sa         queue_consume
+ */
+ssize_t queue_peek_spans(QUEUE que, struct queue_span spans[2])
+{
+    struct queue *self = (struct queue *)que;
+    struct queue_ring *ring;
+    size_t count;
+    size_t head;
+    size_t first;
+
+    if ((self == NULL) || (spans == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    ring = self->first;
+    count = ring->tail - ring->head;
+    if (count == 0) {
+        return 0;
+    }
+
+    head = ring->head & ring->mask;
+    first = ring->mask + 1 - head;
+    if (first > count) {
+        first = count;
+    }
+    spans[0].base = queue_ring_slot(ring, head, self->slot_bytes)->payload;
+    spans[0].count = first;
+    spans[0].stride = self->slot_bytes;
+    if (first == count) {
+        return 1;
+    }
+    spans[1].base = queue_ring_slot(ring, 0, self->slot_bytes)->payload;
+    spans[1].count = count - first;
+    spans[1].stride = self->slot_bytes;
+
+    return 2;
+}
+
+/**
+ *  @details    @c que の先頭から指定の数の要素を取り除く.
+ *
+ *  @param      [in,out]    que     キューオブジェクト.
+ *  @param      [in]        count   取り除く要素の数.
+ *  @return     成功時は, @c que に残っている要素の数が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ *  @sa         queue_peek_spans
+ */
+int queue_consume(QUEUE que, size_t count)
+{
+    struct queue *self = (struct queue *)que;
+
+    if ((self == NULL) || (count > self->count)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    self->count -= count;
+    while (count > 0) {
+        struct queue_ring *ring = self->first;
+        size_t n = ring->tail - ring->head;
+        if (n > count) {
+            n = count;
+        }
+        ring->head += n;
+        count -= n;
+        queue_retire(self);
+    }
+    if (self->count == 0) {
+        self->back = NULL;
+    }
+
+    return self->count;
+}
+
+/**
+ *  @details    @c que に積まれた要素を配列にコピーする.
+ *
+ *  @param      [in]    que     キューオブジェクト.
+ *  @param      [out]   array   確保した配列のポインタ.
+ *  @param      [out]   count   要素の数.
+ *  @return     成功時は, 0 が返り, @c array に確保された配列のポインタを
+ *              設定する. 要素がない場合は NULL を設定する.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @remarks    配列は @c que のメモリ割り当てで確保する. 解放は同じメモリ割り当てと
+ *              @c count × データ部のサイズで @ref allocator_free を呼び出す.
+ *              (システムから確保した場合は free でもよい)
+ *  @warning    スレッドセーフではない.
+ */
+int queue_to_array(QUEUE que, void **array, size_t *count)
+{
+    struct queue *self = (struct queue *)que;
+    char *buf;
+
+    if ((self == NULL) || (array == NULL) || (count == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (self->count == 0) {
+        *array = NULL;
+        *count = 0;
+        return 0;
+    }
+    buf = allocator_alloc(self->attr.allocator, self->payload_bytes * self->count, 0);
+    if (buf == NULL) {
+        return -1;
+    }
+    *array = buf;
+    *count = self->count;
+    for (struct queue_ring *ring = self->first; ring != NULL; ring = ring->next) {
+        for (size_t pos = ring->head; pos != ring->tail; ++pos) {
+            memcpy(buf, queue_ring_slot(ring, pos, self->slot_bytes)->payload, self->payload_bytes);
+            buf += self->payload_bytes;
+        }
+        if (ring == self->last) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ *  セット管理構造体.
+ *
+ *  要素はリストに挿入順で保持し, ハッシュ索引で重複を検出する.
+ */
+struct set {
+    LIST list;                /**< 挿入順に要素を保持するリスト. */
+    struct hindex index;      /**< データ部のハッシュ索引. */
+};
+
+/**
+ *  @details    空で, 指定の容量を備えた, @ref SET オブジェクトを確保
+ *              および初期化する.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        セットの容量.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+SET set_init(size_t payload_bytes, size_t capacity)
+{
+    return set_init_attr(payload_bytes, capacity, NULL);
+}
+
+/**
+ *  @details    空で, 指定の容量と属性を備えた, @ref SET オブジェクトを
+ *              確保および初期化する.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        セットの初期容量.
+ *  @param      [in]    attr            セットの属性.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @sa         list_init_attr
+ */
+SET set_init_attr(size_t payload_bytes,
+                  size_t capacity,
+                  const struct collection_attr *attr)
+{
+    struct collection_attr a = collection_attr_of(attr);
+    const struct allocator *allocator = a.allocator;
+    struct set *self;
+
+    self = allocator_alloc(allocator, sizeof(*self), 0);
+    if (self == NULL) {
+        return NULL;
+    }
+    self->list = list_init_attr(payload_bytes, capacity, &a);
+    if (self->list == NULL) {
+        allocator_free(allocator, self, sizeof(*self));
+        return NULL;
+    }
+    if (hindex_init(&self->index, payload_bytes, capacity, allocator) != 0) {
+        list_release(self->list);
+        allocator_free(allocator, self, sizeof(*self));
+        return NULL;
+    }
+
+    return (SET)self;
+}
+
+/**
+ *  @details    @c set を解放する.
+ *              @c set は @ref set_init の戻り値である必要がある.
+ *
+ *  @param      [in,out]    set セットオブジェクト.
+ *  @warning    スレッドセーフではない.
+ */
+void set_release(SET set)
+{
+    struct set *self = (struct set *)set;
+
+    if (self != NULL) {
+        const struct allocator *allocator = self->index.allocator;
+        list_release(self->list);
+        hindex_release(&self->index);
+        allocator_free(allocator, self, sizeof(*self));
+    }
+}
+
+/**
+ *  @details    @c set を空の状態にする.
+ *
+ *  @param      [in,out]    set セットオブジェクト.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int set_clear(SET set)
+{
+    struct set *self = (struct set *)set;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    hindex_clear(&self->index);
+
+    return list_clear(self->list);
+}
+
+/**
+ *  @details    @c set に要素を追加する.
+ *              指定データがすでに追加されている場合は何もしない.
+ *
+ *  @param      [in,out]    set     セットオブジェクト.
+ *  @param      [in]        payload セットに追加するデータ.
+ *  @return     成功時は, 追加したセット上のデータ部のポインタが返る.
+ *              すでに追加されている場合は, そのデータ部のポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+void *set_add(SET set, void *payload)
+{
+    struct set *self = (struct set *)set;
+    struct hindex_slot *slot;
+    size_t hash;
+    void *p;
+
+    if ((self == NULL) || (payload == NULL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (hindex_reserve(&self->index) != 0) {
+        return NULL;
+    }
+
+    hash = hindex_hash(payload, self->index.payload_bytes);
+    slot = hindex_probe(&self->index, payload, hash);
+    if (slot->epoch == self->index.epoch) {
+        return slot->payload;
+    }
+
+    p = list_insert(self->list, -1, payload);
+    if (p == NULL) {
+        return NULL;
+    }
+    hindex_put(&self->index, slot, hash, p);
+
+    return p;
+}
+
+/**
+ *  @details    配列の要素を格納した @ref SET オブジェクトを確保および初期化する.
+ *              重複する要素は最初のもののみを格納する.
+ *              要素の数が 0 の場合は, 容量 1 の空のセットとなる.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    array           要素の配列. @c count が 0 の場合は NULL でもよい.
+ *  @param      [in]    count           要素の数.
+ *  @param      [in]    attr            セットの属性.
+ *                                      NULL の場合は @ref COLLECTION_ATTR_INITIALIZER
+ *                                      と同じ属性となる.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    容量とハッシュ索引は要素の数に合わせて確保するため,
+ *              構築中に拡張せず, 要素の数に比例した時間で構築する.
+ *  @sa         set_init_attr
+ */
+SET set_from_array(size_t payload_bytes,
+                   const void *array,
+                   size_t count,
+                   const struct collection_attr *attr)
+{
+    struct set *self;
+
+    if ((array == NULL) && (count != 0)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    self = (struct set *)set_init_attr(payload_bytes, (count == 0) ? 1 : count, attr);
+    if (self == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const void *payload = (const char *)array + (payload_bytes * i);
+        size_t hash = hindex_hash(payload, payload_bytes);
+        struct hindex_slot *slot = hindex_probe(&self->index, payload, hash);
+        if (slot->epoch != self->index.epoch) {
+            void *p = list_append((struct list *)self->list, payload);
+            if (p == NULL) {
+                set_release((SET)self);
+                return NULL;
+            }
+            hindex_put(&self->index, slot, hash, p);
+        }
+    }
+    list_rank_seal((struct list *)self->list);
+
+    return (SET)self;
+}
+
+/**
+ *  @details    @c set に追加されている要素の数を返す.
+ *
+ *  @param      [in]    set セットオブジェクト.
+ *  @return     成功時は, @c set に追加されている要素の数を返す.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+ssize_t set_count(SET set)
+{
+    struct set *self = (struct set *)set;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return list_count(self->list);
+}
+
+/**
+ *  @details    @c set の反復子を取得する.
+ *              反復子は要素を追加した順に辿る.
+ *
+ *  @code
+ *  for (ITER iter = set_iter(set;
+ *       iter != NULL;
+ *       iter = iter_next(iter)) {
+ *      void *payload = iter_get_payload(iter);
+ *  }
+ *  @endcode
+ *
+ *  @param      [in]    set セットオブジェクト.
+ *  @return     成功時は, @c set の反復子が返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ *  @sa         iter_next, iter_get_payload
+ */
+ITER set_iter(SET set)
+{
+    struct set *self = (struct set *)set;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    return list_iter(self->list);
+}
+
+/**
+ *  マップ管理構造体.
+ *
+ *  要素 (キーと値の組) はリストに挿入順で保持し, キーのハッシュ索引で
+ *  探索する. 要素のデータ部はキーの後に値を配置する.
+ */
+struct map {
+    LIST list;                /**< 挿入順に要素を保持するリスト. */
+    struct hindex index;      /**< キーのハッシュ索引. */
+    size_t key_bytes;         /**< キーのサイズ. */
+    size_t value_bytes;       /**< 値のサイズ. */
+    size_t value_offset;      /**< 要素のデータ部での値の位置. */
+};
+
+/**
+ *  マップ向け, 要素のデータ部での値の位置を算出する.
+ *  値のサイズから整列を推定し, キーの後ろを整列させる.
+ *
+ *  @param  [in]    key_bytes   キーのサイズ.
+ *  @param  [in]    value_bytes 値のサイズ.
+ *  @return 値の位置が返る.
+ */
+static inline size_t map_value_offset(size_t key_bytes, size_t value_bytes)
+{
+    size_t align = value_bytes & -value_bytes;
+
+    if (align > alignof(max_align_t)) {
+        align = alignof(max_align_t);
+    }
+
+    return ((key_bytes + align - 1) / align) * align;
+}
+
+/**
+ *  @details    空で, 指定の容量を備えた, @ref MAP オブジェクトを確保
+ *              および初期化する.
+ *
+ *  @param      [in]    key_bytes   キーのサイズ.
+ *  @param      [in]    value_bytes 値のサイズ.
+ *  @param      [in]    capacity    マップの容量.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+MAP map_init(size_t key_bytes, size_t value_bytes, size_t capacity)
+{
+    return map_init_attr(key_bytes, value_bytes, capacity, NULL);
+}
+
+/**
+ *  @details    空で, 指定の容量と属性を備えた, @ref MAP オブジェクトを
+ *              確保および初期化する.
+ *
+ *  @param      [in]    key_bytes   キーのサイズ.
+ *  @param      [in]    value_bytes 値のサイズ.
+ *  @param      [in]    capacity    マップの初期容量.
+ *  @param      [in]    attr        マップの属性.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @sa         list_init_attr
+ */
+MAP map_init_attr(size_t key_bytes,
+                  size_t value_bytes,
+                  size_t capacity,
+                  const struct collection_attr *attr)
+{
+    struct collection_attr a = collection_attr_of(attr);
+    const struct allocator *allocator = a.allocator;
+    struct map *self;
+    size_t value_offset;
+
+    if ((key_bytes == 0) || (value_bytes == 0)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    value_offset = map_value_offset(key_bytes, value_bytes);
+
+    self = allocator_alloc(allocator, sizeof(*self), 0);
+    if (self == NULL) {
+        return NULL;
+    }
+    self->list = list_init_attr(value_offset + value_bytes, capacity, &a);
+    if (self->list == NULL) {
+        allocator_free(allocator, self, sizeof(*self));
+        return NULL;
+    }
+    if (hindex_init(&self->index, key_bytes, capacity, allocator) != 0) {
+        list_release(self->list);
+        allocator_free(allocator, self, sizeof(*self));
+        return NULL;
+    }
+    self->key_bytes = key_bytes;
+    self->value_bytes = value_bytes;
+    self->value_offset = value_offset;
+
+    return (MAP)self;
+}
+
+/**
+ *  @details    @c map を解放する.
+ *              @c map は @ref map_init の戻り値である必要がある.
+ *
+ *  @param      [in,out]    map マップオブジェクト.
+ *  @warning    スレッドセーフではない.
+ */
+void map_release(MAP map)
+{
+    struct map *self = (struct map *)map;
+
+    if (self != NULL) {
+        const struct allocator *allocator = self->index.allocator;
+        list_release(self->list);
+        hindex_release(&self->index);
+        allocator_free(allocator, self, sizeof(*self));
+    }
+}
+
+/**
+ *  @details    @c map を空の状態にする.
+ *
+ *  @param      [in,out]    map マップオブジェクト.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int map_clear(MAP map)
+{
+    struct map *self = (struct map *)map;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    hindex_clear(&self->index);
+
+    return list_clear(self->list);
+}
+
+/**
+ *  @details    @c map に @c key と @c value の組を追加する.
+ *              @c key がすでに追加されている場合は値を上書きする.
+ *
+ *  @param      [in,out]    map     マップオブジェクト.
+ *  @param      [in]        key     キー.
+ *  @param      [in]        value   値.
+ *  @return     成功時は, マップ上の値のポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    探索および追加は平均 O(1) で行われる.
+ *  @warning    スレッドセーフではない.
+ */
+void *map_put(MAP map, const void *key, const void *value)
+{
+    struct map *self = (struct map *)map;
+    struct hindex_slot *slot;
+    size_t hash;
+    char *entry;
+
+    if ((self == NULL) || (key == NULL) || (value == NULL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (hindex_reserve(&self->index) != 0) {
+        return NULL;
+    }
+
+    hash = hindex_hash(key, self->key_bytes);
+    slot = hindex_probe(&self->index, key, hash);
+    if (slot->epoch == self->index.epoch) {
+        entry = slot->payload;
+    } else {
+        entry = list_insert_slot(self->list, -1);
+        if (entry == NULL) {
+            return NULL;
+        }
+        memcpy(entry, key, self->key_bytes);
+        hindex_put(&self->index, slot, hash, entry);
+    }
+    memcpy(entry + self->value_offset, value, self->value_bytes);
+
+    return entry + self->value_offset;
+}
+
+/**
+ *  @details    @c map から @c key に対応する値を取得する.
+ *
+ *  @param      [in]    map マップオブジェクト.
+ *  @param      [in]    key キー.
+ *  @return     成功時は, マップ上の値のポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *              @c key がない場合, errno には ENOENT が設定される.
+ *  @warning    スレッドセーフではない.
+ */
+void *map_get(MAP map, const void *key)
+{
+    struct map *self = (struct map *)map;
+    char *entry;
+
+    if ((self == NULL) || (key == NULL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    entry = hindex_find(&self->index, key);
+    if (entry == NULL) {
+        errno = ENOENT;
+        return NULL;
+    }
+
+    return entry + self->value_offset;
+}
+
+/**
+ *  @details    @c map から @c key の要素を削除する.
+ *
+ *  @param      [in,out]    map マップオブジェクト.
+ *  @param      [in]        key キー.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              @c key がない場合, errno には ENOENT が設定される.
+ *  @remarks    ハッシュ索引は後続の要素を詰めて削除するため,
+ *              削除済みの印 (墓標) は残らない.
+ *  @warning    スレッドセーフではない.
+ */
+int map_remove(MAP map, const void *key)
+{
+    struct map *self = (struct map *)map;
+    struct hindex_slot *slot;
+    char *entry;
+
+    if ((self == NULL) || (key == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    slot = hindex_probe(&self->index, key, hindex_hash(key, self->key_bytes));
+    if (slot->epoch != self->index.epoch) {
+        errno = ENOENT;
+        return -1;
+    }
+    entry = slot->payload;
+    hindex_remove(&self->index, slot);
+
+    return list_remove(self->list, (ITER)(entry - offsetof(struct list_node, payload)));
+}
+
+/**
+ *  @details    @c map に追加されている要素の数を返す.
+ *
+ *  @param      [in]    map マップオブジェクト.
+ *  @return     成功時は, @c map に追加されている要素の数を返す.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+ssize_t map_count(MAP map)
+{
+    struct map *self = (struct map *)map;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return list_count(self->list);
+}
+
+/**
+ *  @details    @c map の反復子を取得する.
+ *              反復子は要素を追加した順に辿り, データ部はキーを指す.
+ *
+ *  @code
+ *  for (ITER iter = map_iter(map);
+ *       iter != NULL;
+ *       iter = iter_next(iter)) {
+ *      void *key = iter_get_payload(iter);
+ *      void *value = map_iter_get_value(map, iter);
+ *  }
+ *  @endcode
+ *
+ *  @param      [in]    map マップオブジェクト.
+ *  @return     成功時は, @c map の反復子が返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ *  @sa         iter_next, iter_get_payload, map_iter_get_value
+ */
+ITER map_iter(MAP map)
+{
+    struct map *self = (struct map *)map;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    return list_iter(self->list);
+}
+
+/**
+ *  @details    @c map の反復子から値を取得する.
+ *
+ *  @param      [in]    map     マップオブジェクト.
+ *  @param      [in]    iter    @ref map_iter で得た反復子.
+ *  @return     成功時は, 値のポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+void *map_iter_get_value(MAP map, ITER iter)
+{
+    struct map *self = (struct map *)map;
+    char *entry;
+
+    if ((self == NULL) || (iter == NULL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    entry = iter_get_payload(iter);
+
+    return entry + self->value_offset;
+}
+
+/**
+ *  優先度付きキューのノード構造体.
+ *
+ *  データ部のポインタを要素のハンドルとして返すため, ノードは移動せず,
+ *  ヒープにはノードのポインタを配置する.
+ */
+struct pqueue_node {
+    union {
+        size_t pos;               /**< ヒープ上の位置. (使用中) */
+        struct pqueue_node *next; /**< 次の解放済みノード. (解放済み) */
+    };
+    char payload[];               /**< データ部. */
+};
+
+/**
+ *  優先度付きキュー管理構造体.
+ *
+ *  4 分ヒープとし, 1 段で比較する子を同じキャッシュラインに収め,
+ *  木の高さを 2 分ヒープの半分にする.
+ */
+struct pqueue {
+    struct pool_chunk *pool;      /**< ノードで使用するメモリプール. */
+    struct pool_chunk *fresh;     /**< 未使用のノードを切り出し中のチャンク. */
+    size_t fresh_index;           /**< @c fresh 内の次に切り出す位置. */
+    struct pqueue_node *released; /**< 解放済みのノードのリスト. */
+    struct pqueue_node **heap;    /**< ヒープ. */
+    pqueue_compare compare;       /**< 比較関数. */
+    size_t payload_bytes;         /**< データ部のサイズ. */
+    size_t node_bytes;            /**< ノードのサイズ. */
+    size_t capacity;              /**< 確保したノードの数. */
+    size_t count;                 /**< 使用中のノードの数. */
+    struct collection_attr attr;  /**< 属性. */
+};
+
+/**
+ *  優先度付きキュー管理構造体の初期化子.
+ */
+#define PQUEUE_INITIALIZER(p, h, f, b, n, c, a) \
+    (struct pqueue){                            \
+        .pool = (p),                            \
+        .fresh = (p),                           \
+        .fresh_index = 0,                       \
+        .released = NULL,                       \
+        .heap = (h),                            \
+        .compare = (f),                         \
+        .payload_bytes = (b),                   \
+        .node_bytes = (n),                      \
+        .capacity = (c),                        \
+        .count = 0,                             \
+        .attr = (a)                             \
+    }
+
+/**
+ *  優先度付きキューのヒープの分岐数.
+ */
+#define PQUEUE_ARITY (4)
+
+/**
+ *  データ部のポインタから優先度付きキューのノードを取得する.
+ *
+ *  @param  [in]    payload データ部のポインタ.
+ *  @return ノードのポインタが返る.
+ */
+static inline struct pqueue_node *pqueue_node_of(void *payload)
+{
+    return (struct pqueue_node *)((uintptr_t)payload - offsetof(struct pqueue_node, payload));
+}
+
+/**
+ *  優先度付きキュー向け, ヒープの指定位置にノードを配置する.
+ *
+ *  @param  [in,out]    self    優先度付きキューオブジェクト.
+ *  @param  [in]        pos     配置する位置.
+ *  @param  [in,out]    node    配置するノード.
+ *  @pre    @c self および @c node の非 NULL は呼び出し側で保証すること.
+ */
+static inline void pqueue_place(struct pqueue *self, size_t pos, struct pqueue_node *node)
+{
+    self->heap[pos] = node;
+    node->pos = pos;
+}
+
+/**
+ *  優先度付きキュー向け, ノードを根の方向に移動する.
+ *
+ *  @param  [in,out]    self    優先度付きキューオブジェクト.
+ *  @param  [in]        pos     移動するノードの位置.
+ *  @return 移動後の位置が返る.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static size_t pqueue_sift_up(struct pqueue *self, size_t pos)
+{
+    struct pqueue_node *node = self->heap[pos];
+
+    while (pos > 0) {
+        size_t parent = (pos - 1) / PQUEUE_ARITY;
+        if (self->compare(node->payload, self->heap[parent]->payload) >= 0) {
+            break;
+        }
+        pqueue_place(self, pos, self->heap[parent]);
+        pos = parent;
+    }
+    pqueue_place(self, pos, node);
+
+    return pos;
+}
+
+/**
+ *  優先度付きキュー向け, ノードを葉の方向に移動する.
+ *
+ *  @param  [in,out]    self    優先度付きキューオブジェクト.
+ *  @param  [in]        pos     移動するノードの位置.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static void pqueue_sift_down(struct pqueue *self, size_t pos)
+{
+    struct pqueue_node *node = self->heap[pos];
+
+    for (;;) {
+        size_t first = (pos * PQUEUE_ARITY) + 1;
+        size_t last = first + PQUEUE_ARITY;
+        size_t best = pos;
+        struct pqueue_node *top = node;
+
+        if (last > self->count) {
+            last = self->count;
+        }
+        for (size_t child = first; child < last; ++child) {
+            if (self->compare(self->heap[child]->payload, top->payload) < 0) {
+                best = child;
+                top = self->heap[child];
+            }
+        }
+        if (best == pos) {
+            break;
+        }
+        pqueue_place(self, pos, top);
+        pos = best;
+    }
+    pqueue_place(self, pos, node);
+}
+
+/**
+ *  優先度付きキューの容量を拡張する.
+ *
+ *  @param  [in,out]    self    優先度付きキューオブジェクト.
+ *  @param  [in]        need    必要な追加の要素の数.
+ *  @return 成功時は, 0 が返る.
+ *          失敗時は, -1 が返り, errno が適切に設定される.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static int pqueue_grow(struct pqueue *self, size_t need)
+{
+    struct pool_chunk *chunk;
+    struct pqueue_node **heap;
+    size_t count = pool_grow_count(&self->attr, self->capacity);
+
+    if (count < need) {
+        count = need;
+        if ((!self->attr.growable)
+            || ((self->attr.max_capacity != 0)
+                && (need > (self->attr.max_capacity - self->capacity)))) {
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+
+    heap = allocator_alloc(self->attr.allocator, sizeof(*heap) * (self->capacity + count), 0);
+    chunk = pool_chunk_alloc(self->attr.allocator, count, self->node_bytes);
+    if ((heap == NULL) || (chunk == NULL)) {
+        pool_chunk_free_all(self->attr.allocator, chunk);
+        allocator_free(self->attr.allocator, heap, sizeof(*heap) * (self->capacity + count));
+        errno = ENOMEM;
+        return -1;
+    }
+    memcpy(heap, self->heap, sizeof(*heap) * self->count);
+    allocator_free(self->attr.allocator, self->heap, sizeof(*heap) * self->capacity);
+    self->heap = heap;
+    pool_chunk_append(self->pool, chunk);
+    if (self->fresh == NULL) {
+        self->fresh = chunk;
+        self->fresh_index = 0;
+    }
+    self->capacity += count;
+
+    return 0;
+}
+
+/**
+ *  優先度付きキュー向け, 未使用のノードを取得する.
+ *  呼び出し側で容量を確保しておくこと.
+ *
+ *  @param  [in,out]    self    優先度付きキューオブジェクト.
+ *  @return ノードのポインタが返る.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static inline struct pqueue_node *pqueue_take_node(struct pqueue *self)
+{
+    struct pqueue_node *node = self->released;
+
+    if (node != NULL) {
+        self->released = node->next;
+        return node;
+    }
+
+    return pool_take_fresh(&self->fresh, &self->fresh_index, self->node_bytes);
+}
+
+/**
+ *  @details    空で, 指定の容量を備えた, @ref PQUEUE オブジェクトを確保
+ *              および初期化する.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        優先度付きキューの容量.
+ *  @param      [in]    compare         データ部の比較関数.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+PQUEUE pqueue_init(size_t payload_bytes, size_t capacity, pqueue_compare compare)
+{
+    return pqueue_init_attr(payload_bytes, capacity, compare, NULL);
+}
+
+/**
+ *  @details    空で, 指定の容量と属性を備えた, @ref PQUEUE オブジェクトを
+ *              確保および初期化する.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        優先度付きキューの初期容量.
+ *  @param      [in]    compare         データ部の比較関数.
+ *                                      負数を返した第 1 引数が先に取り出される.
+ *  @param      [in]    attr            優先度付きキューの属性.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @sa         list_init_attr
+ */
+PQUEUE pqueue_init_attr(size_t payload_bytes,
+                        size_t capacity,
+                        pqueue_compare compare,
+                        const struct collection_attr *attr)
+{
+    struct collection_attr a = collection_attr_of(attr);
+    size_t align = alignof(max_align_t);
+    size_t node_bytes;
+    struct pqueue *self;
+    struct pool_chunk *pool;
+    struct pqueue_node **heap;
+
+    if ((payload_bytes == 0) || (capacity == 0) || (compare == NULL)
+        || !collection_attr_is_valid(&a, capacity)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    /* ハンドルとして返すデータ部を整列させる. */
+    node_bytes = sizeof(struct pqueue_node) + payload_bytes;
+    node_bytes = ((node_bytes + align - 1) / align) * align;
+
+    self = allocator_alloc(a.allocator, sizeof(*self), 0);
+    pool = pool_chunk_alloc(a.allocator, capacity, node_bytes);
+    heap = allocator_alloc(a.allocator, sizeof(*heap) * capacity, 0);
+    if ((self == NULL) || (pool == NULL) || (heap == NULL)) {
+        allocator_free(a.allocator, heap, sizeof(*heap) * capacity);
+        pool_chunk_free_all(a.allocator, pool);
+        allocator_free(a.allocator, self, sizeof(*self));
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    *self = PQUEUE_INITIALIZER(pool, heap, compare, payload_bytes, node_bytes, capacity, a);
+
+    return (PQUEUE)self;
+}
+
+/**
+ *  @details    @c pq を解放する.
+ *              @c pq は @ref pqueue_init の戻り値である必要がある.
+ *
+ *  @param      [in,out]    pq  優先度付きキューオブジェクト.
+ *  @warning    スレッドセーフではない.
+ */
+void pqueue_release(PQUEUE pq)
+{
+    struct pqueue *self = (struct pqueue *)pq;
+
+    if (self != NULL) {
+        pool_chunk_free_all(self->attr.allocator, self->pool);
+        allocator_free(self->attr.allocator, self->heap, sizeof(*self->heap) * self->capacity);
+        allocator_free(self->attr.allocator, self, sizeof(*self));
+    }
+}
+
+/**
+ *  @details    @c pq を空の状態にする.
+ *
+ *  @param      [in,out]    pq  優先度付きキューオブジェクト.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int pqueue_clear(PQUEUE pq)
+{
+    struct pqueue *self = (struct pqueue *)pq;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    self->fresh = self->pool;
+    self->fresh_index = 0;
+    self->released = NULL;
+    self->count = 0;
+
+    return 0;
+}
+
+/**
+ *  @details    @c pq に要素を追加する.
+ *
+ *  @param      [in,out]    pq      優先度付きキューオブジェクト.
+ *  @param      [in]        payload 追加するデータ.
+ *  @return     成功時は, 追加した要素のデータ部のポインタが返る.
+ *              このポインタは要素を取り出すまで変わらず, @ref pqueue_update
+ *              および @ref pqueue_remove のハンドルとして使用できる.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    O(log n) で行われる.
+ *  @warning    スレッドセーフではない.
+ */
+void *pqueue_push(PQUEUE pq, const void *payload)
+{
+    struct pqueue *self = (struct pqueue *)pq;
+    struct pqueue_node *node;
+
+    if ((self == NULL) || (payload == NULL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if ((self->count == self->capacity) && (pqueue_grow(self, 1) != 0)) {
+        return NULL;
+    }
+
+    node = pqueue_take_node(self);
+    memcpy(node->payload, payload, self->payload_bytes);
+    pqueue_place(self, self->count++, node);
+    pqueue_sift_up(self, node->pos);
+
+    return node->payload;
+}
+
+/**
+ *  @details    @c array の要素をまとめて @c pq に追加する.
+ *              追加後にヒープ全体を再構築するため, 1 要素ずつ追加するより
+ *              高速 (O(n)) となる.
+ *
+ *  @param      [in,out]    pq      優先度付きキューオブジェクト.
+ *  @param      [in]        array   追加するデータの配列.
+ *  @param      [in]        count   @c array の要素の数.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              失敗時は, 要素は追加されない.
+ *  @warning    スレッドセーフではない.
+ */
+int pqueue_heapify(PQUEUE pq, const void *array, size_t count)
+{
+    struct pqueue *self = (struct pqueue *)pq;
+    const char *p = array;
+
+    if ((self == NULL) || ((array == NULL) && (count > 0))) {
+        errno = EINVAL;
+        return -1;
+    }
+    if ((count > (self->capacity - self->count))
+        && (pqueue_grow(self, count - (self->capacity - self->count)) != 0)) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        struct pqueue_node *node = pqueue_take_node(self);
+        memcpy(node->payload, p + (self->payload_bytes * i), self->payload_bytes);
+        pqueue_place(self, self->count++, node);
+    }
+    /* 葉でない要素を末尾側から沈める. */
+    if (self->count > 1) {
+        for (size_t i = ((self->count - 2) / PQUEUE_ARITY) + 1; i-- > 0; ) {
+            pqueue_sift_down(self, i);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ *  @details    @c pq の先頭 (最も優先度の高い) の要素を取得する.
+ *
+ *  @param      [in]    pq  優先度付きキューオブジェクト.
+ *  @return     成功時は, 先頭の要素のデータ部のポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+void *pqueue_peek(PQUEUE pq)
+{
+    struct pqueue *self = (struct pqueue *)pq;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (self->count == 0) {
+        errno = EAGAIN;
+        return NULL;
+    }
+
+    return self->heap[0]->payload;
+}
+
+/**
+ *  @details    @c pq から @c handle の要素を削除する.
+ *
+ *  @param      [in,out]    pq      優先度付きキューオブジェクト.
+ *  @param      [in]        handle  @ref pqueue_push の戻り値.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @remarks    O(log n) で行われる.
+ *  @warning    スレッドセーフではない.
+ */
+int pqueue_remove(PQUEUE pq, void *handle)
+{
+    struct pqueue *self = (struct pqueue *)pq;
+    struct pqueue_node *node;
+    size_t pos;
+
+    if ((self == NULL) || (handle == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    node = pqueue_node_of(handle);
+    pos = node->pos;
+    if (pos != --self->count) {
+        pqueue_place(self, pos, self->heap[self->count]);
+        if (pqueue_sift_up(self, pos) == pos) {
+            pqueue_sift_down(self, pos);
+        }
+    }
+    node->next = self->released;
+    self->released = node;
+
+    return 0;
+}
+
+/**
+ *  @details    @c pq の先頭の要素をコピーし, 削除する.
+ *
+ *  @param      [in,out]    pq      優先度付きキューオブジェクト.
+ *  @param      [out]       payload データ部をコピーするバッファ.
+ *  @return     成功時は, @c pq に残っている要素の数が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @remarks    O(log n) で行われる.
+ *  @warning    スレッドセーフではない.
+ */
+int pqueue_pop(PQUEUE pq, void *payload)
+{
+    struct pqueue *self = (struct pqueue *)pq;
+    void *top;
+
+    if ((self == NULL) || (payload == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    top = pqueue_peek(pq);
+    if (top == NULL) {
+        return -1;
+    }
+    memcpy(payload, top, self->payload_bytes);
+    pqueue_remove(pq, top);
+
+    return self->count;
+}
+
+/**
+ *  @details    @c handle の要素の優先度を変更した後, ヒープ上の位置を
+ *              修正する.
+ *              データ部は @c handle を通じて呼び出し側で書き換えること.
+ *
+ *  @param      [in,out]    pq      優先度付きキューオブジェクト.
+ *  @param      [in]        handle  @ref pqueue_push の戻り値.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @remarks    優先度を上げる (decrease-key) 場合も下げる場合も
+ *              O(log n) で行われる.
+ *  @warning    スレッドセーフではない.
+ */
+int pqueue_update(PQUEUE pq, void *handle)
+{
+    struct pqueue *self = (struct pqueue *)pq;
+    size_t pos;
+
+    if ((self == NULL) || (handle == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    pos = pqueue_node_of(handle)->pos;
+    if (pqueue_sift_up(self, pos) == pos) {
+        pqueue_sift_down(self, pos);
+    }
+
+    return 0;
+}
+
+/**
+ *  @details    @c pq に追加されている要素の数を返す.
+ *
+ *  @param      [in]    pq  優先度付きキューオブジェクト.
+ *  @return     成功時は, @c pq に追加されている要素の数を返す.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+ssize_t pqueue_count(PQUEUE pq)
+{
+    struct pqueue *self = (struct pqueue *)pq;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return self->count;
+}
+
+/**
+ *  ビットセットの一括演算の単位となるワード数.
+ */
+#define BITSET_BLOCK_WORDS (4)
+
+/**
+ *  ビットセットの一括演算に使用するベクトル型.
+ *
+ *  GCC のベクトル拡張により, ターゲットの SIMD 命令 (SSE2, AVX2 など)
+ *  で複数のワードを同時に演算する.
+ */
+typedef uint64_t bitset_block __attribute__((vector_size(sizeof(uint64_t) * BITSET_BLOCK_WORDS)));
+
+/**
+ *  ビットセット管理構造体.
+ *
+ *  ワード配列はキャッシュラインに整列し, 一括演算の単位の倍数に
+ *  切り上げて確保するため, 端数の処理を必要としない.
+ */
+struct bitset {
+    size_t bits;                                 /**< ビットの数. */
+    size_t words;                                /**< ワードの数. */
+    const struct allocator *allocator;           /**< メモリ割り当て. */
+    alignas(CACHE_LINE_BYTES) uint64_t word[];   /**< ワード配列. */
+};
+
+/**
+ *  ビットセットの確保するサイズを算出する.
+ *
+ *  @param  [in]    words   ワードの数.
+ *  @return 確保するサイズが返る.
+ */
+static inline size_t bitset_bytes(size_t words)
+{
+    size_t bytes = sizeof(struct bitset) + (sizeof(uint64_t) * words);
+
+    return ((bytes + alignof(struct bitset) - 1) / alignof(struct bitset)) * alignof(struct bitset);
+}
+
+/**
+ *  ビットセット向け, ビットの位置を検証する.
+ *
+ *  @param  [in]    self    ビットセットオブジェクト.
+ *  @param  [in]    bit     ビットの位置.
+ *  @return 有効な場合は, true が返る.
+ *          無効な場合は, false が返り, errno が適切に設定される.
+ */
+static inline bool bitset_is_valid(const struct bitset *self, size_t bit)
+{
+    if ((self == NULL) || (bit >= self->bits)) {
+        errno = EINVAL;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ *  @details    すべてのビットが 0 の, 指定のビット数を備えた
+ *              @ref BITSET オブジェクトを確保および初期化する.
+ *
+ *  @param      [in]    bits    ビットの数.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    既定のメモリ割り当てから確保する.
+ */
+BITSET bitset_init(size_t bits)
+{
+    return bitset_init_attr(bits, NULL);
+}
+
+/**
+ *  @details    すべてのビットが 0 の, 指定のビット数と属性を備えた
+ *              @ref BITSET オブジェクトを確保および初期化する.
+ *              属性のうち, メモリ割り当てのみを使用する.
+ *
+ *  @param      [in]    bits    ビットの数.
+ *  @param      [in]    attr    ビットセットの属性.
+ *                              NULL の場合は @ref COLLECTION_ATTR_INITIALIZER
+ *                              と同じ属性となる.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *              拡張可能な属性を指定した場合, errno には EINVAL が設定される.
+ *  @sa         bitset_init
+ */
+BITSET bitset_init_attr(size_t bits, const struct collection_attr *attr)
+{
+    struct collection_attr a = collection_attr_of(attr);
+    const struct allocator *allocator = a.allocator;
+    struct bitset *self;
+    size_t words;
+
+    if ((bits == 0) || a.growable) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    words = (bits + 63) / 64;
+    words = ((words + BITSET_BLOCK_WORDS - 1) / BITSET_BLOCK_WORDS) * BITSET_BLOCK_WORDS;
+
+    self = allocator_alloc(allocator, bitset_bytes(words), alignof(struct bitset));
+    if (self == NULL) {
+        return NULL;
+    }
+    self->bits = bits;
+    self->words = words;
+    self->allocator = allocator;
+    memset(self->word, 0, sizeof(uint64_t) * words);
+
+    return (BITSET)self;
+}
+
+/**
+ *  @details    @c bs を解放する.
+ *              @c bs は @ref bitset_init の戻り値である必要がある.
+ *
+ *  @param      [in,out]    bs  ビットセットオブジェクト.
+ *  @warning    スレッドセーフではない.
+ */
+void bitset_release(BITSET bs)
+{
+    struct bitset *self = (struct bitset *)bs;
+
+    if (self != NULL) {
+        allocator_free(self->allocator, self, bitset_bytes(self->words));
+    }
+}
+
+/**
+ *  @details    @c bs のすべてのビットを 0 にする.
+ *
+ *  @param      [in,out]    bs  ビットセットオブジェクト.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int bitset_clear(BITSET bs)
+{
+    struct bitset *self = (struct bitset *)bs;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(self->word, 0, sizeof(uint64_t) * self->words);
+
+    return 0;
+}
+
+/**
+ *  @details    @c bs の @c bit を 1 にする.
+ *
+ *  @param      [in,out]    bs  ビットセットオブジェクト.
+ *  @param      [in]        bit ビットの位置.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int bitset_set(BITSET bs, size_t bit)
+{
+    struct bitset *self = (struct bitset *)bs;
+
+    if (!bitset_is_valid(self, bit)) {
+        return -1;
+    }
+
+    self->word[bit / 64] |= UINT64_C(1) << (bit % 64);
+
+    return 0;
+}
+
+/**
+ *  @details    @c bs の @c bit を 0 にする.
+ *
+ *  @param      [in,out]    bs  ビットセットオブジェクト.
+ *  @param      [in]        bit ビットの位置.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int bitset_reset(BITSET bs, size_t bit)
+{
+    struct bitset *self = (struct bitset *)bs;
+
+    if (!bitset_is_valid(self, bit)) {
+        return -1;
+    }
+
+    self->word[bit / 64] &= ~(UINT64_C(1) << (bit % 64));
+
+    return 0;
+}
+
+/**
+ *  @details    @c bs の @c bit を取得する.
+ *
+ *  @param      [in]    bs  ビットセットオブジェクト.
+ *  @param      [in]    bit ビットの位置.
+ *  @return     成功時は, ビットが 1 の場合は 1, 0 の場合は 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int bitset_test(BITSET bs, size_t bit)
+{
+    const struct bitset *self = (const struct bitset *)bs;
+
+    if (!bitset_is_valid(self, bit)) {
+        return -1;
+    }
+
+    return (int)((self->word[bit / 64] >> (bit % 64)) & 1);
+}
+
+/**
+ *  @details    @c bs の 1 のビットの数を返す.
+ *
+ *  @param      [in]    bs  ビットセットオブジェクト.
+ *  @return     成功時は, 1 のビットの数が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+ssize_t bitset_count(BITSET bs)
+{
+    const struct bitset *self = (const struct bitset *)bs;
+    ssize_t count = 0;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (size_t i = 0; i < self->words; ++i) {
+        count += __builtin_popcountll(self->word[i]);
+    }
+
+    return count;
+}
+
+/**
+ *  @details    @c bs の @c from 以降で最初に 1 であるビットの位置を返す.
+ *
+ *  @code
+ *  for (ssize_t bit = bitset_next(bs, 0);
+ *       bit >= 0;
+ *       bit = bitset_next(bs, bit + 1)) {
+ *      // do something.
+ *  }
+ *  @endcode
+ *
+ *  @param      [in]    bs      ビットセットオブジェクト.
+ *  @param      [in]    from    探索を開始する位置.
+ *  @return     成功時は, ビットの位置が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              1 のビットがない場合, errno には ENOENT が設定される.
+ *  @remarks    0 のワードは読み飛ばし, ワード内は末尾の 0 の数から
+ *              位置を求める.
+ *  @warning    スレッドセーフではない.
+ */
+ssize_t bitset_next(BITSET bs, size_t from)
+{
+    const struct bitset *self = (const struct bitset *)bs;
+    size_t i;
+    uint64_t word;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (from >= self->bits) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    i = from / 64;
+    word = self->word[i] & (~UINT64_C(0) << (from % 64));
+    while (word == 0) {
+        if (++i == self->words) {
+            errno = ENOENT;
+            return -1;
+        }
+        word = self->word[i];
+    }
+
+    /* 範囲外のビットは常に 0 のため, 位置の検証は不要. */
+    return (ssize_t)((i * 64) + (size_t)__builtin_ctzll(word));
+}
+
+/**
+ *  ビットセット向け, 一括演算の対象を検証する.
+ *
+ *  @param  [in]    dst 演算結果を格納するビットセット.
+ *  @param  [in]    src 演算するビットセット.
+ *  @return 有効な場合は, true が返る.
+ *          無効な場合は, false が返り, errno が適切に設定される.
+ */
+static inline bool bitset_is_compatible(const struct bitset *dst, const struct bitset *src)
+{
+    if ((dst == NULL) || (src == NULL) || (dst->bits != src->bits)) {
+        errno = EINVAL;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ *  ビットセット向け, ワード配列の一括演算の種類.
+ */
+enum bitset_op {
+    BITSET_OP_OR,     /**< 和集合. */
+    BITSET_OP_AND,    /**< 積集合. */
+    BITSET_OP_ANDNOT  /**< 差集合. */
+};
+
+/**
+ *  ビットセット向け, ワード配列を一括演算する.
+ *
+ *  @param  [in,out]    dst 演算結果を格納するビットセット.
+ *  @param  [in]        src 演算するビットセット.
+ *  @param  [in]        op  演算の種類.
+ *  @pre    @c dst と @c src の大きさが等しいことは呼び出し側で保証すること.
+ */
+static inline void bitset_apply(struct bitset *dst, const struct bitset *src, enum bitset_op op)
+{
+    bitset_block *d = (bitset_block *)dst->word;
+    const bitset_block *s = (const bitset_block *)src->word;
+    size_t blocks = dst->words / BITSET_BLOCK_WORDS;
+
+    switch (op) {
+    case BITSET_OP_OR:
+        for (size_t i = 0; i < blocks; ++i) {
+            d[i] |= s[i];
+        }
+        break;
+    case BITSET_OP_AND:
+        for (size_t i = 0; i < blocks; ++i) {
+            d[i] &= s[i];
+        }
+        break;
+    case BITSET_OP_ANDNOT:
+        for (size_t i = 0; i < blocks; ++i) {
+            d[i] &= ~s[i];
+        }
+        break;
+    }
+}
+
+/**
+ *  @details    @c dst を @c dst と @c src の和集合にする.
+ *
+ *  @param      [in,out]    dst 演算結果を格納するビットセット.
+ *  @param      [in]        src 演算するビットセット.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              ビットの数が異なる場合, errno には EINVAL が設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int bitset_union(BITSET dst, BITSET src)
+{
+    if (!bitset_is_compatible((struct bitset *)dst, (struct bitset *)src)) {
+        return -1;
+    }
+
+    bitset_apply((struct bitset *)dst, (struct bitset *)src, BITSET_OP_OR);
+
+    return 0;
+}
+
+/**
+ *  @details    @c dst を @c dst と @c src の積集合にする.
+ *
+ *  @param      [in,out]    dst 演算結果を格納するビットセット.
+ *  @param      [in]        src 演算するビットセット.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              ビットの数が異なる場合, errno には EINVAL が設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int bitset_intersect(BITSET dst, BITSET src)
+{
+    if (!bitset_is_compatible((struct bitset *)dst, (struct bitset *)src)) {
+        return -1;
+    }
+
+    bitset_apply((struct bitset *)dst, (struct bitset *)src, BITSET_OP_AND);
+
+    return 0;
+}
+
+/**
+ *  @details    @c dst から @c src の要素を取り除く (差集合).
+ *
+ *  @param      [in,out]    dst 演算結果を格納するビットセット.
+ *  @param      [in]        src 演算するビットセット.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              ビットの数が異なる場合, errno には EINVAL が設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int bitset_difference(BITSET dst, BITSET src)
+{
+    if (!bitset_is_compatible((struct bitset *)dst, (struct bitset *)src)) {
+        return -1;
+    }
+
+    bitset_apply((struct bitset *)dst, (struct bitset *)src, BITSET_OP_ANDNOT);
+
+    return 0;
+}
+
+/**
+ *  N-ary ツリーノード構造体.
+ */
+struct tree_node {
+    struct tree_node *parent;       /**< 親要素へのポインタ. */
+    struct tree_node *first_child;  /**< 最初の子要素へのポインタ. */
+    struct tree_node *last_child;   /**< 最後の子要素へのポインタ. */
+    struct tree_node *prev_sibling; /**< 前の兄弟要素へのポインタ. */
+    struct tree_node *next_sibling; /**< 次の兄弟要素へのポインタ. */
+    struct tree_node *prev_dup;     /**< データ部が一致する前の要素. 先頭は末尾を指す. */
+    struct tree_node *next_dup;     /**< データ部が一致する次の要素へのポインタ. */
+    char payload[];                 /**< データ部. */
+};
+
+/**
+ *  N-ary ツリーノード構造体の初期化子.
+ */
+#define TREE_NODE_INITIALIZER \
+    (struct tree_node){       \
+        .parent = NULL,       \
+        .first_child = NULL,  \
+        .last_child = NULL,   \
+        .prev_sibling = NULL, \
+        .next_sibling = NULL, \
+        .prev_dup = NULL,     \
+        .next_dup = NULL      \
+    }
+
+/**
+ *  終端を示すリンク番号.
+ */
+#define TREE_LINK_NIL UINT32_MAX
+
+/**
+ *  N-ary ツリーのリンク構造体. (コンパクト配置時)
+ *
+ *  ノードのポインタの代わりに 32 ビットの番号で参照する.
+ *  番号 0 は root を表す. 解放済みの番号は親要素を @ref TREE_LINK_NIL とする.
+ */
+struct tree_link {
+    uint32_t parent;       /**< 親要素の番号. */
+    uint32_t first_child;  /**< 最初の子要素の番号. */
+    uint32_t last_child;   /**< 最後の子要素の番号. */
+    uint32_t prev_sibling; /**< 前の兄弟要素の番号. */
+    uint32_t next_sibling; /**< 次の兄弟要素の番号. */
+    uint32_t prev_dup;     /**< データ部が一致する前の要素の番号. 先頭は末尾を指す. */
+    uint32_t next_dup;     /**< データ部が一致する次の要素の番号. */
+};
+
+/**
+ *  N-ary ツリーのリンク構造体の初期化子.
+ */
+#define TREE_LINK_INITIALIZER          \
+    (struct tree_link){                \
+        .parent = TREE_LINK_NIL,       \
+        .first_child = TREE_LINK_NIL,  \
+        .last_child = TREE_LINK_NIL,   \
+        .prev_sibling = TREE_LINK_NIL, \
+        .next_sibling = TREE_LINK_NIL, \
+        .prev_dup = TREE_LINK_NIL,     \
+        .next_dup = TREE_LINK_NIL      \
+    }
+
+/**
+ *  N-ary ツリーのリンクとデータ部を分離した配置の構造体.
+ *
+ *  走査時にデータ部をキャッシュに載せないよう, リンクの配列と
+ *  データ部の配列を別の領域に確保する.
+ *  データ部の配列はキャッシュラインに整列する.
+ */
+struct tree_soa {
+    struct tree_link *links; /**< リンクの配列. */
+    char *payloads;          /**< データ部の配列. */
+    size_t stride;           /**< データ部の配列の要素の間隔. */
+    size_t count;            /**< 配列の要素数. */
+};
+
+/**
+ *  N-ary ツリーのリンクとデータ部を分離した配置の構造体の初期化子.
+ */
+#define TREE_SOA_INITIALIZER \
+    (struct tree_soa){       \
+        .links = NULL,       \
+        .payloads = NULL,    \
+        .stride = 0,         \
+        .count = 0           \
+    }
+
+/**
+ *  N-ary ツリー管理構造体.
+ */
+struct tree {
+    struct pool_chunk *pool;     /**< ツリーで使用するメモリプール. */
+    struct pool_chunk *fresh;    /**< 未使用のノードを切り出し中のチャンク. */
+    size_t fresh_index;          /**< @c fresh 内の次に切り出す位置. */
+    struct tree_node *released;  /**< 解放済みのノードのリスト. */
+    uint32_t soa_released;       /**< 解放済みの番号のリスト. (コンパクト配置時) */
+    struct tree_node *root;      /**< ツリーの根. */
+    size_t payload_bytes;        /**< データ部のサイズ. */
+    size_t capacity;             /**< 確保したノードの数. */
+    size_t count;                /**< 使用中のノードの数. */
+    struct collection_attr attr; /**< 属性. */
+    struct hindex index;         /**< データ部からノードを引くハッシュ索引. */
+    struct tree_soa soa;         /**< リンクとデータ部の配列. (コンパクト配置時) */
+};
+
+/**
+ *  N-ary ツリー管理構造体の初期化子.
+ */
+#define TREE_INITIALIZER(p, s, b, c, a) \
+    (struct tree){                      \
+        .pool = (p),                    \
+        .fresh = (p),                   \
+        .fresh_index = 0,               \
+        .released = NULL,               \
+        .soa_released = TREE_LINK_NIL,  \
+        .root = NULL,                   \
+        .payload_bytes = (b),           \
+        .capacity = (c),                \
+        .count = 0,                     \
+        .attr = (a),                    \
+        .soa = (s)                      \
+    }
+
+/**
+ *  N-ary ツリー反復子構造体.
+ */
+struct tree_iter {
+    struct tree_walk walk;      /**< 走査子. */
+};
+
+/**
+ *  N-ary ツリー反復子構造体の初期化子.
+ */
+#define TREE_ITER_INITIALIZER         \
+    (struct tree_iter){               \
+        .walk = TREE_WALK_INITIALIZER \
+    }
+
+/**
+ *  N-ary ツリーの 1 ノードあたりのサイズを算出する.
+ *  ノードを連続して配置するため, 基本型の整列に切り上げる.
+ *
+ *  @param  [in]    payload_bytes   データ部のサイズ.
+ *  @return ノードのサイズが返る.
+ */
+static inline size_t tree_node_bytes(size_t payload_bytes)
+{
+    return collection_align(sizeof(struct tree_node) + payload_bytes);
+}
+
+/**
+ *  N-ary ツリー向け, 解放済みノードのリストにノードを追加する.
+ *  解放済みのノードは親要素を NULL とする.
+ *
+ *  @param  [in,out]    self    ツリーオブジェクト.
+ *  @param  [in]        node    追加するノード.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ *  @pre    @c node の非 NULL は呼び出し側で保証すること.
+ */
+static inline void tree_push_released(struct tree *self, struct tree_node *node)
+{
+    node->parent = NULL;
+    node->first_child = NULL;
+    if (self->released == NULL) {
+        node->next_sibling = NULL;
+    } else {
+        node->next_sibling = self->released;
+    }
+    self->released = node;
+}
+
+/**
+ *  N-ary ツリーの容量を拡張する.
+ *
+ *  @param  [in,out]    self    ツリーオブジェクト.
+ *  @return 成功時は, 0 が返る.
+ *          失敗時は, -1 が返り, errno が適切に設定される.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static int tree_grow(struct tree *self)
+{
+    struct pool_chunk *chunk;
+    size_t count;
+
+    count = pool_grow_count(&self->attr, self->capacity);
+    if (count == 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+    chunk = pool_chunk_alloc(self->attr.allocator, count, tree_node_bytes(self->payload_bytes));
+    if (chunk == NULL) {
+        return -1;
+    }
+    pool_chunk_append(self->pool, chunk);
+    self->capacity += count;
+    self->fresh = chunk;
+    self->fresh_index = 0;
+
+    return 0;
+}
+
+/**
+ *  N-ary ツリー向け, 解放済みノードのリストからノードを取得する.
+ *  解放済みノードがない場合は未使用のノードを切り出し, それもない場合,
+ *  拡張可能であれば容量を拡張する.
+ *
+ *  @param  [in,out]    self    ツリーオブジェクト.
+ *  @return 成功時は, ノードのポインタが返る.
+ *          失敗時は, NULL が返り, errno が適切に設定される.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static inline struct tree_node *tree_pop_released(struct tree *self)
+{
+    struct tree_node *node = self->released;
+    size_t node_bytes = tree_node_bytes(self->payload_bytes);
+
+    if (node == NULL) {
+        node = pool_take_fresh(&self->fresh, &self->fresh_index, node_bytes);
+        if (node == NULL) {
+            if (tree_grow(self) != 0) {
+                return NULL;
+            }
+            node = pool_take_fresh(&self->fresh, &self->fresh_index, node_bytes);
+        }
+        return node;
+    }
+
+    self->released = node->next_sibling;
+
+    return node;
+}
+
+/**
+ *  N-ary ツリー向け, リンクとデータ部の配列を確保する.
+ *  データ部の配列はキャッシュラインに整列し, 要素の間隔は
+ *  基本型の整列に合わせる.
+ *
+ *  @param  [in]    allocator       メモリ割り当て.
+ *  @param  [in]    payload_bytes   データ部のサイズ.
+ *  @param  [in]    count           要素の数.
+ *  @return 成功時は, 確保した配列が返る.
+ *          失敗時は, リンクの配列が NULL となり, errno が適切に設定される.
+ */
+static struct tree_soa tree_soa_alloc(const struct allocator *allocator,
+                                      size_t payload_bytes,
+                                      size_t count)
+{
+    struct tree_soa soa = TREE_SOA_INITIALIZER;
+    size_t align = alignof(max_align_t);
+    size_t bytes;
+
+    soa.stride = ((payload_bytes + align - 1) / align) * align;
+    bytes = soa.stride * count;
+    bytes = ((bytes + CACHE_LINE_BYTES - 1) / CACHE_LINE_BYTES) * CACHE_LINE_BYTES;
+
+    soa.count = count;
+    soa.links = allocator_alloc(allocator, sizeof(struct tree_link) * count, 0);
+    soa.payloads = allocator_alloc(allocator, bytes, CACHE_LINE_BYTES);
+    if ((soa.links == NULL) || (soa.payloads == NULL)) {
+        allocator_free(allocator, soa.payloads, bytes);
+        allocator_free(allocator, soa.links, sizeof(struct tree_link) * count);
+        soa = TREE_SOA_INITIALIZER;
+        errno = ENOMEM;
+    }
+
+    return soa;
+}
+
+/**
+ *  N-ary ツリー向け, リンクとデータ部の配列を解放する.
+ *
+ *  @param  [in]        allocator   確保時のメモリ割り当て.
+ *  @param  [in,out]    soa         解放する配列.
+ *  @pre    @c soa の非 NULL は呼び出し側で保証すること.
+ */
+static inline void tree_soa_free(const struct allocator *allocator, struct tree_soa *soa)
+{
+    size_t bytes = soa->stride * soa->count;
+
+    bytes = ((bytes + CACHE_LINE_BYTES - 1) / CACHE_LINE_BYTES) * CACHE_LINE_BYTES;
+    allocator_free(allocator, soa->payloads, bytes);
+    allocator_free(allocator, soa->links, sizeof(struct tree_link) * soa->count);
+    *soa = TREE_SOA_INITIALIZER;
+}
+
+/**
+ *  N-ary ツリー向け, 番号からデータ部を取得する.
+ *
+ *  @param  [in]    soa     リンクとデータ部の配列.
+ *  @param  [in]    index   要素の番号.
+ *  @return データ部のポインタが返る.
+ *  @pre    @c soa の非 NULL は呼び出し側で保証すること.
+ */
+static inline void *tree_soa_payload(const struct tree_soa *soa, uint32_t index)
+{
+    return soa->payloads + (soa->stride * index);
+}
+
+/**
+ *  N-ary ツリー向け, データ部から番号を取得する.
+ *
+ *  @param  [in]    soa     リンクとデータ部の配列.
+ *  @param  [in]    payload データ部のポインタ.
+ *  @return 要素の番号が返る.
+ *  @pre    @c soa および @c payload の非 NULL は呼び出し側で保証すること.
+ */
+static inline uint32_t tree_soa_index(const struct tree_soa *soa, const void *payload)
+{
+    return (uint32_t)(((const char *)payload - soa->payloads) / soa->stride);
+}
+
+/**
+ *  ツリーの初期設定を行う.
+ *
+ *  @param  [in,out]    self            ツリーオブジェクト.
+ *  @param  [in]        pool            ツリーに使用するメモリプール.
+ *  @param  [in]        soa             リンクとデータ部の配列. (コンパクト配置時)
+ *  @param  [in]        payload_bytes   データ部のサイズ.
+ *  @param  [in]        capacity        リストの容量.
+ *  @param  [in]        attr            ツリーの属性.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ *  @pre    コンパクト配置時は @c soa, それ以外は @c pool の非 NULL を
+ *          呼び出し側で保証すること.
+ */
+static inline void tree_setup(struct tree *self,
+                              struct pool_chunk *pool,
+                              struct tree_soa soa,
+                              size_t payload_bytes,
+                              size_t capacity,
+                              struct collection_attr attr)
+{
+    *self = TREE_INITIALIZER(pool, soa, payload_bytes, capacity, attr);
+
+    /* root は固定で割り当てる. */
+    /** @todo root は他の要素と重複しなさそうなデータ部にする,
+     *  もしくは区別できる仕組みを入れる.
+     */
+    if (attr.compact) {
+        /* 番号 0 を root とする. */
+        self->soa.links[0] = TREE_LINK_INITIALIZER;
+        memset(self->soa.payloads, 0x5A, self->payload_bytes);
+        self->fresh_index = 1;
+        return;
+    }
+    self->root = tree_pop_released(self);
+    *(self->root) = TREE_NODE_INITIALIZER;
+    memset(self->root->payload, 0x5A, self->payload_bytes);
+}
+
+/**
+ *  @details    空で, 指定の容量を備えた, @ref TREE オブジェクトを確保
+ *              および初期化する.
+ *              N-ary ツリーのため, 同一の親に複数の子を追加することができる.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        ツリーの容量.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+TREE tree_init(size_t payload_bytes, size_t capacity)
+{
+    return tree_init_attr(payload_bytes, capacity, NULL);
+}
+
+/**
+ *  @details    空で, 指定の容量と属性を備えた, @ref TREE オブジェクトを
+ *              確保および初期化する.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        ツリーの初期容量.
+ *  @param      [in]    attr            ツリーの属性.
+ *                                      NULL の場合は @ref COLLECTION_ATTR_INITIALIZER
+ *                                      と同じ属性となる.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @sa         list_init_attr
+ */
+TREE tree_init_attr(size_t payload_bytes,
+                    size_t capacity,
+                    const struct collection_attr *attr)
+{
+    struct collection_attr a = collection_attr_of(attr);
+    struct tree *self;
+    struct pool_chunk *pool = NULL;
+    struct tree_soa soa = TREE_SOA_INITIALIZER;
+
+    if ((payload_bytes == 0) || (capacity == 0)
+        || !collection_attr_is_valid(&a, capacity)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    /* コンパクト配置は番号を 32 ビットで表すため, 容量を固定する. */
+    if (a.compact && (a.growable || (capacity >= TREE_LINK_NIL))) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    self = allocator_alloc(a.allocator, sizeof(*self), 0);
+    /* root の分を加えて確保する. */
+    if (a.compact) {
+        soa = tree_soa_alloc(a.allocator, payload_bytes, capacity + 1);
+    } else {
+        pool = pool_chunk_alloc(a.allocator, capacity + 1, tree_node_bytes(payload_bytes));
+    }
+    if ((self == NULL) || ((pool == NULL) && (soa.links == NULL))) {
+        pool_chunk_free_all(a.allocator, pool);
+        tree_soa_free(a.allocator, &soa);
+        allocator_free(a.allocator, self, sizeof(*self));
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    tree_setup(self, pool, soa, payload_bytes, capacity, a);
+    if (hindex_init(&self->index, payload_bytes, capacity, a.allocator) != 0) {
+        pool_chunk_free_all(a.allocator, pool);
+        tree_soa_free(a.allocator, &soa);
+        allocator_free(a.allocator, self, sizeof(*self));
+        return NULL;
+    }
+
+    return (TREE)self;
+}
+
+/**
+ *  @details    @c tree を解放する.
+ *              @c tree は @ref tree_init の戻り値である必要がある.
+ *
+ *  @param      [in,out]    tree    ツリーオブジェクト.
+ *  @warning    スレッドセーフではない.
+ */
+void tree_release(TREE tree)
+{
+    struct tree *self = (struct tree *)tree;
+
+    if (self != NULL) {
+        pool_chunk_free_all(self->attr.allocator, self->pool);
+        tree_soa_free(self->attr.allocator, &self->soa);
+        hindex_release(&self->index);
+        allocator_free(self->attr.allocator, self, sizeof(*self));
+    }
+}
+
+/**
+ *  @details    @c tree を空の状態にする.
+ *
+ *  @param      [in,out]    tree    ツリーオブジェクト.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int tree_clear(TREE tree)
+{
+    struct tree *self = (struct tree *)tree;
+    struct hindex index;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* ハッシュ索引の領域は再利用する. */
+    index = self->index;
+    tree_setup(self, self->pool, self->soa, self->payload_bytes, self->capacity, self->attr);
+    self->index = index;
+    hindex_clear(&self->index);
+
+    return 0;
+}
+
+/**
+ *  データ部のポインタから N-ary ツリーノードを取得する.
+ *
+ *  @param  [in]    payload データ部のポインタ.
+ *  @return ノードのポインタが返る.
+ */
+static inline struct tree_node *tree_node_of(void *payload)
+{
+    return (struct tree_node *)((uintptr_t)payload - offsetof(struct tree_node, payload));
+}
+
+/**
+ *  N-ary ツリー向け, ノードを親要素の末尾の子として連結する.
+ *
+ *  @param  [in,out]    owner   親要素のノード.
+ *  @param  [in,out]    node    連結するノード.
+ *  @pre    @c owner および @c node の非 NULL は呼び出し側で保証すること.
+ */
+static inline void tree_node_attach(struct tree_node *owner, struct tree_node *node)
+{
+    node->parent = owner;
+    node->prev_sibling = owner->last_child;
+    node->next_sibling = NULL;
+    if (owner->last_child == NULL) {
+        owner->first_child = node;
+    } else {
+        owner->last_child->next_sibling = node;
+    }
+    owner->last_child = node;
+}
+
+/**
+ *  N-ary ツリー向け, ノードを親要素と兄弟要素から切り離す.
+ *  子要素は切り離さない.
+ *
+ *  @param  [in,out]    node    切り離すノード.
+ *  @pre    @c node は連結済みであることを呼び出し側で保証すること.
+ */
+static inline void tree_node_detach(struct tree_node *node)
+{
+    struct tree_node *owner = node->parent;
+
+    if (node->prev_sibling == NULL) {
+        owner->first_child = node->next_sibling;
+    } else {
+        node->prev_sibling->next_sibling = node->next_sibling;
+    }
+    if (node->next_sibling == NULL) {
+        owner->last_child = node->prev_sibling;
+    } else {
+        node->next_sibling->prev_sibling = node->prev_sibling;
+    }
+    node->prev_sibling = NULL;
+    node->next_sibling = NULL;
+}
+
+/**
+ *  N-ary ツリー向け, 番号を親要素の末尾の子として連結する. (コンパクト配置時)
+ *
+ *  @param  [in,out]    links   リンクの配列.
+ *  @param  [in]        owner   親要素の番号.
+ *  @param  [in]        index   連結する番号.
+ *  @pre    @c links の非 NULL は呼び出し側で保証すること.
+ */
+static inline void tree_soa_attach(struct tree_link *links, uint32_t owner, uint32_t index)
+{
+    links[index].parent = owner;
+    links[index].prev_sibling = links[owner].last_child;
+    links[index].next_sibling = TREE_LINK_NIL;
+    if (links[owner].last_child == TREE_LINK_NIL) {
+        links[owner].first_child = index;
+    } else {
+        links[links[owner].last_child].next_sibling = index;
+    }
+    links[owner].last_child = index;
+}
+
+/**
+ *  N-ary ツリー向け, 番号を親要素と兄弟要素から切り離す. (コンパクト配置時)
+ *  子要素は切り離さない.
+ *
+ *  @param  [in,out]    links   リンクの配列.
+ *  @param  [in]        index   切り離す番号.
+ *  @pre    @c index は連結済みであることを呼び出し側で保証すること.
+ */
+static inline void tree_soa_detach(struct tree_link *links, uint32_t index)
+{
+    uint32_t owner = links[index].parent;
+    uint32_t prev = links[index].prev_sibling;
+    uint32_t next = links[index].next_sibling;
+
+    if (prev == TREE_LINK_NIL) {
+        links[owner].first_child = next;
+    } else {
+        links[prev].next_sibling = next;
+    }
+    if (next == TREE_LINK_NIL) {
+        links[owner].last_child = prev;
+    } else {
+        links[next].prev_sibling = prev;
+    }
+    links[index].prev_sibling = TREE_LINK_NIL;
+    links[index].next_sibling = TREE_LINK_NIL;
+}
+
+/**
+ *  N-ary ツリー向け, ノードを確保して親要素の末尾の子として連結する.
+ *
+ *  @param  [in,out]    self    ツリーオブジェクト.
+ *  @param  [in]        parent  親要素のデータ部. NULL の場合は root となる.
+ *  @param  [in]        payload 追加するデータ.
+ *  @return 成功時は, 追加したデータ部のポインタが返る.
+ *          失敗時は, NULL が返り, errno が適切に設定される.
+ *  @pre    @c self および @c payload の非 NULL は呼び出し側で保証すること.
+ */
+static void *tree_node_link(struct tree *self, void *parent, const void *payload)
+{
+    struct tree_node *owner = (parent == NULL) ? self->root : tree_node_of(parent);
+    struct tree_node *node;
+
+    node = tree_pop_released(self);
+    if (node == NULL) {
+        return NULL;
+    }
+    *node = TREE_NODE_INITIALIZER;
+    memcpy(node->payload, payload, self->payload_bytes);
+    tree_node_attach(owner, node);
+
+    return node->payload;
+}
+
+/**
+ *  N-ary ツリー向け, 番号を確保して親要素の末尾の子として連結する.
+ *  (コンパクト配置時)
+ *
+ *  @param  [in,out]    self    ツリーオブジェクト.
+ *  @param  [in]        parent  親要素のデータ部. NULL の場合は root となる.
+ *  @param  [in]        payload 追加するデータ.
+ *  @return 成功時は, 追加したデータ部のポインタが返る.
+ *          失敗時は, NULL が返り, errno が適切に設定される.
+ *  @pre    @c self および @c payload の非 NULL は呼び出し側で保証すること.
+ */
+static void *tree_soa_link(struct tree *self, void *parent, const void *payload)
+{
+    struct tree_link *links = self->soa.links;
+    uint32_t owner = (parent == NULL) ? 0 : tree_soa_index(&self->soa, parent);
+    uint32_t index;
+
+    if (self->soa_released != TREE_LINK_NIL) {
+        index = self->soa_released;
+        self->soa_released = links[index].next_sibling;
+    } else if (self->fresh_index <= self->capacity) {
+        /* root の分を含めて capacity + 1 個を確保している. */
+        index = (uint32_t)self->fresh_index++;
+    } else {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    links[index] = TREE_LINK_INITIALIZER;
+    memcpy(tree_soa_payload(&self->soa, index), payload, self->payload_bytes);
+    tree_soa_attach(links, owner, index);
+
+    return tree_soa_payload(&self->soa, index);
+}
+
+/**
+ *  N-ary ツリー向け, データ部が一致する前の要素を取得する.
+ *  先頭の要素の場合は, 末尾の要素が返る.
+ *
+ *  @param  [in]    self    ツリーオブジェクト.
+ *  @param  [in]    payload 要素のデータ部.
+ *  @return 前の要素のデータ部が返る.
+ *  @pre    @c self および @c payload の非 NULL は呼び出し側で保証すること.
+ */
+static inline void *tree_dup_prev(const struct tree *self, void *payload)
+{
+    if (self->attr.compact) {
+        uint32_t index = self->soa.links[tree_soa_index(&self->soa, payload)].prev_dup;
+        return tree_soa_payload(&self->soa, index);
+    }
+
+    return tree_node_of(payload)->prev_dup->payload;
+}
+
+/**
+ *  N-ary ツリー向け, データ部が一致する次の要素を取得する.
+ *
+ *  @param  [in]    self    ツリーオブジェクト.
+ *  @param  [in]    payload 要素のデータ部.
+ *  @return 次の要素のデータ部が返る. 末尾の要素の場合は NULL が返る.
+ *  @pre    @c self および @c payload の非 NULL は呼び出し側で保証すること.
+ */
+static inline void *tree_dup_next(const struct tree *self, void *payload)
+{
+    if (self->attr.compact) {
+        uint32_t index = self->soa.links[tree_soa_index(&self->soa, payload)].next_dup;
+        return (index == TREE_LINK_NIL) ? NULL : tree_soa_payload(&self->soa, index);
+    }
+
+    return (tree_node_of(payload)->next_dup == NULL)
+               ? NULL
+               : tree_node_of(payload)->next_dup->payload;
+}
+
+/**
+ *  N-ary ツリー向け, データ部が一致する前の要素を設定する.
+ *
+ *  @param  [in,out]    self    ツリーオブジェクト.
+ *  @param  [in]        payload 設定する要素のデータ部.
+ *  @param  [in]        prev    前の要素のデータ部.
+ *  @pre    @c self, @c payload および @c prev の非 NULL は呼び出し側で保証すること.
+ */
+static inline void tree_dup_set_prev(struct tree *self, void *payload, void *prev)
+{
+    if (self->attr.compact) {
+        self->soa.links[tree_soa_index(&self->soa, payload)].prev_dup =
+            tree_soa_index(&self->soa, prev);
+        return;
+    }
+    tree_node_of(payload)->prev_dup = tree_node_of(prev);
+}
+
+/**
+ *  N-ary ツリー向け, データ部が一致する次の要素を設定する.
+ *
+ *  @param  [in,out]    self    ツリーオブジェクト.
+ *  @param  [in]        payload 設定する要素のデータ部.
+ *  @param  [in]        next    次の要素のデータ部. NULL の場合は末尾となる.
+ *  @pre    @c self および @c payload の非 NULL は呼び出し側で保証すること.
+ */
+static inline void tree_dup_set_next(struct tree *self, void *payload, void *next)
+{
+    if (self->attr.compact) {
+        self->soa.links[tree_soa_index(&self->soa, payload)].next_dup =
+            (next == NULL) ? TREE_LINK_NIL : tree_soa_index(&self->soa, next);
+        return;
+    }
+    tree_node_of(payload)->next_dup = (next == NULL) ? NULL : tree_node_of(next);
+}
+
+/**
+ *  N-ary ツリー向け, 要素を親要素の末尾の子として追加し, ハッシュ索引に登録する.
+ *  データ部が一致する要素が既にある場合は, 索引が指す要素の重複の列の
+ *  末尾に連結する.
+ *
+ *  @param  [in,out]    self    ツリーオブジェクト.
+ *  @param  [in]        owner   親要素のデータ部. NULL の場合は root となる.
+ *  @param  [in]        payload 追加するデータ.
+ *  @return 成功時は, 追加したデータ部のポインタが返る.
+ *          失敗時は, NULL が返り, errno が適切に設定される.
+ *  @pre    @c self および @c payload の非 NULL は呼び出し側で保証すること.
+ */
+static void *tree_store(struct tree *self, void *owner, const void *payload)
+{
+    struct hindex_slot *slot;
+    void *stored;
+    size_t hash;
+
+    if (hindex_reserve(&self->index) != 0) {
+        return NULL;
+    }
+
+    if (self->attr.compact) {
+        stored = tree_soa_link(self, owner, payload);
+    } else {
+        stored = tree_node_link(self, owner, payload);
+    }
+    if (stored == NULL) {
+        return NULL;
+    }
+
+    hash = hindex_hash(stored, self->payload_bytes);
+    slot = hindex_probe(&self->index, stored, hash);
+    if (slot->epoch != self->index.epoch) {
+        hindex_put(&self->index, slot, hash, stored);
+        tree_dup_set_prev(self, stored, stored);
+    } else {
+        void *tail = tree_dup_prev(self, slot->payload);
+
+        tree_dup_set_next(self, tail, stored);
+        tree_dup_set_prev(self, stored, tail);
+        tree_dup_set_prev(self, slot->payload, stored);
+    }
+    ++self->count;
+
+    return stored;
+}
+
+/**
+ *  N-ary ツリー向け, ハンドルが削除されていない要素を指すかを検証する.
+ *
+ *  @param  [in]    self    ツリーオブジェクト.
+ *  @param  [in]    node    要素のハンドル (データ部のポインタ).
+ *  @return 有効な場合は true が返る.
+ *          無効な場合は false が返り, errno が適切に設定される.
+ *  @pre    @c self および @c node の非 NULL は呼び出し側で保証すること.
+ */
+static inline bool tree_node_is_live(const struct tree *self, const void *node)
+{
+    if (self->attr.compact) {
+        const char *p = node;
+        uint32_t index;
+
+        if ((p < self->soa.payloads)
+            || (((size_t)(p - self->soa.payloads) % self->soa.stride) != 0)) {
+            errno = EINVAL;
+            return false;
+        }
+        index = tree_soa_index(&self->soa, node);
+        if ((index == 0) || (index >= self->fresh_index)) {
+            errno = EINVAL;
+            return false;
+        }
+        if (self->soa.links[index].parent == TREE_LINK_NIL) {
+            errno = ENOENT;
+            return false;
+        }
+        return true;
+    }
+
+    if (tree_node_of((void *)node) == self->root) {
+        errno = EINVAL;
+        return false;
+    }
+    if (tree_node_of((void *)node)->parent == NULL) {
+        errno = ENOENT;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ *  N-ary ツリー向け, 削除する要素をハッシュ索引と重複の列から取り除く.
+ *  索引が指す先頭の要素を削除する場合は, 索引を次の要素に付け替え,
+ *  次の要素がなければ索引から取り除く.
+ *
+ *  @param  [in,out]    self    ツリーオブジェクト.
+ *  @param  [in]        payload 削除する要素のデータ部.
+ *  @pre    @c self および @c payload の非 NULL は呼び出し側で保証すること.
+ */
+static void tree_unindex(struct tree *self, void *payload)
+{
+    struct hindex_slot *slot;
+    void *prev = tree_dup_prev(self, payload);
+    void *next = tree_dup_next(self, payload);
+
+    /* 先頭の要素の前は末尾の要素のため, 前の要素の次が自身でなければ先頭である. */
+    if ((prev != payload) && (tree_dup_next(self, prev) == payload)) {
+        tree_dup_set_next(self, prev, next);
+        if (next != NULL) {
+            tree_dup_set_prev(self, next, prev);
+            return;
+        }
+        /* 末尾の要素を削除したため, 先頭から末尾を指し直す. */
+        slot = hindex_probe(&self->index, payload, hindex_hash(payload, self->payload_bytes));
+        tree_dup_set_prev(self, slot->payload, prev);
+        return;
+    }
+
+    slot = hindex_probe(&self->index, payload, hindex_hash(payload, self->payload_bytes));
+    if (next == NULL) {
+        hindex_remove(&self->index, slot);
+        return;
+    }
+    slot->payload = next;
+    tree_dup_set_prev(self, next, prev);
+}
+
+/**
+ *  N-ary ツリー向け, ノードとその子孫を帰りがけ順に解放済みとする.
+ *
+ *  @param  [in,out]    self    ツリーオブジェクト.
+ *  @param  [in,out]    top     削除する部分木の根.
+ *  @return 削除したノードの数が返る.
+ *  @pre    @c top は連結済みであることを呼び出し側で保証すること.
+ */
+static size_t tree_node_remove(struct tree *self, struct tree_node *top)
+{
+    struct tree_node *curr = top, *next;
+    size_t removed = 0;
+
+    tree_node_detach(top);
+    while (curr->first_child != NULL) {
+        curr = curr->first_child;
+    }
+    while (curr != NULL) {
+        if (curr == top) {
+            next = NULL;
+        } else if (curr->next_sibling != NULL) {
+            next = curr->next_sibling;
+            while (next->first_child != NULL) {
+                next = next->first_child;
+            }
+        } else {
+            next = curr->parent;
+        }
+        tree_unindex(self, curr->payload);
+        tree_push_released(self, curr);
+        ++removed;
+        curr = next;
+    }
+
+    return removed;
+}
+
+/**
+ *  N-ary ツリー向け, 番号とその子孫を帰りがけ順に解放済みとする.
+ *  (コンパクト配置時)
+ *
+ *  @param  [in,out]    self    ツリーオブジェクト.
+ *  @param  [in]        top     削除する部分木の根の番号.
+ *  @return 削除した番号の数が返る.
+ *  @pre    @c top は連結済みであることを呼び出し側で保証すること.
+ */
+static size_t tree_soa_remove(struct tree *self, uint32_t top)
+{
+    struct tree_link *links = self->soa.links;
+    uint32_t curr = top, next;
+    size_t removed = 0;
+
+    tree_soa_detach(links, top);
+    while (links[curr].first_child != TREE_LINK_NIL) {
+        curr = links[curr].first_child;
+    }
+    while (curr != TREE_LINK_NIL) {
+        if (curr == top) {
+            next = TREE_LINK_NIL;
+        } else if (links[curr].next_sibling != TREE_LINK_NIL) {
+            next = links[curr].next_sibling;
+            while (links[next].first_child != TREE_LINK_NIL) {
+                next = links[next].first_child;
+            }
+        } else {
+            next = links[curr].parent;
+        }
+        tree_unindex(self, tree_soa_payload(&self->soa, curr));
+        links[curr] = TREE_LINK_INITIALIZER;
+        links[curr].next_sibling = self->soa_released;
+        self->soa_released = curr;
+        ++removed;
+        curr = next;
+    }
+
+    return removed;
+}
+
+/**
+ *  @details    要素の配列と親要素の番号の配列から @ref TREE オブジェクトを
+ *              確保および初期化する.
+ *              @c parents[i] は @c array[i] の親要素の @c array 上の番号で,
+ *              -1 の場合は最上位の要素となる. 兄弟要素は配列の順に並ぶ.
+ *              要素の数が 0 の場合は, 容量 1 の空のツリーとなる.
+ *
+ *  @code
+ *  // 1 - 11
+ *  //   - 12
+ *  // 2
+ *  const int data[] = {1, 11, 12, 2};
+ *  const ssize_t parents[] = {-1, 0, 0, -1};
+ *  TREE tree = tree_from_parent_array(sizeof(int), data, parents, 4, NULL);
+ *  @endcode
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    array           要素の配列. @c count が 0 の場合は NULL でもよい.
+ *  @param      [in]    parents         親要素の番号の配列. @c count が 0 の場合は
+ *                                      NULL でもよい.
+ *  @param      [in]    count           要素の数.
+ *  @param      [in]    attr            ツリーの属性.
+ *                                      NULL の場合は @ref COLLECTION_ATTR_INITIALIZER
+ *                                      と同じ属性となる.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *              親要素が自身より後ろにある場合, errno には EINVAL が設定される.
+ *  @remarks    親要素は自身より前に置くこと. (行きがけ順, 幅優先順など)
+ *              親要素を探索せず, 要素の数に比例した時間で構築する.
+ *  @sa         tree_init_attr
+ */
+TREE tree_from_parent_array(size_t payload_bytes,
+                            const void *array,
+                            const ssize_t *parents,
+                            size_t count,
+                            const struct collection_attr *attr)
+{
+    struct tree *self;
+    size_t node_bytes = tree_node_bytes(payload_bytes);
+
+    if (((array == NULL) || (parents == NULL)) && (count != 0)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if ((parents[i] < -1) || (parents[i] >= (ssize_t)i)) {
+            errno = EINVAL;
+            return NULL;
+        }
+    }
+
+    self = (struct tree *)tree_init_attr(payload_bytes, (count == 0) ? 1 : count, attr);
+    if (self == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        void *owner = NULL;
+        /* 要素は初期確保した領域の先頭 (root の次) から順に配置される. */
+        if (parents[i] >= 0) {
+            size_t index = (size_t)parents[i] + 1;
+            owner = self->attr.compact
+                        ? tree_soa_payload(&self->soa, (uint32_t)index)
+                        : ((struct tree_node *)((uintptr_t)self->pool->nodes
+                                                + (node_bytes * index)))->payload;
+        }
+        if (tree_store(self, owner, (const char *)array + (payload_bytes * i)) == NULL) {
+            tree_release((TREE)self);
+            return NULL;
+        }
+    }
+
+    return (TREE)self;
+}
+
+/**
+ *  @details    @c tree の指定位置に要素を追加する.
+ *              @c parent と一致する要素が複数存在する場合は, 最初に追加された
+ *              要素の子として追加する.
+ *
+ *  @param      [in,out]    tree    ツリーオブジェクト.
+ *  @param      [in]        parent  子として追加する親要素.
+ *                                  NULL の場合は最上位に追加する.
+ *  @param      [in]        payload ツリーに追加するデータ.
+ *  @return     成功時は, 追加したツリー上のデータ部のポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *              @c parent がツリーにない場合, errno には ENOENT が設定される.
+ *  @remarks    親の探索はハッシュ索引により O(1) で行われる.
+ *  @warning    スレッドセーフではない.
+ */
+void *tree_insert(TREE tree, void *parent, void *payload)
+{
+    struct tree *self = (struct tree *)tree;
+    void *owner = NULL;
+
+    if ((self == NULL) || (payload == NULL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (parent != NULL) {
+        owner = hindex_find(&self->index, parent);
+        if (owner == NULL) {
+            errno = ENOENT;
+            return NULL;
+        }
+    }
+
+    return tree_store(self, owner, payload);
+}
+
+/**
+ *  @details    @c tree の @c parent の末尾の子として要素を追加し,
+ *              追加した要素のハンドルを返す.
+ *              @ref tree_insert と異なり, 親要素をデータ部から探索しない.
+ *
+ *  @param      [in,out]    tree    ツリーオブジェクト.
+ *  @param      [in]        parent  親要素のハンドル.
+ *                                  NULL の場合は最上位に追加する.
+ *  @param      [in]        payload ツリーに追加するデータ.
+ *  @return     成功時は, 追加した要素のハンドルが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *              @c parent が削除済みの場合, errno には ENOENT が設定される.
+ *  @remarks    ハンドルは要素を削除するまで有効で, 移動しても変わらない.
+ *  @warning    スレッドセーフではない.
+ */
+TREE_NODE tree_insert_node(TREE tree, TREE_NODE parent, const void *payload)
+{
+    struct tree *self = (struct tree *)tree;
+
+    if ((self == NULL) || (payload == NULL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if ((parent != NULL) && !tree_node_is_live(self, parent)) {
+        return NULL;
+    }
+
+    return (TREE_NODE)tree_store(self, parent, payload);
+}
+
+/**
+ *  @details    @c tree から @c payload と一致する要素のハンドルを取得する.
+ *              一致する要素が複数存在する場合は, 最初に追加された要素となる.
+ *
+ *  @param      [in]    tree    ツリーオブジェクト.
+ *  @param      [in]    payload 探索するデータ.
+ *  @return     成功時は, 要素のハンドルが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *              一致する要素がない場合, errno には ENOENT が設定される.
+ *  @remarks    探索はハッシュ索引により O(1) で行われる.
+ *  @warning    スレッドセーフではない.
+ */
+TREE_NODE tree_find(TREE tree, const void *payload)
+{
+    struct tree *self = (struct tree *)tree;
+    void *found;
+
+    if ((self == NULL) || (payload == NULL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    found = hindex_find(&self->index, payload);
+    if (found == NULL) {
+        errno = ENOENT;
+    }
+
+    return (TREE_NODE)found;
+}
+
+/**
+ *  @details    @c node のデータ部を取得する.
+ *
+ *  @param      [in]    tree    ツリーオブジェクト.
+ *  @param      [in]    node    要素のハンドル.
+ *  @return     成功時は, データ部のポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+void *tree_node_get_payload(TREE tree, TREE_NODE node)
 {
-    struct list *self = (struct list *)list;
+    struct tree *self = (struct tree *)tree;
 
-    if (self == NULL) {
+    if ((self == NULL) || (node == NULL)) {
         errno = EINVAL;
-        return -1;
+        return NULL;
+    }
+    if (!tree_node_is_live(self, node)) {
+        return NULL;
     }
 
-    return self->count;
+    return (void *)node;
 }
 
 /**
- *  @details    @c list の反復子を取得する.
- *
- *  @code
- *  for (ITER iter = list_iter(list);
- *       iter != NULL;
- *       iter = iter_next(iter)) {
- *      void *payload = iter_get_payload(iter);
- *  }
- *  @endcode
+ *  @details    @c node の親要素のハンドルを取得する.
  *
- *  @param      [in]    list    リストオブジェクト.
- *  @return     成功時は, @c list の反復子が返る.
- *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @param      [in]    tree    ツリーオブジェクト.
+ *  @param      [in]    node    要素のハンドル.
+ *  @return     成功時は, 親要素のハンドルが返る.
+ *              最上位の要素の場合, または失敗時は, NULL が返る.
+ *              失敗時は, errno が適切に設定される.
  *  @warning    スレッドセーフではない.
- *  @sa         iter_next, iter_get_payload
  */
-ITER list_iter(LIST list)
+TREE_NODE tree_node_get_parent(TREE tree, TREE_NODE node)
 {
-    struct list *self = (struct list *)list;
-    if (self == NULL) {
+    struct tree *self = (struct tree *)tree;
+
+    if ((self == NULL) || (node == NULL)) {
         errno = EINVAL;
         return NULL;
     }
-    return (ITER)self->root;
+    if (!tree_node_is_live(self, node)) {
+        return NULL;
+    }
+
+    if (self->attr.compact) {
+        uint32_t parent = self->soa.links[tree_soa_index(&self->soa, node)].parent;
+        return (parent == 0) ? NULL : (TREE_NODE)tree_soa_payload(&self->soa, parent);
+    }
+
+    return (tree_node_of(node)->parent == self->root)
+               ? NULL
+               : (TREE_NODE)tree_node_of(node)->parent->payload;
 }
 
 /**
- *  @details    @c list に積まれた要素を配列にコピーする.
+ *  @details    @c node とその子孫を @c tree から削除する.
+ *              削除した要素は解放済みとなり, 以降の追加で再利用される.
  *
- *  @param      [in]    list    リストオブジェクト.
- *  @param      [out]   array   確保した配列のポインタ.
- *  @param      [out]   count   要素の数.
- *  @return     成功時は, 0 が返り, @c array に確保された配列のポインタを
- *              設定する.
+ *  @param      [in,out]    tree    ツリーオブジェクト.
+ *  @param      [in]        node    削除する要素のハンドル.
+ *  @return     成功時は, 削除した要素の数が返る.
  *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              @c node が削除済みの場合, errno には ENOENT が設定される.
+ *  @remarks    削除した要素の数に比例した時間がかかり, メモリを確保しない.
+ *              削除した要素のハンドルおよびデータ部のポインタは無効となる.
  *  @warning    スレッドセーフではない.
  */
-
-int list_to_array(LIST list, void **array, size_t *count)
+ssize_t tree_remove(TREE tree, TREE_NODE node)
 {
-    struct list *self = (struct list *)list;
-    ITER iter;
-    void *buf;
+    struct tree *self = (struct tree *)tree;
+    size_t removed;
 
-    if ((self == NULL) || (array == NULL) || (count == NULL)) {
+    if ((self == NULL) || (node == NULL)) {
         errno = EINVAL;
         return -1;
     }
+    if (!tree_node_is_live(self, node)) {
+        return -1;
+    }
 
-    buf = malloc(self->payload_bytes * self->count);
-    if (buf == NULL) {
+    if (self->attr.compact) {
+        removed = tree_soa_remove(self, tree_soa_index(&self->soa, node));
+    } else {
+        removed = tree_node_remove(self, tree_node_of(node));
+    }
+    self->count -= removed;
+
+    return (ssize_t)removed;
+}
+
+/**
+ *  @details    @c node とその子孫を, @c parent の末尾の子として移動する.
+ *              データ部は移動せず, ハンドルはそのまま有効である.
+ *
+ *  @param      [in,out]    tree    ツリーオブジェクト.
+ *  @param      [in]        node    移動する要素のハンドル.
+ *  @param      [in]        parent  移動先の親要素のハンドル.
+ *                                  NULL の場合は最上位に移動する.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              @c parent が @c node 自身またはその子孫の場合,
+ *              errno には EINVAL が設定される.
+ *              @c node または @c parent が削除済みの場合,
+ *              errno には ENOENT が設定される.
+ *  @remarks    付け替えは O(1) で行われ, 部分木の大きさによらない.
+ *              循環の検証のため, @c parent の深さに比例した時間がかかる.
+ *  @warning    スレッドセーフではない.
+ */
+int tree_move(TREE tree, TREE_NODE node, TREE_NODE parent)
+{
+    struct tree *self = (struct tree *)tree;
+
+    if ((self == NULL) || (node == NULL)) {
+        errno = EINVAL;
         return -1;
     }
-    *array = buf;
-    *count = 0;
-    for (iter = list_iter(list); iter != NULL; iter = iter_next(iter)) {
-        memcpy(buf, iter_get_payload(iter), self->payload_bytes);
-        buf = (void *)((uintptr_t)buf + self->payload_bytes);
-        ++(*count);
+    if (!tree_node_is_live(self, node)
+        || ((parent != NULL) && !tree_node_is_live(self, parent))) {
+        return -1;
+    }
+
+    if (self->attr.compact) {
+        struct tree_link *links = self->soa.links;
+        uint32_t index = tree_soa_index(&self->soa, node);
+        uint32_t owner = (parent == NULL) ? 0 : tree_soa_index(&self->soa, parent);
+
+        for (uint32_t i = owner; i != 0; i = links[i].parent) {
+            if (i == index) {
+                errno = EINVAL;
+                return -1;
+            }
+        }
+        tree_soa_detach(links, index);
+        tree_soa_attach(links, owner, index);
+    } else {
+        struct tree_node *moved = tree_node_of(node);
+        struct tree_node *owner = (parent == NULL) ? self->root : tree_node_of(parent);
+
+        for (struct tree_node *n = owner; n != self->root; n = n->parent) {
+            if (n == moved) {
+                errno = EINVAL;
+                return -1;
+            }
+        }
+        tree_node_detach(moved);
+        tree_node_attach(owner, moved);
     }
 
     return 0;
 }
 
 /**
- *  @details    空で, 指定の容量を備えた, @ref STACK オブジェクトを確保
- *              および初期化する.
+ *  @details    @c tree に追加されている要素の数を返す.
  *
- *  @param      [in]    payload_bytes   データ部のサイズ.
- *  @param      [in]    capacity        スタックの容量.
- *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
- *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @param      [in]    tree    ツリーオブジェクト.
+ *  @return     成功時は, @c tree に追加されている要素の数を返す.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
  */
-STACK stack_init(size_t payload_bytes, size_t capacity)
+ssize_t tree_count(TREE tree)
 {
-    return (STACK)list_init(payload_bytes, capacity);
+    struct tree *self = (struct tree *)tree;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return self->count;
 }
 
 /**
- *  @details    @c stack を解放する.
- *              @c stack は @ref stack_init の戻り値である必要がある.
+ *  N-ary ツリー向け, 行きがけ順で次のノードを取得する.
+ *  親要素へのポインタを辿るため, 補助的なスタックを必要としない.
  *
- *  @param      [in,out]    stack   スタックオブジェクト.
- *  @warning    スレッドセーフではない.
+ *  @param  [in]        root    走査の起点 (ツリーの根, または部分木の根).
+ *  @param  [in]        node    現在地のノード.
+ *  @param  [in,out]    age     現在地の世代. 次のノードの世代に更新する.
+ *  @return 次のノードが返る. 次のノードがない場合は NULL が返る.
+ *  @pre    @c root, @c node および @c age の非 NULL は呼び出し側で保証すること.
  */
-void stack_release(STACK stack)
+static inline struct tree_node *tree_node_next(const struct tree_node *root,
+                                               const struct tree_node *node,
+                                               int *age)
 {
-    list_release((LIST)stack);
+    if (node->first_child != NULL) {
+        ++*age;
+        return node->first_child;
+    }
+    while ((node != root) && (node->next_sibling == NULL)) {
+        node = node->parent;
+        --*age;
+    }
+
+    return (node == root) ? NULL : node->next_sibling;
 }
 
 /**
- *  @details    @c stack を空の状態にする.
+ *  N-ary ツリー向け, 行きがけ順で次の番号を取得する. (コンパクト配置時)
+ *  リンクの配列のみを参照し, データ部には触れない.
  *
- *  @param      [in,out]    stack   スタックオブジェクト.
- *  @return     成功時は, 0 が返る.
- *              失敗時は, -1 が返り, errno が適切に設定される.
- *  @warning    スレッドセーフではない.
+ *  @param  [in]        links   リンクの配列.
+ *  @param  [in]        top     走査の起点の番号 (0 の場合はツリーの根).
+ *  @param  [in]        index   現在地の番号.
+ *  @param  [in,out]    age     現在地の世代. 次の要素の世代に更新する.
+ *  @return 次の番号が返る. 次の要素がない場合は @ref TREE_LINK_NIL が返る.
+ *  @pre    @c links および @c age の非 NULL は呼び出し側で保証すること.
  */
-int stack_clear(STACK stack)
+static inline uint32_t tree_soa_next(const struct tree_link *links,
+                                     uint32_t top,
+                                     uint32_t index,
+                                     int *age)
 {
-    return list_clear((LIST)stack);
+    if (links[index].first_child != TREE_LINK_NIL) {
+        ++*age;
+        return links[index].first_child;
+    }
+    while ((index != top) && (links[index].next_sibling == TREE_LINK_NIL)) {
+        index = links[index].parent;
+        --*age;
+    }
+
+    return (index == top) ? TREE_LINK_NIL : links[index].next_sibling;
 }
 
 /**
- *  @details    @c stack に要素を積む.
+ *  @details    @c walk を @c tree の先頭の要素に位置付ける.
  *
- *  @param      [in,out]    stack   スタックオブジェクト.
- *  @param      [in]        payload スタックに積むデータ.
- *  @return     成功時は, 積んだスタック上のデータ部のポインタが返る.
- *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @code
+ *  struct tree_walk walk;
+ *  for (void *payload = tree_walk_first(tree, &walk);
+ *       payload != NULL;
+ *       payload = tree_walk_next(&walk)) {
+ *      int age = tree_walk_get_age(&walk);
+ *  }
+ *  @endcode
+ *
+ *  @param      [in]    tree    ツリーオブジェクト.
+ *  @param      [out]   walk    走査子.
+ *  @return     成功時は, 先頭の要素のデータ部のポインタが返る.
+ *              要素がない場合, または失敗時は, NULL が返り, errno が
+ *              適切に設定される.
+ *  @remarks    走査は深さ (子要素) 優先で行われる.
+ *              走査子は呼び出し側で確保し, 走査中にメモリを確保しない.
  *  @warning    スレッドセーフではない.
+ *              走査中にツリーを変更した場合の動作は未定義.
+ *  @sa         tree_walk_next, tree_walk_get_age
  */
-void *stack_push(STACK stack, void *payload)
+void *tree_walk_first(TREE tree, struct tree_walk *walk)
 {
-    return list_insert((LIST)stack, 0, payload);
+    struct tree *self = (struct tree *)tree;
+
+    if ((self == NULL) || (walk == NULL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    *walk = TREE_WALK_INITIALIZER;
+    walk->tree = self;
+    walk->age = 1;
+    if (self->attr.compact) {
+        uint32_t first = self->soa.links[0].first_child;
+        if (first != TREE_LINK_NIL) {
+            walk->payload = tree_soa_payload(&self->soa, first);
+        }
+    } else if (self->root->first_child != NULL) {
+        walk->payload = self->root->first_child->payload;
+    }
+    if (walk->payload == NULL) {
+        errno = ENOENT;
+    }
+
+    return walk->payload;
 }
 
 /**
- *  @details    @c stack から, 最初の要素を取り除く.
+ *  @details    @c walk を次の要素に進める.
  *
- *  @param      [in,out]    stack   スタックオブジェクト.
- *  @param      [out]       payload データ部をコピーするバッファ.
- *  @return     成功時は, @c stack に残っている要素の数が返る.
- *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @param      [in,out]    walk    走査子.
+ *  @return     成功時は, 次の要素のデータ部のポインタが返る.
+ *              次の要素がない場合, または失敗時は, NULL が返り, errno が
+ *              適切に設定される.
  *  @warning    スレッドセーフではない.
  */
-int stack_pop(STACK stack, void *payload)
+void *tree_walk_next(struct tree_walk *walk)
 {
-    LIST list = (LIST)stack;
-    ITER iter = list_iter(list);
+    const struct tree *self;
 
-    if ((list == NULL) || (payload == NULL)) {
+    if ((walk == NULL) || (walk->tree == NULL)) {
         errno = EINVAL;
-        return -1;
+        return NULL;
     }
-    if (iter == NULL) {
-        errno = EAGAIN;
-        return -1;
+    if (walk->payload == NULL) {
+        errno = ENOENT;
+        return NULL;
     }
 
-    memcpy(payload, iter_get_payload(iter), list_payload_bytes(list));
-    list_remove(list, iter);
+    self = walk->tree;
+    if (self->attr.compact) {
+        uint32_t next = tree_soa_next(self->soa.links,
+                                      (walk->top == NULL) ? 0 : tree_soa_index(&self->soa, walk->top),
+                                      tree_soa_index(&self->soa, walk->payload),
+                                      &walk->age);
+        walk->payload = (next == TREE_LINK_NIL) ? NULL : tree_soa_payload(&self->soa, next);
+    } else {
+        struct tree_node *next = tree_node_next((walk->top == NULL) ? self->root
+                                                                    : tree_node_of(walk->top),
+                                                tree_node_of(walk->payload),
+                                                &walk->age);
+        walk->payload = (next == NULL) ? NULL : next->payload;
+    }
+    if (walk->payload == NULL) {
+        errno = ENOENT;
+    }
 
-    return list_count(list);
+    return walk->payload;
 }
 
 /**
- *  @details    @c stack に積まれている要素の数を返す.
+ *  @details    @c walk の現在地のツリー上での世代 (深さ) を取得する.
  *
- *  @param      [in]    stack   スタックオブジェクト.
- *  @return     成功時は, @c stack に積まれている要素の数を返す.
+ *  @param      [in]    walk    走査子.
+ *  @return     成功時は, 世代が返る.
  *              失敗時は, -1 が返り, errno が適切に設定される.
  *  @warning    スレッドセーフではない.
  */
-ssize_t stack_count(STACK stack)
+int tree_walk_get_age(const struct tree_walk *walk)
 {
-    return list_count((LIST)stack);
+    if ((walk == NULL) || (walk->tree == NULL) || (walk->payload == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return walk->age;
 }
 
 /**
- *  @details    @c stack の反復子を取得する.
+ *  @details    @c tree の反復子を取得する.
  *
  *  @code
- *  for (ITER iter = stack_iter(stack);
+ *  for (TREE_ITER iter = tree_iter_get(tree);
  *       iter != NULL;
- *       iter = iter_next(iter)) {
- *      void *payload = iter_get_payload(iter);
+ *       iter = tree_iter_next(iter)) {
+ *      void *payload = tree_iter_get_payload(iter);
+        int age = tree_iter_get_age(iter);
  *  }
  *  @endcode
  *
- *  @param      [in]    stack   スタックオブジェクト.
- *  @return     成功時は, @c stack の反復子が返る.
+ *  @param      [in]    tree    ツリーオブジェクト.
+ *  @return     成功時は, @c tree の反復子が返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    走査は深さ (子要素) 優先で行われる.
+ *              確保するのは反復子自身のみ (@c tree のメモリ割り当てから確保する) で,
+ *              走査はツリーの容量によらない.
+ *              メモリを確保せずに走査する場合は @ref tree_walk_first を使用する.
+ *  @warning    スレッドセーフではない.
+ *  @sa         tree_iter_next, tree_iter_get_payload, tree_iter_get_age
+ */
+TREE_ITER tree_iter_get(TREE tree)
+{
+    struct tree_walk walk;
+    struct tree_iter *iter;
+
+    if (tree_walk_first(tree, &walk) == NULL) {
+        return NULL;
+    }
+
+    iter = allocator_alloc(((const struct tree *)walk.tree)->attr.allocator, sizeof(*iter), 0);
+    if (iter == NULL) {
+        return NULL;
+    }
+    *iter = TREE_ITER_INITIALIZER;
+    iter->walk = walk;
+
+    return (TREE_ITER)iter;
+}
+
+/**
+ *  @details    @c iter を解放する.
+ *              @c iter は @ref tree_iter_get の戻り値である必要がある.
+ *
+ *  @param      [in,out]    iter    反復子オブジェクト.
+ *  @warning    スレッドセーフではない.
+ */
+void tree_iter_release(TREE_ITER iter)
+{
+    struct tree_iter *self = (struct tree_iter *)iter;
+
+    if (self != NULL) {
+        allocator_free(((const struct tree *)self->walk.tree)->attr.allocator,
+                       self, sizeof(*self));
+    }
+}
+
+/**
+ *  @details    @c iter の次の反復子を取得する.
+ *              次の要素がない場合, @c iter は解放される.
+ *
+ *  @param      [in]    iter    N-ary ツリーの反復子.
+ *  @return     成功時は, 次の反復子が返る. 次の要素がない場合は NULL が返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    末尾まで走査した場合は @ref tree_iter_release を呼び出す
+ *              必要はない (NULL を渡してもよい).
+ *  @warning    スレッドセーフではない.
+ */
+TREE_ITER tree_iter_next(TREE_ITER iter)
+{
+    struct tree_iter *self = (struct tree_iter *)iter;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (tree_walk_next(&self->walk) == NULL) {
+        tree_iter_release(iter);
+        return NULL;
+    }
+
+    return iter;
+}
+
+/**
+ *  @details    @c iter のデータ部を取得する.
+ *
+ *  @param      [in]    iter    N-ary ツリーの反復子.
+ *  @return     成功時は, データ部のポインタが返る.
  *              失敗時は, NULL が返り, errno が適切に設定される.
  *  @warning    スレッドセーフではない.
- *  @sa         iter_next, iter_get_payload
  */
-ITER stack_iter(STACK stack)
+void *tree_iter_get_payload(TREE_ITER iter)
 {
-    return list_iter((LIST)stack);
+    struct tree_iter *self = (struct tree_iter *)iter;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    return self->walk.payload;
 }
 
 /**
- *  @details    空で, 指定の容量を備えた, @ref QUEUE オブジェクトを
- *              確保および初期化する.
+ *  @details    @c iter のツリー上での世代 (深さ) を取得する.
  *
- *  @param      [in]    payload_bytes   データ部のサイズ.
- *  @param      [in]    capacity        キューの容量.
- *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
- *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @param      [in]    iter    N-ary ツリーの反復子.
+ *  @return     成功時は, 世代が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
  */
-QUEUE queue_init(size_t payload_bytes, size_t capacity)
+int tree_iter_get_age(TREE_ITER iter)
 {
-    return (QUEUE)list_init(payload_bytes, capacity);
+    struct tree_iter *self = (struct tree_iter *)iter;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return tree_walk_get_age(&self->walk);
 }
 
 /**
- *  @details    @c que を解放する.
- *              @c que は @ref queue_init の戻り値である必要がある.
+ *  N-ary ツリー向け, 要素の世代 (深さ) を算出する.
  *
- *  @param      [in,out]    que キューオブジェクト.
- *  @warning    スレッドセーフではない.
+ *  @param  [in]    self    ツリーオブジェクト.
+ *  @param  [in]    node    要素のハンドル (データ部のポインタ).
+ *  @return 世代が返る.
+ *  @pre    @c node は有効なハンドルであることを呼び出し側で保証すること.
  */
-void queue_release(QUEUE que)
+static int tree_node_depth(const struct tree *self, const void *node)
 {
-    list_release((LIST)que);
+    int age = 0;
+
+    if (self->attr.compact) {
+        for (uint32_t i = tree_soa_index(&self->soa, node); i != 0; i = self->soa.links[i].parent) {
+            ++age;
+        }
+    } else {
+        for (const struct tree_node *n = tree_node_of((void *)node); n != self->root; n = n->parent) {
+            ++age;
+        }
+    }
+
+    return age;
 }
 
 /**
- *  @details    @c que を空の状態にする.
+ *  @details    @c walk を @c tree の @c top を根とする部分木の先頭
+ *              (@c top 自身) に位置付ける.
+ *              以降の @ref tree_walk_next は部分木の外に出ない.
  *
- *  @param      [in,out]    que キューオブジェクト.
- *  @return     成功時は, 0 が返る.
- *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @param      [in]    tree    ツリーオブジェクト.
+ *  @param      [in]    top     部分木の根のハンドル.
+ *                              NULL の場合は @ref tree_walk_first と同じとなる.
+ *  @param      [out]   walk    走査子.
+ *  @return     成功時は, @c top のデータ部のポインタが返る.
+ *              要素がない場合, または失敗時は, NULL が返り, errno が
+ *              適切に設定される.
+ *  @remarks    世代はツリーの根からの深さとなる.
+ *              走査子は呼び出し側で確保し, 走査中にメモリを確保しない.
  *  @warning    スレッドセーフではない.
+ *              走査中にツリーを変更した場合の動作は未定義.
+ *  @sa         tree_walk_first, tree_walk_next
  */
-int queue_clear(QUEUE que)
+void *tree_walk_first_at(TREE tree, TREE_NODE top, struct tree_walk *walk)
 {
-    return list_clear((LIST)que);
+    struct tree *self = (struct tree *)tree;
+
+    if (top == NULL) {
+        return tree_walk_first(tree, walk);
+    }
+    if ((self == NULL) || (walk == NULL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!tree_node_is_live(self, top)) {
+        return NULL;
+    }
+
+    *walk = TREE_WALK_INITIALIZER;
+    walk->tree = self;
+    walk->top = top;
+    walk->payload = top;
+    walk->age = tree_node_depth(self, top);
+
+    return walk->payload;
 }
 
 /**
- *  @details    @c que の最後に要素を追加する.
+ *  N-ary ツリー向け, 要素の子のハンドルを幅優先走査のキューに追加する.
  *
- *  @param      [in,out]    que     キューオブジェクト.
- *  @param      [in]        payload キューに追加するデータ.
- *  @return     成功時は, 追加したキュー上のデータ部のポインタが返る.
- *              失敗時は, NULL が返り, errno が適切に設定される.
- *  @warning    スレッドセーフではない.
+ *  @param  [in,out]    bfs     幅優先走査子.
+ *  @param  [in]        node    要素のハンドル. NULL の場合はツリーの根となる.
+ *  @return 成功時は, 0 が返る.
+ *          失敗時は, -1 が返り, errno が適切に設定される.
+ *  @pre    @c bfs の非 NULL は呼び出し側で保証すること.
  */
-void *queue_enq(QUEUE que, void *payload)
+static int tree_bfs_expand(struct tree_bfs *bfs, const void *node)
 {
-    return list_insert((LIST)que, -1, payload);
+    const struct tree *self = bfs->tree;
+    void *child;
+
+    if (self->attr.compact) {
+        const struct tree_link *links = self->soa.links;
+        uint32_t index = (node == NULL) ? 0 : tree_soa_index(&self->soa, node);
+        for (uint32_t i = links[index].first_child; i != TREE_LINK_NIL; i = links[i].next_sibling) {
+            child = tree_soa_payload(&self->soa, i);
+            if (queue_enq((QUEUE)bfs->queue, &child) == NULL) {
+                return -1;
+            }
+        }
+    } else {
+        const struct tree_node *owner = (node == NULL) ? self->root : tree_node_of((void *)node);
+        for (struct tree_node *n = owner->first_child; n != NULL; n = n->next_sibling) {
+            child = n->payload;
+            if (queue_enq((QUEUE)bfs->queue, &child) == NULL) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
 }
 
 /**
- *  @details    @c que の最初の要素をコピーし, 削除する.
+ *  @details    @c bfs を @c tree の @c top を根とする部分木の幅優先走査に
+ *              初期化する.
+ *              未訪問の要素のハンドルはリングバッファのキューに保持する.
  *
- *  @param      [in,out]    que     キューオブジェクト.
- *  @param      [out]       payload データ部をコピーするバッファ.
- *  @return     成功時は, @c que に残っている要素の数が返る.
+ *  @code
+ *  struct tree_bfs bfs;
+ *  tree_bfs_init(&bfs, tree, NULL);
+ *  for (void *payload = tree_bfs_next(&bfs);
+ *       payload != NULL;
+ *       payload = tree_bfs_next(&bfs)) {
+ *      int age = tree_bfs_get_age(&bfs);
+ *  }
+ *  tree_bfs_release(&bfs);
+ *  @endcode
+ *
+ *  @param      [out]   bfs     幅優先走査子.
+ *  @param      [in]    tree    ツリーオブジェクト.
+ *  @param      [in]    top     部分木の根のハンドル.
+ *                              NULL の場合はツリー全体 (最上位の要素から) となる.
+ *  @return     成功時は, 0 が返る.
  *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @remarks    キューはツリーの要素の数を容量として, @c tree のメモリ割り当てから
+ *              確保する. 走査中はメモリを確保しない.
  *  @warning    スレッドセーフではない.
+ *              走査中にツリーを変更した場合の動作は未定義.
+ *  @sa         tree_bfs_next, tree_bfs_next_level, tree_bfs_release
  */
-int queue_deq(QUEUE que, void *payload)
+int tree_bfs_init(struct tree_bfs *bfs, TREE tree, TREE_NODE top)
 {
-    LIST list = (LIST)que;
-    ITER iter = list_iter(list);
+    struct tree *self = (struct tree *)tree;
+    struct collection_attr attr = COLLECTION_ATTR_INITIALIZER;
+    void *seed = top;
 
-    if ((list == NULL) || (payload == NULL)) {
+    if ((bfs == NULL) || (self == NULL)) {
         errno = EINVAL;
         return -1;
     }
-    if (iter == NULL) {
-        errno = EAGAIN;
+    if ((top != NULL) && !tree_node_is_live(self, top)) {
+        return -1;
+    }
+
+    *bfs = TREE_BFS_INITIALIZER;
+    bfs->tree = self;
+    attr.allocator = self->attr.allocator;
+    bfs->queue = queue_init_attr(sizeof(void *), (self->count == 0) ? 1 : self->count, &attr);
+    if (bfs->queue == NULL) {
         return -1;
     }
 
-    memcpy(payload, iter_get_payload(iter), list_payload_bytes(list));
-    list_remove(list, iter);
+    if (top == NULL) {
+        bfs->age = 1;
+        if (tree_bfs_expand(bfs, NULL) != 0) {
+            tree_bfs_release(bfs);
+            return -1;
+        }
+    } else {
+        bfs->age = tree_node_depth(self, top);
+        queue_enq((QUEUE)bfs->queue, &seed);
+    }
+    bfs->remaining = (size_t)queue_count((QUEUE)bfs->queue);
 
-    return list_count(list);
+    return 0;
 }
 
 /**
- *  @details    @c que に積まれた要素の数を返す.
+ *  @details    @c bfs を幅優先で次の要素に進める.
  *
- *  @param      [in]    que キューオブジェクト.
- *  @return     成功時は, @c que に積まれた要素の数を返す.
- *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @param      [in,out]    bfs     幅優先走査子.
+ *  @return     成功時は, 次の要素のデータ部のポインタが返る.
+ *              次の要素がない場合, または失敗時は, NULL が返り, errno が
+ *              適切に設定される.
  *  @warning    スレッドセーフではない.
+ *              @ref tree_bfs_next_level と混在させないこと.
  */
-ssize_t queue_count(QUEUE que)
+void *tree_bfs_next(struct tree_bfs *bfs)
 {
-    return list_count((LIST)que);
+    void *node;
+
+    if ((bfs == NULL) || (bfs->queue == NULL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (queue_deq((QUEUE)bfs->queue, &node) < 0) {
+        bfs->payload = NULL;
+        errno = ENOENT;
+        return NULL;
+    }
+    /* 現在の世代を出し尽くした時点で, キューには次の世代のみが残っている. */
+    if (bfs->remaining == 0) {
+        ++bfs->age;
+        bfs->remaining = (size_t)queue_count((QUEUE)bfs->queue) + 1;
+    }
+    --bfs->remaining;
+    if (tree_bfs_expand(bfs, node) != 0) {
+        return NULL;
+    }
+    bfs->payload = node;
+
+    return node;
 }
 
 /**
- *  @details    @c que の反復子を取得する.
+ *  @details    @c bfs を次の世代に進め, その世代のすべての要素のハンドルを
+ *              連続した領域として取得する.
+ *              i 番目のハンドルは
+ *              <tt>*(TREE_NODE *)((char *)span.base + (i * span.stride))</tt>
+ *              となる.
  *
  *  @code
- *  for (ITER iter = queue_iter(que);
- *       iter != NULL;
- *       iter = iter_next(iter)) {
- *      void *payload = iter_get_payload(iter);
+ *  struct tree_bfs bfs;
+ *  struct queue_span spans[2];
+ *  tree_bfs_init(&bfs, tree, NULL);
+ *  for (ssize_t n = tree_bfs_next_level(&bfs, spans);
+ *       n > 0;
+ *       n = tree_bfs_next_level(&bfs, spans)) {
+ *      int age = tree_bfs_get_age(&bfs);
+ *      for (ssize_t s = 0; s < n; ++s) {
+ *          for (size_t i = 0; i < spans[s].count; ++i) {
+ *              TREE_NODE node = *(TREE_NODE *)((char *)spans[s].base + (i * spans[s].stride));
+ *          }
+ *      }
  *  }
+ *  tree_bfs_release(&bfs);
  *  @endcode
  *
- *  @param      [in]    que キューオブジェクト.
- *  @return     成功時は, @c que の反復子が返る.
- *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @param      [in,out]    bfs     幅優先走査子.
+ *  @param      [out]       spans   領域を格納する配列.
+ *  @return     成功時は, 取得した領域の数 (1 または 2) が返る.
+ *              次の世代がない場合は 0 が返り, errno には ENOENT が設定される.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @remarks    領域は次の呼び出しまで有効である.
  *  @warning    スレッドセーフではない.
- *  @sa         iter_next, iter_get_payload
+ *              @ref tree_bfs_next と混在させないこと.
+ *  @sa         queue_peek_spans
  */
-ITER queue_iter(QUEUE que)
+ssize_t tree_bfs_next_level(struct tree_bfs *bfs, struct queue_span spans[2])
 {
-    return list_iter((LIST)que);
+    ssize_t n;
+
+    if ((bfs == NULL) || (bfs->queue == NULL) || (spans == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* 前回返した世代を取り除き, その子をキューに追加する. */
+    if (bfs->payload != NULL) {
+        for (; bfs->remaining > 0; --bfs->remaining) {
+            void *node;
+            queue_deq((QUEUE)bfs->queue, &node);
+            if (tree_bfs_expand(bfs, node) != 0) {
+                return -1;
+            }
+        }
+        ++bfs->age;
+    }
+
+    n = queue_peek_spans((QUEUE)bfs->queue, spans);
+    if (n <= 0) {
+        bfs->payload = NULL;
+        if (n == 0) {
+            errno = ENOENT;
+        }
+        return n;
+    }
+    bfs->remaining = (size_t)queue_count((QUEUE)bfs->queue);
+    bfs->payload = *(void **)spans[0].base;
+
+    return n;
 }
 
 /**
- *  @details    @c que に積まれた要素を配列にコピーする.
+ *  @details    @c bfs の現在地 (または現在の世代) のツリー上での世代
+ *              (深さ) を取得する.
  *
- *  @param      [in]    que     キューオブジェクト.
- *  @param      [out]   array   確保した配列のポインタ.
- *  @param      [out]   count   要素の数.
- *  @return     成功時は, 0 が返り, @c array に確保された配列のポインタを
- *              設定する.
+ *  @param      [in]    bfs     幅優先走査子.
+ *  @return     成功時は, 世代が返る.
  *              失敗時は, -1 が返り, errno が適切に設定される.
  *  @warning    スレッドセーフではない.
  */
-
-int queue_to_array(QUEUE que, void **array, size_t *count)
+int tree_bfs_get_age(const struct tree_bfs *bfs)
 {
-    return list_to_array((LIST)que, array, count);
-}
+    if ((bfs == NULL) || (bfs->tree == NULL) || (bfs->payload == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
 
-/**
- *  @details    空で, 指定の容量を備えた, @ref SET オブジェクトを確保
- *              および初期化する.
- *
- *  @param      [in]    payload_bytes   データ部のサイズ.
- *  @param      [in]    capacity        セットの容量.
- *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
- *              失敗時は, NULL が返り, errno が適切に設定される.
- */
-SET set_init(size_t payload_bytes, size_t capacity)
-{
-    return (SET)list_init(payload_bytes, capacity);
+    return bfs->age;
 }
 
 /**
- *  @details    @c set を解放する.
- *              @c set は @ref set_init の戻り値である必要がある.
+ *  @details    @c bfs が使用するキューを解放する.
  *
- *  @param      [in,out]    set セットオブジェクト.
+ *  @param      [in,out]    bfs     幅優先走査子.
  *  @warning    スレッドセーフではない.
  */
-void set_release(SET set)
+void tree_bfs_release(struct tree_bfs *bfs)
 {
-    list_release((LIST)set);
+    if (bfs != NULL) {
+        queue_release((QUEUE)bfs->queue);
+        *bfs = TREE_BFS_INITIALIZER;
+    }
 }
 
 /**
- *  @details    @c set を空の状態にする.
+ *  @details    @c link を @c list の @c next の前に連結する.
  *
- *  @param      [in,out]    set セットオブジェクト.
- *  @return     成功時は, 0 が返る.
- *              失敗時は, -1 が返り, errno が適切に設定される.
- *  @warning    スレッドセーフではない.
+ *  @param  [in,out]    list    Intrusive リスト.
+ *  @param  [in]        next    連結位置の次の要素. NULL の場合は末尾に連結する.
+ *  @param  [in,out]    link    連結する要素.
+ *  @pre    引数の検証は呼び出し側で行うこと.
  */
-int set_clear(SET set)
+static inline void ilist_link_before(struct ilist *list,
+                                     struct ilist_link *next,
+                                     struct ilist_link *link)
 {
-    return list_clear((LIST)set);
+    struct ilist_link *prev = (next == NULL) ? list->last : next->prev;
+
+    link->prev = prev;
+    link->next = next;
+    link->owner = list;
+    if (prev != NULL) {
+        prev->next = link;
+    } else {
+        list->first = link;
+    }
+    if (next != NULL) {
+        next->prev = link;
+    } else {
+        list->last = link;
+    }
+    ++list->count;
 }
 
 /**
- *  @details    @c set に要素を追加する.
- *              指定データがすでに追加されている場合は何もしない.
+ *  @details    @c link を @c list に連結できるかを検証する.
  *
- *  @param      [in,out]    set     セットオブジェクト.
- *  @param      [in]        payload セットに追加するデータ.
- *  @return     成功時は, 追加したセット上のデータ部のポインタが返る.
- *              失敗時は, NULL が返り, errno が適切に設定される.
- *  @warning    スレッドセーフではない.
+ *  @param  [in]    list    Intrusive リスト.
+ *  @param  [in]    link    連結する要素.
+ *  @return 連結できる場合は true が返る.
+ *          連結できない場合は false が返り, errno が適切に設定される.
  */
-void *set_add(SET set, void *payload)
+static inline bool ilist_link_is_free(const struct ilist *list, const struct ilist_link *link)
 {
-    LIST list = (LIST)set;
-    ssize_t payload_bytes;
-    ITER iter;
-
-    if ((list == NULL) || (payload == NULL)) {
+    if ((list == NULL) || (link == NULL)) {
         errno = EINVAL;
-        return NULL;
+        return false;
     }
-
-    payload_bytes = list_payload_bytes(list);
-    for (iter = list_iter(list); iter != NULL; iter = iter_next(iter)) {
-        void *p = iter_get_payload(iter);
-        if (memcmp(payload, p, payload_bytes) == 0) {
-            return p;
-        }
+    if (link->owner != NULL) {
+        errno = EBUSY;
+        return false;
     }
 
-    return list_insert(list, -1, payload);
+    return true;
 }
 
 /**
- *  @details    @c set に追加されている要素の数を返す.
+ *  @details    @c link を @c list の末尾に連結する.
+ *              データを複製せず, @c link を含む構造体がそのまま要素となる.
  *
- *  @param      [in]    set セットオブジェクト.
- *  @return     成功時は, @c set に追加されている要素の数を返す.
+ *  @param      [in,out]    list    Intrusive リスト.
+ *  @param      [in,out]    link    連結する要素.
+ *  @return     成功時は, 0 が返る.
  *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              @c link が既に連結されている場合, errno には EBUSY が設定される.
  *  @warning    スレッドセーフではない.
  */
-ssize_t set_count(SET set)
+int ilist_push_back(struct ilist *list, struct ilist_link *link)
 {
-    return list_count((LIST)set);
+    if (!ilist_link_is_free(list, link)) {
+        return -1;
+    }
+
+    ilist_link_before(list, NULL, link);
+
+    return 0;
 }
 
 /**
- *  @details    @c set の反復子を取得する.
- *
- *  @code
- *  for (ITER iter = set_iter(set;
- *       iter != NULL;
- *       iter = iter_next(iter)) {
- *      void *payload = iter_get_payload(iter);
- *  }
- *  @endcode
+ *  @details    @c link を @c list の先頭に連結する.
  *
- *  @param      [in]    set セットオブジェクト.
- *  @return     成功時は, @c set の反復子が返る.
- *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @param      [in,out]    list    Intrusive リスト.
+ *  @param      [in,out]    link    連結する要素.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              @c link が既に連結されている場合, errno には EBUSY が設定される.
  *  @warning    スレッドセーフではない.
- *  @sa         iter_next, iter_get_payload
  */
-ITER set_iter(SET set)
+int ilist_push_front(struct ilist *list, struct ilist_link *link)
 {
-    return list_iter((LIST)set);
-}
-
-/**
- *  N-ary ツリーノード構造体.
- */
-struct tree_node {
-    struct tree_node *first_child;  /**< 最初の子要素へのポインタ. */
-    struct tree_node *next_sibling; /**< 次の兄弟要素へのポインタ. */
-    int age;                        /**< 世代. (ツリー上での深さ) */
-    char payload[];                 /**< データ部. */
-};
-
-/**
- *  N-ary ツリーノード構造体の初期化子.
- */
-#define TREE_NODE_INITIALIZER \
-    (struct tree_node){       \
-        .first_child = NULL,  \
-        .next_sibling = NULL, \
-        .age = 0              \
+    if (!ilist_link_is_free(list, link)) {
+        return -1;
     }
 
-/**
- *  N-ary ツリー管理構造体.
- */
-struct tree {
-    void *pool;                 /**< ツリーで使用するメモリプール. */
-    struct tree_node *released; /**< 解放済みのノードのリスト. */
-    struct tree_node *root;     /**< ツリーの根. */
-    size_t payload_bytes;       /**< データ部のサイズ. */
-    size_t capacity;            /**< 確保したノードの数. */
-    size_t count;               /**< 使用中のノードの数. */
-};
-
-/**
- *  N-ary ツリー管理構造体の初期化子.
- */
-#define TREE_INITIALIZER(p, b, c) \
-    (struct tree){                \
-        .pool = (p),              \
-        .released = NULL,         \
-        .root = NULL,             \
-        .payload_bytes = (b),     \
-        .capacity = (c),          \
-        .count = 0                \
-    }
+    ilist_link_before(list, list->first, link);
 
-/**
- *  N-ary ツリー反復子構造体.
- */
-struct tree_iter {
-    STACK fringe;               /**< 探索経路を保持するスタック. */
-    int age;                    /**< 現在地の世代. */
-    void *payload;              /**< 現在地のデータ部. */
-};
+    return 0;
+}
 
 /**
- *  N-ary ツリー反復子構造体の初期化子.
+ *  @details    @c link を @c list の @c pos の前に連結する.
+ *
+ *  @param      [in,out]    list    Intrusive リスト.
+ *  @param      [in,out]    pos     連結位置の要素. NULL の場合は末尾に連結する.
+ *  @param      [in,out]    link    連結する要素.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              @c pos が @c list の要素でない場合, errno には EINVAL が設定される.
+ *              @c link が既に連結されている場合, errno には EBUSY が設定される.
+ *  @warning    スレッドセーフではない.
  */
-#define TREE_ITER_INITIALIZER \
-    (struct tree_iter){       \
-        .fringe = NULL,       \
-        .age = 0,             \
-        .payload = NULL       \
+int ilist_insert_before(struct ilist *list, struct ilist_link *pos, struct ilist_link *link)
+{
+    if (!ilist_link_is_free(list, link)) {
+        return -1;
     }
+    if ((pos != NULL) && (pos->owner != list)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    ilist_link_before(list, pos, link);
+
+    return 0;
+}
 
 /**
- *  N-ary ツリー向け, 解放済みノードのリストにノードを追加する.
+ *  @details    @c link を @c list から切り離す.
+ *              切り離した @c link は, 再び連結できる.
  *
- *  @param  [in,out]    self    ツリーオブジェクト.
- *  @param  [in]        node    追加するノード.
- *  @pre    @c self の非 NULL は呼び出し側で保証すること.
- *  @pre    @c node の非 NULL は呼び出し側で保証すること.
+ *  @param      [in,out]    list    Intrusive リスト.
+ *  @param      [in,out]    link    切り離す要素.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              @c link が @c list の要素でない場合, errno には EINVAL が設定される.
+ *  @warning    スレッドセーフではない.
  */
-static inline void tree_push_released(struct tree *self, struct tree_node *node)
+int ilist_remove(struct ilist *list, struct ilist_link *link)
 {
-    node->first_child = NULL;
-    if (self->released == NULL) {
-        node->next_sibling = NULL;
+    if ((list == NULL) || (link == NULL) || (link->owner != list)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (link->prev != NULL) {
+        link->prev->next = link->next;
     } else {
-        node->next_sibling = self->released;
+        list->first = link->next;
     }
-    self->released = node;
+    if (link->next != NULL) {
+        link->next->prev = link->prev;
+    } else {
+        list->last = link->prev;
+    }
+    --list->count;
+    *link = ILIST_LINK_INITIALIZER;
+
+    return 0;
 }
 
 /**
- *  N-ary ツリー向け, 解放済みノードのリストからノードを取得する.
+ *  @details    @c list の先頭の要素を切り離して取得する.
  *
- *  @param  [in,out]    self    ツリーオブジェクト.
- *  @return 成功時は, ノードのポインタが返る.
- *          失敗時は, NULL が返り, errno が適切に設定される.
- *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ *  @param      [in,out]    list    Intrusive リスト.
+ *  @return     成功時は, 切り離した要素が返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *              要素がない場合, errno には ENOENT が設定される.
+ *  @warning    スレッドセーフではない.
  */
-static inline struct tree_node *tree_pop_released(struct tree *self)
+struct ilist_link *ilist_pop_front(struct ilist *list)
 {
-    struct tree_node *node = self->released;
+    struct ilist_link *link;
 
-    if (node == NULL) {
-        errno = ENOMEM;
+    if (list == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (list->first == NULL) {
+        errno = ENOENT;
         return NULL;
     }
 
-    self->released = node->next_sibling;
+    link = list->first;
+    ilist_remove(list, link);
 
-    return node;
+    return link;
 }
 
 /**
- *  ツリーの初期設定を行う.
+ *  @details    @c list の先頭の要素を取得する.
  *
- *  @param  [in,out]    self            ツリーオブジェクト.
- *  @param  [in]        pool            ツリーに使用するメモリプール.
- *  @param  [in]        payload_bytes   データ部のサイズ.
- *  @param  [in]        capacity        リストの容量.
- *  @pre    @c self の非 NULL は呼び出し側で保証すること.
- *  @pre    @c pool の非 NULL は呼び出し側で保証すること.
+ *  @param      [in]    list    Intrusive リスト.
+ *  @return     成功時は, 先頭の要素が返る. 要素がない場合は NULL が返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
  */
-static inline void tree_setup(struct tree *self,
-                              void *pool,
-                              size_t payload_bytes,
-                              size_t capacity)
+struct ilist_link *ilist_first(const struct ilist *list)
 {
-    size_t node_bytes;
-    struct tree_node *node;
-
-    *self = TREE_INITIALIZER(pool, payload_bytes, capacity);
-    node_bytes = sizeof(*node) + self->payload_bytes;
-    for (size_t i = 0; i < self->capacity + 1; ++i) {
-        node = (struct tree_node *)((uintptr_t)self->pool + (node_bytes * i));
-        tree_push_released(self, node);
+    if (list == NULL) {
+        errno = EINVAL;
+        return NULL;
     }
 
-    /* root は固定で割り当てる. */
-    /** @todo root は他の要素と重複しなさそうなデータ部にする,
-     *  もしくは区別できる仕組みを入れる.
-     */
-    self->root = tree_pop_released(self);
-    *(self->root) = TREE_NODE_INITIALIZER;
-    memset(self->root->payload, 0x5A, self->payload_bytes);
+    return list->first;
 }
 
 /**
- *  @details    空で, 指定の容量を備えた, @ref TREE オブジェクトを確保
- *              および初期化する.
- *              N-ary ツリーのため, 同一の親に複数の子を追加することができる.
+ *  @details    @c list の末尾の要素を取得する.
  *
- *  @param      [in]    payload_bytes   データ部のサイズ.
- *  @param      [in]    capacity        ツリーの容量.
- *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *  @param      [in]    list    Intrusive リスト.
+ *  @return     成功時は, 末尾の要素が返る. 要素がない場合は NULL が返る.
  *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
  */
-TREE tree_init(size_t payload_bytes, size_t capacity)
+struct ilist_link *ilist_last(const struct ilist *list)
 {
-    struct tree *self;
-    size_t node_bytes;
-    void *pool;
-
-    if ((payload_bytes == 0) || (capacity == 0)) {
+    if (list == NULL) {
         errno = EINVAL;
         return NULL;
     }
 
-    self = malloc(sizeof(*self));
-    node_bytes = sizeof(struct tree_node) + payload_bytes;
-    pool = calloc(capacity + 1, node_bytes);
-    if ((self == NULL) || (pool == NULL)) {
-        free(pool);
-        free(self);
-        errno = ENOMEM;
+    return list->last;
+}
+
+/**
+ *  @details    @c link の次の要素を取得する.
+ *
+ *  @param      [in]    link    Intrusive リストの要素.
+ *  @return     成功時は, 次の要素が返る. 末尾の場合は NULL が返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+struct ilist_link *ilist_next(const struct ilist_link *link)
+{
+    if (link == NULL) {
+        errno = EINVAL;
         return NULL;
     }
 
-    tree_setup(self, pool, payload_bytes, capacity);
-
-    return (TREE)self;
+    return link->next;
 }
 
 /**
- *  @details    @c tree を解放する.
- *              @c tree は @ref tree_init の戻り値である必要がある.
+ *  @details    @c link の前の要素を取得する.
  *
- *  @param      [in,out]    tree    ツリーオブジェクト.
+ *  @param      [in]    link    Intrusive リストの要素.
+ *  @return     成功時は, 前の要素が返る. 先頭の場合は NULL が返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
  *  @warning    スレッドセーフではない.
  */
-void tree_release(TREE tree)
+struct ilist_link *ilist_prev(const struct ilist_link *link)
 {
-    struct tree *self = (struct tree *)tree;
-
-    if (self != NULL) {
-        free(self->pool);
-        free(self);
+    if (link == NULL) {
+        errno = EINVAL;
+        return NULL;
     }
+
+    return link->prev;
 }
 
 /**
- *  @details    @c tree を空の状態にする.
+ *  @details    @c list の要素の数を取得する.
  *
- *  @param      [in,out]    tree    ツリーオブジェクト.
- *  @return     成功時は, 0 が返る.
+ *  @param      [in]    list    Intrusive リスト.
+ *  @return     成功時は, 要素の数が返る.
  *              失敗時は, -1 が返り, errno が適切に設定される.
  *  @warning    スレッドセーフではない.
  */
-int tree_clear(TREE tree)
+ssize_t ilist_count(const struct ilist *list)
 {
-    struct tree *self = (struct tree *)tree;
-
-    if (self == NULL) {
+    if (list == NULL) {
         errno = EINVAL;
         return -1;
     }
 
-    tree_setup(self, self->pool, self->payload_bytes, self->capacity);
-
-    return 0;
+    return (ssize_t)list->count;
 }
 
 /**
- *  @details    @c t に追加された @c parent の子に要素を追加するための再帰処理.
- *              @c parent が複数存在する場合は, 最初に見つかった要素の子として
- *              追加する.
+ *  Intrusive N-ary ツリー向け, 行きがけ順で次の要素を取得する.
+ *  親要素へのポインタを辿るため, 補助的なスタックを必要としない.
  *
- *  @param      [in,out]    self    ツリーオブジェクト.
- *  @param      [in,out]    node    探索中の要素.
- *  @param      [in]        age     探索中の世代 (深さ).
- *  @param      [in]        parent  探索対象のデータ部.
- *  @param      [in]        payload ツリーに追加するデータ.
- *  @return     成功時は, 追加したツリー上のデータ部のポインタが返る.
- *              失敗時は, NULL が返り, errno が適切に設定される.
- *  @remarks    探索は幅 (同一の親に追加された要素) 優先で行われる.
- *  @pre        @c self の非 NULL は呼び出し側で保証すること.
- *  @pre        @c node の非 NULL は呼び出し側で保証すること.
- *  @pre        @c parent の非 NULL は呼び出し側で保証すること.
- *  @pre        @c payload の非 NULL は呼び出し側で保証すること.
- */
-static void *tree_insert_inner(struct tree *self,
-                               struct tree_node *node,
-                               int age,
-                               void *parent,
-                               void *payload)
-{
-    void *additional = NULL;
-
-    if (memcmp(node->payload, parent, self->payload_bytes) == 0) {
-        struct tree_node *child = node->first_child;
-        if (child == NULL) {
-            node->first_child = tree_pop_released(self);
-            if (node->first_child == NULL) {
-                return NULL;
-            }
-            *node->first_child = TREE_NODE_INITIALIZER;
-            node->first_child->age = age;
-            memcpy(node->first_child->payload, payload, self->payload_bytes);
-            additional = node->first_child->payload;
-        } else {
-            while (child->next_sibling != NULL) {
-                child = child->next_sibling;
-            }
-            child->next_sibling = tree_pop_released(self);
-            if (child->next_sibling == NULL) {
-                return NULL;
-            }
-            *child->next_sibling = TREE_NODE_INITIALIZER;
-            child->next_sibling->age = age;
-            memcpy(child->next_sibling->payload, payload, self->payload_bytes);
-            additional = child->next_sibling->payload;
-        }
-        ++self->count;
-    } else {
-        if (node->next_sibling != NULL) {
-            additional = tree_insert_inner(self,
-                                           node->next_sibling,
-                                           age,
-                                           parent,
-                                           payload);
-        }
-        if ((additional == NULL) && (node->first_child != NULL)) {
-            additional = tree_insert_inner(self,
-                                           node->first_child,
-                                           age + 1,
-                                           parent,
-                                           payload);
-        }
+ *  @param  [in]    top     走査の起点. (起点の兄弟には進まない)
+ *  @param  [in]    link    現在地の要素.
+ *  @return 次の要素が返る. 次の要素がない場合は NULL が返る.
+ *  @pre    @c top および @c link の非 NULL は呼び出し側で保証すること.
+ */
+static inline struct itree_link *itree_link_next(const struct itree_link *top,
+                                                 const struct itree_link *link)
+{
+    if (link->first_child != NULL) {
+        return link->first_child;
+    }
+    while ((link != top) && (link->next_sibling == NULL)) {
+        link = link->parent;
     }
 
-    return additional;
+    return (link == top) ? NULL : link->next_sibling;
 }
 
 /**
- *  @details    @c tree の指定位置に要素を追加する.
+ *  @details    @c link を @c tree の @c parent の最後の子として連結する.
+ *              データを複製せず, @c link を含む構造体がそのまま要素となる.
  *
- *  @param      [in,out]    tree    ツリーオブジェクト.
- *  @param      [in]        parent  子として追加する親要素.
- *  @param      [in]        payload ツリーに追加するデータ.
- *  @return     成功時は, 追加したツリー上のデータ部のポインタが返る.
- *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @param      [in,out]    tree    Intrusive N-ary ツリー.
+ *  @param      [in,out]    parent  親要素. NULL の場合は最上位に連結する.
+ *  @param      [in,out]    link    連結する要素.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              @c parent が @c tree の要素でない場合, errno には EINVAL が設定される.
+ *              @c link が既に連結されている場合, errno には EBUSY が設定される.
  *  @warning    スレッドセーフではない.
  */
-void *tree_insert(TREE tree, void *parent, void *payload)
+int itree_insert(struct itree *tree, struct itree_link *parent, struct itree_link *link)
 {
-    struct tree *self = (struct tree *)tree;
-
-    if ((self == NULL) || (payload == NULL)) {
+    if ((tree == NULL) || (link == NULL)
+        || ((parent != NULL) && (parent->owner != tree))) {
         errno = EINVAL;
-        return NULL;
+        return -1;
     }
+    if (link->owner != NULL) {
+        errno = EBUSY;
+        return -1;
+    }
+    if (parent == NULL) {
+        parent = &tree->root;
+    }
+
+    *link = ITREE_LINK_INITIALIZER;
+    link->parent = parent;
+    link->prev_sibling = parent->last_child;
+    link->owner = tree;
+    if (parent->last_child != NULL) {
+        parent->last_child->next_sibling = link;
+    } else {
+        parent->first_child = link;
+    }
+    parent->last_child = link;
+    ++tree->count;
 
-    return tree_insert_inner(self,
-                             self->root,
-                             1,
-                             (parent ?: self->root->payload),
-                             payload);
+    return 0;
 }
 
 /**
- *  @details    @c tree に追加されている要素の数を返す.
+ *  @details    @c link とその子孫を @c tree から切り離す.
+ *              切り離した要素はすべて未連結に戻り, 個別に再び連結できる.
  *
- *  @param      [in]    tree    ツリーオブジェクト.
- *  @return     成功時は, @c tree に追加されている要素の数を返す.
+ *  @param      [in,out]    tree    Intrusive N-ary ツリー.
+ *  @param      [in,out]    link    切り離す要素.
+ *  @return     成功時は, 切り離した要素の数が返る.
  *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              @c link が @c tree の要素でない場合, errno には EINVAL が設定される.
+ *  @remarks    子孫の数に比例した時間がかかる.
  *  @warning    スレッドセーフではない.
  */
-ssize_t tree_count(TREE tree)
+ssize_t itree_remove(struct itree *tree, struct itree_link *link)
 {
-    struct tree *self = (struct tree *)tree;
+    struct itree_link *parent, *curr, *next;
+    size_t removed = 0;
 
-    if (self == NULL) {
+    if ((tree == NULL) || (link == NULL) || (link->owner != tree)) {
         errno = EINVAL;
         return -1;
     }
 
-    return self->count;
+    parent = link->parent;
+    if (link->prev_sibling != NULL) {
+        link->prev_sibling->next_sibling = link->next_sibling;
+    } else {
+        parent->first_child = link->next_sibling;
+    }
+    if (link->next_sibling != NULL) {
+        link->next_sibling->prev_sibling = link->prev_sibling;
+    } else {
+        parent->last_child = link->prev_sibling;
+    }
+    link->prev_sibling = NULL;
+    link->next_sibling = NULL;
+
+    /* 子孫を帰りがけ順に未連結へ戻す. */
+    curr = link;
+    while (curr->first_child != NULL) {
+        curr = curr->first_child;
+    }
+    while (curr != NULL) {
+        if (curr == link) {
+            next = NULL;
+        } else if (curr->next_sibling != NULL) {
+            next = curr->next_sibling;
+            while (next->first_child != NULL) {
+                next = next->first_child;
+            }
+        } else {
+            next = curr->parent;
+        }
+        *curr = ITREE_LINK_INITIALIZER;
+        ++removed;
+        curr = next;
+    }
+    tree->count -= removed;
+
+    return (ssize_t)removed;
 }
 
 /**
- *  @details    @c tree の反復子を取得する.
- *
- *  @code
- *  for (TREE_ITER iter = tree_iter_get(tree);
- *       iter != NULL;
- *       iter = tree_iter_next(iter)) {
- *      void *payload = tree_iter_get_payload(iter);
-        int age = tree_iter_get_age(iter);
- *  }
- *  @endcode
+ *  @details    @c tree の行きがけ順で先頭の要素を取得する.
  *
- *  @param      [in]    tree    ツリーオブジェクト.
- *  @return     成功時は, @c tree の反復子が返る.
+ *  @param      [in]    tree    Intrusive N-ary ツリー.
+ *  @return     成功時は, 先頭の要素が返る. 要素がない場合は NULL が返る.
  *              失敗時は, NULL が返り, errno が適切に設定される.
- *  @remarks    走査は深さ (子要素) 優先で行われる.
  *  @warning    スレッドセーフではない.
- *  @sa         tree_iter_next, tree_iter_get_payload, tree_iter_get_age
  */
-TREE_ITER tree_iter_get(TREE tree)
+struct itree_link *itree_first(const struct itree *tree)
 {
-    struct tree *self = (struct tree *)tree;
-    struct tree_iter *iter;
-
-    iter = malloc(sizeof(*iter));
-    if (iter == NULL) {
-        return NULL;
-    }
-    *iter = TREE_ITER_INITIALIZER;
-    iter->fringe = stack_init(sizeof(struct tree_node *), self->capacity);
-    if (iter->fringe == NULL) {
-        free(iter);
+    if (tree == NULL) {
+        errno = EINVAL;
         return NULL;
     }
 
-    if (self->root->first_child != NULL) {
-        stack_push(iter->fringe, &self->root->first_child);
-    }
-
-    if (tree_iter_next((TREE_ITER)iter) == NULL) {
-        tree_iter_release((TREE_ITER)iter);
-        iter = NULL;
-    }
-    return (TREE_ITER)iter;
+    return tree->root.first_child;
 }
 
 /**
- *  @details    @c iter を解放する.
- *              @c iter は @ref tree_iter_get の戻り値である必要がある.
+ *  @details    @c tree の行きがけ順で @c link の次の要素を取得する.
+ *              走査中にメモリを確保しない.
  *
- *  @param      [in,out]    iter    反復子オブジェクト.
+ *  @param      [in]    tree    Intrusive N-ary ツリー.
+ *  @param      [in]    link    現在地の要素.
+ *  @return     成功時は, 次の要素が返る. 次の要素がない場合は NULL が返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
  *  @warning    スレッドセーフではない.
  */
-void tree_iter_release(TREE_ITER iter)
+struct itree_link *itree_next(const struct itree *tree, const struct itree_link *link)
 {
-    struct tree_iter *self = (struct tree_iter *)iter;
-
-    if (self != NULL) {
-        stack_release(self->fringe);
-        free(self);
+    if ((tree == NULL) || (link == NULL) || (link->owner != tree)) {
+        errno = EINVAL;
+        return NULL;
     }
+
+    return itree_link_next(&tree->root, link);
 }
 
 /**
- *  @details    @c iter の次の反復子を取得する.
+ *  @details    @c link の親要素を取得する.
  *
- *  @param      [in]    iter    N-ary ツリーの反復子.
- *  @return     成功時は, 次の反復子が返る. 次の要素がない場合は NULL が返る.
+ *  @param      [in]    tree    Intrusive N-ary ツリー.
+ *  @param      [in]    link    要素.
+ *  @return     成功時は, 親要素が返る. 最上位の要素の場合は NULL が返る.
  *              失敗時は, NULL が返り, errno が適切に設定される.
  *  @warning    スレッドセーフではない.
  */
-TREE_ITER tree_iter_next(TREE_ITER iter)
+struct itree_link *itree_parent(const struct itree *tree, const struct itree_link *link)
 {
-    struct tree_iter *self = (struct tree_iter *)iter;
-    struct tree_node *node;
-    int ret;
-
-    if (self == NULL) {
+    if ((tree == NULL) || (link == NULL) || (link->owner != tree)) {
         errno = EINVAL;
         return NULL;
     }
 
-    if (stack_count(self->fringe) == 0) {
-        errno = ENOENT;
-        return NULL;
-    }
+    return (link->parent == &tree->root) ? NULL : link->parent;
+}
 
-    ret = stack_pop(self->fringe, &node);
-    if (ret == -1) {
+/**
+ *  @details    @c link の最初の子要素を取得する.
+ *
+ *  @param      [in]    link    要素.
+ *  @return     成功時は, 最初の子要素が返る. 子要素がない場合は NULL が返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+struct itree_link *itree_first_child(const struct itree_link *link)
+{
+    if (link == NULL) {
+        errno = EINVAL;
         return NULL;
     }
-    self->age = node->age;
-    self->payload = node->payload;
-    if (node->next_sibling != NULL) {
-        stack_push(self->fringe, &node->next_sibling);
-    }
-    if (node->first_child != NULL) {
-        stack_push(self->fringe, &node->first_child);
-    }
 
-    return iter;
+    return link->first_child;
 }
 
 /**
- *  @details    @c iter のデータ部を取得する.
+ *  @details    @c link の次の兄弟要素を取得する.
  *
- *  @param      [in]    iter    N-ary ツリーの反復子.
- *  @return     成功時は, データ部のポインタが返る.
+ *  @param      [in]    link    要素.
+ *  @return     成功時は, 次の兄弟要素が返る. 兄弟要素がない場合は NULL が返る.
  *              失敗時は, NULL が返り, errno が適切に設定される.
  *  @warning    スレッドセーフではない.
  */
-void *tree_iter_get_payload(TREE_ITER iter)
+struct itree_link *itree_next_sibling(const struct itree_link *link)
 {
-    struct tree_iter *self = (struct tree_iter *)iter;
-
-    if (self == NULL) {
+    if (link == NULL) {
         errno = EINVAL;
         return NULL;
     }
 
-    return self->payload;
+    return link->next_sibling;
 }
 
 /**
- *  @details    @c iter のツリー上での世代 (深さ) を取得する.
+ *  @details    @c link のツリー上での世代 (深さ) を取得する.
+ *              最上位の要素の世代は 1 となる.
  *
- *  @param      [in]    iter    N-ary ツリーの反復子.
+ *  @param      [in]    tree    Intrusive N-ary ツリー.
+ *  @param      [in]    link    要素.
  *  @return     成功時は, 世代が返る.
  *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @remarks    親要素を辿るため, 深さに比例した時間がかかる.
  *  @warning    スレッドセーフではない.
  */
-int tree_iter_get_age(TREE_ITER iter)
+int itree_get_age(const struct itree *tree, const struct itree_link *link)
 {
-    struct tree_iter *self = (struct tree_iter *)iter;
+    int age = 0;
 
-    if (self == NULL) {
+    if ((tree == NULL) || (link == NULL) || (link->owner != tree)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (; link != &tree->root; link = link->parent) {
+        ++age;
+    }
+
+    return age;
+}
+
+/**
+ *  @details    @c tree の要素の数を取得する.
+ *
+ *  @param      [in]    tree    Intrusive N-ary ツリー.
+ *  @return     成功時は, 要素の数が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+ssize_t itree_count(const struct itree *tree)
+{
+    if (tree == NULL) {
         errno = EINVAL;
         return -1;
     }
 
-    return self->age;
+    return (ssize_t)tree->count;
 }
@@ -0,0 +1,578 @@
+/** @file   concurrent.c
+ *  @brief  スレッドセーフなコレクションに関する機能を提供する.
+ *
+ *  ロックフリーのコレクション (キュー, スタック) を提供する.
+ *
+ *  @date   2026-10-16 新規作成.
+ *  @copyright  Copyright (c) 2018 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <errno.h>
+
+#include "collections.h"
+#include "debug.h"
+
+/**
+ *  キャッシュラインのサイズ.
+ */
+#define CACHE_LINE_BYTES (64)
+
+/**
+ *  終端を示すノード番号.
+ */
+#define NODE_NIL UINT32_MAX
+
+/**
+ *  属性から使用するメモリ割り当てを得る.
+ *
+ *  @param  [in]    attr    コレクションの属性. NULL の場合は既定となる.
+ *  @return メモリ割り当てが返る. 未指定の場合は, この時点の既定が返る.
+ */
+static inline const struct allocator *concurrent_allocator_of(const struct collection_attr *attr)
+{
+    return ((attr != NULL) && (attr->allocator != NULL)) ? attr->allocator
+                                                         : allocator_get_default();
+}
+
+/**
+ *  スレッドセーフなキューのセル構造体.
+ */
+struct cqueue_cell {
+    atomic_size_t seq; /**< セルの世代番号. */
+    char payload[];    /**< データ部. */
+};
+
+/**
+ *  スレッドセーフなキュー管理構造体.
+ *
+ *  生産者と消費者の位置は, 偽共有を避けるため別のキャッシュラインに配置する.
+ */
+struct cqueue {
+    alignas(CACHE_LINE_BYTES) atomic_size_t enq_pos; /**< 次に追加する位置. */
+    alignas(CACHE_LINE_BYTES) atomic_size_t deq_pos; /**< 次に取り出す位置. */
+    alignas(CACHE_LINE_BYTES) void *cells;           /**< セルの配列. */
+    size_t cell_bytes;                               /**< セルのサイズ. */
+    size_t payload_bytes;                            /**< データ部のサイズ. */
+    size_t mask;                                     /**< 位置からセル番号への変換マスク. */
+    const struct allocator *allocator;               /**< メモリ割り当て. */
+};
+
+/**
+ *  セル番号からセルを取得する.
+ *
+ *  @param  [in]    self    キューオブジェクト.
+ *  @param  [in]    pos     位置.
+ *  @return セルのポインタが返る.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static inline struct cqueue_cell *cqueue_cell(struct cqueue *self, size_t pos)
+{
+    return (struct cqueue_cell *)((uintptr_t)self->cells + (self->cell_bytes * (pos & self->mask)));
+}
+
+/**
+ *  @details    空で, 指定の容量を備えた, @ref CQUEUE オブジェクトを確保
+ *              および初期化する.
+ *              容量は 2 のべき乗に切り上げる.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        キューの容量.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    既定のメモリ割り当てから確保する.
+ */
+CQUEUE cqueue_init(size_t payload_bytes, size_t capacity)
+{
+    return cqueue_init_attr(payload_bytes, capacity, NULL);
+}
+
+/**
+ *  @details    空で, 指定の容量と属性を備えた, @ref CQUEUE オブジェクトを
+ *              確保および初期化する.
+ *              容量は 2 のべき乗に切り上げる.
+ *              属性のうち, メモリ割り当てのみを使用する.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        キューの容量.
+ *  @param      [in]    attr            キューの属性.
+ *                                      NULL の場合は @ref COLLECTION_ATTR_INITIALIZER
+ *                                      と同じ属性となる.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *              拡張可能な属性を指定した場合, errno には EINVAL が設定される.
+ *  @sa         cqueue_init
+ */
+CQUEUE cqueue_init_attr(size_t payload_bytes,
+                        size_t capacity,
+                        const struct collection_attr *attr)
+{
+    const struct allocator *allocator = concurrent_allocator_of(attr);
+    struct cqueue *self;
+    size_t cell_bytes;
+    size_t slots;
+    void *cells;
+
+    if ((payload_bytes == 0) || (capacity == 0) || (capacity > (SIZE_MAX >> 1))
+        || ((attr != NULL) && attr->growable)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    for (slots = 1; slots < capacity; slots <<= 1) {
+        ;
+    }
+    cell_bytes = sizeof(struct cqueue_cell) + payload_bytes;
+    cell_bytes = (cell_bytes + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1);
+
+    self = allocator_alloc(allocator, sizeof(*self), alignof(struct cqueue));
+    cells = allocator_zalloc(allocator, slots * cell_bytes, 0);
+    if ((self == NULL) || (cells == NULL)) {
+        allocator_free(allocator, cells, slots * cell_bytes);
+        allocator_free(allocator, self, sizeof(*self));
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    atomic_init(&self->enq_pos, 0);
+    atomic_init(&self->deq_pos, 0);
+    self->cells = cells;
+    self->cell_bytes = cell_bytes;
+    self->payload_bytes = payload_bytes;
+    self->mask = slots - 1;
+    self->allocator = allocator;
+    for (size_t i = 0; i < slots; ++i) {
+        atomic_init(&cqueue_cell(self, i)->seq, i);
+    }
+
+    return (CQUEUE)self;
+}
+
+/**
+ *  @details    @c que を解放する.
+ *              @c que は @ref cqueue_init の戻り値である必要がある.
+ *
+ *  @param      [in,out]    que キューオブジェクト.
+ *  @warning    他のスレッドが使用中の場合は解放してはならない.
+ */
+void cqueue_release(CQUEUE que)
+{
+    struct cqueue *self = (struct cqueue *)que;
+
+    if (self != NULL) {
+        allocator_free(self->allocator, self->cells, (self->mask + 1) * self->cell_bytes);
+        allocator_free(self->allocator, self, sizeof(*self));
+    }
+}
+
+/**
+ *  @details    @c que の最後に要素を追加する.
+ *
+ *              セルの世代番号が位置と一致する場合は空きセルであり,
+ *              生産者は位置を CAS で確保した後にデータ部を書き込む.
+ *              世代番号の release ストアにより, 書き込んだデータ部は
+ *              世代番号を acquire ロードした消費者から可視となる.
+ *
+ *  @param      [in,out]    que     キューオブジェクト.
+ *  @param      [in]        payload キューに追加するデータ.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              キューが満杯の場合, errno には ENOMEM が設定される.
+ *  @remarks    複数のスレッドから同時に呼び出すことができる.
+ */
+int cqueue_enq(CQUEUE que, const void *payload)
+{
+    struct cqueue *self = (struct cqueue *)que;
+    struct cqueue_cell *cell;
+    size_t pos;
+
+    if ((self == NULL) || (payload == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    pos = atomic_load_explicit(&self->enq_pos, memory_order_relaxed);
+    for (;;) {
+        size_t seq;
+        intptr_t diff;
+
+        cell = cqueue_cell(self, pos);
+        seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&self->enq_pos, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            errno = ENOMEM;
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&self->enq_pos, memory_order_relaxed);
+        }
+    }
+
+    memcpy(cell->payload, payload, self->payload_bytes);
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+
+    return 0;
+}
+
+/**
+ *  @details    @c que の最初の要素をコピーし, 削除する.
+ *
+ *              セルの世代番号が位置 + 1 と一致する場合は使用中のセルであり,
+ *              消費者は位置を CAS で確保した後にデータ部を読み出す.
+ *              読み出し後, 世代番号を 1 周先の位置として release ストアし,
+ *              セルを生産者に返却する.
+ *
+ *  @param      [in,out]    que     キューオブジェクト.
+ *  @param      [out]       payload データ部をコピーするバッファ.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              キューが空の場合, errno には EAGAIN が設定される.
+ *  @remarks    複数のスレッドから同時に呼び出すことができる.
+ */
+int cqueue_deq(CQUEUE que, void *payload)
+{
+    struct cqueue *self = (struct cqueue *)que;
+    struct cqueue_cell *cell;
+    size_t pos;
+
+    if ((self == NULL) || (payload == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    pos = atomic_load_explicit(&self->deq_pos, memory_order_relaxed);
+    for (;;) {
+        size_t seq;
+        intptr_t diff;
+
+        cell = cqueue_cell(self, pos);
+        seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&self->deq_pos, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            errno = EAGAIN;
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&self->deq_pos, memory_order_relaxed);
+        }
+    }
+
+    memcpy(payload, cell->payload, self->payload_bytes);
+    atomic_store_explicit(&cell->seq, pos + self->mask + 1, memory_order_release);
+
+    return 0;
+}
+
+/**
+ *  @details    @c que に積まれた要素の数を返す.
+ *
+ *  @param      [in]    que キューオブジェクト.
+ *  @return     成功時は, @c que に積まれた要素の数を返す.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @remarks    他のスレッドが操作中の場合は概算値となる.
+ */
+ssize_t cqueue_count(CQUEUE que)
+{
+    struct cqueue *self = (struct cqueue *)que;
+    size_t enq, deq;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    deq = atomic_load_explicit(&self->deq_pos, memory_order_relaxed);
+    enq = atomic_load_explicit(&self->enq_pos, memory_order_relaxed);
+
+    return (enq > deq) ? (ssize_t)(enq - deq) : 0;
+}
+
+/**
+ *  スレッドセーフなスタックのノード構造体.
+ */
+struct cstack_node {
+    _Atomic uint32_t next; /**< 次のノード番号. */
+    char payload[];        /**< データ部. */
+};
+
+/**
+ *  スレッドセーフなスタック管理構造体.
+ *
+ *  先頭は, 下位 32 ビットにノード番号, 上位 32 ビットに ABA 対策の
+ *  タグを持つ.
+ */
+struct cstack {
+    alignas(CACHE_LINE_BYTES) _Atomic uint64_t top;      /**< 使用中ノードの先頭. */
+    alignas(CACHE_LINE_BYTES) _Atomic uint64_t released; /**< 解放済みノードの先頭. */
+    alignas(CACHE_LINE_BYTES) void *pool;                /**< スタックで使用するメモリプール. */
+    size_t node_bytes;                                   /**< ノードのサイズ. */
+    size_t payload_bytes;                                /**< データ部のサイズ. */
+    _Atomic size_t count;                                /**< 使用中のノードの数. */
+    size_t capacity;                                     /**< ノードの数. */
+    const struct allocator *allocator;                   /**< メモリ割り当て. */
+};
+
+/**
+ *  ノード番号からノードを取得する.
+ *
+ *  @param  [in]    self    スタックオブジェクト.
+ *  @param  [in]    index   ノード番号.
+ *  @return ノードのポインタが返る.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static inline struct cstack_node *cstack_node(struct cstack *self, uint32_t index)
+{
+    return (struct cstack_node *)((uintptr_t)self->pool + (self->node_bytes * index));
+}
+
+/**
+ *  Treiber スタックにノードを積む.
+ *
+ *  CAS の成功 (release) により, ノードへの書き込みは, 同じ先頭を
+ *  acquire ロードしたスレッドから可視となる.
+ *  先頭の更新ごとにタグを進めるため, 同一ノードの再利用による
+ *  ABA 問題は発生しない.
+ *
+ *  @param  [in,out]    self    スタックオブジェクト.
+ *  @param  [in,out]    head    積む先の先頭.
+ *  @param  [in]        index   積むノード番号.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static void cstack_push_node(struct cstack *self, _Atomic uint64_t *head, uint32_t index)
+{
+    struct cstack_node *node = cstack_node(self, index);
+    uint64_t old = atomic_load_explicit(head, memory_order_relaxed);
+    uint64_t new;
+
+    do {
+        atomic_store_explicit(&node->next, (uint32_t)old, memory_order_relaxed);
+        new = ((old & 0xFFFFFFFF00000000ULL) + (1ULL << 32)) | index;
+    } while (!atomic_compare_exchange_weak_explicit(head, &old, new,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+}
+
+/**
+ *  Treiber スタックからノードを取り出す.
+ *
+ *  プールは解放されないため, 他のスレッドが取り出し中のノードの
+ *  次ノード番号を読んでも安全である (タグの不一致により CAS が失敗する).
+ *
+ *  @param  [in,out]    self    スタックオブジェクト.
+ *  @param  [in,out]    head    取り出す先頭.
+ *  @return 成功時は, ノード番号が返る.
+ *          空の場合は, @ref NODE_NIL が返る.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static uint32_t cstack_pop_node(struct cstack *self, _Atomic uint64_t *head)
+{
+    uint64_t old = atomic_load_explicit(head, memory_order_acquire);
+    uint64_t new;
+    uint32_t index;
+
+    do {
+        index = (uint32_t)old;
+        if (index == NODE_NIL) {
+            return NODE_NIL;
+        }
+        new = ((old & 0xFFFFFFFF00000000ULL) + (1ULL << 32))
+              | atomic_load_explicit(&cstack_node(self, index)->next, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(head, &old, new,
+                                                    memory_order_acquire,
+                                                    memory_order_acquire));
+
+    return index;
+}
+
+/**
+ *  @details    空で, 指定の容量を備えた, @ref CSTACK オブジェクトを確保
+ *              および初期化する.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        スタックの容量.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    既定のメモリ割り当てから確保する.
+ */
+CSTACK cstack_init(size_t payload_bytes, size_t capacity)
+{
+    return cstack_init_attr(payload_bytes, capacity, NULL);
+}
+
+/**
+ *  @details    空で, 指定の容量と属性を備えた, @ref CSTACK オブジェクトを
+ *              確保および初期化する.
+ *              属性のうち, メモリ割り当てのみを使用する.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        スタックの容量.
+ *  @param      [in]    attr            スタックの属性.
+ *                                      NULL の場合は @ref COLLECTION_ATTR_INITIALIZER
+ *                                      と同じ属性となる.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *              拡張可能な属性を指定した場合, errno には EINVAL が設定される.
+ *  @sa         cstack_init
+ */
+CSTACK cstack_init_attr(size_t payload_bytes,
+                        size_t capacity,
+                        const struct collection_attr *attr)
+{
+    const struct allocator *allocator = concurrent_allocator_of(attr);
+    struct cstack *self;
+    size_t node_bytes;
+    void *pool;
+
+    if ((payload_bytes == 0) || (capacity == 0) || (capacity >= NODE_NIL)
+        || ((attr != NULL) && attr->growable)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    node_bytes = sizeof(struct cstack_node) + payload_bytes;
+    node_bytes = (node_bytes + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1);
+
+    self = allocator_alloc(allocator, sizeof(*self), alignof(struct cstack));
+    pool = allocator_zalloc(allocator, capacity * node_bytes, 0);
+    if ((self == NULL) || (pool == NULL)) {
+        allocator_free(allocator, pool, capacity * node_bytes);
+        allocator_free(allocator, self, sizeof(*self));
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    self->pool = pool;
+    self->node_bytes = node_bytes;
+    self->payload_bytes = payload_bytes;
+    self->capacity = capacity;
+    self->allocator = allocator;
+    atomic_init(&self->top, NODE_NIL);
+    atomic_init(&self->released, NODE_NIL);
+    atomic_init(&self->count, 0);
+    for (size_t i = capacity; i-- > 0;) {
+        struct cstack_node *node = cstack_node(self, (uint32_t)i);
+        atomic_init(&node->next, (uint32_t)atomic_load_explicit(&self->released, memory_order_relaxed));
+        atomic_store_explicit(&self->released, i, memory_order_relaxed);
+    }
+
+    return (CSTACK)self;
+}
+
+/**
+ *  @details    @c stack を解放する.
+ *              @c stack は @ref cstack_init の戻り値である必要がある.
+ *
+ *  @param      [in,out]    stack   スタックオブジェクト.
+ *  @warning    他のスレッドが使用中の場合は解放してはならない.
+ */
+void cstack_release(CSTACK stack)
+{
+    struct cstack *self = (struct cstack *)stack;
+
+    if (self != NULL) {
+        allocator_free(self->allocator, self->pool, self->capacity * self->node_bytes);
+        allocator_free(self->allocator, self, sizeof(*self));
+    }
+}
+
+/**
+ *  @details    @c stack に要素を積む.
+ *
+ *  @param      [in,out]    stack   スタックオブジェクト.
+ *  @param      [in]        payload スタックに積むデータ.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              スタックが満杯の場合, errno には ENOMEM が設定される.
+ *  @remarks    複数のスレッドから同時に呼び出すことができる.
+ */
+int cstack_push(CSTACK stack, const void *payload)
+{
+    struct cstack *self = (struct cstack *)stack;
+    uint32_t index;
+
+    if ((self == NULL) || (payload == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    index = cstack_pop_node(self, &self->released);
+    if (index == NODE_NIL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    memcpy(cstack_node(self, index)->payload, payload, self->payload_bytes);
+    /* 取り出される前に数えるため, 公開より先に加算する. */
+    atomic_fetch_add_explicit(&self->count, 1, memory_order_relaxed);
+    cstack_push_node(self, &self->top, index);
+
+    return 0;
+}
+
+/**
+ *  @details    @c stack から, 最初の要素を取り除く.
+ *
+ *  @param      [in,out]    stack   スタックオブジェクト.
+ *  @param      [out]       payload データ部をコピーするバッファ.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              スタックが空の場合, errno には EAGAIN が設定される.
+ *  @remarks    複数のスレッドから同時に呼び出すことができる.
+ */
+int cstack_pop(CSTACK stack, void *payload)
+{
+    struct cstack *self = (struct cstack *)stack;
+    uint32_t index;
+
+    if ((self == NULL) || (payload == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    index = cstack_pop_node(self, &self->top);
+    if (index == NODE_NIL) {
+        errno = EAGAIN;
+        return -1;
+    }
+    atomic_fetch_sub_explicit(&self->count, 1, memory_order_relaxed);
+    memcpy(payload, cstack_node(self, index)->payload, self->payload_bytes);
+    cstack_push_node(self, &self->released, index);
+
+    return 0;
+}
+
+/**
+ *  @details    @c stack に積まれている要素の数を返す.
+ *
+ *  @param      [in]    stack   スタックオブジェクト.
+ *  @return     成功時は, @c stack に積まれている要素の数を返す.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @remarks    他のスレッドが操作中の場合は概算値となる.
+ *              積み込み中の要素を含むことはあるが, 負の値にはならない.
+ */
+ssize_t cstack_count(CSTACK stack)
+{
+    struct cstack *self = (struct cstack *)stack;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return atomic_load_explicit(&self->count, memory_order_relaxed);
+}
@@ -8,17 +8,26 @@
  *  This code is licensed under the MIT License.
  */
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdalign.h>
 #include <errno.h>
 #include <assert.h>
 
 #include "debug.h"
 #include "hfsm.h"
+#include "collections_typed.h"
 
 /**
  *  最大のコンポジット状態ネスト.
  */
 #define NEST_MAX (5)
 
+/**
+ *  実行可能集合に含まれないことを示す位置.
+ */
+#define SCHED_NONE SIZE_MAX
+
 /**
  *  状態マシン構造体.
  */
@@ -28,17 +37,70 @@ struct fsm {
 
     STACK src_ancestors;              /**< 元状態の祖先を保持するバッファ. */
     STACK dest_ancestors;             /**< 先状態の祖先を保持するバッファ. */
+
+    const struct fsm_trans *in_flight; /**< 完了待ちの遷移. */
+    uintptr_t token;                  /**< 発行中の保留トークン. 0 の場合は未発行. */
+    uintptr_t token_seq;              /**< 保留トークンの通番. */
+    bool in_async;                    /**< 非同期アクションを実行中か. */
+    QUEUE deferred;                   /**< 遷移中に発生したイベントのキュー. */
+
+    int activity;                     /**< do アクティビティの再開位置. */
+    unsigned int activity_epoch;      /**< do アクティビティの取り消し回数. */
+
+    struct fsm_sched *sched;          /**< 所属する更新スケジューラ. */
+    size_t sched_index;               /**< 実行可能集合での位置. */
+    unsigned int sched_tick;          /**< 最後に更新した周期. */
+
+    const struct allocator *allocator; /**< メモリ割り当て. */
+    bool in_place;                     /**< 呼び出し側の領域に配置したか. */
 };
 
 /**
  *  状態マシン構造体の設定ヘルパ.
  */
-#define FSM_HELPER(curr, corr, s, d) \
+#define FSM_HELPER(curr, corr, s, d, q, a) \
     (struct fsm){                    \
         .current = (curr),           \
         .corresps = (corr),          \
         .src_ancestors = (s),        \
-        .dest_ancestors = (d)        \
+        .dest_ancestors = (d),       \
+        .in_flight = NULL,           \
+        .token = 0,                  \
+        .token_seq = 0,              \
+        .in_async = false,           \
+        .deferred = (q),             \
+        .activity = 0,               \
+        .activity_epoch = 0,         \
+        .sched = NULL,               \
+        .sched_index = SCHED_NONE,   \
+        .sched_tick = 0,             \
+        .allocator = (a),            \
+        .in_place = false            \
+    }
+
+/**
+ *  更新スケジューラ構造体.
+ */
+struct fsm_sched {
+    struct fsm **runnable; /**< do アクティビティが実行可能な状態マシンの集合. */
+    size_t count;          /**< 実行可能な状態マシンの数. */
+    size_t attached;       /**< 登録されている状態マシンの数. */
+    size_t capacity;       /**< 登録可能な状態マシンの数. */
+    unsigned int tick;     /**< 更新周期. */
+    const struct allocator *allocator; /**< メモリ割り当て. */
+};
+
+/**
+ *  更新スケジューラ構造体の設定ヘルパ.
+ */
+#define FSM_SCHED_HELPER(r, c, a) \
+    (struct fsm_sched){         \
+        .runnable = (r),        \
+        .count = 0,             \
+        .attached = 0,          \
+        .capacity = (c),        \
+        .tick = 0,              \
+        .allocator = (a)        \
     }
 
 /**
@@ -59,6 +121,16 @@ const struct fsm_state state_end_ = FSM_STATE_INITIALIZER("end"),
 const struct fsm_event event_null_ = FSM_EVENT_INITIALIZER("null"),
                        *event_null = &event_null_;
 
+/**
+ *  状態のポインタ型. (型付きのコレクションの要素型)
+ */
+typedef const struct fsm_state *fsm_state_ptr;
+
+/**
+ *  状態のポインタのキュー操作関数.
+ */
+COLLECTION_DEFINE_QUEUE(state_queue, fsm_state_ptr)
+
 /**
  *  指定する状態の変数を取得する.
  *
@@ -76,6 +148,38 @@ static inline struct fsm_state_variable *get_state_variable(const struct fsm_sta
     return (state->variable != NULL) ? state->variable : &null_obj;
 }
 
+/**
+ *  状態マシンの実行可能集合への所属を更新する.
+ *
+ *  更新スケジューラに登録されていない場合は何もしない.
+ *  実行可能集合からの削除は末尾要素との入れ替えで行う.
+ *
+ *  @param  [in,out]    machine 状態マシン.
+ *  @pre    @c machine の非 NULL は呼び出し側で保証すること.
+ */
+static void sched_refresh(struct fsm *machine)
+{
+    struct fsm_sched *sched = machine->sched;
+    bool runnable;
+
+    if (sched == NULL) {
+        return;
+    }
+
+    runnable = (machine->in_flight == NULL)
+               && (machine->current->exec != NULL)
+               && (machine->activity != FSM_ACTIVITY_DONE);
+    if (runnable && (machine->sched_index == SCHED_NONE)) {
+        machine->sched_index = sched->count;
+        sched->runnable[sched->count++] = machine;
+    } else if (!runnable && (machine->sched_index != SCHED_NONE)) {
+        struct fsm *last = sched->runnable[--sched->count];
+        sched->runnable[machine->sched_index] = last;
+        last->sched_index = machine->sched_index;
+        machine->sched_index = SCHED_NONE;
+    }
+}
+
 /**
  *  entry アクションが設定されていれば, 実行する.
  *
@@ -101,7 +205,9 @@ static inline void entry_if_can_be(struct fsm *machine,
 /**
  *  do アクティビティが設定されていれば, 実行する.
  *
- *  do アクティビティが設定されていない場合は何もしない.
+ *  do アクティビティが設定されていない場合, 完了済みの場合, 及び
+ *  遷移中の場合は何もしない.
+ *  do アクティビティ内で状態遷移が発生した場合は, 中断位置を破棄する.
  *
  *  @param  [in]    machine 状態マシン.
  *  @pre    @c machine の非 NULL は呼び出し側で保証すること.
@@ -109,8 +215,16 @@ static inline void entry_if_can_be(struct fsm *machine,
 static inline void exec_if_can_be(struct fsm *machine)
 {
     const struct fsm_state *state = machine->current;
-    if ((state->exec != NULL)) {
+    unsigned int epoch = machine->activity_epoch;
+
+    if ((machine->in_flight == NULL)
+        && (state->exec != NULL)
+        && (machine->activity != FSM_ACTIVITY_DONE)) {
         state->exec(machine, get_state_variable(state)->data);
+        if (machine->activity_epoch != epoch) {
+            machine->activity = 0;
+        }
+        sched_refresh(machine);
     }
 }
 
@@ -118,7 +232,7 @@ static inline void exec_if_can_be(struct fsm *machine)
  *  exit アクションが設定されていれば, 実行する.
  *
  *  exit アクションが設定されていない場合は何もしない.
- *  親状態の履歴状態の更新も行う.
+ *  親状態の履歴状態の更新, 及び do アクティビティの取り消しも行う.
  *  状態が入れ子になっている場合, 目標となる子にたどり着く途中では
  *  @c cmpl が false となる.
  *
@@ -134,6 +248,8 @@ static inline void exit_if_can_be(struct fsm *machine,
 {
     const struct fsm_state *parent = get_state_variable(state)->parent;
 
+    machine->activity = 0;
+    ++machine->activity_epoch;
     if (state->exit != NULL) {
         state->exit(machine, get_state_variable(state)->data, cmpl);
     }
@@ -164,6 +280,7 @@ static void fsm_change_state(struct fsm *machine,
     if (machine->current == new_state) {
         exit_if_can_be(machine, machine->current, true);
         entry_if_can_be(machine, new_state, true);
+        sched_refresh(machine);
         return;
     }
 
@@ -211,38 +328,21 @@ static void fsm_change_state(struct fsm *machine,
     if (get_state_variable(dest_state)->history != NULL) {
         fsm_change_state(machine, get_state_variable(dest_state)->history);
     }
+    sched_refresh(machine);
 }
 
 /**
- *  状態の遷移を行う.
+ *  ガード条件とアクションを通過した遷移を確定する.
  *
- *  遷移にガード条件が設定されている場合は, 条件を満たさない場合は
- *  遷移は行わない.
- *  遷移にアクションが設定されている場合は, アクションを実行後に遷移を行う.
  *  遷移先が NULL の場合は内部遷移となる.
  *
  *  @param  [in]    machine 状態マシン.
- *  @param  [in]    state   起点となる状態.
- *  @param  [in]    event   発生したイベント.
- *  @return 対応表に条件が一致する項目があった場合は, 状態遷移が行われ, true が返る.
- *          一致する項目がなかった場合は, false が返る.
+ *  @param  [in]    corr    確定する遷移.
  *  @pre    @c machine の非 NULL は呼び出し側で保証すること.
- *  @pre    @c state の非 NULL は呼び出し側で保証すること.
- *  @pre    @c event の非 NULL は呼び出し側で保証すること.
+ *  @pre    @c corr の非 NULL は呼び出し側で保証すること.
  */
-static bool fsm_state_transit(struct fsm *machine,
-                              const struct fsm_state *state,
-                              const struct fsm_event *event)
+static void fsm_state_commit(struct fsm *machine, const struct fsm_trans *corr)
 {
-    int i;
-
-    for (i = 0; machine->corresps[i].from != NULL; ++i) {
-        const struct fsm_trans *corr = &machine->corresps[i];
-        if ((corr->from == state) && (corr->event == event)) {
-            if ((corr->cond == NULL) || corr->cond->func(machine)) {
-                if (corr->action != NULL) {
-                    corr->action->func(machine);
-                }
 if (corr->to == NULL) {
     if ((corr->cond == NULL) && (corr->action == NULL)) {
         DEBUG("state: %s %s", corr->from->name, corr->event->name);
@@ -264,9 +364,63 @@ if (corr->to == NULL) {
         DEBUG("state: %s --%s[%s]/%s-> %s", corr->from->name, corr->event->name, corr->cond->name, corr->action->name, corr->to->name);
     }
 }
-                if (corr->to != NULL) {
-                    fsm_change_state(machine, corr->to);
+    if (corr->to != NULL) {
+        fsm_change_state(machine, corr->to);
+    }
+}
+
+/**
+ *  状態の遷移を行う.
+ *
+ *  遷移にガード条件が設定されている場合は, 条件を満たさない場合は
+ *  遷移は行わない.
+ *  遷移にアクションが設定されている場合は, アクションを実行後に遷移を行う.
+ *  非同期アクションが保留トークンを返した場合は, 遷移中となり,
+ *  @ref fsm_action_complete が呼ばれるまで遷移を保留する.
+ *  非同期アクションの実行中から遷移中とするため, アクションの内部で
+ *  完了した場合 (トークンを返す前に @ref fsm_action_complete が
+ *  呼ばれた場合) も, 同期的に完了したものとして遷移する.
+ *  遷移先が NULL の場合は内部遷移となる.
+ *
+ *  @param  [in]    machine 状態マシン.
+ *  @param  [in]    state   起点となる状態.
+ *  @param  [in]    event   発生したイベント.
+ *  @return 対応表に条件が一致する項目があった場合は, 状態遷移が行われ, true が返る.
+ *          一致する項目がなかった場合は, false が返る.
+ *  @pre    @c machine の非 NULL は呼び出し側で保証すること.
+ *  @pre    @c state の非 NULL は呼び出し側で保証すること.
+ *  @pre    @c event の非 NULL は呼び出し側で保証すること.
+ */
+static bool fsm_state_transit(struct fsm *machine,
+                              const struct fsm_state *state,
+                              const struct fsm_event *event)
+{
+    int i;
+
+    for (i = 0; machine->corresps[i].from != NULL; ++i) {
+        const struct fsm_trans *corr = &machine->corresps[i];
+        if ((corr->from == state) && (corr->event == event)) {
+            if ((corr->cond == NULL) || corr->cond->func(machine)) {
+                if ((corr->action != NULL) && (corr->action->async != NULL)) {
+                    FSM_TOKEN token;
+
+                    machine->in_flight = corr;
+                    machine->token = 0;
+                    machine->in_async = true;
+                    token = corr->action->async(machine);
+                    machine->in_async = false;
+                    if ((token != NULL) && (machine->token != 0)
+                        && (token == (FSM_TOKEN)machine->token)) {
+                        sched_refresh(machine);
+                        return true;
+                    }
+                    /* 同期的に完了した. */
+                    machine->in_flight = NULL;
+                    machine->token = 0;
+                } else if (corr->action != NULL) {
+                    corr->action->func(machine);
                 }
+                fsm_state_commit(machine, corr);
 
                 return true;
             }
@@ -276,6 +430,42 @@ if (corr->to == NULL) {
     return false;
 }
 
+/**
+ *  サイズを基本型の整列に切り上げる.
+ *
+ *  @param  [in]    bytes   サイズ.
+ *  @return 切り上げたサイズが返る.
+ */
+static inline size_t fsm_align(size_t bytes)
+{
+    return ((bytes + alignof(max_align_t) - 1) / alignof(max_align_t)) * alignof(max_align_t);
+}
+
+/**
+ *  生成した状態マシンに状態の関係性を設定し, 開始状態から Null 遷移を行う.
+ *
+ *  @param  [in,out]    machine 状態マシン.
+ *  @param  [in]        rels    状態の関係性.
+ */
+static void fsm_setup(struct fsm *machine, const struct fsm_rels *rels)
+{
+    /* 状態の関係性を設定する. */
+    if (rels != NULL) {
+        const struct fsm_state *oneself, *parent;
+        for (int i = 0; rels[i].oneself != NULL; ++i) {
+            oneself = rels[i].oneself;
+            parent = rels[i].parent;
+            get_state_variable(oneself)->parent = parent;
+            if (rels[i].is_default) {
+                get_state_variable(parent)->history = oneself;
+            }
+        }
+    }
+
+    /* Null 遷移を行う. */
+    fsm_state_transit(machine, machine->current, event_null);
+}
+
 /**
  *  @details    開始状態の状態マシンを, 生成する.
  *              初期化後の状態は @ref state_start となる.
@@ -287,45 +477,160 @@ if (corr->to == NULL) {
  *  @param      [in]    corresps    状態遷移の対応表.
  *  @return     成功時は, 確保および初期化されたオブジェクトのポインタが返る.
  *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    既定のメモリ割り当てから確保する.
  */
 struct fsm *fsm_init(const struct fsm_rels *rels,
                      const struct fsm_trans *corresps)
 {
+    return fsm_init_attr(rels, corresps, NULL);
+}
+
+/**
+ *  @details    開始状態の状態マシンを, 指定の属性で生成する.
+ *
+ *  @code
+ *  struct fsm_attr attr = FSM_ATTR_INITIALIZER;
+ *  attr.allocator = &allocator_slab;
+ *  struct fsm *machine = fsm_init_attr(rels, corresps, &attr);
+ *  @endcode
+ *
+ *  @param      [in]    rels        状態の関係性.
+ *  @param      [in]    corresps    状態遷移の対応表.
+ *  @param      [in]    attr        状態マシンの属性.
+ *                                  NULL の場合は @ref FSM_ATTR_INITIALIZER と
+ *                                  同じ属性となる.
+ *  @return     成功時は, 確保および初期化されたオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    状態マシンの使用領域, および @ref fsm_dump_state_transition で
+ *              一時的に使用する領域は, 属性のメモリ割り当てから確保する.
+ *              状態遷移および do アクティビティの実行中は確保を行わない.
+ *  @sa         fsm_init
+ */
+struct fsm *fsm_init_attr(const struct fsm_rels *rels,
+                          const struct fsm_trans *corresps,
+                          const struct fsm_attr *attr)
+{
+    struct collection_attr coll_attr = COLLECTION_ATTR_INITIALIZER;
     struct fsm *machine;
     STACK src_ancs, dest_ancs;
+    QUEUE deferred;
 
     if (corresps == NULL) {
         errno = EINVAL;
         return NULL;
     }
 
-    machine = malloc(sizeof(struct fsm));
-    src_ancs = stack_init(sizeof(struct fsm_state*), NEST_MAX);
-    dest_ancs = stack_init(sizeof(struct fsm_state*), NEST_MAX);
-    if ((machine == NULL) || (src_ancs == NULL) || (dest_ancs == NULL)) {
+    coll_attr.allocator = ((attr != NULL) && (attr->allocator != NULL))
+                          ? attr->allocator : allocator_get_default();
+    machine = allocator_alloc(coll_attr.allocator, sizeof(struct fsm), 0);
+    src_ancs = stack_init_attr(sizeof(struct fsm_state*), NEST_MAX, &coll_attr);
+    dest_ancs = stack_init_attr(sizeof(struct fsm_state*), NEST_MAX, &coll_attr);
+    deferred = queue_init_attr(sizeof(struct fsm_event *), FSM_DEFER_MAX, &coll_attr);
+    if ((machine == NULL) || (src_ancs == NULL) || (dest_ancs == NULL) || (deferred == NULL)) {
+        queue_release(deferred);
         stack_release(dest_ancs);
         stack_release(src_ancs);
-        free(machine);
+        allocator_free(coll_attr.allocator, machine, sizeof(struct fsm));
         return NULL;
     }
 
-    *machine = FSM_HELPER(state_start, corresps, src_ancs, dest_ancs);
+    *machine = FSM_HELPER(state_start, corresps, src_ancs, dest_ancs, deferred,
+                          coll_attr.allocator);
+    fsm_setup(machine, rels);
 
-    /* 状態の関係性を設定する. */
-    if (rels != NULL) {
-        const struct fsm_state *oneself, *parent;
-        for (int i = 0; rels[i].oneself != NULL; ++i) {
-            oneself = rels[i].oneself;
-            parent = rels[i].parent;
-            get_state_variable(oneself)->parent = parent;
-            if (rels[i].is_default) {
-                get_state_variable(parent)->history = oneself;
-            }
-        }
+    return machine;
+}
+
+/**
+ *  @details    @ref fsm_init_in で状態マシンを配置するために必要なサイズを取得する.
+ *
+ *  @param      [in]    rels        状態の関係性.
+ *  @param      [in]    corresps    状態遷移の対応表.
+ *  @return     成功時は, 必要なサイズが返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @remarks    現在の実装では, 必要なサイズは @c rels および @c corresps の
+ *              内容によらない. 起動時に一度取得しておけばよい.
+ */
+ssize_t fsm_required_size(const struct fsm_rels *rels, const struct fsm_trans *corresps)
+{
+    (void)rels;
+
+    if (corresps == NULL) {
+        errno = EINVAL;
+        return -1;
     }
 
-    /* Null 遷移を行う. */
-    fsm_state_transit(machine, machine->current, event_null);
+    return (ssize_t)(fsm_align(sizeof(struct fsm))
+                     + (fsm_align(stack_required_size(sizeof(struct fsm_state *), NEST_MAX)) * 2)
+                     + fsm_align(queue_required_size(sizeof(struct fsm_event *), FSM_DEFER_MAX)));
+}
+
+/**
+ *  @details    開始状態の状態マシンを, 呼び出し側の領域に配置して生成する.
+ *              状態マシン本体と, 状態遷移に使用する作業領域をすべて @c buffer
+ *              に配置する.
+ *
+ *  @code
+ *  struct session {
+ *      ...
+ *      alignas(max_align_t) unsigned char machine[FSM_BUFFER_BYTES];
+ *  };
+ *  assert(fsm_required_size(rels, corresps) <= FSM_BUFFER_BYTES);
+ *  struct fsm *machine = fsm_init_in(session->machine, sizeof(session->machine),
+ *                                    rels, corresps);
+ *  @endcode
+ *
+ *  @param      [out]   buffer      配置する領域. 基本型に整列していること.
+ *  @param      [in]    size        @c buffer のサイズ.
+ *  @param      [in]    rels        状態の関係性.
+ *  @param      [in]    corresps    状態遷移の対応表.
+ *  @return     成功時は, 初期化されたオブジェクトのポインタ (@c buffer) が返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *              @c size が @ref fsm_required_size に満たない場合,
+ *              errno には ENOMEM が設定される.
+ *  @remarks    メモリを確保しない. @ref fsm_term は領域を解放しない.
+ *              @ref fsm_dump_state_transition で一時的に使用する領域は,
+ *              既定のメモリ割り当てから確保する.
+ *  @sa         fsm_required_size
+ */
+struct fsm *fsm_init_in(void *buffer,
+                        size_t size,
+                        const struct fsm_rels *rels,
+                        const struct fsm_trans *corresps)
+{
+    ssize_t required = fsm_required_size(rels, corresps);
+    size_t stack_bytes = fsm_align(stack_required_size(sizeof(struct fsm_state *), NEST_MAX));
+    size_t queue_bytes = fsm_align(queue_required_size(sizeof(struct fsm_event *), FSM_DEFER_MAX));
+    struct fsm *machine = buffer;
+    uintptr_t p = (uintptr_t)buffer + fsm_align(sizeof(struct fsm));
+    STACK src_ancs, dest_ancs;
+    QUEUE deferred;
+
+    if (required < 0) {
+        return NULL;
+    }
+    if ((buffer == NULL) || (((uintptr_t)buffer % alignof(max_align_t)) != 0)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (size < (size_t)required) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    src_ancs = stack_init_in((void *)p, stack_bytes, sizeof(struct fsm_state *), NEST_MAX);
+    p += stack_bytes;
+    dest_ancs = stack_init_in((void *)p, stack_bytes, sizeof(struct fsm_state *), NEST_MAX);
+    p += stack_bytes;
+    deferred = queue_init_in((void *)p, queue_bytes, sizeof(struct fsm_event *), FSM_DEFER_MAX);
+    if ((src_ancs == NULL) || (dest_ancs == NULL) || (deferred == NULL)) {
+        return NULL;
+    }
+
+    *machine = FSM_HELPER(state_start, corresps, src_ancs, dest_ancs, deferred,
+                          allocator_get_default());
+    machine->in_place = true;
+    fsm_setup(machine, rels);
 
     return machine;
 }
@@ -344,10 +649,18 @@ int fsm_term(struct fsm *machine)
         return -1;
     }
 
+    machine->in_flight = NULL;
+    machine->token = 0;
     fsm_change_state(machine, state_end);
+    if (machine->sched != NULL) {
+        fsm_sched_detach(machine);
+    }
+    queue_release(machine->deferred);
     stack_release(machine->dest_ancestors);
     stack_release(machine->src_ancestors);
-    free(machine);
+    if (!machine->in_place) {
+        allocator_free(machine->allocator, machine, sizeof(struct fsm));
+    }
 
     return 0;
 }
@@ -355,16 +668,34 @@ int fsm_term(struct fsm *machine)
 /**
  *  @details    指定イベントによる状態遷移を発生させる.
  *              現在の状態に対応する遷移がない場合は, 親にイベントを伝播させる.
+ *              非同期アクションの完了待ちの場合は, イベントをキューに保留し,
+ *              遷移の完了後に発生させる.
+ *              保留できるイベントは @ref FSM_DEFER_MAX 個までとする.
+ *              状態遷移中はメモリを確保しないため, 保留キューは拡張しない.
  *
  *  @param      [in]    machine 状態マシン.
  *  @param      [in]    event   発生したイベント.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              保留キューが満杯の場合, errno には ENOBUFS が設定され,
+ *              イベントは破棄される.
  */
-void fsm_transition(struct fsm *machine, const struct fsm_event *event)
+int fsm_transition(struct fsm *machine, const struct fsm_event *event)
 {
     const struct fsm_state *state;
 
     if ((machine == NULL) || (event == NULL)) {
-        return;
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (machine->in_flight != NULL) {
+        if (queue_enq(machine->deferred, (void *)&event) == NULL) {
+            DEBUG("event dropped: %s", event->name);
+            errno = ENOBUFS;
+            return -1;
+        }
+        return 0;
     }
 
     state = machine->current;
@@ -372,12 +703,109 @@ void fsm_transition(struct fsm *machine, const struct fsm_event *event)
         state = get_state_variable(state)->parent;
     }
 
+    /* Null 遷移を行う. */
+    if (machine->in_flight == NULL) {
+        fsm_state_transit(machine, machine->current, event_null);
+    }
+
+    return 0;
+}
+
+/**
+ *  @details    非同期アクションの内部から呼び出し, 遷移を保留するための
+ *              トークンを取得する.
+ *              取得したトークンを非同期アクションの戻り値とすること.
+ *              トークンは遷移ごとの通番を持ち, 完了した遷移のトークンは
+ *              以降の遷移では無効となる.
+ *
+ *  @param      [in]    machine 状態マシン.
+ *  @return     成功時は, 保留トークンが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *              非同期アクションの実行中でない場合, errno には EINVAL が設定される.
+ */
+FSM_TOKEN fsm_action_pend(struct fsm *machine)
+{
+    if ((machine == NULL) || !machine->in_async) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    /* 0 は未発行を表すため, 通番は 0 を飛ばす. */
+    if (++machine->token_seq == 0) {
+        ++machine->token_seq;
+    }
+    machine->token = machine->token_seq;
+
+    return (FSM_TOKEN)machine->token;
+}
+
+/**
+ *  @details    @c token で保留している遷移を完了させる.
+ *              遷移を確定した後, Null 遷移と保留していたイベントを処理する.
+ *              非同期アクションの内部で呼び出した場合は, アクションから
+ *              戻った時点で同期的に遷移する.
+ *
+ *  @param      [in]    machine 状態マシン.
+ *  @param      [in]    token   @ref fsm_action_pend で取得したトークン.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              @c token が保留中の遷移のものでない場合 (完了済み, または
+ *              重複した呼び出しの場合), errno には EINVAL が設定される.
+ *  @warning    @ref fsm_term 後の状態マシンを渡してはならない.
+ */
+int fsm_action_complete(struct fsm *machine, FSM_TOKEN token)
+{
+    const struct fsm_trans *corr;
+    const struct fsm_event *event;
+
+    if ((machine == NULL) || (token == NULL) || (machine->in_flight == NULL)
+        || (machine->token == 0) || (token != (FSM_TOKEN)machine->token)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    machine->token = 0;
+    if (machine->in_async) {
+        /* 非同期アクションから戻った時点で遷移を確定する. */
+        return 0;
+    }
+
+    corr = machine->in_flight;
+    machine->in_flight = NULL;
+    fsm_state_commit(machine, corr);
+    sched_refresh(machine);
+
     /* Null 遷移を行う. */
     fsm_state_transit(machine, machine->current, event_null);
+
+    while ((machine->in_flight == NULL) && (queue_deq(machine->deferred, &event) >= 0)) {
+        fsm_transition(machine, event);
+    }
+
+    return 0;
+}
+
+/**
+ *  @details    @c machine が非同期アクションの完了待ちか確認する.
+ *
+ *  @param      [in]    machine 状態マシン.
+ *  @return     完了待ちの場合は true が返る.
+ *              それ以外の場合は false が返る.
+ */
+bool fsm_in_flight(struct fsm *machine)
+{
+    if (machine == NULL) {
+        errno = EINVAL;
+        return false;
+    }
+
+    return machine->in_flight != NULL;
 }
 
 /**
  *  @details    現在の状態の do アクティビティを実行する.
+ *              @ref FSM_ACTIVITY_YIELD で中断した do アクティビティは
+ *              中断位置から再開し, 完了済みの場合は何もしない.
  *
  *  @param  [in]    machine 状態マシン.
  */
@@ -390,6 +818,212 @@ void fsm_update(struct fsm *machine)
     exec_if_can_be(machine);
 }
 
+/**
+ *  @details    指定の数の状態マシンを登録できる, 更新スケジューラを生成する.
+ *
+ *  @param      [in]    capacity    登録可能な状態マシンの数.
+ *  @return     成功時は, 確保および初期化されたオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    既定のメモリ割り当てから確保する.
+ */
+struct fsm_sched *fsm_sched_init(size_t capacity)
+{
+    return fsm_sched_init_attr(capacity, NULL);
+}
+
+/**
+ *  @details    属性を指定して, 指定の数の状態マシンを登録できる,
+ *              更新スケジューラを生成する.
+ *
+ *  @param      [in]    capacity    登録可能な状態マシンの数.
+ *  @param      [in]    attr        属性.
+ *                                  NULL の場合は @ref FSM_ATTR_INITIALIZER と
+ *                                  同じ属性となる.
+ *  @return     成功時は, 確保および初期化されたオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    属性のメモリ割り当てから確保する.
+ *  @sa         fsm_sched_init
+ */
+struct fsm_sched *fsm_sched_init_attr(size_t capacity, const struct fsm_attr *attr)
+{
+    const struct allocator *allocator = ((attr != NULL) && (attr->allocator != NULL))
+                                        ? attr->allocator : allocator_get_default();
+    struct fsm_sched *sched;
+    struct fsm **runnable;
+
+    if (capacity == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    sched = allocator_alloc(allocator, sizeof(*sched), 0);
+    runnable = allocator_zalloc(allocator, capacity * sizeof(*runnable), 0);
+    if ((sched == NULL) || (runnable == NULL)) {
+        allocator_free(allocator, runnable, capacity * sizeof(*runnable));
+        allocator_free(allocator, sched, sizeof(*sched));
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    *sched = FSM_SCHED_HELPER(runnable, capacity, allocator);
+
+    return sched;
+}
+
+/**
+ *  @details    @c sched の使用領域を解放する.
+ *              登録されている状態マシンは, 事前に登録を解除しておくこと.
+ *
+ *  @param      [in,out]    sched   更新スケジューラ.
+ */
+void fsm_sched_release(struct fsm_sched *sched)
+{
+    if (sched != NULL) {
+        allocator_free(sched->allocator, sched->runnable,
+                       sched->capacity * sizeof(*sched->runnable));
+        allocator_free(sched->allocator, sched, sizeof(*sched));
+    }
+}
+
+/**
+ *  @details    @c machine を @c sched に登録する.
+ *              以降, @c machine は状態遷移の度に実行可能集合への所属が更新され,
+ *              @ref fsm_update_all の対象となる.
+ *
+ *  @param      [in,out]    sched   更新スケジューラ.
+ *  @param      [in,out]    machine 状態マシン.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int fsm_sched_attach(struct fsm_sched *sched, struct fsm *machine)
+{
+    if ((sched == NULL) || (machine == NULL) || (machine->sched != NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (sched->attached >= sched->capacity) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    ++sched->attached;
+    machine->sched = sched;
+    machine->sched_tick = sched->tick;
+    sched_refresh(machine);
+
+    return 0;
+}
+
+/**
+ *  @details    @c machine の更新スケジューラへの登録を解除する.
+ *
+ *  @param      [in,out]    machine 状態マシン.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int fsm_sched_detach(struct fsm *machine)
+{
+    struct fsm_sched *sched;
+
+    if ((machine == NULL) || (machine->sched == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    sched = machine->sched;
+    if (machine->sched_index != SCHED_NONE) {
+        struct fsm *last = sched->runnable[--sched->count];
+        sched->runnable[machine->sched_index] = last;
+        last->sched_index = machine->sched_index;
+        machine->sched_index = SCHED_NONE;
+    }
+    --sched->attached;
+    machine->sched = NULL;
+
+    return 0;
+}
+
+/**
+ *  @details    @c sched に登録されている状態マシンのうち, 実行可能な
+ *              do アクティビティを持つものだけを更新する.
+ *              1 回の呼び出しで, 各状態マシンは高々 1 回だけ更新される.
+ *
+ *  @param      [in,out]    sched   更新スケジューラ.
+ */
+void fsm_update_all(struct fsm_sched *sched)
+{
+    if (sched == NULL) {
+        return;
+    }
+
+    ++sched->tick;
+    /* 更新中に実行可能集合から外れた要素は末尾要素と入れ替わるため,
+     * 末尾から走査する.
+     */
+    for (size_t i = sched->count; i-- > 0;) {
+        struct fsm *machine;
+
+        if (i >= sched->count) {
+            continue;
+        }
+        machine = sched->runnable[i];
+        if (machine->sched_tick == sched->tick) {
+            continue;
+        }
+        machine->sched_tick = sched->tick;
+        exec_if_can_be(machine);
+    }
+}
+
+/**
+ *  @details    @c sched で実行可能な状態マシンの数を取得する.
+ *
+ *  @param      [in]    sched   更新スケジューラ.
+ *  @return     成功時は, 実行可能な状態マシンの数が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+ssize_t fsm_sched_count(struct fsm_sched *sched)
+{
+    if (sched == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return sched->count;
+}
+
+/**
+ *  @details    現在の状態の do アクティビティの再開位置を取得する.
+ *              @ref FSM_ACTIVITY_BEGIN などのマクロから使用する.
+ *
+ *  @param      [in]    machine 状態マシン.
+ *  @return     再開位置のポインタが返る.
+ *  @pre        @c machine の非 NULL は呼び出し側で保証すること.
+ */
+int *fsm_activity_resume(struct fsm *machine)
+{
+    return &machine->activity;
+}
+
+/**
+ *  @details    現在の状態に, 未完了の do アクティビティがあるか確認する.
+ *
+ *  @param      [in]    machine 状態マシン.
+ *  @return     実行可能な do アクティビティがある場合は true が返る.
+ *              ない場合は false が返る.
+ */
+bool fsm_activity_runnable(struct fsm *machine)
+{
+    if (machine == NULL) {
+        errno = EINVAL;
+        return false;
+    }
+
+    return (machine->in_flight == NULL)
+           && (machine->current->exec != NULL)
+           && (machine->activity != FSM_ACTIVITY_DONE);
+}
+
 /**
  *  @details    指定状態の固有情報を取得する.
  *
@@ -436,6 +1070,8 @@ void fsm_current_state(struct fsm *machine, char *name, size_t len)
  */
 void fsm_dump_state_transition(struct fsm *machine, void (*handler)(TREE))
 {
+    struct collection_attr attr = COLLECTION_ATTR_HELPER(true, 0);
+    struct collection_attr fixed_attr = COLLECTION_ATTR_INITIALIZER;
     SET states;
     const struct fsm_state *state;
     TREE tree;
@@ -445,8 +1081,17 @@ void fsm_dump_state_transition(struct fsm *machine, void (*handler)(TREE))
         return;
     }
 
-    /* すべての状態を収集する. */
-    states = set_init(sizeof(struct fsm_state *), 30);
+    /* 一時的なコレクションは状態マシンのメモリ割り当てから確保する. */
+    attr.allocator = machine->allocator;
+    fixed_attr.allocator = machine->allocator;
+
+    /* すべての状態を収集する.
+     * 状態の数は事前に分からないため, 拡張可能なセットを使用する.
+     */
+    states = set_init_attr(sizeof(struct fsm_state *), 16, &attr);
+    if (states == NULL) {
+        return;
+    }
     for (int i = 0; machine->corresps[i].from != NULL; ++i) {
         const struct fsm_trans *corr = &machine->corresps[i];
         for (state = corr->from; state != NULL; state = get_state_variable(state)->parent) {
@@ -461,26 +1106,28 @@ void fsm_dump_state_transition(struct fsm *machine, void (*handler)(TREE))
      * 収集した状態は順不同であり, 多分木に追加する際に必ず親が追加されている
      * とは限らない.
      * その為, 追加に失敗した要素はキューに追加しておき, リトライする.
+     * 状態の数は確定しているため, 走査に有利なコンパクト配置とする.
      */
-    tree = tree_init(sizeof(struct fsm_state *), set_count(states));
-    reserve = queue_init(sizeof(struct fsm_state *), set_count(states));
+    reserve = queue_init_attr(sizeof(fsm_state_ptr), set_count(states), &fixed_attr);
+    fixed_attr.compact = true;
+    tree = tree_init_attr(sizeof(struct fsm_state *), set_count(states), &fixed_attr);
     for (ITER it = set_iter(states); it != NULL; it = iter_next(it)) {
         state = *(const struct fsm_state **)iter_get_payload(it);
         const struct fsm_state **parent =
             (get_state_variable(state)->parent != NULL) ? &get_state_variable(state)->parent : NULL;
         if (tree_insert(tree, (void *)parent, (void *)&state) == NULL) {
-            queue_enq(reserve, (void *)&state);
+            state_queue_enq(reserve, state);
         }
     }
     set_release(states);
     while (queue_count(reserve) > 0) {
-        if (queue_deq(reserve, &state) < 0) {
+        if (state_queue_deq(reserve, &state) < 0) {
             break;
         }
         const struct fsm_state **parent =
             (get_state_variable(state)->parent != NULL) ? &get_state_variable(state)->parent : NULL;
         if (tree_insert(tree, (void *)parent, (void *)&state) == NULL) {
-            queue_enq(reserve, (void *)&state);
+            state_queue_enq(reserve, state);
         }
     }
     queue_release(reserve);
@@ -0,0 +1,415 @@
+/** @file   inbox.c
+ *  @brief  状態マシンへのイベント配送 (受信箱とバッチ送信) 実装.
+ *
+ *  他のスレッドの状態マシンにイベントを送る際, 送信側でイベントを
+ *  まとめてから受信箱に渡すことで, イベントごとのキャッシュライン転送を
+ *  削減する.
+ *
+ *  @date   2026-10-16 新規作成.
+ *  @copyright  Copyright (c) 2018 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+
+#include "debug.h"
+#include "hfsm.h"
+
+/**
+ *  バッチ送信で同時に保持できる宛先の最大数.
+ */
+#define BATCH_DEST_MAX (8)
+
+/**
+ *  受信箱構造体.
+ */
+struct fsm_inbox {
+    CQUEUE batches;                    /**< 受信したバッチのキュー. */
+    const struct allocator *allocator; /**< メモリ割り当て. */
+};
+
+/**
+ *  宛先ごとの送信バッファ構造体.
+ */
+struct fsm_outbox {
+    struct fsm_inbox *inbox; /**< 宛先の受信箱. */
+    struct fsm_batch batch;  /**< 送信待ちのイベント. */
+    uint64_t deadline;       /**< 送信期限 (ナノ秒). */
+};
+
+/**
+ *  バッチ送信構造体.
+ */
+struct fsm_batcher {
+    size_t threshold;                          /**< 送信するイベント数の閾値. */
+    uint64_t timeout;                          /**< 送信までの最大待ち時間 (ナノ秒). */
+    struct fsm_outbox outboxes[BATCH_DEST_MAX]; /**< 宛先ごとの送信バッファ. */
+    const struct allocator *allocator;         /**< メモリ割り当て. */
+};
+
+/**
+ *  単調増加する現在時刻を取得する.
+ *
+ *  @return 現在時刻 (ナノ秒) が返る.
+ */
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ *  送信バッファのイベントを受信箱に渡す.
+ *
+ *  @param  [in,out]    outbox  送信バッファ.
+ *  @return 成功時は, 0 が返る.
+ *          失敗時は, -1 が返り, errno が適切に設定される.
+ *  @pre    @c outbox の非 NULL は呼び出し側で保証すること.
+ */
+static int outbox_flush(struct fsm_outbox *outbox)
+{
+    if (outbox->batch.count == 0) {
+        return 0;
+    }
+    if (cqueue_enq(outbox->inbox->batches, &outbox->batch) != 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+    outbox->batch.count = 0;
+
+    return 0;
+}
+
+/**
+ *  @details    指定の数のバッチを保持できる受信箱を生成する.
+ *
+ *  @param      [in]    capacity    保持できるバッチの数.
+ *  @return     成功時は, 確保および初期化されたオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    既定のメモリ割り当てから確保する.
+ */
+struct fsm_inbox *fsm_inbox_init(size_t capacity)
+{
+    return fsm_inbox_init_attr(capacity, NULL);
+}
+
+/**
+ *  @details    属性を指定して, 指定の数のバッチを保持できる受信箱を生成する.
+ *
+ *  @param      [in]    capacity    保持できるバッチの数.
+ *  @param      [in]    attr        属性.
+ *                                  NULL の場合は @ref FSM_ATTR_INITIALIZER と
+ *                                  同じ属性となる.
+ *  @return     成功時は, 確保および初期化されたオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    受信箱とバッチのキューは, 属性のメモリ割り当てから確保する.
+ *  @sa         fsm_inbox_init
+ */
+struct fsm_inbox *fsm_inbox_init_attr(size_t capacity, const struct fsm_attr *attr)
+{
+    struct collection_attr coll_attr = COLLECTION_ATTR_INITIALIZER;
+    const struct allocator *allocator;
+    struct fsm_inbox *inbox;
+
+    allocator = ((attr != NULL) && (attr->allocator != NULL))
+                ? attr->allocator : allocator_get_default();
+    coll_attr.allocator = allocator;
+    inbox = allocator_alloc(allocator, sizeof(*inbox), 0);
+    if (inbox == NULL) {
+        return NULL;
+    }
+    inbox->allocator = allocator;
+    inbox->batches = cqueue_init_attr(sizeof(struct fsm_batch), capacity, &coll_attr);
+    if (inbox->batches == NULL) {
+        allocator_free(allocator, inbox, sizeof(*inbox));
+        return NULL;
+    }
+
+    return inbox;
+}
+
+/**
+ *  @details    @c inbox の使用領域を解放する.
+ *
+ *  @param      [in,out]    inbox   受信箱.
+ */
+void fsm_inbox_release(struct fsm_inbox *inbox)
+{
+    if (inbox != NULL) {
+        cqueue_release(inbox->batches);
+        allocator_free(inbox->allocator, inbox, sizeof(*inbox));
+    }
+}
+
+/**
+ *  @details    @c inbox からバッチを 1 つ取り出す.
+ *
+ *  @param      [in,out]    inbox   受信箱.
+ *  @param      [out]       batch   取り出したバッチ.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              受信箱が空の場合, errno には EAGAIN が設定される.
+ *  @remarks    複数のスレッドから同時に呼び出すことができる.
+ */
+int fsm_inbox_pop(struct fsm_inbox *inbox, struct fsm_batch *batch)
+{
+    if ((inbox == NULL) || (batch == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return cqueue_deq(inbox->batches, batch);
+}
+
+/**
+ *  @details    @c batch のイベントを順に @c machine に発生させる.
+ *
+ *              保留できずに破棄されたイベントは数に含めない.
+ *
+ *  @param      [in,out]    machine 状態マシン.
+ *  @param      [in]        batch   イベントのバッチ.
+ *  @return     成功時は, 受け付けたイベントの数が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+ssize_t fsm_dispatch_batch(struct fsm *machine, const struct fsm_batch *batch)
+{
+    ssize_t count = 0;
+
+    if ((machine == NULL) || (batch == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (size_t i = 0; i < batch->count; ++i) {
+        if (fsm_transition(machine, batch->events[i]) == 0) {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+/**
+ *  @details    @c inbox に届いているバッチをすべて取り出し, @c machine に
+ *              発生させる.
+ *
+ *  @param      [in,out]    inbox   受信箱.
+ *  @param      [in,out]    machine 状態マシン.
+ *  @return     成功時は, 発生させたイベントの数が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+ssize_t fsm_inbox_dispatch(struct fsm_inbox *inbox, struct fsm *machine)
+{
+    struct fsm_batch batch;
+    ssize_t count = 0;
+
+    if ((inbox == NULL) || (machine == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    while (cqueue_deq(inbox->batches, &batch) == 0) {
+        count += fsm_dispatch_batch(machine, &batch);
+    }
+
+    return count;
+}
+
+/**
+ *  @details    バッチ送信オブジェクトを生成する.
+ *              送信バッファのイベントが @c threshold 個に達するか,
+ *              最初のイベントから @c timeout_us マイクロ秒を経過すると
+ *              受信箱に渡す.
+ *
+ *  @param      [in]    threshold   送信するイベント数の閾値.
+ *                                  1 以上 @ref FSM_BATCH_MAX 以下とすること.
+ *  @param      [in]    timeout_us  送信までの最大待ち時間 (マイクロ秒).
+ *  @return     成功時は, 確保および初期化されたオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    既定のメモリ割り当てから確保する.
+ *  @warning    スレッドセーフではない. 送信スレッドごとに生成すること.
+ */
+struct fsm_batcher *fsm_batcher_init(size_t threshold, unsigned long timeout_us)
+{
+    return fsm_batcher_init_attr(threshold, timeout_us, NULL);
+}
+
+/**
+ *  @details    属性を指定してバッチ送信オブジェクトを生成する.
+ *
+ *  @param      [in]    threshold   送信するイベント数の閾値.
+ *                                  1 以上 @ref FSM_BATCH_MAX 以下とすること.
+ *  @param      [in]    timeout_us  送信までの最大待ち時間 (マイクロ秒).
+ *  @param      [in]    attr        属性.
+ *                                  NULL の場合は @ref FSM_ATTR_INITIALIZER と
+ *                                  同じ属性となる.
+ *  @return     成功時は, 確保および初期化されたオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @remarks    属性のメモリ割り当てから確保する.
+ *  @warning    スレッドセーフではない. 送信スレッドごとに生成すること.
+ *  @sa         fsm_batcher_init
+ */
+struct fsm_batcher *fsm_batcher_init_attr(size_t threshold,
+                                          unsigned long timeout_us,
+                                          const struct fsm_attr *attr)
+{
+    const struct allocator *allocator = ((attr != NULL) && (attr->allocator != NULL))
+                                        ? attr->allocator : allocator_get_default();
+    struct fsm_batcher *batcher;
+
+    if ((threshold == 0) || (threshold > FSM_BATCH_MAX)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    batcher = allocator_zalloc(allocator, sizeof(*batcher), 0);
+    if (batcher == NULL) {
+        return NULL;
+    }
+    batcher->allocator = allocator;
+    batcher->threshold = threshold;
+    batcher->timeout = (uint64_t)timeout_us * 1000ULL;
+
+    return batcher;
+}
+
+/**
+ *  @details    @c batcher の使用領域を解放する.
+ *              送信待ちのイベントは破棄されるため, 事前に
+ *              @ref fsm_batcher_flush を呼び出すこと.
+ *
+ *  @param      [in,out]    batcher バッチ送信オブジェクト.
+ */
+void fsm_batcher_release(struct fsm_batcher *batcher)
+{
+    if (batcher != NULL) {
+        allocator_free(batcher->allocator, batcher, sizeof(*batcher));
+    }
+}
+
+/**
+ *  @details    @c inbox 宛ての @c event を送信バッファに追加する.
+ *              閾値または送信期限に達した場合は受信箱に渡す.
+ *
+ *  @param      [in,out]    batcher バッチ送信オブジェクト.
+ *  @param      [in,out]    inbox   宛先の受信箱.
+ *  @param      [in]        event   送信するイベント.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              受信箱が満杯で追加できない場合, errno には EAGAIN が設定される.
+ */
+int fsm_batcher_post(struct fsm_batcher *batcher,
+                     struct fsm_inbox *inbox,
+                     const struct fsm_event *event)
+{
+    struct fsm_outbox *outbox = NULL;
+    struct fsm_outbox *vacant = NULL;
+    uint64_t now;
+
+    if ((batcher == NULL) || (inbox == NULL) || (event == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (size_t i = 0; i < BATCH_DEST_MAX; ++i) {
+        struct fsm_outbox *o = &batcher->outboxes[i];
+        if (o->inbox == inbox) {
+            outbox = o;
+            break;
+        }
+        if ((vacant == NULL) && ((o->inbox == NULL) || (o->batch.count == 0))) {
+            vacant = o;
+        }
+    }
+    if (outbox == NULL) {
+        if ((vacant == NULL) && (fsm_batcher_flush(batcher) == 0)) {
+            vacant = &batcher->outboxes[0];
+        }
+        if (vacant == NULL) {
+            return -1;
+        }
+        outbox = vacant;
+        outbox->inbox = inbox;
+        outbox->batch.count = 0;
+    }
+
+    if ((outbox->batch.count == FSM_BATCH_MAX) && (outbox_flush(outbox) != 0)) {
+        return -1;
+    }
+    now = now_ns();
+    if (outbox->batch.count == 0) {
+        outbox->deadline = now + batcher->timeout;
+    }
+    outbox->batch.events[outbox->batch.count++] = event;
+
+    if ((outbox->batch.count >= batcher->threshold) || (now >= outbox->deadline)) {
+        /* 受信箱が満杯の場合は送信バッファに残し, 次の機会に渡す. */
+        outbox_flush(outbox);
+    }
+
+    return 0;
+}
+
+/**
+ *  @details    送信期限を過ぎた送信バッファを受信箱に渡す.
+ *              イベントを送信しない期間も, 定期的に呼び出すこと.
+ *
+ *  @param      [in,out]    batcher バッチ送信オブジェクト.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int fsm_batcher_poll(struct fsm_batcher *batcher)
+{
+    uint64_t now;
+    int ret = 0;
+
+    if (batcher == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    now = now_ns();
+    for (size_t i = 0; i < BATCH_DEST_MAX; ++i) {
+        struct fsm_outbox *outbox = &batcher->outboxes[i];
+        if ((outbox->batch.count > 0) && (now >= outbox->deadline)) {
+            if (outbox_flush(outbox) != 0) {
+                ret = -1;
+            }
+        }
+    }
+
+    return ret;
+}
+
+/**
+ *  @details    すべての送信バッファを受信箱に渡す.
+ *
+ *  @param      [in,out]    batcher バッチ送信オブジェクト.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int fsm_batcher_flush(struct fsm_batcher *batcher)
+{
+    int ret = 0;
+
+    if (batcher == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (size_t i = 0; i < BATCH_DEST_MAX; ++i) {
+        struct fsm_outbox *outbox = &batcher->outboxes[i];
+        if ((outbox->inbox != NULL) && (outbox_flush(outbox) != 0)) {
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
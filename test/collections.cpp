@@ -4,11 +4,42 @@
  *  @author t-kenji <protect.2501@gmail.com>
  *  @date   2018-03-18 新規作成.
  */
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
 #include <catch.hpp>
 
 extern "C" {
 #include "debug.h"
 #include "collections.h"
+}
+#include "collections_typed.h"
+
+namespace {
+
+struct pair_payload {
+    const void *first;
+    const void *second;
+};
+
+COLLECTION_DEFINE_STACK(int_stack, int)
+COLLECTION_DEFINE_QUEUE(pair_queue, struct pair_payload)
+COLLECTION_DEFINE_LIST(int_list, int)
+
+int compare_int(const void *a, const void *b)
+{
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+
+    return (x > y) - (x < y);
+}
+
 }
 
 SCENARIO("リストが初期化できること", "[list][init]") {
@@ -25,6 +56,281 @@ SCENARIO("リストが初期化できること", "[list][init]") {
     }
 }
 
+SCENARIO("リストの消去と追加を繰り返せること", "[list][clear]") {
+    GIVEN("リストを容量 5 で初期化しておく") {
+        LIST list = list_init(sizeof(int), 5);
+
+        WHEN("要素の追加, 削除, 消去を繰り返す") {
+            for (int round = 0; round < 100; ++round) {
+                for (int i = 0; i < 5; ++i) {
+                    REQUIRE(list_add(list, &i) != NULL);
+                }
+                REQUIRE(list_remove(list, list_iter(list)) == 0);
+                REQUIRE(list_clear(list) == 0);
+                REQUIRE(list_count(list) == 0);
+                REQUIRE(list_iter(list) == NULL);
+            }
+
+            THEN("容量いっぱいまで追加でき, それを超えると失敗すること") {
+                int a = 0x55;
+                for (int i = 0; i < 5; ++i) {
+                    REQUIRE(list_add(list, &i) != NULL);
+                }
+                REQUIRE(list_add(list, &a) == NULL);
+
+                int expected = 0;
+                for (ITER iter = list_iter(list); iter != NULL; iter = iter_next(iter)) {
+                    REQUIRE(*(int *)iter_get_payload(iter) == expected);
+                    ++expected;
+                }
+                REQUIRE(expected == 5);
+            }
+        }
+
+        list_release(list);
+    }
+}
+
+SCENARIO("リストの指定位置に要素を挿入, 取得できること", "[list][index]") {
+    GIVEN("リストを容量 5 で初期化しておく") {
+        LIST list = list_init(sizeof(int), 5);
+
+        WHEN("先頭, 末尾, 中間に要素を挿入する") {
+            int a;
+            a = 1; list_insert(list, 0, &a);
+            a = 3; list_insert(list, 1, &a);
+            a = 0; list_insert(list, 0, &a);
+            a = 2; list_insert(list, 2, &a);
+
+            THEN("指定位置の要素が取得できること") {
+                for (int i = 0; i < 4; ++i) {
+                    REQUIRE(*(int *)list_get(list, i) == i);
+                }
+                REQUIRE(list_get(list, 4) == NULL);
+            }
+
+            THEN("要素数を超える位置には挿入できないこと") {
+                a = 9;
+                REQUIRE(list_insert(list, 5, &a) == NULL);
+                REQUIRE(list_count(list) == 4);
+                REQUIRE(list_insert(list, 4, &a) != NULL);
+            }
+        }
+
+        list_release(list);
+    }
+
+    GIVEN("位置索引を有効にした拡張可能なリストを容量 8 で初期化しておく") {
+        struct collection_attr attr = COLLECTION_ATTR_INDEXED_HELPER(true, 0);
+        LIST list = list_init_attr(sizeof(int), 8, &attr);
+        REQUIRE(list != NULL);
+
+        WHEN("中間への挿入と削除を繰り返す") {
+            std::vector<int> expected;
+            unsigned int seed = 1;
+            for (int i = 0; i < 1000; ++i) {
+                seed = seed * 1103515245 + 12345;
+                int pos = (int)((seed >> 8) % (expected.size() + 1));
+                REQUIRE(list_insert(list, pos, &i) != NULL);
+                expected.insert(expected.begin() + pos, i);
+                if ((i % 3) == 0) {
+                    ITER iter = list_iter(list);
+                    for (size_t k = 0; k < (expected.size() / 2); ++k) {
+                        iter = iter_next(iter);
+                    }
+                    REQUIRE(list_remove(list, iter) == 0);
+                    expected.erase(expected.begin() + (expected.size() / 2));
+                }
+            }
+
+            THEN("位置による取得が挿入順序と一致すること") {
+                REQUIRE(list_count(list) == (ssize_t)expected.size());
+                for (size_t k = 0; k < expected.size(); ++k) {
+                    REQUIRE(*(int *)list_get(list, k) == expected[k]);
+                }
+            }
+
+            THEN("反復子による走査が挿入順序と一致すること") {
+                size_t k = 0;
+                for (ITER iter = list_iter(list); iter != NULL; iter = iter_next(iter), ++k) {
+                    REQUIRE(*(int *)iter_get_payload(iter) == expected[k]);
+                }
+                REQUIRE(k == expected.size());
+            }
+
+            THEN("消去後も位置による操作ができること") {
+                int a = 7, b = 8;
+                REQUIRE(list_clear(list) == 0);
+                REQUIRE(list_get(list, 0) == NULL);
+                list_add(list, &a);
+                list_insert(list, 0, &b);
+                REQUIRE(*(int *)list_get(list, 0) == 8);
+                REQUIRE(*(int *)list_get(list, 1) == 7);
+            }
+        }
+
+        list_release(list);
+    }
+}
+
+SCENARIO("拡張可能なリストが容量を超えて要素を追加できること", "[list][grow]") {
+    GIVEN("拡張可能なリストを容量 2 で初期化しておく") {
+        struct collection_attr attr = COLLECTION_ATTR_INITIALIZER;
+        attr.growable = true;
+        LIST list = list_init_attr(sizeof(int), 2, &attr);
+        REQUIRE(list != NULL);
+
+        WHEN("要素を 100 個追加する") {
+            int *payloads[100];
+            for (int i = 0; i < 100; ++i) {
+                payloads[i] = (int *)list_add(list, &i);
+                REQUIRE(payloads[i] != NULL);
+            }
+
+            THEN("リストの長さが 100 であること") {
+                REQUIRE(list_count(list) == 100);
+            }
+
+            THEN("追加時に返されたデータ部のポインタが有効なままであること") {
+                for (int i = 0; i < 100; ++i) {
+                    REQUIRE(*payloads[i] == i);
+                }
+            }
+
+            THEN("消去後も同じ数の要素を追加できること") {
+                REQUIRE(list_clear(list) == 0);
+                for (int i = 0; i < 100; ++i) {
+                    REQUIRE(list_add(list, &i) != NULL);
+                }
+                REQUIRE(list_count(list) == 100);
+            }
+        }
+
+        list_release(list);
+    }
+
+    GIVEN("最大容量 5 の拡張可能なリストを容量 2 で初期化しておく") {
+        struct collection_attr attr = COLLECTION_ATTR_HELPER(true, 5);
+        LIST list = list_init_attr(sizeof(int), 2, &attr);
+        REQUIRE(list != NULL);
+
+        WHEN("要素を 5 つ追加する") {
+            for (int i = 0; i < 5; ++i) {
+                REQUIRE(list_add(list, &i) != NULL);
+            }
+
+            THEN("6 つ目の追加に ENOMEM で失敗すること") {
+                int a = 0x55;
+                errno = 0;
+                REQUIRE(list_add(list, &a) == NULL);
+                REQUIRE(errno == ENOMEM);
+                REQUIRE(list_count(list) == 5);
+            }
+        }
+
+        list_release(list);
+    }
+
+    GIVEN("特になし") {
+        WHEN("最大容量より大きい容量で初期化する") {
+            struct collection_attr attr = COLLECTION_ATTR_HELPER(true, 2);
+            LIST list = list_init_attr(sizeof(int), 5, &attr);
+
+            THEN("インスタンスが NULL となる") {
+                REQUIRE(list == NULL);
+            }
+        }
+    }
+}
+
+SCENARIO("スタックに要素を積み, 取り出せること", "[stack][push][pop]") {
+    GIVEN("スタックを容量 5 で初期化しておく") {
+        STACK stack = stack_init(sizeof(int), 5);
+        REQUIRE(stack != NULL);
+
+        WHEN("要素を 5 つ積む") {
+            for (int i = 0; i < 5; ++i) {
+                REQUIRE(stack_push(stack, &i) != NULL);
+            }
+
+            THEN("6 つ目を積むと ENOMEM で失敗すること") {
+                int a = 0x55;
+                errno = 0;
+                REQUIRE(stack_push(stack, &a) == NULL);
+                REQUIRE(errno == ENOMEM);
+                REQUIRE(stack_count(stack) == 5);
+            }
+
+            THEN("反復子で最後に積んだ要素から順に取得できること") {
+                int expected = 4;
+                for (ITER iter = stack_iter(stack); iter != NULL; iter = iter_next(iter)) {
+                    REQUIRE(*(int *)iter_get_payload(iter) == expected);
+                    --expected;
+                }
+                REQUIRE(expected == -1);
+            }
+
+            THEN("最後に積んだ要素から順に取り出せること") {
+                int a;
+                for (int i = 4; i >= 0; --i) {
+                    REQUIRE(stack_pop(stack, &a) == i);
+                    REQUIRE(a == i);
+                }
+                errno = 0;
+                REQUIRE(stack_pop(stack, &a) == -1);
+                REQUIRE(errno == EAGAIN);
+            }
+
+            THEN("消去すると空になり, 再び積めること") {
+                int a = 0x55;
+                REQUIRE(stack_clear(stack) == 0);
+                REQUIRE(stack_count(stack) == 0);
+                REQUIRE(stack_iter(stack) == NULL);
+                REQUIRE(stack_push(stack, &a) != NULL);
+                REQUIRE(stack_count(stack) == 1);
+            }
+        }
+
+        stack_release(stack);
+    }
+
+    GIVEN("拡張可能なスタックを容量 2 で初期化しておく") {
+        struct collection_attr attr = COLLECTION_ATTR_HELPER(true, 0);
+        STACK stack = stack_init_attr(sizeof(int), 2, &attr);
+        REQUIRE(stack != NULL);
+
+        WHEN("要素を 100 個積み, 50 個取り出してから再び 50 個積む") {
+            int *payloads[100];
+            int a;
+            for (int i = 0; i < 100; ++i) {
+                payloads[i] = (int *)stack_push(stack, &i);
+                REQUIRE(payloads[i] != NULL);
+            }
+            for (int i = 0; i < 50; ++i) {
+                stack_pop(stack, &a);
+            }
+            for (int i = 50; i < 100; ++i) {
+                REQUIRE(stack_push(stack, &i) == payloads[i]);
+            }
+
+            THEN("データ部のポインタが移動していないこと") {
+                for (int i = 0; i < 100; ++i) {
+                    REQUIRE(*payloads[i] == i);
+                }
+            }
+
+            THEN("すべての要素を逆順に取り出せること") {
+                for (int i = 99; i >= 0; --i) {
+                    REQUIRE(stack_pop(stack, &a) == i);
+                    REQUIRE(a == i);
+                }
+            }
+        }
+
+        stack_release(stack);
+    }
+}
+
 SCENARIO("キューが初期化できること", "[queue][init]") {
     GIVEN("特になし") {
         WHEN("キューを容量 0 で初期化する") {
@@ -200,139 +506,714 @@ SCENARIO("キューから要素を取り出せること", "[queue][deq]") {
     }
 }
 
-SCENARIO("ツリーが初期化できること", "[tree][init]") {
-    GIVEN("特になし") {
-        WHEN("ツリーを容量 5 で初期化する") {
-            TREE tree = tree_init(sizeof(int), 5);
+SCENARIO("キューの要素をコピーせずに参照できること", "[queue][span]") {
+    GIVEN("キューを容量 4 で初期化しておく") {
+        QUEUE que = queue_init(sizeof(int), 4);
 
-            THEN("インスタンスが NULL ではないこと") {
-                REQUIRE(tree != NULL);
-            }
+        WHEN("要素を追加しない") {
+            struct queue_span spans[2];
 
-            tree_release(tree);
+            THEN("領域の数が 0 であること") {
+                REQUIRE(queue_peek_spans(que, spans) == 0);
+            }
         }
-    }
-}
 
-SCENARIO("ツリーに要素が追加できること", "[tree][add]") {
-    GIVEN("ツリーを容量 5 で初期化しておく") {
-        TREE tree = tree_init(sizeof(int), 5);
+        WHEN("折り返すように要素を追加, 取り出す") {
+            struct queue_span spans[2];
+            int a, b;
+            for (a = 0; a < 3; ++a) {
+                queue_enq(que, &a);
+            }
+            queue_deq(que, &b);
+            queue_deq(que, &b);
+            for (; a < 6; ++a) {
+                queue_enq(que, &a);
+            }
 
-        WHEN("要素を追加しない") {
-            THEN("ツリーの要素数が 0 であること") {
-                REQUIRE(tree_count(tree) == 0);
+            THEN("2 つの領域で追加順に要素が参照できること") {
+                int expected = 2;
+                REQUIRE(queue_peek_spans(que, spans) == 2);
+                for (int n = 0; n < 2; ++n) {
+                    for (size_t i = 0; i < spans[n].count; ++i) {
+                        REQUIRE(*(int *)((char *)spans[n].base + (i * spans[n].stride)) == expected);
+                        ++expected;
+                    }
+                }
+                REQUIRE(expected == 6);
             }
-        }
 
-        WHEN("要素を root に 1 つ追加する") {
-            int a = 0x55;
-            REQUIRE(tree_insert(tree, NULL, &a) != NULL);
+            THEN("先頭から取り除いた残りが取り出せること") {
+                REQUIRE(queue_consume(que, 3) == 1);
+                REQUIRE(queue_peek_spans(que, spans) == 1);
+                REQUIRE(spans[0].count == 1);
+                REQUIRE(*(int *)spans[0].base == 5);
+                REQUIRE(queue_deq(que, &b) == 0);
+                REQUIRE(b == 5);
+            }
 
-            THEN("ツリーの要素数が 1 であること") {
-                REQUIRE(tree_count(tree) == 1);
+            THEN("要素数を超えて取り除けないこと") {
+                REQUIRE(queue_consume(que, 5) == -1);
+                REQUIRE(queue_count(que) == 4);
             }
         }
 
-        WHEN("要素を root に 5 つ追加する") {
-            for (int i = 0; i < 5; ++i) {
-                REQUIRE(tree_insert(tree, NULL, &i) != NULL);
+        queue_release(que);
+    }
+
+    GIVEN("拡張可能なキューを容量 2 で初期化しておく") {
+        struct collection_attr attr = COLLECTION_ATTR_HELPER(true, 0);
+        QUEUE que = queue_init_attr(sizeof(int), 2, &attr);
+
+        WHEN("要素の追加と取り出しを交互に繰り返しながら拡張する") {
+            int a = 0, b = 0, expected = 0;
+            for (int round = 0; round < 10; ++round) {
+                for (int i = 0; i < 7; ++i, ++a) {
+                    REQUIRE(queue_enq(que, &a) != NULL);
+                }
+                for (int i = 0; i < 5; ++i, ++expected) {
+                    queue_deq(que, &b);
+                    REQUIRE(b == expected);
+                }
             }
 
-            THEN("ツリーの要素数が 5 であること") {
-                REQUIRE(tree_count(tree) == 5);
+            THEN("反復子で追加順に残りの要素が取得できること") {
+                for (ITER iter = queue_iter(que); iter != NULL; iter = iter_next(iter)) {
+                    REQUIRE(*(int *)iter_get_payload(iter) == expected);
+                    ++expected;
+                }
+                REQUIRE(expected == a);
+            }
+
+            THEN("配列に追加順でコピーできること") {
+                int *array;
+                size_t count;
+                REQUIRE(queue_to_array(que, (void **)&array, &count) == 0);
+                REQUIRE(count == 20);
+                for (size_t i = 0; i < count; ++i) {
+                    REQUIRE(array[i] == (int)(expected + i));
+                }
+                free(array);
+            }
+
+            THEN("領域を辿って取り除くとすべての要素を追加順に参照できること") {
+                struct queue_span spans[2];
+                ssize_t n;
+                while ((n = queue_peek_spans(que, spans)) > 0) {
+                    for (ssize_t k = 0; k < n; ++k) {
+                        for (size_t i = 0; i < spans[k].count; ++i) {
+                            REQUIRE(*(int *)((char *)spans[k].base + (i * spans[k].stride)) == expected);
+                            ++expected;
+                        }
+                        queue_consume(que, spans[k].count);
+                    }
+                }
+                REQUIRE(expected == a);
+                REQUIRE(queue_count(que) == 0);
             }
         }
 
-        WHEN("要素を階層的に 5 つ追加する") {
-            int a = 0, b;
-            REQUIRE(tree_insert(tree, NULL, &a) != NULL);
-            a = 1; b = 0;
-            REQUIRE(tree_insert(tree, &b, &a) != NULL);
-            a = 2; b = 0;
-            REQUIRE(tree_insert(tree, &b, &a) != NULL);
-            a = 3; b = 2;
-            REQUIRE(tree_insert(tree, &b, &a) != NULL);
-            a = 4; b = 3;
-            REQUIRE(tree_insert(tree, &b, &a) != NULL);
+        queue_release(que);
+    }
+}
 
-            THEN("ツリーの要素数が 5 であること") {
-                REQUIRE(tree_count(tree) == 5);
+SCENARIO("最大の容量を持つ拡張可能なキューは格納中の要素の数で制限されること", "[queue][grow]") {
+    GIVEN("最大の容量 8 の拡張可能なキューを容量 4 で初期化しておく") {
+        struct collection_attr attr = COLLECTION_ATTR_HELPER(true, 8);
+        QUEUE que = queue_init_attr(sizeof(int), 4, &attr);
+        REQUIRE(que != NULL);
+
+        WHEN("拡張して 8 つ追加し, 3 つ取り出す") {
+            for (int i = 0; i < 8; ++i) {
+                REQUIRE(queue_enq(que, &i) != NULL);
+            }
+            int b = -1;
+            for (int i = 0; i < 3; ++i) {
+                REQUIRE(queue_deq(que, &b) == (7 - i));
+                REQUIRE(b == i);
+            }
+
+            THEN("最大の容量まで再び追加でき, それ以上は ENOMEM で失敗すること") {
+                for (int i = 13; i < 16; ++i) {
+                    REQUIRE(queue_enq(que, &i) != NULL);
+                }
+                REQUIRE(queue_count(que) == 8);
+                int extra = 99;
+                errno = 0;
+                REQUIRE(queue_enq(que, &extra) == NULL);
+                REQUIRE(errno == ENOMEM);
+
+                const int expected[] = {3, 4, 5, 6, 7, 13, 14, 15};
+                for (int i = 0; i < 8; ++i) {
+                    REQUIRE(queue_deq(que, &b) == (7 - i));
+                    REQUIRE(b == expected[i]);
+                }
             }
         }
 
-        tree_release(tree);
+        queue_release(que);
     }
 }
 
-SCENARIO("ツリーを反復子で処理できること", "[tree][iterator]") {
-    GIVEN("ツリーを容量 5 で初期化しておく") {
-        TREE tree = tree_init(sizeof(int), 5);
+SCENARIO("セットに重複なく要素が追加できること", "[set][add]") {
+    GIVEN("セットを容量 1000 で初期化しておく") {
+        SET set = set_init(sizeof(int), 1000);
 
-        WHEN("要素を root に 5 つ追加する") {
-            for (int i = 0; i < 5; ++i) {
-                tree_insert(tree, NULL, &i);
+        WHEN("0 から 999 を 2 回ずつ追加する") {
+            for (int n = 0; n < 2; ++n) {
+                for (int i = 0; i < 1000; ++i) {
+                    REQUIRE(set_add(set, &i) != NULL);
+                }
             }
 
-            THEN("反復子でツリーに沿った順に値が取得できること") {
-                TREE_ITER iter = tree_iter_get(tree);
-                REQUIRE(iter != NULL);
-                REQUIRE(*(int *)tree_iter_get_payload(iter) == 0);
-                iter = tree_iter_next(iter);
-                REQUIRE(*(int *)tree_iter_get_payload(iter) == 1);
-                iter = tree_iter_next(iter);
-                REQUIRE(*(int *)tree_iter_get_payload(iter) == 2);
-                iter = tree_iter_next(iter);
-                REQUIRE(*(int *)tree_iter_get_payload(iter) == 3);
-                iter = tree_iter_next(iter);
-                REQUIRE(*(int *)tree_iter_get_payload(iter) == 4);
+            THEN("セットの要素数が 1000 であること") {
+                REQUIRE(set_count(set) == 1000);
+            }
+
+            THEN("反復子で追加した順に値が取得できること") {
+                int expected = 0;
+                for (ITER iter = set_iter(set); iter != NULL; iter = iter_next(iter)) {
+                    REQUIRE(*(int *)iter_get_payload(iter) == expected);
+                    ++expected;
+                }
+                REQUIRE(expected == 1000);
+            }
+
+            THEN("同じ値の追加では既存のデータ部のポインタが返ること") {
+                int a = 500;
+                void *p = set_add(set, &a);
+                REQUIRE(p != &a);
+                REQUIRE(set_add(set, &a) == p);
+                REQUIRE(*(int *)p == 500);
             }
         }
 
-        WHEN("要素を階層的に 5 つ追加する (pat 1)") {
-            int a = 0, b;
-            tree_insert(tree, NULL, &a);
-            a = 1; b = 0;
-            tree_insert(tree, &b, &a);
-            a = 2; b = 0;
-            tree_insert(tree, &b, &a);
-            a = 3; b = 2;
-            tree_insert(tree, &b, &a);
-            a = 4; b = 3;
-            tree_insert(tree, &b, &a);
+        WHEN("要素の追加と消去を繰り返す") {
+            for (int round = 0; round < 100; ++round) {
+                for (int i = 0; i < 10; ++i) {
+                    int a = round + i;
+                    REQUIRE(set_add(set, &a) != NULL);
+                }
+                REQUIRE(set_count(set) == 10);
+                REQUIRE(set_clear(set) == 0);
+            }
 
-            THEN("反復子でツリーに沿った順に値が取得できること") {
-                TREE_ITER iter = tree_iter_get(tree);
-                REQUIRE(iter != NULL);
+            THEN("消去前の要素が残っていないこと") {
+                int a = 0;
+                REQUIRE(set_count(set) == 0);
+                REQUIRE(set_add(set, &a) != NULL);
+                REQUIRE(set_count(set) == 1);
+            }
+        }
 
-                REQUIRE(*(int *)tree_iter_get_payload(iter) == 0);
-                REQUIRE(tree_iter_get_age(iter) == 1);
-                iter = tree_iter_next(iter);
-                REQUIRE(*(int *)tree_iter_get_payload(iter) == 1);
-                REQUIRE(tree_iter_get_age(iter) == 2);
-                iter = tree_iter_next(iter);
-                REQUIRE(*(int *)tree_iter_get_payload(iter) == 2);
-                REQUIRE(tree_iter_get_age(iter) == 2);
-                iter = tree_iter_next(iter);
-                REQUIRE(*(int *)tree_iter_get_payload(iter) == 3);
-                REQUIRE(tree_iter_get_age(iter) == 3);
-                iter = tree_iter_next(iter);
-                REQUIRE(*(int *)tree_iter_get_payload(iter) == 4);
-                REQUIRE(tree_iter_get_age(iter) == 4);
+        WHEN("要素を追加してから消去する") {
+            int a = 1;
+            set_add(set, &a);
+            REQUIRE(set_clear(set) == 0);
 
-                tree_iter_release(iter);
+            THEN("同じ値を再び追加できること") {
+                REQUIRE(set_count(set) == 0);
+                REQUIRE(set_add(set, &a) != NULL);
+                REQUIRE(set_count(set) == 1);
             }
         }
 
-        WHEN("要素を階層的に 5 つ追加する (pat 2)") {
-            int a = 0, b;
-            tree_insert(tree, NULL, &a);
-            a = 1; b = 0;
+        set_release(set);
+    }
+}
+
+SCENARIO("マップにキーと値を追加, 取得, 削除できること", "[map]") {
+    GIVEN("マップを拡張可能で容量 4 で初期化しておく") {
+        const struct collection_attr attr = COLLECTION_ATTR_HELPER(true, 0);
+        MAP map = map_init_attr(sizeof(int), sizeof(double), 4, &attr);
+        REQUIRE(map != NULL);
+
+        WHEN("10000 個のキーを追加する") {
+            for (int i = 0; i < 10000; ++i) {
+                double v = i * 0.5;
+                REQUIRE(map_put(map, &i, &v) != NULL);
+            }
+
+            THEN("すべてのキーの値が取得できること") {
+                REQUIRE(map_count(map) == 10000);
+                for (int i = 0; i < 10000; ++i) {
+                    double *v = (double *)map_get(map, &i);
+                    REQUIRE(v != NULL);
+                    REQUIRE(*v == i * 0.5);
+                }
+            }
+
+            THEN("既存のキーへの追加は値を上書きすること") {
+                int key = 42;
+                double v = -1.0;
+                REQUIRE(*(double *)map_put(map, &key, &v) == -1.0);
+                REQUIRE(*(double *)map_get(map, &key) == -1.0);
+                REQUIRE(map_count(map) == 10000);
+            }
+
+            THEN("奇数のキーを削除しても偶数のキーが取得できること") {
+                for (int i = 1; i < 10000; i += 2) {
+                    REQUIRE(map_remove(map, &i) == 0);
+                }
+                REQUIRE(map_count(map) == 5000);
+                for (int i = 0; i < 10000; ++i) {
+                    errno = 0;
+                    double *v = (double *)map_get(map, &i);
+                    if ((i % 2) == 0) {
+                        REQUIRE(v != NULL);
+                        REQUIRE(*v == i * 0.5);
+                    } else {
+                        REQUIRE(v == NULL);
+                        REQUIRE(errno == ENOENT);
+                    }
+                }
+
+                int n = 0;
+                for (ITER iter = map_iter(map); iter != NULL; iter = iter_next(iter), n += 2) {
+                    REQUIRE(*(int *)iter_get_payload(iter) == n);
+                    REQUIRE(*(double *)map_iter_get_value(map, iter) == n * 0.5);
+                }
+                REQUIRE(n == 10000);
+            }
+
+            THEN("削除と追加を繰り返しても取得できること") {
+                for (int round = 0; round < 3; ++round) {
+                    for (int i = 0; i < 10000; ++i) {
+                        REQUIRE(map_remove(map, &i) == 0);
+                        double v = i + round;
+                        REQUIRE(map_put(map, &i, &v) != NULL);
+                    }
+                }
+                for (int i = 0; i < 10000; ++i) {
+                    REQUIRE(*(double *)map_get(map, &i) == i + 2);
+                }
+            }
+
+            THEN("消去すると空になり, 再び追加できること") {
+                int key = 7;
+                double v = 1.0;
+                REQUIRE(map_clear(map) == 0);
+                REQUIRE(map_count(map) == 0);
+                REQUIRE(map_get(map, &key) == NULL);
+                REQUIRE(map_put(map, &key, &v) != NULL);
+                REQUIRE(*(double *)map_get(map, &key) == 1.0);
+            }
+        }
+
+        WHEN("存在しないキーを削除する") {
+            int key = 1;
+            errno = 0;
+
+            THEN("ENOENT で失敗すること") {
+                REQUIRE(map_remove(map, &key) == -1);
+                REQUIRE(errno == ENOENT);
+            }
+        }
+
+        map_release(map);
+    }
+
+    GIVEN("マップを容量 2 で初期化しておく") {
+        MAP map = map_init(sizeof(int), sizeof(int), 2);
+
+        WHEN("容量を超えてキーを追加する") {
+            int k = 0, v = 0;
+            map_put(map, &k, &v);
+            k = 1;
+            map_put(map, &k, &v);
+            k = 2;
+            errno = 0;
+
+            THEN("ENOMEM で失敗すること") {
+                REQUIRE(map_put(map, &k, &v) == NULL);
+                REQUIRE(errno == ENOMEM);
+                REQUIRE(map_count(map) == 2);
+            }
+        }
+
+        map_release(map);
+    }
+}
+
+SCENARIO("優先度付きキューから優先度順に要素を取り出せること", "[pqueue]") {
+    GIVEN("優先度付きキューを拡張可能で容量 4 で初期化しておく") {
+        const struct collection_attr attr = COLLECTION_ATTR_HELPER(true, 0);
+        PQUEUE pq = pqueue_init_attr(sizeof(int), 4, compare_int, &attr);
+        REQUIRE(pq != NULL);
+        std::vector<int> values;
+        unsigned int seed = 1;
+        for (int i = 0; i < 5000; ++i) {
+            seed = (seed * 1103515245u) + 12345u;
+            values.push_back((int)((seed >> 8) % 1000));
+        }
+
+        WHEN("要素を 1 つずつ追加する") {
+            std::vector<int *> handles;
+            for (int v : values) {
+                int *handle = (int *)pqueue_push(pq, &v);
+                REQUIRE(handle != NULL);
+                handles.push_back(handle);
+            }
+
+            THEN("昇順に取り出せること") {
+                std::vector<int> sorted(values);
+                std::sort(sorted.begin(), sorted.end());
+                REQUIRE(*(int *)pqueue_peek(pq) == sorted[0]);
+                for (size_t i = 0; i < sorted.size(); ++i) {
+                    int v;
+                    REQUIRE(pqueue_pop(pq, &v) == (int)(sorted.size() - i - 1));
+                    REQUIRE(v == sorted[i]);
+                }
+                REQUIRE(pqueue_peek(pq) == NULL);
+                REQUIRE(errno == EAGAIN);
+            }
+
+            THEN("ハンドルから優先度を変更, 削除できること") {
+                REQUIRE(*handles[0] == values[0]);
+                *handles[100] = -1;
+                REQUIRE(pqueue_update(pq, handles[100]) == 0);
+                REQUIRE(*(int *)pqueue_peek(pq) == -1);
+                *handles[100] = 5000;
+                REQUIRE(pqueue_update(pq, handles[100]) == 0);
+                REQUIRE(pqueue_remove(pq, handles[200]) == 0);
+
+                std::vector<int> expected(values);
+                expected[100] = 5000;
+                expected.erase(expected.begin() + 200);
+                std::sort(expected.begin(), expected.end());
+                REQUIRE(pqueue_count(pq) == (ssize_t)expected.size());
+                for (int e : expected) {
+                    int v;
+                    REQUIRE(pqueue_pop(pq, &v) >= 0);
+                    REQUIRE(v == e);
+                }
+            }
+        }
+
+        WHEN("配列からまとめて追加する") {
+            int first = 500;
+            pqueue_push(pq, &first);
+            REQUIRE(pqueue_heapify(pq, values.data(), values.size()) == 0);
+
+            THEN("昇順に取り出せること") {
+                std::vector<int> sorted(values);
+                sorted.push_back(first);
+                std::sort(sorted.begin(), sorted.end());
+                REQUIRE(pqueue_count(pq) == (ssize_t)sorted.size());
+                for (int e : sorted) {
+                    int v;
+                    REQUIRE(pqueue_pop(pq, &v) >= 0);
+                    REQUIRE(v == e);
+                }
+            }
+
+            THEN("消去すると空になること") {
+                REQUIRE(pqueue_clear(pq) == 0);
+                REQUIRE(pqueue_count(pq) == 0);
+                REQUIRE(pqueue_push(pq, &first) != NULL);
+                REQUIRE(*(int *)pqueue_peek(pq) == first);
+            }
+        }
+
+        pqueue_release(pq);
+    }
+
+    GIVEN("優先度付きキューを容量 2 で初期化しておく") {
+        PQUEUE pq = pqueue_init(sizeof(int), 2, compare_int);
+        int values[] = {3, 1, 2};
+
+        WHEN("容量を超えて追加する") {
+            errno = 0;
+
+            THEN("ENOMEM で失敗すること") {
+                REQUIRE(pqueue_push(pq, &values[0]) != NULL);
+                REQUIRE(pqueue_push(pq, &values[1]) != NULL);
+                REQUIRE(pqueue_push(pq, &values[2]) == NULL);
+                REQUIRE(errno == ENOMEM);
+                REQUIRE(pqueue_heapify(pq, values, 1) == -1);
+                REQUIRE(pqueue_count(pq) == 2);
+            }
+        }
+
+        pqueue_release(pq);
+    }
+}
+
+SCENARIO("ビットセットで集合演算ができること", "[bitset]") {
+    GIVEN("ビット数 1000 のビットセットを 2 つ初期化しておく") {
+        BITSET a = bitset_init(1000);
+        BITSET b = bitset_init(1000);
+        REQUIRE(a != NULL);
+        REQUIRE(b != NULL);
+
+        WHEN("a に 3 の倍数, b に 5 の倍数のビットを立てる") {
+            for (size_t i = 0; i < 1000; i += 3) {
+                REQUIRE(bitset_set(a, i) == 0);
+            }
+            for (size_t i = 0; i < 1000; i += 5) {
+                REQUIRE(bitset_set(b, i) == 0);
+            }
+
+            THEN("立てたビットの数と位置が取得できること") {
+                REQUIRE(bitset_count(a) == 334);
+                REQUIRE(bitset_test(a, 999) == 1);
+                REQUIRE(bitset_test(a, 998) == 0);
+                size_t expected = 0;
+                for (ssize_t bit = bitset_next(a, 0); bit >= 0; bit = bitset_next(a, bit + 1)) {
+                    REQUIRE((size_t)bit == expected);
+                    expected += 3;
+                }
+                REQUIRE(expected == 1002);
+                REQUIRE(errno == ENOENT);
+            }
+
+            THEN("和集合, 積集合, 差集合が求められること") {
+                BITSET c = bitset_init(1000);
+                REQUIRE(bitset_union(c, a) == 0);
+                REQUIRE(bitset_intersect(c, b) == 0);
+                REQUIRE(bitset_count(c) == 67);
+                for (ssize_t bit = bitset_next(c, 0); bit >= 0; bit = bitset_next(c, bit + 1)) {
+                    REQUIRE((bit % 15) == 0);
+                }
+
+                REQUIRE(bitset_difference(a, c) == 0);
+                REQUIRE(bitset_count(a) == 334 - 67);
+                REQUIRE(bitset_test(a, 15) == 0);
+                REQUIRE(bitset_test(a, 3) == 1);
+
+                REQUIRE(bitset_union(a, b) == 0);
+                REQUIRE(bitset_count(a) == 334 + 200 - 67);
+                bitset_release(c);
+            }
+
+            THEN("ビットを戻す, 消去すると 0 になること") {
+                REQUIRE(bitset_reset(a, 3) == 0);
+                REQUIRE(bitset_test(a, 3) == 0);
+                REQUIRE(bitset_next(a, 1) == 6);
+                REQUIRE(bitset_clear(a) == 0);
+                REQUIRE(bitset_count(a) == 0);
+                REQUIRE(bitset_next(a, 0) == -1);
+            }
+        }
+
+        WHEN("範囲外のビットを操作する") {
+            errno = 0;
+
+            THEN("EINVAL で失敗すること") {
+                REQUIRE(bitset_set(a, 1000) == -1);
+                REQUIRE(errno == EINVAL);
+                REQUIRE(bitset_test(a, 1000) == -1);
+            }
+        }
+
+        WHEN("ビット数の異なるビットセットと演算する") {
+            BITSET c = bitset_init(64);
+            errno = 0;
+
+            THEN("EINVAL で失敗すること") {
+                REQUIRE(bitset_union(a, c) == -1);
+                REQUIRE(errno == EINVAL);
+            }
+            bitset_release(c);
+        }
+
+        bitset_release(b);
+        bitset_release(a);
+    }
+}
+
+SCENARIO("ツリーが初期化できること", "[tree][init]") {
+    GIVEN("特になし") {
+        WHEN("ツリーを容量 5 で初期化する") {
+            TREE tree = tree_init(sizeof(int), 5);
+
+            THEN("インスタンスが NULL ではないこと") {
+                REQUIRE(tree != NULL);
+            }
+
+            tree_release(tree);
+        }
+    }
+}
+
+SCENARIO("ツリーに要素が追加できること", "[tree][add]") {
+    GIVEN("ツリーを容量 5 で初期化しておく") {
+        TREE tree = tree_init(sizeof(int), 5);
+
+        WHEN("要素を追加しない") {
+            THEN("ツリーの要素数が 0 であること") {
+                REQUIRE(tree_count(tree) == 0);
+            }
+        }
+
+        WHEN("要素を root に 1 つ追加する") {
+            int a = 0x55;
+            REQUIRE(tree_insert(tree, NULL, &a) != NULL);
+
+            THEN("ツリーの要素数が 1 であること") {
+                REQUIRE(tree_count(tree) == 1);
+            }
+        }
+
+        WHEN("要素を root に 5 つ追加する") {
+            for (int i = 0; i < 5; ++i) {
+                REQUIRE(tree_insert(tree, NULL, &i) != NULL);
+            }
+
+            THEN("ツリーの要素数が 5 であること") {
+                REQUIRE(tree_count(tree) == 5);
+            }
+        }
+
+        WHEN("要素を階層的に 5 つ追加する") {
+            int a = 0, b;
+            REQUIRE(tree_insert(tree, NULL, &a) != NULL);
+            a = 1; b = 0;
+            REQUIRE(tree_insert(tree, &b, &a) != NULL);
+            a = 2; b = 0;
+            REQUIRE(tree_insert(tree, &b, &a) != NULL);
+            a = 3; b = 2;
+            REQUIRE(tree_insert(tree, &b, &a) != NULL);
+            a = 4; b = 3;
+            REQUIRE(tree_insert(tree, &b, &a) != NULL);
+
+            THEN("ツリーの要素数が 5 であること") {
+                REQUIRE(tree_count(tree) == 5);
+            }
+        }
+
+        tree_release(tree);
+    }
+}
+
+SCENARIO("ツリーの親要素がデータ部から探索されること", "[tree][parent]") {
+    GIVEN("ツリーを容量 20000 で初期化しておく") {
+        TREE tree = tree_init(sizeof(int), 20000);
+
+        WHEN("root に 10000 個, 各要素に子を 1 つずつ追加する") {
+            for (int i = 0; i < 10000; ++i) {
+                REQUIRE(tree_insert(tree, NULL, &i) != NULL);
+            }
+            for (int i = 0; i < 10000; ++i) {
+                int child = 10000 + i;
+                REQUIRE(tree_insert(tree, &i, &child) != NULL);
+            }
+
+            THEN("各要素の直後にその子が走査されること") {
+                int n = 0;
+                TREE_ITER iter;
+                for (iter = tree_iter_get(tree); n < 20000; iter = tree_iter_next(iter), ++n) {
+                    int expected = ((n % 2) == 0) ? (n / 2) : (10000 + (n / 2));
+                    REQUIRE(*(int *)tree_iter_get_payload(iter) == expected);
+                    REQUIRE(tree_iter_get_age(iter) == ((n % 2) + 1));
+                }
+                tree_iter_release(iter);
+            }
+        }
+
+        WHEN("存在しない親を指定して追加する") {
+            int a = 1, parent = 99;
+            tree_insert(tree, NULL, &a);
+            errno = 0;
+
+            THEN("ENOENT で失敗すること") {
+                REQUIRE(tree_insert(tree, &parent, &a) == NULL);
+                REQUIRE(errno == ENOENT);
+                REQUIRE(tree_count(tree) == 1);
+            }
+        }
+
+        WHEN("同じ値の要素が複数ある親を指定して追加する") {
+            int a = 1, b = 2, c = 3;
+            tree_insert(tree, NULL, &a);
+            tree_insert(tree, NULL, &b);
+            tree_insert(tree, &b, &a);
+            tree_insert(tree, &a, &c);
+
+            THEN("最初に追加された要素の子となること") {
+                TREE_ITER iter = tree_iter_get(tree);
+                REQUIRE(*(int *)tree_iter_get_payload(iter) == 1);
+                iter = tree_iter_next(iter);
+                REQUIRE(*(int *)tree_iter_get_payload(iter) == 3);
+                REQUIRE(tree_iter_get_age(iter) == 2);
+                tree_iter_release(iter);
+            }
+        }
+
+        tree_release(tree);
+    }
+}
+
+SCENARIO("拡張可能なツリーが容量を超えて要素を追加できること", "[tree][grow]") {
+    GIVEN("拡張可能なツリーを容量 1 で初期化しておく") {
+        struct collection_attr attr = COLLECTION_ATTR_HELPER(true, 0);
+        TREE tree = tree_init_attr(sizeof(int), 1, &attr);
+        REQUIRE(tree != NULL);
+
+        WHEN("要素を親子関係で 50 個追加する") {
+            int a = 0;
+            REQUIRE(tree_insert(tree, NULL, &a) != NULL);
+            for (int i = 1; i < 50; ++i) {
+                int parent = i - 1;
+                REQUIRE(tree_insert(tree, &parent, &i) != NULL);
+            }
+
+            THEN("反復子で追加した順に値と世代が取得できること") {
+                int expected = 0;
+                TREE_ITER iter;
+                for (iter = tree_iter_get(tree); iter != NULL; iter = tree_iter_next(iter)) {
+                    REQUIRE(*(int *)tree_iter_get_payload(iter) == expected);
+                    REQUIRE(tree_iter_get_age(iter) == expected + 1);
+                    ++expected;
+                    if (expected == 50) {
+                        break;
+                    }
+                }
+                REQUIRE(expected == 50);
+                REQUIRE(tree_count(tree) == 50);
+                tree_iter_release(iter);
+            }
+        }
+
+        tree_release(tree);
+    }
+}
+
+SCENARIO("ツリーを反復子で処理できること", "[tree][iterator]") {
+    GIVEN("ツリーを容量 5 で初期化しておく") {
+        TREE tree = tree_init(sizeof(int), 5);
+
+        WHEN("要素を root に 5 つ追加する") {
+            for (int i = 0; i < 5; ++i) {
+                tree_insert(tree, NULL, &i);
+            }
+
+            THEN("反復子でツリーに沿った順に値が取得できること") {
+                TREE_ITER iter = tree_iter_get(tree);
+                REQUIRE(iter != NULL);
+                REQUIRE(*(int *)tree_iter_get_payload(iter) == 0);
+                iter = tree_iter_next(iter);
+                REQUIRE(*(int *)tree_iter_get_payload(iter) == 1);
+                iter = tree_iter_next(iter);
+                REQUIRE(*(int *)tree_iter_get_payload(iter) == 2);
+                iter = tree_iter_next(iter);
+                REQUIRE(*(int *)tree_iter_get_payload(iter) == 3);
+                iter = tree_iter_next(iter);
+                REQUIRE(*(int *)tree_iter_get_payload(iter) == 4);
+
+                tree_iter_release(iter);
+            }
+        }
+
+        WHEN("要素を階層的に 5 つ追加する (pat 1)") {
+            int a = 0, b;
+            tree_insert(tree, NULL, &a);
+            a = 1; b = 0;
             tree_insert(tree, &b, &a);
             a = 2; b = 0;
             tree_insert(tree, &b, &a);
             a = 3; b = 2;
             tree_insert(tree, &b, &a);
-            a = 4; b = 1;
+            a = 4; b = 3;
             tree_insert(tree, &b, &a);
 
             THEN("反復子でツリーに沿った順に値が取得できること") {
@@ -345,19 +1226,1417 @@ SCENARIO("ツリーを反復子で処理できること", "[tree][iterator]") {
                 REQUIRE(*(int *)tree_iter_get_payload(iter) == 1);
                 REQUIRE(tree_iter_get_age(iter) == 2);
                 iter = tree_iter_next(iter);
-                REQUIRE(*(int *)tree_iter_get_payload(iter) == 4);
-                REQUIRE(tree_iter_get_age(iter) == 3);
-                iter = tree_iter_next(iter);
                 REQUIRE(*(int *)tree_iter_get_payload(iter) == 2);
                 REQUIRE(tree_iter_get_age(iter) == 2);
                 iter = tree_iter_next(iter);
                 REQUIRE(*(int *)tree_iter_get_payload(iter) == 3);
                 REQUIRE(tree_iter_get_age(iter) == 3);
+                iter = tree_iter_next(iter);
+                REQUIRE(*(int *)tree_iter_get_payload(iter) == 4);
+                REQUIRE(tree_iter_get_age(iter) == 4);
 
                 tree_iter_release(iter);
             }
         }
 
+        WHEN("要素を階層的に 5 つ追加する (pat 2)") {
+            int a = 0, b;
+            tree_insert(tree, NULL, &a);
+            a = 1; b = 0;
+            tree_insert(tree, &b, &a);
+            a = 2; b = 0;
+            tree_insert(tree, &b, &a);
+            a = 3; b = 2;
+            tree_insert(tree, &b, &a);
+            a = 4; b = 1;
+            tree_insert(tree, &b, &a);
+
+            THEN("反復子でツリーに沿った順に値が取得できること") {
+                TREE_ITER iter = tree_iter_get(tree);
+                REQUIRE(iter != NULL);
+
+                REQUIRE(*(int *)tree_iter_get_payload(iter) == 0);
+                REQUIRE(tree_iter_get_age(iter) == 1);
+                iter = tree_iter_next(iter);
+                REQUIRE(*(int *)tree_iter_get_payload(iter) == 1);
+                REQUIRE(tree_iter_get_age(iter) == 2);
+                iter = tree_iter_next(iter);
+                REQUIRE(*(int *)tree_iter_get_payload(iter) == 4);
+                REQUIRE(tree_iter_get_age(iter) == 3);
+                iter = tree_iter_next(iter);
+                REQUIRE(*(int *)tree_iter_get_payload(iter) == 2);
+                REQUIRE(tree_iter_get_age(iter) == 2);
+                iter = tree_iter_next(iter);
+                REQUIRE(*(int *)tree_iter_get_payload(iter) == 3);
+                REQUIRE(tree_iter_get_age(iter) == 3);
+
+                tree_iter_release(iter);
+            }
+        }
+
+        tree_release(tree);
+    }
+}
+
+SCENARIO("ツリーをメモリを確保せずに走査できること", "[tree][walk]") {
+    GIVEN("ツリーを容量 1000 で初期化しておく") {
+        TREE tree = tree_init(sizeof(int), 1000);
+        struct tree_walk walk;
+
+        WHEN("要素を追加しない") {
+            errno = 0;
+
+            THEN("先頭の取得が ENOENT で失敗すること") {
+                REQUIRE(tree_walk_first(tree, &walk) == NULL);
+                REQUIRE(errno == ENOENT);
+            }
+        }
+
+        WHEN("深さ 1000 の一本道を追加する") {
+            for (int i = 0; i < 1000; ++i) {
+                int parent = i - 1;
+                REQUIRE(tree_insert(tree, (i == 0) ? NULL : &parent, &i) != NULL);
+            }
+
+            THEN("根から順に深さとともに走査され, 末尾で NULL が返ること") {
+                int n = 0;
+                for (int *p = (int *)tree_walk_first(tree, &walk);
+                     p != NULL;
+                     p = (int *)tree_walk_next(&walk), ++n) {
+                    REQUIRE(*p == n);
+                    REQUIRE(tree_walk_get_age(&walk) == n + 1);
+                }
+                REQUIRE(n == 1000);
+                REQUIRE(tree_walk_next(&walk) == NULL);
+            }
+        }
+
+        WHEN("要素を階層的に 5 つ追加する") {
+            int a = 0, b;
+            tree_insert(tree, NULL, &a);
+            a = 1; b = 0;
+            tree_insert(tree, &b, &a);
+            a = 2; b = 0;
+            tree_insert(tree, &b, &a);
+            a = 3; b = 2;
+            tree_insert(tree, &b, &a);
+            a = 4; b = 1;
+            tree_insert(tree, &b, &a);
+            a = 5;
+            tree_insert(tree, NULL, &a);
+
+            THEN("反復子と同じ順に走査されること") {
+                const int expected[][2] = {{0, 1}, {1, 2}, {4, 3}, {2, 2}, {3, 3}, {5, 1}};
+                int n = 0;
+                for (int *p = (int *)tree_walk_first(tree, &walk);
+                     p != NULL;
+                     p = (int *)tree_walk_next(&walk), ++n) {
+                    REQUIRE(*p == expected[n][0]);
+                    REQUIRE(tree_walk_get_age(&walk) == expected[n][1]);
+                }
+                REQUIRE(n == 6);
+            }
+        }
+
+        tree_release(tree);
+    }
+}
+
+SCENARIO("コンパクト配置のツリーを操作できること", "[tree][compact]") {
+    GIVEN("コンパクト配置のツリーを容量 5 で初期化しておく") {
+        struct collection_attr attr = COLLECTION_ATTR_INITIALIZER;
+        attr.compact = true;
+        TREE tree = tree_init_attr(sizeof(int), 5, &attr);
+        REQUIRE(tree != NULL);
+
+        WHEN("要素を階層的に 5 つ追加する") {
+            int a = 0, b;
+            int *first = (int *)tree_insert(tree, NULL, &a);
+            a = 1; b = 0;
+            tree_insert(tree, &b, &a);
+            a = 2; b = 0;
+            tree_insert(tree, &b, &a);
+            a = 3; b = 2;
+            tree_insert(tree, &b, &a);
+            a = 4; b = 1;
+            tree_insert(tree, &b, &a);
+
+            THEN("データ部が整列して配置されること") {
+                REQUIRE(((uintptr_t)first % alignof(std::max_align_t)) == 0);
+            }
+
+            THEN("ポインタ配置と同じ順に走査されること") {
+                const int expected[][2] = {{0, 1}, {1, 2}, {4, 3}, {2, 2}, {3, 3}};
+                struct tree_walk walk;
+                int n = 0;
+                for (int *p = (int *)tree_walk_first(tree, &walk);
+                     p != NULL;
+                     p = (int *)tree_walk_next(&walk), ++n) {
+                    REQUIRE(*p == expected[n][0]);
+                    REQUIRE(tree_walk_get_age(&walk) == expected[n][1]);
+                }
+                REQUIRE(n == 5);
+
+                TREE_ITER iter = tree_iter_get(tree);
+                REQUIRE(*(int *)tree_iter_get_payload(iter) == 0);
+                iter = tree_iter_next(iter);
+                REQUIRE(*(int *)tree_iter_get_payload(iter) == 1);
+                REQUIRE(tree_iter_get_age(iter) == 2);
+                tree_iter_release(iter);
+            }
+
+            THEN("容量を超える追加は ENOMEM で失敗すること") {
+                a = 5;
+                errno = 0;
+                REQUIRE(tree_insert(tree, NULL, &a) == NULL);
+                REQUIRE(errno == ENOMEM);
+                REQUIRE(tree_count(tree) == 5);
+            }
+
+            THEN("消去後に再び追加できること") {
+                struct tree_walk walk;
+                REQUIRE(tree_clear(tree) == 0);
+                REQUIRE(tree_walk_first(tree, &walk) == NULL);
+                a = 7;
+                REQUIRE(tree_insert(tree, NULL, &a) != NULL);
+                REQUIRE(*(int *)tree_walk_first(tree, &walk) == 7);
+                REQUIRE(tree_count(tree) == 1);
+            }
+        }
+
+        tree_release(tree);
+    }
+
+    GIVEN("拡張可能なコンパクト配置の属性を用意しておく") {
+        struct collection_attr attr = COLLECTION_ATTR_HELPER(true, 0);
+        attr.compact = true;
+
+        WHEN("ツリーを初期化する") {
+            errno = 0;
+            TREE tree = tree_init_attr(sizeof(int), 5, &attr);
+
+            THEN("EINVAL で失敗すること") {
+                REQUIRE(tree == NULL);
+                REQUIRE(errno == EINVAL);
+            }
+        }
+    }
+}
+
+SCENARIO("型付きのフロントエンドで要素を操作できること", "[typed]") {
+    GIVEN("型付きのスタック, キュー, リストを初期化しておく") {
+        STACK stack = int_stack_init(4);
+        QUEUE que = pair_queue_init(4);
+        LIST list = int_list_init(4);
+        int a = 1, b = 2;
+
+        WHEN("要素を追加して取り出す") {
+            for (int i = 0; i < 4; ++i) {
+                REQUIRE(int_stack_push(stack, i) != NULL);
+                REQUIRE(pair_queue_enq(que, pair_payload{&a, (i % 2) ? &b : NULL}) != NULL);
+                REQUIRE(int_list_add(list, i * 10) != NULL);
+            }
+
+            THEN("型なしの API と同じ順に取り出せること") {
+                REQUIRE(int_stack_push(stack, 4) == NULL);
+                REQUIRE(errno == ENOMEM);
+                for (int i = 3; i >= 0; --i) {
+                    int v;
+                    REQUIRE(int_stack_pop(stack, &v) == 0);
+                    REQUIRE(v == i);
+                }
+                REQUIRE(int_stack_pop(stack, &a) == -1);
+                REQUIRE(errno == EAGAIN);
+
+                for (int i = 0; i < 4; ++i) {
+                    struct pair_payload p;
+                    REQUIRE(pair_queue_deq(que, &p) == 0);
+                    REQUIRE(p.first == &a);
+                    REQUIRE(p.second == ((i % 2) ? &b : NULL));
+                }
+                REQUIRE(queue_count(que) == 0);
+
+                REQUIRE(*int_list_get(list, 2) == 20);
+                REQUIRE(int_list_insert(list, 0, -1) == NULL);
+            }
+
+            THEN("型なしの API と混在できること") {
+                int v = 0;
+                REQUIRE(stack_pop(stack, &v) == 3);
+                REQUIRE(v == 3);
+                REQUIRE(*(int *)list_get(list, 3) == 30);
+            }
+        }
+
+        list_release(list);
+        queue_release(que);
+        stack_release(stack);
+    }
+
+    GIVEN("C++ の型付きのコレクションを拡張可能で初期化しておく") {
+        const struct collection_attr attr = COLLECTION_ATTR_HELPER(true, 0);
+        hfsm::typed_stack<pair_payload> stack(2, &attr);
+        hfsm::typed_queue<int> que(2, &attr);
+        hfsm::typed_list<int> list(2, &attr);
+        int a = 1;
+
+        WHEN("初期容量を超えて追加する") {
+            for (int i = 0; i < 100; ++i) {
+                REQUIRE(stack.push(pair_payload{&a, &list}) != NULL);
+                REQUIRE(que.enq(i) != NULL);
+                REQUIRE(list.add(i) != NULL);
+            }
+
+            THEN("追加した順に応じて取り出せること") {
+                REQUIRE(stack.count() == 100);
+                REQUIRE(list.count() == 100);
+                for (int i = 0; i < 100; ++i) {
+                    pair_payload p;
+                    int v;
+                    REQUIRE(stack.pop(p) == 0);
+                    REQUIRE(p.first == &a);
+                    REQUIRE(que.deq(v) == 0);
+                    REQUIRE(v == i);
+                    REQUIRE(*list.get(i) == i);
+                }
+                REQUIRE(que.count() == 0);
+            }
+        }
+    }
+}
+
+SCENARIO("スレッドセーフなキューに複数スレッドから要素を追加, 取り出せること", "[cqueue][stress]") {
+    GIVEN("スレッドセーフなキューを容量 64 で初期化しておく") {
+        CQUEUE que = cqueue_init(sizeof(int), 64);
+        REQUIRE(que != NULL);
+
+        WHEN("4 つの生産者と 4 つの消費者で要素を受け渡す") {
+            const int producers = 4, consumers = 4, per_producer = 20000;
+            std::atomic<long long> sum(0);
+            std::atomic<int> received(0);
+            std::vector<std::thread> threads;
+
+            for (int p = 0; p < producers; ++p) {
+                threads.emplace_back([&, p]() {
+                    for (int i = 0; i < per_producer; ++i) {
+                        int data = (p * per_producer) + i;
+                        while (cqueue_enq(que, &data) != 0) {
+                            std::this_thread::yield();
+                        }
+                    }
+                });
+            }
+            for (int c = 0; c < consumers; ++c) {
+                threads.emplace_back([&]() {
+                    while (received.load() < producers * per_producer) {
+                        int data;
+                        if (cqueue_deq(que, &data) == 0) {
+                            sum += data;
+                            ++received;
+                        } else {
+                            std::this_thread::yield();
+                        }
+                    }
+                });
+            }
+            for (auto &t : threads) {
+                t.join();
+            }
+
+            THEN("すべての要素が 1 回ずつ取り出されること") {
+                long long n = (long long)producers * per_producer;
+                REQUIRE(received.load() == n);
+                REQUIRE(sum.load() == (n * (n - 1)) / 2);
+                REQUIRE(cqueue_count(que) == 0);
+            }
+        }
+
+        cqueue_release(que);
+    }
+}
+
+SCENARIO("スレッドセーフなスタックに複数スレッドから要素を積み, 取り出せること", "[cstack][stress]") {
+    GIVEN("スレッドセーフなスタックを容量 16 で初期化しておく") {
+        CSTACK stack = cstack_init(sizeof(int), 16);
+        REQUIRE(stack != NULL);
+
+        WHEN("容量を超えて積む") {
+            int data = 0;
+            for (int i = 0; i < 16; ++i) {
+                REQUIRE(cstack_push(stack, &i) == 0);
+            }
+
+            THEN("17 個目は失敗し, 後に積んだ順に取り出せること") {
+                REQUIRE(cstack_push(stack, &data) == -1);
+                for (int i = 15; i >= 0; --i) {
+                    REQUIRE(cstack_pop(stack, &data) == 0);
+                    REQUIRE(data == i);
+                }
+                REQUIRE(cstack_pop(stack, &data) == -1);
+            }
+        }
+
+        WHEN("8 つのスレッドで積む, 取り出すを繰り返す") {
+            const int workers = 8, rounds = 20000;
+            std::atomic<long long> pushed(0), popped(0);
+            std::atomic<bool> done(false);
+            std::atomic<int> out_of_range(0);
+            std::vector<std::thread> threads;
+
+            /* 操作中も要素の数が負や容量超過にならないことを観測する. */
+            std::thread observer([&]() {
+                while (!done) {
+                    ssize_t count = cstack_count(stack);
+                    if ((count < 0) || (count > 16 + workers)) {
+                        ++out_of_range;
+                    }
+                }
+            });
+            for (int w = 0; w < workers; ++w) {
+                threads.emplace_back([&, w]() {
+                    for (int i = 0; i < rounds; ++i) {
+                        int data = (w * rounds) + i;
+                        if (cstack_push(stack, &data) == 0) {
+                            pushed += data;
+                        }
+                        if (cstack_pop(stack, &data) == 0) {
+                            popped += data;
+                        }
+                    }
+                });
+            }
+            for (auto &t : threads) {
+                t.join();
+            }
+            done = true;
+            observer.join();
+
+            THEN("積んだ要素がすべて 1 回ずつ取り出されること") {
+                int data;
+                while (cstack_pop(stack, &data) == 0) {
+                    popped += data;
+                }
+                REQUIRE(pushed.load() == popped.load());
+                REQUIRE(cstack_count(stack) == 0);
+                REQUIRE(out_of_range.load() == 0);
+            }
+        }
+
+        cstack_release(stack);
+    }
+}
+
+SCENARIO("スラブから領域を確保, 解放できること", "[allocator][slab]") {
+    GIVEN("スラブのメモリ割り当てを使用する") {
+        const struct allocator *slab = &allocator_slab;
+
+        WHEN("様々なサイズの領域を確保する") {
+            std::vector<std::pair<void *, size_t>> blocks;
+            for (size_t bytes = 1; bytes <= 8192; bytes = (bytes * 3) / 2 + 1) {
+                void *ptr = allocator_alloc(slab, bytes, 0);
+                REQUIRE(ptr != NULL);
+                memset(ptr, 0xa5, bytes);
+                blocks.emplace_back(ptr, bytes);
+            }
+
+            THEN("基本型に整列した, 重ならない領域が得られること") {
+                for (auto &b : blocks) {
+                    REQUIRE(((uintptr_t)b.first % alignof(max_align_t)) == 0);
+                    REQUIRE(((unsigned char *)b.first)[b.second - 1] == 0xa5);
+                    allocator_free(slab, b.first, b.second);
+                }
+            }
+        }
+
+        WHEN("整列を指定して確保する") {
+            void *ptr = allocator_alloc(slab, 128, 64);
+
+            THEN("指定の整列となること") {
+                REQUIRE(ptr != NULL);
+                REQUIRE(((uintptr_t)ptr % 64) == 0);
+                allocator_free(slab, ptr, 128);
+            }
+        }
+
+        WHEN("解放した直後に同じサイズを確保する") {
+            void *first = allocator_alloc(slab, 40, 0);
+            allocator_free(slab, first, 40);
+            void *second = allocator_alloc(slab, 48, 0);
+
+            THEN("スレッドのマガジンから同じ領域が再利用されること") {
+                REQUIRE(second == first);
+                allocator_free(slab, second, 48);
+            }
+        }
+
+        WHEN("不正な要求を行う") {
+            THEN("失敗し, errno が EINVAL となること") {
+                errno = 0;
+                REQUIRE(allocator_alloc(slab, 0, 0) == NULL);
+                REQUIRE(errno == EINVAL);
+                errno = 0;
+                REQUIRE(allocator_alloc(slab, 24, 3) == NULL);
+                REQUIRE(errno == EINVAL);
+                errno = 0;
+                REQUIRE(allocator_alloc(slab, 24, 16) == NULL);
+                REQUIRE(errno == EINVAL);
+                errno = 0;
+                REQUIRE(slab_reserve(0, 1) == -1);
+                REQUIRE(errno == EINVAL);
+                errno = 0;
+                REQUIRE(slab_reserve(8192, 1) == -1);
+                REQUIRE(errno == EINVAL);
+            }
+        }
+
+        WHEN("事前に確保しておく") {
+            THEN("成功すること") {
+                REQUIRE(slab_reserve(96, 4096) == 0);
+                REQUIRE(slab_reserve(96, 16) == 0);
+            }
+        }
+
+        WHEN("8 つのスレッドで確保, 解放を繰り返し, 別のスレッドで解放する") {
+            const int workers = 8, rounds = 2000;
+            const size_t depth = 48;
+            std::atomic<int> corrupted(0);
+            std::vector<std::vector<void *>> leftovers(workers);
+            std::vector<std::thread> threads;
+
+            for (int w = 0; w < workers; ++w) {
+                threads.emplace_back([&, w]() {
+                    std::vector<int *> held;
+                    for (int i = 0; i < rounds; ++i) {
+                        int *ptr = (int *)allocator_alloc(slab, sizeof(int) * 8, 0);
+                        if (ptr == NULL) {
+                            ++corrupted;
+                            continue;
+                        }
+                        std::fill(ptr, ptr + 8, w);
+                        held.push_back(ptr);
+                        if (held.size() == depth) {
+                            for (int *p : held) {
+                                if (std::count(p, p + 8, w) != 8) {
+                                    ++corrupted;
+                                }
+                                allocator_free(slab, p, sizeof(int) * 8);
+                            }
+                            held.clear();
+                        }
+                    }
+                    for (int *p : held) {
+                        leftovers[w].push_back(p);
+                    }
+                });
+            }
+            for (auto &t : threads) {
+                t.join();
+            }
+
+            THEN("他のスレッドの領域と重ならず, 別のスレッドからも解放できること") {
+                REQUIRE(corrupted.load() == 0);
+                for (auto &v : leftovers) {
+                    for (void *p : v) {
+                        allocator_free(slab, p, sizeof(int) * 8);
+                    }
+                }
+                slab_flush();
+            }
+        }
+    }
+}
+
+SCENARIO("スラブから確保するコレクションを操作できること", "[allocator][collections]") {
+    GIVEN("スラブを使用する拡張可能な属性を用意しておく") {
+        struct collection_attr attr = COLLECTION_ATTR_HELPER(true, 0);
+        attr.allocator = &allocator_slab;
+
+        WHEN("各コレクションに初期容量を超えて要素を追加する") {
+            LIST list = list_init_attr(sizeof(int), 4, &attr);
+            STACK stack = stack_init_attr(sizeof(int), 4, &attr);
+            QUEUE que = queue_init_attr(sizeof(int), 4, &attr);
+            SET set = set_init_attr(sizeof(int), 4, &attr);
+            MAP map = map_init_attr(sizeof(int), sizeof(int), 4, &attr);
+            PQUEUE pq = pqueue_init_attr(sizeof(int), 4, compare_int, &attr);
+            TREE tree = tree_init_attr(sizeof(int), 4, &attr);
+            REQUIRE(list != NULL);
+            REQUIRE(stack != NULL);
+            REQUIRE(que != NULL);
+            REQUIRE(set != NULL);
+            REQUIRE(map != NULL);
+            REQUIRE(pq != NULL);
+            REQUIRE(tree != NULL);
+
+            for (int i = 0; i < 100; ++i) {
+                int value = i * 2;
+                REQUIRE(list_add(list, &i) != NULL);
+                REQUIRE(stack_push(stack, &i) != NULL);
+                REQUIRE(queue_enq(que, &i) != NULL);
+                REQUIRE(set_add(set, &i) != NULL);
+                REQUIRE(map_put(map, &i, &value) != NULL);
+                REQUIRE(pqueue_push(pq, &i) != NULL);
+                REQUIRE(tree_insert(tree, NULL, &i) != NULL);
+            }
+
+            THEN("すべての要素が保持されていること") {
+                int data;
+                REQUIRE(list_count(list) == 100);
+                REQUIRE(stack_count(stack) == 100);
+                REQUIRE(queue_count(que) == 100);
+                REQUIRE(set_count(set) == 100);
+                REQUIRE(map_count(map) == 100);
+                REQUIRE(pqueue_count(pq) == 100);
+                REQUIRE(tree_count(tree) == 100);
+                REQUIRE(*(int *)map_get(map, &(data = 42)) == 84);
+                REQUIRE(pqueue_pop(pq, &data) == 99);
+                REQUIRE(data == 0);
+            }
+
+            tree_release(tree);
+            pqueue_release(pq);
+            map_release(map);
+            set_release(set);
+            queue_release(que);
+            stack_release(stack);
+            list_release(list);
+        }
+
+        WHEN("コンパクト配置のツリーを初期化する") {
+            struct collection_attr fixed = COLLECTION_ATTR_INITIALIZER;
+            fixed.allocator = &allocator_slab;
+            fixed.compact = true;
+            TREE tree = tree_init_attr(sizeof(int), 8, &fixed);
+
+            THEN("容量まで要素を追加できること") {
+                REQUIRE(tree != NULL);
+                for (int i = 0; i < 8; ++i) {
+                    REQUIRE(tree_insert(tree, NULL, &i) != NULL);
+                }
+                int extra = 8;
+                REQUIRE(tree_insert(tree, NULL, &extra) == NULL);
+            }
+
+            tree_release(tree);
+        }
+    }
+}
+
+SCENARIO("既定のメモリ割り当てを差し替え, 確保を計数できること", "[allocator][default]") {
+    GIVEN("システムから確保を計数するメモリ割り当てを既定にしておく") {
+        const struct allocator *counter = allocator_counter_init(NULL);
+        REQUIRE(counter != NULL);
+        allocator_set_default(counter);
+        REQUIRE(allocator_get_default() == counter);
+
+        WHEN("属性を指定せずにコレクションを生成し, 既定を戻してから解放する") {
+            struct allocator_stats stats = ALLOCATOR_STATS_INITIALIZER;
+            LIST list = list_init(sizeof(int), 8);
+            BITSET bs = bitset_init(100);
+            CQUEUE que = cqueue_init(sizeof(int), 8);
+            REQUIRE(list != NULL);
+            REQUIRE(bs != NULL);
+            REQUIRE(que != NULL);
+            for (int i = 0; i < 8; ++i) {
+                REQUIRE(list_add(list, &i) != NULL);
+            }
+            int *array;
+            size_t count;
+            REQUIRE(list_to_array(list, (void **)&array, &count) == 0);
+            REQUIRE(count == 8);
+            REQUIRE(allocator_counter_get_stats(counter, &stats) == 0);
+            size_t allocs = stats.allocs;
+
+            allocator_set_default(NULL);
+            REQUIRE(allocator_get_default() == &allocator_system);
+            allocator_free(counter, array, sizeof(int) * count);
+            cqueue_release(que);
+            bitset_release(bs);
+            list_release(list);
+
+            THEN("生成時の既定から確保し, すべて同じメモリ割り当てに返却されること") {
+                REQUIRE(allocator_counter_get_stats(counter, &stats) == 0);
+                REQUIRE(allocs >= 6);
+                REQUIRE(stats.allocs == allocs);
+                REQUIRE(stats.frees == allocs);
+                REQUIRE(stats.failures == 0);
+                REQUIRE(stats.bytes_in_use == 0);
+                REQUIRE(stats.peak_bytes > 0);
+            }
+        }
+
+        WHEN("既定を戻し, 属性にメモリ割り当てを指定して固定容量のコレクションを生成する") {
+            allocator_set_default(NULL);
+            struct allocator_stats stats = ALLOCATOR_STATS_INITIALIZER;
+            struct collection_attr attr = COLLECTION_ATTR_INITIALIZER;
+            attr.allocator = counter;
+            BITSET bs = bitset_init_attr(100, &attr);
+            CQUEUE que = cqueue_init_attr(sizeof(int), 8, &attr);
+            CSTACK stack = cstack_init_attr(sizeof(int), 8, &attr);
+            REQUIRE(bs != NULL);
+            REQUIRE(que != NULL);
+            REQUIRE(stack != NULL);
+            REQUIRE(allocator_counter_get_stats(counter, &stats) == 0);
+            size_t allocs = stats.allocs;
+            cstack_release(stack);
+            cqueue_release(que);
+            bitset_release(bs);
+
+            THEN("指定したメモリ割り当てから確保し, すべて返却されること") {
+                REQUIRE(allocs == 5);
+                REQUIRE(allocator_counter_get_stats(counter, &stats) == 0);
+                REQUIRE(stats.frees == allocs);
+                REQUIRE(stats.bytes_in_use == 0);
+            }
+
+            THEN("拡張可能な属性は指定できないこと") {
+                attr.growable = true;
+                errno = 0;
+                REQUIRE(bitset_init_attr(100, &attr) == NULL);
+                REQUIRE(errno == EINVAL);
+                errno = 0;
+                REQUIRE(cqueue_init_attr(sizeof(int), 8, &attr) == NULL);
+                REQUIRE(errno == EINVAL);
+                errno = 0;
+                REQUIRE(cstack_init_attr(sizeof(int), 8, &attr) == NULL);
+                REQUIRE(errno == EINVAL);
+            }
+        }
+
+        WHEN("計数しないメモリ割り当ての統計情報を取得する") {
+            struct allocator_stats stats;
+
+            THEN("失敗し, errno が EINVAL となること") {
+                errno = 0;
+                REQUIRE(allocator_counter_get_stats(&allocator_system, &stats) == -1);
+                REQUIRE(errno == EINVAL);
+            }
+        }
+
+        allocator_set_default(NULL);
+        allocator_counter_release(counter);
+    }
+
+    GIVEN("割り当てなしを既定にしておく") {
+        allocator_set_default(&allocator_none);
+
+        WHEN("コレクションを生成する") {
+            errno = 0;
+            LIST list = list_init(sizeof(int), 8);
+            int list_errno = errno;
+            errno = 0;
+            BITSET bs = bitset_init(64);
+            int bitset_errno = errno;
+            allocator_set_default(NULL);
+
+            THEN("失敗し, errno が ENOMEM となること") {
+                REQUIRE(list == NULL);
+                REQUIRE(list_errno == ENOMEM);
+                REQUIRE(bs == NULL);
+                REQUIRE(bitset_errno == ENOMEM);
+            }
+        }
+
+        WHEN("生成済みの固定容量のコレクションを操作する") {
+            allocator_set_default(NULL);
+            STACK stack = stack_init(sizeof(int), 4);
+            REQUIRE(stack != NULL);
+            allocator_set_default(&allocator_none);
+            int data = 1;
+            void *pushed = stack_push(stack, &data);
+            allocator_set_default(NULL);
+
+            THEN("確保を伴わない操作は成功すること") {
+                REQUIRE(pushed != NULL);
+            }
+
+            stack_release(stack);
+        }
+
+        allocator_set_default(NULL);
+    }
+}
+
+SCENARIO("呼び出し側の領域にスタックとキューを配置できること", "[stack][queue][in_place]") {
+    GIVEN("必要なサイズの領域を用意し, 割り当てなしを既定にしておく") {
+        alignas(std::max_align_t) unsigned char stack_buf[512];
+        alignas(std::max_align_t) unsigned char queue_buf[512];
+        ssize_t stack_bytes = stack_required_size(sizeof(int), 8);
+        ssize_t queue_bytes = queue_required_size(sizeof(int), 8);
+        REQUIRE(stack_bytes > 0);
+        REQUIRE(queue_bytes > 0);
+        REQUIRE((size_t)stack_bytes <= sizeof(stack_buf));
+        REQUIRE((size_t)queue_bytes <= sizeof(queue_buf));
+        allocator_set_default(&allocator_none);
+
+        WHEN("領域に配置し, 容量まで要素を追加する") {
+            STACK stack = stack_init_in(stack_buf, (size_t)stack_bytes, sizeof(int), 8);
+            QUEUE que = queue_init_in(queue_buf, (size_t)queue_bytes, sizeof(int), 8);
+            REQUIRE(stack != NULL);
+            REQUIRE(que != NULL);
+            for (int i = 0; i < 8; ++i) {
+                REQUIRE(stack_push(stack, &i) != NULL);
+                REQUIRE(queue_enq(que, &i) != NULL);
+            }
+            int extra = 8;
+            errno = 0;
+            void *pushed = stack_push(stack, &extra);
+            int stack_errno = errno;
+            errno = 0;
+            void *enqueued = queue_enq(que, &extra);
+            int queue_errno = errno;
+
+            THEN("容量を超える追加は ENOMEM で失敗し, 格納した要素は取り出せること") {
+                REQUIRE(pushed == NULL);
+                REQUIRE(stack_errno == ENOMEM);
+                REQUIRE(enqueued == NULL);
+                REQUIRE(queue_errno == ENOMEM);
+                for (int i = 0; i < 8; ++i) {
+                    int popped = -1, dequeued = -1;
+                    REQUIRE(stack_pop(stack, &popped) == 7 - i);
+                    REQUIRE(popped == 7 - i);
+                    REQUIRE(queue_deq(que, &dequeued) == 7 - i);
+                    REQUIRE(dequeued == i);
+                }
+            }
+
+            queue_release(que);
+            stack_release(stack);
+        }
+
+        WHEN("必要なサイズに満たない領域に配置する") {
+            errno = 0;
+            STACK stack = stack_init_in(stack_buf, (size_t)stack_bytes - 1, sizeof(int), 8);
+            int stack_errno = errno;
+            errno = 0;
+            QUEUE que = queue_init_in(queue_buf, (size_t)queue_bytes - 1, sizeof(int), 8);
+            int queue_errno = errno;
+
+            THEN("失敗し, errno が ENOMEM となること") {
+                REQUIRE(stack == NULL);
+                REQUIRE(stack_errno == ENOMEM);
+                REQUIRE(que == NULL);
+                REQUIRE(queue_errno == ENOMEM);
+            }
+        }
+
+        WHEN("整列していない領域に配置する") {
+            errno = 0;
+            STACK stack = stack_init_in(stack_buf + 1, sizeof(stack_buf) - 1, sizeof(int), 8);
+            int stack_errno = errno;
+
+            THEN("失敗し, errno が EINVAL となること") {
+                REQUIRE(stack == NULL);
+                REQUIRE(stack_errno == EINVAL);
+            }
+        }
+
+        allocator_set_default(NULL);
+    }
+}
+
+namespace {
+
+struct intrusive_item {
+    int value;
+    struct ilist_link link;
+    struct itree_link node;
+};
+
+} // namespace
+
+SCENARIO("呼び出し側の構造体をリストに連結できること", "[ilist]") {
+    GIVEN("リストとリンクを埋め込んだ要素を用意する") {
+        struct ilist list = ILIST_INITIALIZER;
+        intrusive_item items[5];
+        for (int i = 0; i < 5; ++i) {
+            items[i].value = i;
+            items[i].link = ILIST_LINK_INITIALIZER;
+        }
+
+        WHEN("先頭, 末尾, 指定位置に連結する") {
+            REQUIRE(ilist_push_back(&list, &items[1].link) == 0);
+            REQUIRE(ilist_push_back(&list, &items[3].link) == 0);
+            REQUIRE(ilist_push_front(&list, &items[0].link) == 0);
+            REQUIRE(ilist_insert_before(&list, &items[3].link, &items[2].link) == 0);
+            REQUIRE(ilist_insert_before(&list, NULL, &items[4].link) == 0);
+
+            THEN("複製せずに順に辿れること") {
+                REQUIRE(ilist_count(&list) == 5);
+                int i = 0;
+                for (struct ilist_link *link = ilist_first(&list);
+                     link != NULL;
+                     link = ilist_next(link), ++i) {
+                    intrusive_item *item = COLLECTION_ENTRY(link, intrusive_item, link);
+                    REQUIRE(item == &items[i]);
+                }
+                REQUIRE(i == 5);
+                REQUIRE(ilist_last(&list) == &items[4].link);
+                REQUIRE(ilist_prev(&items[4].link) == &items[3].link);
+            }
+
+            THEN("連結済みの要素は連結できず, errno が EBUSY となること") {
+                errno = 0;
+                REQUIRE(ilist_push_back(&list, &items[2].link) == -1);
+                REQUIRE(errno == EBUSY);
+            }
+
+            THEN("途中の要素を切り離し, 再び連結できること") {
+                REQUIRE(ilist_remove(&list, &items[2].link) == 0);
+                REQUIRE(ilist_count(&list) == 4);
+                REQUIRE(ilist_next(&items[1].link) == &items[3].link);
+                errno = 0;
+                REQUIRE(ilist_remove(&list, &items[2].link) == -1);
+                REQUIRE(errno == EINVAL);
+                REQUIRE(ilist_push_front(&list, &items[2].link) == 0);
+                REQUIRE(ilist_first(&list) == &items[2].link);
+            }
+
+            THEN("先頭から順にすべて取り出せること") {
+                for (int i = 0; i < 5; ++i) {
+                    REQUIRE(ilist_pop_front(&list) == &items[i].link);
+                }
+                errno = 0;
+                REQUIRE(ilist_pop_front(&list) == NULL);
+                REQUIRE(errno == ENOENT);
+                REQUIRE(ilist_count(&list) == 0);
+                REQUIRE(ilist_first(&list) == NULL);
+                REQUIRE(ilist_last(&list) == NULL);
+            }
+        }
+    }
+}
+
+SCENARIO("呼び出し側の構造体をツリーに連結できること", "[itree]") {
+    GIVEN("ツリーとリンクを埋め込んだ要素を用意する") {
+        struct itree tree = ITREE_INITIALIZER;
+        intrusive_item items[7];
+        for (int i = 0; i < 7; ++i) {
+            items[i].value = i;
+            items[i].node = ITREE_LINK_INITIALIZER;
+        }
+
+        WHEN("2 つの最上位の要素の下に子孫を連結する") {
+            /* 0 - 1 - 2
+             *   - 3
+             * 4 - 5
+             *   - 6 */
+            REQUIRE(itree_insert(&tree, NULL, &items[0].node) == 0);
+            REQUIRE(itree_insert(&tree, &items[0].node, &items[1].node) == 0);
+            REQUIRE(itree_insert(&tree, &items[1].node, &items[2].node) == 0);
+            REQUIRE(itree_insert(&tree, &items[0].node, &items[3].node) == 0);
+            REQUIRE(itree_insert(&tree, NULL, &items[4].node) == 0);
+            REQUIRE(itree_insert(&tree, &items[4].node, &items[5].node) == 0);
+            REQUIRE(itree_insert(&tree, &items[4].node, &items[6].node) == 0);
+
+            THEN("行きがけ順に辿れ, 親子関係と世代が取得できること") {
+                const int ages[] = {1, 2, 3, 2, 1, 2, 2};
+                REQUIRE(itree_count(&tree) == 7);
+                int i = 0;
+                for (struct itree_link *link = itree_first(&tree);
+                     link != NULL;
+                     link = itree_next(&tree, link), ++i) {
+                    intrusive_item *item = COLLECTION_ENTRY(link, intrusive_item, node);
+                    REQUIRE(item->value == i);
+                    REQUIRE(itree_get_age(&tree, link) == ages[i]);
+                }
+                REQUIRE(i == 7);
+                REQUIRE(itree_parent(&tree, &items[0].node) == NULL);
+                REQUIRE(itree_parent(&tree, &items[2].node) == &items[1].node);
+                REQUIRE(itree_first_child(&items[4].node) == &items[5].node);
+                REQUIRE(itree_next_sibling(&items[1].node) == &items[3].node);
+            }
+
+            THEN("部分木を切り離すと, 子孫も未連結に戻ること") {
+                REQUIRE(itree_remove(&tree, &items[1].node) == 2);
+                REQUIRE(itree_count(&tree) == 5);
+                REQUIRE(itree_first_child(&items[0].node) == &items[3].node);
+                errno = 0;
+                REQUIRE(itree_next(&tree, &items[2].node) == NULL);
+                REQUIRE(errno == EINVAL);
+                REQUIRE(itree_insert(&tree, &items[6].node, &items[2].node) == 0);
+                REQUIRE(itree_get_age(&tree, &items[2].node) == 3);
+
+                ssize_t removed = itree_remove(&tree, &items[0].node);
+                REQUIRE(removed == 2);
+                REQUIRE(itree_remove(&tree, &items[4].node) == 4);
+                REQUIRE(itree_count(&tree) == 0);
+                REQUIRE(itree_first(&tree) == NULL);
+                errno = 0;
+                REQUIRE(itree_remove(&tree, &items[0].node) == -1);
+                REQUIRE(errno == EINVAL);
+            }
+
+            THEN("連結済みの要素や他のツリーの親には連結できないこと") {
+                struct itree other = ITREE_INITIALIZER;
+                intrusive_item extra;
+                extra.node = ITREE_LINK_INITIALIZER;
+                errno = 0;
+                REQUIRE(itree_insert(&other, NULL, &items[3].node) == -1);
+                REQUIRE(errno == EBUSY);
+                errno = 0;
+                REQUIRE(itree_insert(&other, &items[0].node, &extra.node) == -1);
+                REQUIRE(errno == EINVAL);
+            }
+        }
+    }
+}
+
+namespace {
+
+/* 1 - 11 - 111
+ *   - 12
+ * 2 - 21 */
+void check_tree_handles(TREE tree) {
+    int data[] = {1, 11, 111, 12, 2, 21};
+    TREE_NODE n1 = tree_insert_node(tree, NULL, &data[0]);
+    TREE_NODE n11 = tree_insert_node(tree, n1, &data[1]);
+    TREE_NODE n111 = tree_insert_node(tree, n11, &data[2]);
+    TREE_NODE n12 = tree_insert_node(tree, n1, &data[3]);
+    TREE_NODE n2 = tree_insert_node(tree, NULL, &data[4]);
+    TREE_NODE n21 = tree_insert_node(tree, n2, &data[5]);
+    REQUIRE(n1 != NULL);
+    REQUIRE(n11 != NULL);
+    REQUIRE(n111 != NULL);
+    REQUIRE(n12 != NULL);
+    REQUIRE(n2 != NULL);
+    REQUIRE(n21 != NULL);
+    REQUIRE(tree_count(tree) == 6);
+    REQUIRE(*(int *)tree_node_get_payload(tree, n111) == 111);
+    REQUIRE(tree_find(tree, &data[3]) == n12);
+    REQUIRE(tree_node_get_parent(tree, n111) == n11);
+    REQUIRE(tree_node_get_parent(tree, n1) == NULL);
+
+    /* 11 を部分木ごと 21 の下に移動する. */
+    REQUIRE(tree_move(tree, n11, n21) == 0);
+    REQUIRE(tree_node_get_parent(tree, n11) == n21);
+    errno = 0;
+    REQUIRE(tree_move(tree, n2, n111) == -1);
+    REQUIRE(errno == EINVAL);
+    {
+        const int values[] = {1, 12, 2, 21, 11, 111};
+        const int ages[] = {1, 2, 1, 2, 3, 4};
+        struct tree_walk walk;
+        int i = 0;
+        for (int *p = (int *)tree_walk_first(tree, &walk);
+             p != NULL;
+             p = (int *)tree_walk_next(&walk), ++i) {
+            REQUIRE(*p == values[i]);
+            REQUIRE(tree_walk_get_age(&walk) == ages[i]);
+        }
+        REQUIRE(i == 6);
+    }
+
+    /* 21 を部分木ごと削除し, 解放した要素を再利用する. */
+    REQUIRE(tree_remove(tree, n21) == 3);
+    REQUIRE(tree_count(tree) == 3);
+    errno = 0;
+    REQUIRE(tree_find(tree, &data[2]) == NULL);
+    REQUIRE(errno == ENOENT);
+    errno = 0;
+    REQUIRE(tree_remove(tree, n21) == -1);
+    REQUIRE(errno == ENOENT);
+    int added = 3;
+    TREE_NODE n3 = tree_insert_node(tree, n2, &added);
+    REQUIRE(n3 != NULL);
+    REQUIRE(tree_find(tree, &added) == n3);
+    int parent = 2;
+    added = 22;
+    REQUIRE(tree_insert(tree, &parent, &added) != NULL);
+    REQUIRE(tree_count(tree) == 5);
+    {
+        const int values[] = {1, 12, 2, 3, 22};
+        struct tree_walk walk;
+        int i = 0;
+        for (int *p = (int *)tree_walk_first(tree, &walk);
+             p != NULL;
+             p = (int *)tree_walk_next(&walk), ++i) {
+            REQUIRE(*p == values[i]);
+        }
+        REQUIRE(i == 5);
+    }
+}
+
+/* 5 (a) - 7
+ * 5 (b)
+ * 5 (c) */
+void check_tree_duplicates(TREE tree) {
+    int five = 5, seven = 7, child = 9;
+    TREE_NODE a = tree_insert_node(tree, NULL, &five);
+    TREE_NODE b = tree_insert_node(tree, NULL, &five);
+    TREE_NODE c = tree_insert_node(tree, NULL, &five);
+    REQUIRE(a != NULL);
+    REQUIRE(b != NULL);
+    REQUIRE(c != NULL);
+    REQUIRE(tree_insert_node(tree, a, &seven) != NULL);
+    REQUIRE(tree_find(tree, &five) == a);
+
+    /* 索引が指す最初の要素を削除しても, 残りの要素を探索できる. */
+    REQUIRE(tree_remove(tree, a) == 2);
+    REQUIRE(tree_find(tree, &five) == b);
+    REQUIRE(tree_insert(tree, &five, &child) != NULL);
+    REQUIRE(tree_node_get_parent(tree, tree_find(tree, &child)) == b);
+
+    /* 末尾の要素を削除した後に追加した要素も探索できる. */
+    REQUIRE(tree_remove(tree, c) == 1);
+    TREE_NODE d = tree_insert_node(tree, NULL, &five);
+    REQUIRE(d != NULL);
+    REQUIRE(tree_remove(tree, b) == 2);
+    REQUIRE(tree_find(tree, &five) == d);
+    REQUIRE(tree_remove(tree, d) == 1);
+    errno = 0;
+    REQUIRE(tree_find(tree, &five) == NULL);
+    REQUIRE(errno == ENOENT);
+    REQUIRE(tree_count(tree) == 0);
+}
+
+} // namespace
+
+SCENARIO("ハンドルでツリーの要素を移動, 削除できること", "[tree][node]") {
+    GIVEN("ツリーを容量 6 で初期化しておく") {
+        TREE tree = tree_init(sizeof(int), 6);
+        REQUIRE(tree != NULL);
+
+        THEN("ハンドルで追加, 移動, 削除ができ, 解放した要素が再利用されること") {
+            check_tree_handles(tree);
+        }
+
+        THEN("データ部が一致する要素を削除しても, 残りの要素を探索できること") {
+            check_tree_duplicates(tree);
+        }
+
+        tree_release(tree);
+    }
+
+    GIVEN("コンパクト配置のツリーを容量 6 で初期化しておく") {
+        struct collection_attr attr = COLLECTION_ATTR_INITIALIZER;
+        attr.compact = true;
+        TREE tree = tree_init_attr(sizeof(int), 6, &attr);
+        REQUIRE(tree != NULL);
+
+        THEN("ハンドルで追加, 移動, 削除ができ, 解放した要素が再利用されること") {
+            check_tree_handles(tree);
+        }
+
+        THEN("データ部が一致する要素を削除しても, 残りの要素を探索できること") {
+            check_tree_duplicates(tree);
+        }
+
+        tree_release(tree);
+    }
+}
+
+SCENARIO("ツリーを幅優先, 世代ごと, 部分木に限定して走査できること", "[tree][bfs]") {
+    GIVEN("3 世代のツリーを用意しておく") {
+        /* 1 - 11 - 111
+         *        - 112
+         *   - 12
+         * 2 - 21 - 211 */
+        TREE tree = tree_init(sizeof(int), 8);
+        REQUIRE(tree != NULL);
+        int data[] = {1, 11, 111, 112, 12, 2, 21, 211};
+        TREE_NODE n1 = tree_insert_node(tree, NULL, &data[0]);
+        TREE_NODE n11 = tree_insert_node(tree, n1, &data[1]);
+        REQUIRE(tree_insert_node(tree, n11, &data[2]) != NULL);
+        REQUIRE(tree_insert_node(tree, n11, &data[3]) != NULL);
+        REQUIRE(tree_insert_node(tree, n1, &data[4]) != NULL);
+        TREE_NODE n2 = tree_insert_node(tree, NULL, &data[5]);
+        TREE_NODE n21 = tree_insert_node(tree, n2, &data[6]);
+        REQUIRE(tree_insert_node(tree, n21, &data[7]) != NULL);
+
+        WHEN("ツリー全体を幅優先で走査する") {
+            std::vector<int> values, ages;
+            struct tree_bfs bfs;
+            REQUIRE(tree_bfs_init(&bfs, tree, NULL) == 0);
+            for (int *p = (int *)tree_bfs_next(&bfs); p != NULL; p = (int *)tree_bfs_next(&bfs)) {
+                values.push_back(*p);
+                ages.push_back(tree_bfs_get_age(&bfs));
+            }
+            tree_bfs_release(&bfs);
+
+            THEN("世代の順に取得できること") {
+                REQUIRE(values == (std::vector<int>{1, 2, 11, 12, 21, 111, 112, 211}));
+                REQUIRE(ages == (std::vector<int>{1, 1, 2, 2, 2, 3, 3, 3}));
+            }
+        }
+
+        WHEN("世代ごとに走査する") {
+            std::vector<std::vector<int>> levels;
+            std::vector<int> ages;
+            struct tree_bfs bfs;
+            struct queue_span spans[2];
+            REQUIRE(tree_bfs_init(&bfs, tree, NULL) == 0);
+            for (ssize_t n = tree_bfs_next_level(&bfs, spans);
+                 n > 0;
+                 n = tree_bfs_next_level(&bfs, spans)) {
+                std::vector<int> level;
+                for (ssize_t s = 0; s < n; ++s) {
+                    for (size_t i = 0; i < spans[s].count; ++i) {
+                        TREE_NODE node = *(TREE_NODE *)((char *)spans[s].base + (i * spans[s].stride));
+                        level.push_back(*(int *)tree_node_get_payload(tree, node));
+                    }
+                }
+                levels.push_back(level);
+                ages.push_back(tree_bfs_get_age(&bfs));
+            }
+            int end_errno = errno;
+            tree_bfs_release(&bfs);
+
+            THEN("同じ世代の要素がまとめて取得できること") {
+                REQUIRE(levels.size() == 3);
+                REQUIRE(levels[0] == (std::vector<int>{1, 2}));
+                REQUIRE(levels[1] == (std::vector<int>{11, 12, 21}));
+                REQUIRE(levels[2] == (std::vector<int>{111, 112, 211}));
+                REQUIRE(ages == (std::vector<int>{1, 2, 3}));
+                REQUIRE(end_errno == ENOENT);
+            }
+        }
+
+        WHEN("部分木に限定して走査する") {
+            std::vector<int> dfs, dfs_ages, bfs_values;
+            struct tree_walk walk;
+            for (int *p = (int *)tree_walk_first_at(tree, n1, &walk);
+                 p != NULL;
+                 p = (int *)tree_walk_next(&walk)) {
+                dfs.push_back(*p);
+                dfs_ages.push_back(tree_walk_get_age(&walk));
+            }
+            struct tree_bfs bfs;
+            REQUIRE(tree_bfs_init(&bfs, tree, n11) == 0);
+            for (int *p = (int *)tree_bfs_next(&bfs); p != NULL; p = (int *)tree_bfs_next(&bfs)) {
+                bfs_values.push_back(*p);
+            }
+            tree_bfs_release(&bfs);
+
+            THEN("部分木の外の要素は取得されないこと") {
+                REQUIRE(dfs == (std::vector<int>{1, 11, 111, 112, 12}));
+                REQUIRE(dfs_ages == (std::vector<int>{1, 2, 3, 3, 2}));
+                REQUIRE(bfs_values == (std::vector<int>{11, 111, 112}));
+            }
+        }
+
+        tree_release(tree);
+    }
+
+    GIVEN("コンパクト配置のツリーを用意しておく") {
+        struct collection_attr attr = COLLECTION_ATTR_INITIALIZER;
+        attr.compact = true;
+        TREE tree = tree_init_attr(sizeof(int), 4, &attr);
+        REQUIRE(tree != NULL);
+        int data[] = {1, 11, 12, 121};
+        TREE_NODE n1 = tree_insert_node(tree, NULL, &data[0]);
+        REQUIRE(tree_insert_node(tree, n1, &data[1]) != NULL);
+        TREE_NODE n12 = tree_insert_node(tree, n1, &data[2]);
+        REQUIRE(tree_insert_node(tree, n12, &data[3]) != NULL);
+
+        WHEN("幅優先と部分木の深さ優先で走査する") {
+            std::vector<int> bfs_values, dfs;
+            struct tree_bfs bfs;
+            REQUIRE(tree_bfs_init(&bfs, tree, NULL) == 0);
+            for (int *p = (int *)tree_bfs_next(&bfs); p != NULL; p = (int *)tree_bfs_next(&bfs)) {
+                bfs_values.push_back(*p);
+            }
+            tree_bfs_release(&bfs);
+            struct tree_walk walk;
+            for (int *p = (int *)tree_walk_first_at(tree, n12, &walk);
+                 p != NULL;
+                 p = (int *)tree_walk_next(&walk)) {
+                dfs.push_back(*p);
+            }
+
+            THEN("通常の配置と同じ順に取得できること") {
+                REQUIRE(bfs_values == (std::vector<int>{1, 11, 12, 121}));
+                REQUIRE(dfs == (std::vector<int>{12, 121}));
+            }
+        }
+
+        tree_release(tree);
+    }
+}
+
+SCENARIO("配列からコレクションを一括で構築できること", "[list][set][tree][bulk]") {
+    GIVEN("要素の配列を用意しておく") {
+        const int data[] = {5, 3, 5, 1, 3, 7};
+
+        WHEN("リストとセットを構築する") {
+            struct collection_attr indexed = COLLECTION_ATTR_INDEXED_HELPER(false, 0);
+            LIST list = list_from_array(sizeof(int), data, 6, NULL);
+            LIST ranked = list_from_array(sizeof(int), data, 6, &indexed);
+            SET set = set_from_array(sizeof(int), data, 6, NULL);
+            REQUIRE(list != NULL);
+            REQUIRE(ranked != NULL);
+            REQUIRE(set != NULL);
+
+            THEN("リストは配列の順, セットは重複を除いた順となること") {
+                std::vector<int> values, unique;
+                for (ITER iter = list_iter(list); iter != NULL; iter = iter_next(iter)) {
+                    values.push_back(*(int *)iter_get_payload(iter));
+                }
+                for (ITER iter = set_iter(set); iter != NULL; iter = iter_next(iter)) {
+                    unique.push_back(*(int *)iter_get_payload(iter));
+                }
+                REQUIRE(values == (std::vector<int>{5, 3, 5, 1, 3, 7}));
+                REQUIRE(list_count(ranked) == 6);
+                REQUIRE(*(int *)list_get(ranked, 3) == 1);
+                REQUIRE(unique == (std::vector<int>{5, 3, 1, 7}));
+                REQUIRE(set_count(set) == 4);
+                int added = 9;
+                REQUIRE(set_add(set, &added) != NULL);
+                REQUIRE(set_count(set) == 5);
+            }
+
+            set_release(set);
+            list_release(ranked);
+            list_release(list);
+        }
+    }
+
+    GIVEN("位置索引を有効にした属性と多数の要素の配列を用意しておく") {
+        struct collection_attr indexed = COLLECTION_ATTR_INDEXED_HELPER(true, 0);
+        std::vector<int> data(1000);
+        for (int i = 0; i < 1000; ++i) {
+            data[i] = i;
+        }
+
+        WHEN("配列からリストを構築する") {
+            LIST ranked = list_from_array(sizeof(int), data.data(), data.size(), &indexed);
+            REQUIRE(ranked != NULL);
+
+            THEN("位置による取得, 挿入, 削除が配列の順と一致すること") {
+                for (int i = 0; i < 1000; ++i) {
+                    REQUIRE(*(int *)list_get(ranked, i) == i);
+                }
+                int added = -1;
+                REQUIRE(list_insert(ranked, 500, &added) != NULL);
+                REQUIRE(*(int *)list_get(ranked, 500) == -1);
+                REQUIRE(*(int *)list_get(ranked, 501) == 500);
+                REQUIRE(list_remove(ranked, list_iter(ranked)) == 0);
+                REQUIRE(*(int *)list_get(ranked, 0) == 1);
+                REQUIRE(*(int *)list_get(ranked, 999) == 999);
+            }
+
+            list_release(ranked);
+        }
+    }
+
+    GIVEN("空の配列を用意しておく") {
+        WHEN("リスト, セット, ツリーを構築する") {
+            LIST list = list_from_array(sizeof(int), NULL, 0, NULL);
+            SET set = set_from_array(sizeof(int), NULL, 0, NULL);
+            TREE tree = tree_from_parent_array(sizeof(int), NULL, NULL, 0, NULL);
+
+            THEN("空のコレクションとなり, 要素を追加できること") {
+                int added = 1;
+                REQUIRE(list != NULL);
+                REQUIRE(set != NULL);
+                REQUIRE(tree != NULL);
+                REQUIRE(list_count(list) == 0);
+                REQUIRE(set_count(set) == 0);
+                REQUIRE(tree_count(tree) == 0);
+                REQUIRE(list_add(list, &added) != NULL);
+                REQUIRE(set_add(set, &added) != NULL);
+                REQUIRE(tree_insert(tree, NULL, &added) != NULL);
+            }
+
+            tree_release(tree);
+            set_release(set);
+            list_release(list);
+        }
+    }
+
+    GIVEN("要素の配列と親要素の番号の配列を用意しておく") {
+        /* 1 - 11 - 111
+         *   - 12
+         * 2 - 21 */
+        const int data[] = {1, 11, 2, 111, 12, 21};
+        const ssize_t parents[] = {-1, 0, -1, 1, 0, 2};
+
+        WHEN("通常の配置とコンパクト配置でツリーを構築する") {
+            struct collection_attr compact = COLLECTION_ATTR_INITIALIZER;
+            compact.compact = true;
+            TREE trees[] = {
+                tree_from_parent_array(sizeof(int), data, parents, 6, NULL),
+                tree_from_parent_array(sizeof(int), data, parents, 6, &compact)
+            };
+
+            THEN("行きがけ順に親子関係と世代が再現されること") {
+                for (TREE tree : trees) {
+                    REQUIRE(tree != NULL);
+                    REQUIRE(tree_count(tree) == 6);
+                    std::vector<int> values, ages;
+                    struct tree_walk walk;
+                    for (int *p = (int *)tree_walk_first(tree, &walk);
+                         p != NULL;
+                         p = (int *)tree_walk_next(&walk)) {
+                        values.push_back(*p);
+                        ages.push_back(tree_walk_get_age(&walk));
+                    }
+                    REQUIRE(values == (std::vector<int>{1, 11, 111, 12, 2, 21}));
+                    REQUIRE(ages == (std::vector<int>{1, 2, 3, 2, 1, 2}));
+                    int key = 111, parent = 11;
+                    REQUIRE(tree_node_get_parent(tree, tree_find(tree, &key))
+                            == tree_find(tree, &parent));
+                }
+            }
+
+            for (TREE tree : trees) {
+                tree_release(tree);
+            }
+        }
+
+        WHEN("親要素が自身より後ろにある配列で構築する") {
+            const ssize_t forward[] = {-1, 2, -1};
+            errno = 0;
+            TREE tree = tree_from_parent_array(sizeof(int), data, forward, 3, NULL);
+
+            THEN("失敗し, errno が EINVAL となること") {
+                REQUIRE(tree == NULL);
+                REQUIRE(errno == EINVAL);
+            }
+        }
+    }
+}
+
+SCENARIO("データ部のサイズによらず要素がノードの整列に合うこと", "[list][stack][queue][tree][align]") {
+    GIVEN("データ部が 3 バイトの拡張可能なコレクションを容量 2 で用意しておく") {
+        const struct collection_attr attr = COLLECTION_ATTR_HELPER(true, 0);
+        const struct collection_attr indexed = COLLECTION_ATTR_INDEXED_HELPER(true, 0);
+        LIST list = list_init_attr(3, 2, &attr);
+        LIST ranked = list_init_attr(3, 2, &indexed);
+        STACK stack = stack_init_attr(3, 2, &attr);
+        QUEUE queue = queue_init_attr(3, 2, &attr);
+        TREE tree = tree_init_attr(3, 2, &attr);
+        REQUIRE(list != NULL);
+        REQUIRE(ranked != NULL);
+        REQUIRE(stack != NULL);
+        REQUIRE(queue != NULL);
+        REQUIRE(tree != NULL);
+
+        WHEN("容量を超えて要素を追加する") {
+            /* ノードの直後に置くデータ部は, 少なくともノードの整列に合う. */
+            const size_t align = alignof(void *);
+            char data[3] = {1, 2, 3};
+            std::vector<void *> added;
+            for (int i = 0; i < 5; ++i) {
+                data[0] = (char)i;
+                added.push_back(list_add(list, data));
+                added.push_back(list_add(ranked, data));
+                added.push_back(stack_push(stack, data));
+                added.push_back(queue_enq(queue, data));
+                added.push_back(tree_insert(tree, NULL, data));
+            }
+
+            THEN("すべての要素のデータ部が整列していること") {
+                for (void *p : added) {
+                    REQUIRE(p != NULL);
+                    REQUIRE(((uintptr_t)p % align) == 0);
+                }
+            }
+        }
+
         tree_release(tree);
+        queue_release(queue);
+        stack_release(stack);
+        list_release(ranked);
+        list_release(list);
     }
 }
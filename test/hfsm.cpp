@@ -4,6 +4,7 @@
  *  @author t-kenji <protect.2501@gmail.com>
  *  @date   2018-03-18 新規作成.
  */
+#include <cerrno>
 #include <cstdio>
 
 #include <catch.hpp>
@@ -46,6 +47,34 @@ static void entry_only_entry(struct fsm *machine, void *data, bool cmpl)
 }
 FSM_STATE(state_entry_only, &entry_only_param, entry_only_entry, NULL, NULL);
 
+struct activity_param {
+    int step;
+    int calls;
+    bool ready;
+};
+static struct activity_param activity_param = {0, 0, false};
+static void activity_exec(struct fsm *machine, void *data)
+{
+    struct activity_param *param = (struct activity_param *)data;
+
+    ++param->calls;
+    FSM_ACTIVITY_BEGIN(machine);
+    for (param->step = 1; param->step < 3; ++param->step) {
+        FSM_ACTIVITY_YIELD(machine);
+    }
+    FSM_ACTIVITY_AWAIT(machine, param->ready);
+    param->step = 10;
+    FSM_ACTIVITY_END(machine);
+}
+FSM_STATE(state_activity, &activity_param, NULL, activity_exec, NULL);
+
+static int counting_param = 0;
+static void counting_exec(struct fsm *machine, void *data)
+{
+    ++*(int *)data;
+}
+FSM_STATE(state_counting, &counting_param, NULL, counting_exec, NULL);
+
 FSM_EVENT(event_1);
 FSM_EVENT(event_2);
 FSM_EVENT(event_3);
@@ -64,6 +93,21 @@ FSM_ACTION(action_only_action, (struct fsm *machine))
     action_only_param = true;
 }
 
+static FSM_TOKEN async_action_token = NULL;
+FSM_ASYNC_ACTION(async_action, (struct fsm *machine))
+{
+    async_action_token = fsm_action_pend(machine);
+    return async_action_token;
+}
+
+static int async_inline_result = 0;
+FSM_ASYNC_ACTION(async_inline_action, (struct fsm *machine))
+{
+    FSM_TOKEN token = fsm_action_pend(machine);
+    async_inline_result = fsm_action_complete(machine, token);
+    return token;
+}
+
 SCENARIO("状態マシンが初期化できること", "[fsm][init]") {
     GIVEN("特になし") {
         WHEN("状態遷移なしで状態マシンを初期化する") {
@@ -241,6 +285,281 @@ SCENARIO("遷移時にアクションが呼び出されること", "[fsm][action
     }
 }
 
+SCENARIO("do アクティビティが中断, 再開できること", "[fsm][activity]") {
+    GIVEN("再開可能な do アクティビティを持つ状態への遷移を定義する") {
+        const struct fsm_trans corresps[] = {
+            FSM_TRANS_HELPER(state_start, event_null, NULL, NULL, state_activity),
+            FSM_TRANS_HELPER(state_activity, event_1, NULL, NULL, state_root_with_no_handler),
+            FSM_TRANS_HELPER(state_root_with_no_handler, event_2, NULL, NULL, state_activity),
+            FSM_TRANS_TERMINATOR
+        };
+        activity_param = (struct activity_param){0, 0, false};
+        struct fsm *machine = fsm_init(NULL, corresps);
+        REQUIRE(machine != NULL);
+
+        WHEN("do アクティビティを繰り返し実行する") {
+            THEN("中断した位置から再開し, 完了後は実行されないこと") {
+                REQUIRE(fsm_activity_runnable(machine));
+                fsm_update(machine);
+                REQUIRE(activity_param.step == 1);
+                fsm_update(machine);
+                REQUIRE(activity_param.step == 2);
+                fsm_update(machine);
+                fsm_update(machine);
+                REQUIRE(activity_param.step == 3);
+                activity_param.ready = true;
+                fsm_update(machine);
+                REQUIRE(activity_param.step == 10);
+                REQUIRE_FALSE(fsm_activity_runnable(machine));
+                fsm_update(machine);
+                REQUIRE(activity_param.calls == 5);
+            }
+        }
+
+        WHEN("do アクティビティの途中で状態から出る") {
+            fsm_update(machine);
+            fsm_update(machine);
+            REQUIRE(activity_param.step == 2);
+            fsm_transition(machine, event_1);
+            fsm_transition(machine, event_2);
+
+            THEN("do アクティビティが最初から実行されること") {
+                activity_param.step = 0;
+                fsm_update(machine);
+                REQUIRE(activity_param.step == 1);
+            }
+        }
+
+        fsm_term(machine);
+    }
+}
+
+SCENARIO("実行可能な状態マシンだけが更新されること", "[fsm][sched]") {
+    GIVEN("更新スケジューラに 4 つの状態マシンを登録する") {
+        const struct fsm_trans corresps[] = {
+            FSM_TRANS_HELPER(state_start, event_null, NULL, NULL, state_root_with_no_handler),
+            FSM_TRANS_HELPER(state_root_with_no_handler, event_1, NULL, NULL, state_counting),
+            FSM_TRANS_HELPER(state_counting, event_2, NULL, NULL, state_root_with_no_handler),
+            FSM_TRANS_TERMINATOR
+        };
+        struct fsm_sched *sched = fsm_sched_init(4);
+        REQUIRE(sched != NULL);
+        struct fsm *machines[4];
+        for (int i = 0; i < 4; ++i) {
+            machines[i] = fsm_init(NULL, corresps);
+            REQUIRE(machines[i] != NULL);
+            REQUIRE(fsm_sched_attach(sched, machines[i]) == 0);
+        }
+        counting_param = 0;
+
+        WHEN("do アクティビティのない状態のまま更新する") {
+            fsm_update_all(sched);
+
+            THEN("実行可能な状態マシンがないこと") {
+                REQUIRE(fsm_sched_count(sched) == 0);
+                REQUIRE(counting_param == 0);
+            }
+        }
+
+        WHEN("2 つの状態マシンを do アクティビティのある状態に遷移させる") {
+            fsm_transition(machines[1], event_1);
+            fsm_transition(machines[3], event_1);
+            fsm_update_all(sched);
+
+            THEN("遷移させた状態マシンだけが更新されること") {
+                REQUIRE(fsm_sched_count(sched) == 2);
+                REQUIRE(counting_param == 2);
+            }
+
+            THEN("状態から出た状態マシンは更新されないこと") {
+                fsm_transition(machines[1], event_2);
+                fsm_update_all(sched);
+                REQUIRE(fsm_sched_count(sched) == 1);
+                REQUIRE(counting_param == 3);
+            }
+        }
+
+        WHEN("5 つ目の状態マシンを登録する") {
+            struct fsm *machine = fsm_init(NULL, corresps);
+
+            THEN("登録に失敗すること") {
+                REQUIRE(fsm_sched_attach(sched, machine) == -1);
+            }
+
+            fsm_term(machine);
+        }
+
+        for (int i = 0; i < 4; ++i) {
+            fsm_term(machines[i]);
+        }
+        fsm_sched_release(sched);
+    }
+}
+
+SCENARIO("非同期アクションの完了後に遷移すること", "[fsm][async]") {
+    GIVEN("非同期アクションありの状態遷移を定義する") {
+        const struct fsm_trans corresps[] = {
+            FSM_TRANS_HELPER(state_start, event_1, NULL, async_action, state_root_with_no_handler),
+            FSM_TRANS_HELPER(state_root_with_no_handler, event_2, NULL, NULL, state_root_with_no_handler2),
+            FSM_TRANS_TERMINATOR
+        };
+        struct fsm *machine = fsm_init(NULL, corresps);
+        REQUIRE(machine != NULL);
+        async_action_token = NULL;
+
+        WHEN("状態遷移にあるイベントを発生させる") {
+            fsm_transition(machine, event_1);
+
+            THEN("完了するまで遷移中となること") {
+                char name[32] = {0};
+                REQUIRE(async_action_token != NULL);
+                REQUIRE(fsm_in_flight(machine));
+                fsm_current_state(machine, name, sizeof(name));
+                REQUIRE_THAT(name, Equals("start"));
+            }
+
+            THEN("完了後に遷移し, 保留したイベントが処理されること") {
+                char name[32] = {0};
+                fsm_transition(machine, event_2);
+                REQUIRE(fsm_action_complete(machine, async_action_token) == 0);
+                REQUIRE_FALSE(fsm_in_flight(machine));
+                fsm_current_state(machine, name, sizeof(name));
+                REQUIRE_THAT(name, Equals("state_root_with_no_handler2"));
+            }
+
+            THEN("2 回目の完了は失敗すること") {
+                REQUIRE(fsm_action_complete(machine, async_action_token) == 0);
+                errno = 0;
+                REQUIRE(fsm_action_complete(machine, async_action_token) == -1);
+                REQUIRE(errno == EINVAL);
+            }
+        }
+
+        fsm_term(machine);
+    }
+
+    GIVEN("完了待ちの状態マシンに保留の上限までイベントを発生させる") {
+        const struct fsm_trans corresps[] = {
+            FSM_TRANS_HELPER(state_start, event_1, NULL, async_action, state_root_with_no_handler),
+            FSM_TRANS_TERMINATOR
+        };
+        struct fsm *machine = fsm_init(NULL, corresps);
+        REQUIRE(machine != NULL);
+        REQUIRE(fsm_transition(machine, event_1) == 0);
+        for (int i = 0; i < FSM_DEFER_MAX; ++i) {
+            REQUIRE(fsm_transition(machine, event_2) == 0);
+        }
+
+        WHEN("さらにイベントを発生させる") {
+            errno = 0;
+            int result = fsm_transition(machine, event_2);
+
+            THEN("保留できずに失敗すること") {
+                REQUIRE(result == -1);
+                REQUIRE(errno == ENOBUFS);
+                REQUIRE(fsm_action_complete(machine, async_action_token) == 0);
+            }
+        }
+
+        fsm_term(machine);
+    }
+
+    GIVEN("非同期アクションで往復する状態遷移を定義する") {
+        const struct fsm_trans corresps[] = {
+            FSM_TRANS_HELPER(state_start, event_1, NULL, async_action, state_root_with_no_handler),
+            FSM_TRANS_HELPER(state_root_with_no_handler, event_3, NULL, async_action, state_start),
+            FSM_TRANS_TERMINATOR
+        };
+        struct fsm *machine = fsm_init(NULL, corresps);
+        REQUIRE(machine != NULL);
+
+        WHEN("1 回目の遷移を完了させ, 2 回目の遷移を開始する") {
+            fsm_transition(machine, event_1);
+            FSM_TOKEN stale = async_action_token;
+            REQUIRE(fsm_action_complete(machine, stale) == 0);
+            fsm_transition(machine, event_3);
+
+            THEN("前の遷移のトークンでは完了できないこと") {
+                REQUIRE(async_action_token != stale);
+                errno = 0;
+                REQUIRE(fsm_action_complete(machine, stale) == -1);
+                REQUIRE(errno == EINVAL);
+                REQUIRE(fsm_in_flight(machine));
+                REQUIRE(fsm_action_complete(machine, async_action_token) == 0);
+                REQUIRE_FALSE(fsm_in_flight(machine));
+            }
+        }
+
+        fsm_term(machine);
+    }
+
+    GIVEN("非同期アクションの内部で完了する状態遷移を定義する") {
+        const struct fsm_trans corresps[] = {
+            FSM_TRANS_HELPER(state_start, event_1, NULL, async_inline_action, state_root_with_no_handler),
+            FSM_TRANS_TERMINATOR
+        };
+        struct fsm *machine = fsm_init(NULL, corresps);
+        REQUIRE(machine != NULL);
+        async_inline_result = -1;
+
+        WHEN("状態遷移にあるイベントを発生させる") {
+            fsm_transition(machine, event_1);
+
+            THEN("遷移中とならず, 同期的に遷移すること") {
+                char name[32] = {0};
+                REQUIRE(async_inline_result == 0);
+                REQUIRE_FALSE(fsm_in_flight(machine));
+                fsm_current_state(machine, name, sizeof(name));
+                REQUIRE_THAT(name, Equals("state_root_with_no_handler"));
+            }
+        }
+
+        fsm_term(machine);
+    }
+}
+
+SCENARIO("バッチ送信したイベントが受信箱から発生すること", "[fsm][inbox]") {
+    GIVEN("受信箱と閾値 2 のバッチ送信を用意する") {
+        const struct fsm_trans corresps[] = {
+            FSM_TRANS_HELPER(state_start, event_1, NULL, NULL, state_root_with_no_handler),
+            FSM_TRANS_HELPER(state_root_with_no_handler, event_2, NULL, NULL, state_root_with_no_handler2),
+            FSM_TRANS_HELPER(state_root_with_no_handler2, event_3, NULL, NULL, state_root_with_no_handler3),
+            FSM_TRANS_TERMINATOR
+        };
+        struct fsm *machine = fsm_init(NULL, corresps);
+        struct fsm_inbox *inbox = fsm_inbox_init(4);
+        struct fsm_batcher *batcher = fsm_batcher_init(2, 1000000);
+        REQUIRE(machine != NULL);
+        REQUIRE(inbox != NULL);
+        REQUIRE(batcher != NULL);
+
+        WHEN("3 つのイベントを送信する") {
+            REQUIRE(fsm_batcher_post(batcher, inbox, event_1) == 0);
+            REQUIRE(fsm_batcher_post(batcher, inbox, event_2) == 0);
+            REQUIRE(fsm_batcher_post(batcher, inbox, event_3) == 0);
+
+            THEN("閾値に達したイベントだけが発生すること") {
+                char name[32] = {0};
+                REQUIRE(fsm_inbox_dispatch(inbox, machine) == 2);
+                fsm_current_state(machine, name, sizeof(name));
+                REQUIRE_THAT(name, Equals("state_root_with_no_handler2"));
+            }
+
+            THEN("フラッシュ後に残りのイベントが発生すること") {
+                char name[32] = {0};
+                REQUIRE(fsm_batcher_flush(batcher) == 0);
+                REQUIRE(fsm_inbox_dispatch(inbox, machine) == 3);
+                fsm_current_state(machine, name, sizeof(name));
+                REQUIRE_THAT(name, Equals("state_root_with_no_handler3"));
+            }
+        }
+
+        fsm_batcher_release(batcher);
+        fsm_inbox_release(inbox);
+        fsm_term(machine);
+    }
+}
+
 SCENARIO("ガード条件により遷移がキャンセル中止されること", "[fsm][cond]") {
     GIVEN("ガード条件ありの遷移を定義する") {
         const struct fsm_trans corresps[] = {
@@ -277,6 +596,154 @@ SCENARIO("ガード条件により遷移がキャンセル中止されること"
     }
 }
 
+SCENARIO("状態マシンのメモリ割り当てを指定できること", "[fsm][allocator]") {
+    GIVEN("確保を計数するメモリ割り当てで状態マシンを初期化する") {
+        const struct fsm_trans corresps[] = {
+            FSM_TRANS_HELPER(state_start, event_1, NULL, NULL, state_root_with_no_handler),
+            FSM_TRANS_HELPER(state_root_with_no_handler, event_2, NULL, NULL, state_start),
+            FSM_TRANS_TERMINATOR
+        };
+        const struct allocator *counter = allocator_counter_init(&allocator_slab);
+        REQUIRE(counter != NULL);
+        struct fsm_attr attr = FSM_ATTR_INITIALIZER;
+        attr.allocator = counter;
+        struct fsm *machine = fsm_init_attr(NULL, corresps, &attr);
+        REQUIRE(machine != NULL);
+        struct allocator_stats initial = ALLOCATOR_STATS_INITIALIZER;
+        REQUIRE(allocator_counter_get_stats(counter, &initial) == 0);
+
+        WHEN("既定を割り当てなしにして状態遷移を繰り返す") {
+            allocator_set_default(&allocator_none);
+            for (int i = 0; i < 100; ++i) {
+                fsm_transition(machine, event_1);
+                fsm_update(machine);
+                fsm_transition(machine, event_2);
+            }
+            allocator_set_default(NULL);
+
+            THEN("状態遷移は確保を行わないこと") {
+                struct allocator_stats stats = ALLOCATOR_STATS_INITIALIZER;
+                char name[32] = {0};
+                fsm_current_state(machine, name, sizeof(name));
+                REQUIRE_THAT(name, Equals("start"));
+                REQUIRE(allocator_counter_get_stats(counter, &stats) == 0);
+                REQUIRE(initial.allocs > 0);
+                REQUIRE(stats.allocs == initial.allocs);
+                REQUIRE(stats.failures == 0);
+            }
+        }
+
+        WHEN("状態マシンを破棄する") {
+            fsm_term(machine);
+            machine = NULL;
+
+            THEN("確保した領域がすべて返却されること") {
+                struct allocator_stats stats = ALLOCATOR_STATS_INITIALIZER;
+                REQUIRE(allocator_counter_get_stats(counter, &stats) == 0);
+                REQUIRE(stats.frees == stats.allocs);
+                REQUIRE(stats.bytes_in_use == 0);
+            }
+        }
+
+        if (machine != NULL) {
+            fsm_term(machine);
+        }
+        allocator_counter_release(counter);
+    }
+
+    GIVEN("確保を計数するメモリ割り当てを属性に指定しておく") {
+        const struct allocator *counter = allocator_counter_init(NULL);
+        REQUIRE(counter != NULL);
+        struct fsm_attr attr = FSM_ATTR_INITIALIZER;
+        attr.allocator = counter;
+
+        WHEN("更新スケジューラ, 受信箱, バッチ送信オブジェクトを生成して破棄する") {
+            struct allocator_stats stats = ALLOCATOR_STATS_INITIALIZER;
+            struct fsm_sched *sched = fsm_sched_init_attr(4, &attr);
+            struct fsm_inbox *inbox = fsm_inbox_init_attr(4, &attr);
+            struct fsm_batcher *batcher = fsm_batcher_init_attr(4, 100, &attr);
+            REQUIRE(sched != NULL);
+            REQUIRE(inbox != NULL);
+            REQUIRE(batcher != NULL);
+            REQUIRE(allocator_counter_get_stats(counter, &stats) == 0);
+            size_t allocs = stats.allocs;
+            fsm_batcher_release(batcher);
+            fsm_inbox_release(inbox);
+            fsm_sched_release(sched);
+
+            THEN("指定したメモリ割り当てから確保し, すべて返却されること") {
+                /* スケジューラ 2, 受信箱 1 + キュー 2, バッチ送信 1. */
+                REQUIRE(allocs == 6);
+                REQUIRE(allocator_counter_get_stats(counter, &stats) == 0);
+                REQUIRE(stats.frees == allocs);
+                REQUIRE(stats.bytes_in_use == 0);
+            }
+        }
+
+        allocator_counter_release(counter);
+    }
+
+    GIVEN("割り当てなしで状態マシンを初期化する") {
+        const struct fsm_trans corresps[] = {
+            FSM_TRANS_HELPER(state_start, event_1, NULL, NULL, state_root_with_no_handler),
+            FSM_TRANS_TERMINATOR
+        };
+        const struct fsm_attr attr = FSM_ATTR_HELPER(&allocator_none);
+        errno = 0;
+        struct fsm *machine = fsm_init_attr(NULL, corresps, &attr);
+
+        THEN("失敗し, errno が ENOMEM となること") {
+            REQUIRE(machine == NULL);
+            REQUIRE(errno == ENOMEM);
+        }
+    }
+}
+
+SCENARIO("呼び出し側の領域に状態マシンを配置できること", "[fsm][in_place]") {
+    GIVEN("必要なサイズの領域を用意し, 割り当てなしを既定にしておく") {
+        const struct fsm_trans corresps[] = {
+            FSM_TRANS_HELPER(state_start, event_1, NULL, NULL, state_root_with_no_handler),
+            FSM_TRANS_HELPER(state_root_with_no_handler, event_2, NULL, NULL, state_start),
+            FSM_TRANS_TERMINATOR
+        };
+        alignas(std::max_align_t) unsigned char buffer[4096];
+        ssize_t required = fsm_required_size(NULL, corresps);
+        REQUIRE(required > 0);
+        REQUIRE((size_t)required <= sizeof(buffer));
+        allocator_set_default(&allocator_none);
+
+        WHEN("領域に状態マシンを配置し, 状態遷移を繰り返す") {
+            struct fsm *machine = fsm_init_in(buffer, (size_t)required, NULL, corresps);
+            REQUIRE(machine != NULL);
+            for (int i = 0; i < 100; ++i) {
+                fsm_transition(machine, event_1);
+                fsm_update(machine);
+                fsm_transition(machine, event_2);
+            }
+            char name[32] = {0};
+            fsm_current_state(machine, name, sizeof(name));
+            fsm_term(machine);
+
+            THEN("確保を行わずに状態遷移すること") {
+                REQUIRE((void *)machine == (void *)buffer);
+                REQUIRE_THAT(name, Equals("start"));
+            }
+        }
+
+        WHEN("必要なサイズに満たない領域に配置する") {
+            errno = 0;
+            struct fsm *machine = fsm_init_in(buffer, (size_t)required - 1, NULL, corresps);
+
+            THEN("失敗し, errno が ENOMEM となること") {
+                REQUIRE(machine == NULL);
+                REQUIRE(errno == ENOMEM);
+            }
+        }
+
+        allocator_set_default(NULL);
+    }
+}
+
 SCENARIO("状態遷移の定義をダンプする", "[fsm][dump]") {
     GIVEN("1 つの状態から複数の遷移がある定義を行う") {
         const struct fsm_trans corresps[] = {